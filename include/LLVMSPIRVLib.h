@@ -43,8 +43,13 @@
 
 #include "LLVMSPIRVOpts.h"
 
+#include <atomic>
 #include <iostream>
+#include <map>
+#include <mutex>
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace llvm {
 // Pass initialization functions need to be declared before inclusion of
@@ -66,6 +71,7 @@ void initializeSPIRVLowerBitCastToNonStandardTypeLegacyPass(PassRegistry &);
 
 class ModulePass;
 class FunctionPass;
+class raw_ostream;
 } // namespace llvm
 
 #include "llvm/IR/Module.h"
@@ -79,15 +85,11 @@ bool isSpirvBinary(const std::string &Img);
 
 #ifdef _SPIRV_SUPPORT_TEXT_FMT
 /// \brief Convert SPIR-V between binary and internal textual formats.
-/// This function is not thread safe and should not be used in multi-thread
-/// applications unless guarded by a critical section.
 /// \returns true if succeeds.
 bool convertSpirv(std::istream &IS, std::ostream &OS, std::string &ErrMsg,
                   bool FromText, bool ToText);
 
 /// \brief Convert SPIR-V between binary and internal text formats.
-/// This function is not thread safe and should not be used in multi-thread
-/// applications unless guarded by a critical section.
 bool convertSpirv(std::string &Input, std::string &Out, std::string &ErrMsg,
                   bool ToText);
 
@@ -95,6 +97,43 @@ bool convertSpirv(std::string &Input, std::string &Out, std::string &ErrMsg,
 bool isSpirvText(std::string &Img);
 #endif
 
+/// \brief Link SPIR-V binaries into one module without translating them to
+/// LLVM IR. Identical types, constants, capabilities and extensions are
+/// merged and symbols imported by one input are resolved to the definitions
+/// exported by another one through the LinkageAttributes decoration.
+/// \returns true if succeeds.
+bool linkSpirv(const std::vector<std::string> &Inputs, std::string &Out,
+               std::string &ErrMsg);
+
+/// \brief Specialize the specialization constants of a SPIR-V binary without
+/// translating it to LLVM IR. OpSpecConstant* instructions become OpConstant*
+/// ones holding the values set by TranslatorOpts::setSpecConst for their
+/// SpecId, or their default values otherwise. If \p FoldSpecConstantOps is
+/// set, integer and boolean OpSpecConstantOp instructions are evaluated too.
+/// \returns true if succeeds.
+bool specializeSpirv(const std::string &Input, const TranslatorOpts &Opts,
+                     bool FoldSpecConstantOps, std::string &Out,
+                     std::string &ErrMsg);
+
+/// Parts of a SPIR-V module that stripSpirv can remove.
+enum class StripKind : uint32_t {
+  /// OpName and OpMemberName.
+  Names,
+  /// OpLine, OpNoLine, OpString, OpModuleProcessed, the file and source text
+  /// of OpSource, and the SPIRV.debug, OpenCL.DebugInfo.100 and
+  /// NonSemantic.Shader.DebugInfo instructions.
+  Debug,
+  /// NonSemantic.AuxData instructions.
+  AuxData
+};
+
+/// \brief Remove the parts of a SPIR-V binary selected by \p Parts, a mask
+/// with the bit 1 << StripKind set for every part, without decoding the
+/// binary into a SPIRVModule. The id bound is lowered to the largest id left.
+/// \returns true if succeeds.
+bool stripSpirv(const std::string &Input, unsigned Parts, std::string &Out,
+                std::string &ErrMsg);
+
 /// \brief Load SPIR-V from istream as a SPIRVModule.
 /// \returns null on failure.
 std::unique_ptr<SPIRVModule> readSpirvModule(std::istream &IS,
@@ -139,6 +178,143 @@ SPIRVModuleTextReport formatSpirvReport(const SPIRVModuleReport &Report);
 /// \returns empty string if no known error code is found.
 std::string getErrorMessage(int ErrCode);
 
+/// \brief Content-addressed on-disk cache of translation results.
+/// Entries are keyed by a hash of the input bytes, the translation direction
+/// and the canonical form of TranslatorOpts (see getCanonicalString). Entries
+/// are written atomically and never expire by age; a hit refreshes the access
+/// time of the entry. If a size limit is given, the least recently used
+/// entries are removed once the cache grows beyond it. All member functions
+/// are thread safe.
+class TranslationCache {
+public:
+  struct Statistics {
+    uint64_t Hits = 0;
+    uint64_t Misses = 0;
+    uint64_t Stores = 0;
+  };
+
+  /// \param MaxSizeBytes upper bound for the total size of the cache, zero
+  /// means no limit and the cache is never pruned.
+  TranslationCache(const std::string &Dir, uint64_t MaxSizeBytes = 0);
+
+  /// \brief Compute the key of translating \p Input with \p Opts.
+  std::string getKey(llvm::StringRef Input, const TranslatorOpts &Opts,
+                     bool IsReverse) const;
+
+  /// \brief Look up a previously stored result.
+  /// \returns true on hit.
+  bool lookup(const std::string &Key, std::string &Result);
+
+  /// \brief Store a translation result and prune the cache if it exceeds
+  /// the size limit.
+  /// \returns true if the entry was written.
+  bool store(const std::string &Key, llvm::StringRef Result);
+
+  Statistics getStatistics() const;
+
+private:
+  std::string getEntryPath(const std::string &Key) const;
+  /// Get the total size of the entries in the cache directory.
+  uint64_t getDirectorySize() const;
+
+  std::string Dir;
+  uint64_t MaxSizeBytes;
+  /// Size of the cache directory as of the last scan plus the entries stored
+  /// since, so the directory is only scanned when it has to be pruned. Other
+  /// processes sharing the directory are only seen by the next scan.
+  std::mutex SizeMutex;
+  uint64_t CacheSize = 0;
+  bool CacheSizeKnown = false;
+  std::atomic<uint64_t> Hits{0};
+  std::atomic<uint64_t> Misses{0};
+  std::atomic<uint64_t> Stores{0};
+};
+
+/// \brief Wall time and entity counters of translations.
+///
+/// Register a report with TranslatorOpts::setTimeReport to collect the time
+/// spent in every phase (decoding, each regularization pass, type, function
+/// and debug info translation, encoding) of the translations using those
+/// options, and the number of SPIR-V instructions, types and constants they
+/// create and of the builtins they mangle. Time spent in type translation is
+/// also included in the phase that triggered it. A report accumulates all the
+/// translations it is registered with; all member functions are thread safe.
+class TranslationTimeReport {
+public:
+  enum Counter : unsigned {
+    InstructionsCreated,
+    TypesCreated,
+    ConstantsCreated,
+    BuiltinsMangled,
+    NumCounters
+  };
+
+  /// \brief Add \p Seconds of wall time to \p Phase.
+  void addTime(llvm::StringRef Phase, double Seconds);
+
+  void addCount(Counter C, uint64_t N = 1) { Counters[C] += N; }
+
+  /// \returns the accumulated wall time of \p Phase in seconds.
+  double getTime(llvm::StringRef Phase) const;
+
+  uint64_t getCount(Counter C) const { return Counters[C]; }
+
+  /// \brief Print the report as a human-readable table.
+  void print(llvm::raw_ostream &OS) const;
+
+  /// \brief Print the report as a JSON object.
+  void printJSON(llvm::raw_ostream &OS) const;
+
+private:
+  mutable std::mutex Lock;
+  // Phases in the order they were first reported.
+  std::vector<std::pair<std::string, double>> Phases;
+  std::atomic<uint64_t> Counters[NumCounters] = {};
+};
+
+/// \brief Approximate memory footprint of an in-memory SPIR-V module.
+///
+/// Bytes are attributed both to a category and to the opcode of the entry
+/// owning them. Entries are charged to the category of the entity they
+/// represent, except for the operand and literal vectors of instructions,
+/// types and constants, which are charged to OperandVectors. Entry names are
+/// charged to Names and the bookkeeping containers of the module itself to
+/// ModuleTables. Heap sizes of standard containers are estimated.
+struct SPIRVMemoryReport {
+  enum Category : unsigned {
+    Instructions,
+    OperandVectors,
+    Decorations,
+    Strings,
+    DebugInstructions,
+    Names,
+    ModuleTables,
+    NumCategories
+  };
+
+  struct Usage {
+    uint64_t Count = 0;
+    uint64_t Bytes = 0;
+  };
+
+  Usage Categories[NumCategories];
+  /// Entries and bytes by opcode, including their operands and strings.
+  std::map<uint32_t, Usage> Opcodes;
+
+  void add(Category C, uint64_t Bytes, uint64_t Count = 0) {
+    Categories[C].Bytes += Bytes;
+    Categories[C].Count += Count;
+  }
+
+  uint64_t getTotalBytes() const;
+
+  static const char *getCategoryName(Category C);
+
+  /// \brief Print the report as a human-readable table, listing the opcodes
+  /// by decreasing footprint.
+  void print(llvm::raw_ostream &OS) const;
+};
+
 } // End namespace SPIRV
 
 namespace llvm {
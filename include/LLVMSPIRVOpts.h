@@ -46,6 +46,7 @@
 #include <cstdint>
 #include <map>
 #include <optional>
+#include <string>
 #include <unordered_map>
 
 namespace llvm {
@@ -117,6 +118,9 @@ enum class DebugInfoEIS : uint32_t {
 
 enum class BuiltinFormat : uint32_t { Function, Global };
 
+class TranslationTimeReport;
+struct SPIRVMemoryReport;
+
 /// \brief Helper class to manage SPIR-V translation
 class TranslatorOpts {
 public:
@@ -157,6 +161,10 @@ public:
 
   void setMemToRegEnabled(bool Mem2Reg) { SPIRVMemToReg = Mem2Reg; }
 
+  bool isFusedLoweringEnabled() const { return FusedLowering; }
+
+  void setFusedLoweringEnabled(bool Fused) { FusedLowering = Fused; }
+
   bool preserveAuxData() const { return PreserveAuxData; }
 
   void setPreserveAuxData(bool ArgValue) { PreserveAuxData = ArgValue; }
@@ -238,12 +246,59 @@ public:
   }
   BuiltinFormat getBuiltinFormat() const noexcept { return SPIRVBuiltinFormat; }
 
+  // The following settings default to the values of the corresponding
+  // command line options, but can be set per translation so that concurrent
+  // translations in one process do not have to share them.
+
+  /// Read and write SPIR-V in the internal text format (-spirv-text).
+  bool useTextFormat() const noexcept;
+  void setUseTextFormat(bool Text) noexcept { TextFormat = Text; }
+
+  /// Print SPIR-V debug output (-spirv-debug).
+  bool isDebugOutputEnabled() const noexcept;
+  void setDebugOutputEnabled(bool Enable) noexcept { DebugOutput = Enable; }
+
+  /// Erase OpenCL metadata after it is translated (-spirv-erase-cl-md).
+  bool isEraseOCLMDEnabled() const noexcept;
+  void setEraseOCLMDEnabled(bool Erase) noexcept { EraseOCLMetadata = Erase; }
+
+  /// Lower constant expressions to instructions (-spirv-lower-const-expr).
+  bool isLowerConstExprEnabled() const noexcept;
+  void setLowerConstExprEnabled(bool Lower) noexcept { LowerConstExpr = Lower; }
+
+  /// Collect phase timings and counters into \p Report, which must outlive
+  /// the translations using these options. Null disables the collection.
+  void setTimeReport(TranslationTimeReport *Report) noexcept {
+    TimeReport = Report;
+  }
+  TranslationTimeReport *getTimeReport() const noexcept { return TimeReport; }
+
+  /// Store the memory footprint of the SPIR-V module of each translation
+  /// using these options into \p Report, replacing its previous contents. It
+  /// is taken when the module is largest: before encoding in the forward
+  /// direction, after decoding in the reverse one. Null disables it.
+  void setMemoryReport(SPIRVMemoryReport *Report) noexcept {
+    MemoryReport = Report;
+  }
+  SPIRVMemoryReport *getMemoryReport() const noexcept { return MemoryReport; }
+
+  /// Returns a canonical textual form of all the options, including the
+  /// process-wide library options which change the translation result, such
+  /// as --spirv-expand-step. Equal sets of options always produce the same
+  /// string, so it can be used as a part of a cache key. Options which only
+  /// control diagnostics (--spirv-debug, --spirv-trace, verification of the
+  /// regularization passes) are left out.
+  std::string getCanonicalString() const;
+
 private:
   // Common translation options
   VersionNumber MaxVersion = VersionNumber::MaximumVersion;
   ExtensionsStatusMap ExtStatusMap;
   // SPIRVMemToReg option affects LLVM IR regularization phase
   bool SPIRVMemToReg = false;
+  // Run the independent instruction lowerings of the regularization phase in
+  // a single traversal of the module
+  bool FusedLowering = false;
   // SPIR-V to LLVM translation options
   bool GenKernelArgNameMD = false;
   std::unordered_map<uint32_t, uint64_t> ExternalSpecialization;
@@ -284,6 +339,16 @@ private:
   bool PreserveAuxData = false;
 
   BuiltinFormat SPIRVBuiltinFormat = BuiltinFormat::Function;
+
+  // Unset optional means the command line option value is used
+  std::optional<bool> TextFormat;
+  std::optional<bool> DebugOutput;
+  std::optional<bool> EraseOCLMetadata;
+  std::optional<bool> LowerConstExpr;
+
+  // Not a part of the canonical string: it does not affect the output
+  TranslationTimeReport *TimeReport = nullptr;
+  SPIRVMemoryReport *MemoryReport = nullptr;
 };
 
 } // namespace SPIRV
@@ -43,10 +43,40 @@
 #include <llvm/ADT/SmallVector.h>
 #include <llvm/ADT/StringRef.h>
 #include <llvm/IR/IntrinsicInst.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <algorithm>
 
 using namespace llvm;
 using namespace SPIRV;
 
+// Process-wide defaults of the per-translation settings below. They are only
+// written while the command line is parsed.
+namespace SPIRV {
+extern bool SPIRVUseTextFormat;
+extern bool SPIRVDbgEnable;
+extern cl::opt<bool> EraseOCLMD;
+extern cl::opt<bool> SPIRVLowerConst;
+extern cl::opt<bool> SPIRVEnableStepExpansion;
+} // namespace SPIRV
+
+bool TranslatorOpts::useTextFormat() const noexcept {
+  return TextFormat.value_or(SPIRV::SPIRVUseTextFormat);
+}
+
+bool TranslatorOpts::isDebugOutputEnabled() const noexcept {
+  return DebugOutput.value_or(SPIRV::SPIRVDbgEnable);
+}
+
+bool TranslatorOpts::isEraseOCLMDEnabled() const noexcept {
+  return EraseOCLMetadata.value_or(SPIRV::EraseOCLMD);
+}
+
+bool TranslatorOpts::isLowerConstExprEnabled() const noexcept {
+  return LowerConstExpr.value_or(SPIRV::SPIRVLowerConst);
+}
+
 void TranslatorOpts::enableAllExtensions() {
 #define EXT(X) ExtStatusMap[ExtensionID::X] = true;
 #include "LLVMSPIRVExtensions.inc"
@@ -74,3 +104,55 @@ void TranslatorOpts::setSPIRVAllowUnknownIntrinsics(
     TranslatorOpts::ArgList IntrinsicPrefixList) noexcept {
   SPIRVAllowUnknownIntrinsics = IntrinsicPrefixList;
 }
+
+std::string TranslatorOpts::getCanonicalString() const {
+  std::string Result;
+  raw_string_ostream OS(Result);
+  OS << "version=" << static_cast<uint32_t>(MaxVersion) << ';';
+
+  // Only explicitly set extensions matter, the map is ordered by id.
+  OS << "ext=";
+  for (const auto &It : ExtStatusMap)
+    if (It.second)
+      OS << static_cast<uint32_t>(It.first) << (*It.second ? '+' : '-');
+  OS << ';';
+
+  OS << "mem2reg=" << SPIRVMemToReg << ';' << "fused=" << FusedLowering << ';'
+     << "argnamemd=" << GenKernelArgNameMD << ';';
+
+  std::vector<std::pair<uint32_t, uint64_t>> SpecConsts(
+      ExternalSpecialization.begin(), ExternalSpecialization.end());
+  std::sort(SpecConsts.begin(), SpecConsts.end());
+  OS << "specconst=";
+  for (const auto &SC : SpecConsts)
+    OS << SC.first << ':' << SC.second << ',';
+  OS << ';';
+
+  OS << "extinst=" << static_cast<uint32_t>(ExtInstValue) << ';'
+     << "bis=" << static_cast<uint32_t>(DesiredRepresentationOfBIs) << ';'
+     << "fpcontract=" << static_cast<uint32_t>(FPCMode) << ';';
+
+  OS << "unknownintrinsics=";
+  if (SPIRVAllowUnknownIntrinsics) {
+    OS << '[';
+    for (const auto &Prefix : *SPIRVAllowUnknownIntrinsics)
+      OS << Prefix.size() << ':' << Prefix << ',';
+    OS << ']';
+  }
+  OS << ';';
+
+  OS << "extradiexpr=" << AllowExtraDIExpressions << ';'
+     << "debugeis=" << static_cast<uint32_t>(DebugInfoVersion) << ';'
+     << "fmuladd2mad=" << ReplaceLLVMFmulAddWithOpenCLMad << ';'
+     << "argtypestring=" << PreserveOCLKernelArgTypeMetadataThroughString
+     << ';' << "auxdata=" << PreserveAuxData << ';'
+     << "builtinformat=" << static_cast<uint32_t>(SPIRVBuiltinFormat) << ';'
+     << "text=" << useTextFormat() << ';'
+     << "eraseoclmd=" << isEraseOCLMDEnabled() << ';'
+     << "lowerconstexpr=" << isLowerConstExprEnabled() << ';';
+
+  // Library options without a TranslatorOpts counterpart which change the
+  // output. The debug output, tracing and verification options don't.
+  OS << "stepexpansion=" << SPIRVEnableStepExpansion << ';';
+  return OS.str();
+}
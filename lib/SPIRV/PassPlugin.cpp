@@ -41,6 +41,7 @@
 #include "SPIRVLowerBitCastToNonStandardType.h"
 #include "SPIRVLowerBool.h"
 #include "SPIRVLowerConstExpr.h"
+#include "SPIRVLowerFused.h"
 #include "SPIRVLowerLLVMIntrinsic.h"
 #include "SPIRVLowerMemmove.h"
 #include "SPIRVLowerOCLBlocks.h"
@@ -98,6 +99,10 @@ PassPluginLibraryInfo getSPIRVPluginInfo() {
                 PM.addPass(SPIRVLowerConstExprPass());
                 return true;
               }
+              if (Name == "spirv-lower-fused") {
+                PM.addPass(SPIRVLowerFusedPass(TranslatorOpts{}));
+                return true;
+              }
               if (Name == "spirv-lower-memmove") {
                 PM.addPass(SPIRVLowerMemmovePass());
                 return true;
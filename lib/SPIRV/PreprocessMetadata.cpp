@@ -298,7 +298,7 @@ void PreprocessMetadataBase::preprocessOCLMetadata(Module *M, SPIRVMDBuilder *B,
                                   : spv::SourceLanguageOpenCL_C)
       .add(CLVer)
       .done();
-  if (EraseOCLMD)
+  if (Opts.isEraseOCLMDEnabled())
     B->eraseNamedMD(kSPIR2MD::OCLVer).eraseNamedMD(kSPIR2MD::SPIRVer);
 
   // !spirv.MemoryModel = !{!x}
@@ -322,10 +322,10 @@ void PreprocessMetadataBase::preprocessOCLMetadata(Module *M, SPIRVMDBuilder *B,
     for (auto &I : Exts)
       N.addOp().add(I).done();
   }
-  if (EraseOCLMD)
+  if (Opts.isEraseOCLMDEnabled())
     B->eraseNamedMD(kSPIR2MD::Extensions).eraseNamedMD(kSPIR2MD::OptFeatures);
 
-  if (EraseOCLMD)
+  if (Opts.isEraseOCLMDEnabled())
     B->eraseNamedMD(kSPIR2MD::FPContract);
 }
 
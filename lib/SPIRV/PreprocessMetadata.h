@@ -43,6 +43,7 @@
 #include "llvm/IR/PassManager.h"
 #include "llvm/Pass.h"
 
+#include "LLVMSPIRVOpts.h"
 #include "SPIRVMDBuilder.h"
 
 namespace SPIRV {
@@ -52,6 +53,8 @@ class SPIRVMDWalker;
 class PreprocessMetadataBase {
 public:
   PreprocessMetadataBase() : M(nullptr), Ctx(nullptr) {}
+  PreprocessMetadataBase(const SPIRV::TranslatorOpts &Opts)
+      : M(nullptr), Ctx(nullptr), Opts(Opts) {}
 
   bool runPreprocessMetadata(Module &M);
   void visit(Module *M);
@@ -64,6 +67,7 @@ public:
 private:
   Module *M;
   LLVMContext *Ctx;
+  SPIRV::TranslatorOpts Opts;
 };
 
 class PreprocessMetadataLegacy : public ModulePass,
@@ -81,6 +85,10 @@ class PreprocessMetadataPass
     : public llvm::PassInfoMixin<PreprocessMetadataPass>,
       public PreprocessMetadataBase {
 public:
+  PreprocessMetadataPass() = default;
+  PreprocessMetadataPass(const SPIRV::TranslatorOpts &Opts)
+      : PreprocessMetadataBase(Opts) {}
+
   llvm::PreservedAnalyses run(llvm::Module &M,
                               llvm::ModuleAnalysisManager &MAM);
 
@@ -123,8 +123,10 @@ void SPIRVLowerBoolBase::visitSIToFPInst(SIToFPInst &I) {
   handleCastInstructions(I);
 }
 
+void SPIRVLowerBoolBase::initialize(Module &M) { Context = &M.getContext(); }
+
 bool SPIRVLowerBoolBase::runLowerBool(Module &M) {
-  Context = &M.getContext();
+  initialize(M);
   visit(M);
 
   verifyRegularizationPass(M, "SPIRVLowerBool");
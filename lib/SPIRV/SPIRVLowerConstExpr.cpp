@@ -44,6 +44,7 @@
 #include "SPIRVMDWalker.h"
 #include "libSPIRV/SPIRVDebug.h"
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/StringSwitch.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/InstVisitor.h"
@@ -53,8 +54,8 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/TargetParser/Triple.h"
 
-#include <list>
-#include <set>
+#include <algorithm>
+#include <vector>
 
 using namespace llvm;
 using namespace SPIRV;
@@ -81,7 +82,7 @@ public:
 char SPIRVLowerConstExprLegacy::ID = 0;
 
 bool SPIRVLowerConstExprBase::runLowerConstExpr(Module &Module) {
-  if (!SPIRVLowerConst)
+  if (!Opts.isLowerConstExprEnabled())
     return false;
 
   M = &Module;
@@ -101,26 +102,33 @@ bool SPIRVLowerConstExprBase::runLowerConstExpr(Module &Module) {
 /// function are replaced by instructions placed in the entry block since it
 /// dominates all other BB's. Each constant expression only needs to be lowered
 /// once in each function and all uses of it by instructions in that function
-/// is replaced by one instruction.
-/// ToDo: remove redundant instructions for common subexpression
+/// is replaced by one instruction. This also holds for constant expressions
+/// that are only reachable through other lowered expressions or through
+/// metadata operands, so common subexpressions share one instruction.
 
 bool SPIRVLowerConstExprBase::visit(Module *M) {
   bool Changed = false;
   for (auto &I : M->functions()) {
-    std::list<Instruction *> WorkList;
+    // The work list is used as a stack, so seed it in reverse program order.
+    std::vector<Instruction *> WorkList;
     for (auto &BI : I) {
       for (auto &II : BI) {
         WorkList.push_back(&II);
       }
     }
+    std::reverse(WorkList.begin(), WorkList.end());
+    // Instructions already materialized for constant expressions in this
+    // function.
+    DenseMap<ConstantExpr *, Instruction *> LoweredCEs;
     auto FBegin = I.begin();
     while (!WorkList.empty()) {
-      auto *II = WorkList.front();
+      auto *II = WorkList.back();
+      WorkList.pop_back();
 
-      auto LowerOp = [&II, &FBegin, &I, &Changed](Value *V) -> Value * {
-        if (isa<Function>(V))
-          return V;
-        auto *CE = cast<ConstantExpr>(V);
+      auto LowerOp = [&](ConstantExpr *CE) -> Instruction * {
+        auto It = LoweredCEs.find(CE);
+        if (It != LoweredCEs.end())
+          return It->second;
         SPIRVDBG(dbgs() << "[lowerConstantExpressions] " << *CE;)
         auto *ReplInst = CE->getAsInstruction();
         auto *InsPoint = II->getParent() == &*FBegin ? II : &FBegin->back();
@@ -142,28 +150,26 @@ bool SPIRVLowerConstExprBase::visit(Module *M) {
               ReplInst->moveBefore(User);
           User->replaceUsesOfWith(CE, ReplInst);
         }
+        LoweredCEs[CE] = ReplInst;
+        WorkList.push_back(ReplInst);
         Changed = true;
         return ReplInst;
       };
 
-      WorkList.pop_front();
-
       for (unsigned OI = 0, OE = II->getNumOperands(); OI != OE; ++OI) {
         auto *Op = II->getOperand(OI);
         if (auto *CE = dyn_cast<ConstantExpr>(Op)) {
-          WorkList.push_front(cast<Instruction>(LowerOp(CE)));
+          // Uses in instructions created after the first lowering of CE still
+          // refer to CE, so make sure the operand is replaced.
+          II->setOperand(OI, LowerOp(CE));
         } else if (auto *MDAsVal = dyn_cast<MetadataAsValue>(Op)) {
           Metadata *MD = MDAsVal->getMetadata();
           if (auto *ConstMD = dyn_cast<ConstantAsMetadata>(MD)) {
             Constant *C = ConstMD->getValue();
-            Value *ReplInst = nullptr;
-            if (auto *CE = dyn_cast<ConstantExpr>(C))
-              ReplInst = LowerOp(CE);
-            if (ReplInst) {
-              Metadata *RepMD = ValueAsMetadata::get(ReplInst);
+            if (auto *CE = dyn_cast<ConstantExpr>(C)) {
+              Metadata *RepMD = ValueAsMetadata::get(LowerOp(CE));
               Value *RepMDVal = MetadataAsValue::get(M->getContext(), RepMD);
               II->setOperand(OI, RepMDVal);
-              WorkList.push_front(cast<Instruction>(ReplInst));
             }
           }
         }
@@ -15,6 +15,8 @@
 #ifndef SPIRV_LOWERCONSTEXPR_H
 #define SPIRV_LOWERCONSTEXPR_H
 
+#include "LLVMSPIRVOpts.h"
+
 #include "llvm/IR/PassManager.h"
 
 namespace SPIRV {
@@ -22,6 +24,8 @@ namespace SPIRV {
 class SPIRVLowerConstExprBase {
 public:
   SPIRVLowerConstExprBase() : M(nullptr), Ctx(nullptr) {}
+  SPIRVLowerConstExprBase(const SPIRV::TranslatorOpts &Opts)
+      : M(nullptr), Ctx(nullptr), Opts(Opts) {}
 
   bool runLowerConstExpr(llvm::Module &M);
   bool visit(llvm::Module *M);
@@ -29,12 +33,17 @@ public:
 private:
   llvm::Module *M;
   llvm::LLVMContext *Ctx;
+  SPIRV::TranslatorOpts Opts;
 };
 
 class SPIRVLowerConstExprPass
     : public llvm::PassInfoMixin<SPIRVLowerConstExprPass>,
       public SPIRVLowerConstExprBase {
 public:
+  SPIRVLowerConstExprPass() = default;
+  SPIRVLowerConstExprPass(const SPIRV::TranslatorOpts &Opts)
+      : SPIRVLowerConstExprBase(Opts) {}
+
   llvm::PreservedAnalyses run(llvm::Module &M,
                               llvm::ModuleAnalysisManager &MAM) {
     return runLowerConstExpr(M) ? llvm::PreservedAnalyses::none()
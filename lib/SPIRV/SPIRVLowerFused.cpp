@@ -0,0 +1,77 @@
+//===- SPIRVLowerFused.cpp - Fused instruction lowering -------------------===//
+//
+//                     The LLVM/SPIR-V Translator
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+// Copyright (c) 2024 The Khronos Group Inc.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimers.
+// Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimers in the documentation
+// and/or other materials provided with the distribution.
+// Neither the names of The Khronos Group, nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// Software without specific prior written permission.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH
+// THE SOFTWARE.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements a single instruction traversal that combines the
+// lowerings of SPIRVLowerBool, SPIRVLowerMemmove and SPIRVLowerLLVMIntrinsic.
+//
+//===----------------------------------------------------------------------===//
+#define DEBUG_TYPE "spv-lower-fused"
+
+#include "SPIRVLowerFused.h"
+#include "libSPIRV/SPIRVDebug.h"
+
+using namespace llvm;
+
+namespace SPIRV {
+
+bool SPIRVLowerFusedBase::runLowerFused(Module &M) {
+  LowerBool.initialize(M);
+  LowerMemmove.initialize(M);
+  LowerLLVMIntrinsic.initialize(M);
+  MemMoves.clear();
+
+  // The intrinsic lowering appends the emulation functions it links in to
+  // the module. In the separate pipeline only SPIRVLowerLLVMIntrinsic, which
+  // runs last, sees them, so they get the intrinsic lowering alone.
+  Function *LastOriginal = M.empty() ? nullptr : &M.getFunctionList().back();
+  auto F = M.begin();
+  for (; LastOriginal && F != M.end(); ++F) {
+    visit(*F);
+    if (&*F == LastOriginal) {
+      ++F;
+      break;
+    }
+  }
+  for (; F != M.end(); ++F)
+    LowerLLVMIntrinsic.visit(*F);
+
+  for (MemMoveInst *I : MemMoves)
+    LowerMemmove.expandMemMove(*I);
+
+  verifyRegularizationPass(M, "SPIRVLowerFused");
+  // SPIRVLowerBool always reports the module as modified.
+  return true;
+}
+
+} // namespace SPIRV
@@ -0,0 +1,105 @@
+//===- SPIRVLowerFused.h - Fused instruction lowering -----------*- C++ -*-===//
+//
+//                     The LLVM/SPIR-V Translator
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+// Copyright (c) 2024 The Khronos Group Inc.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimers.
+// Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimers in the documentation
+// and/or other materials provided with the distribution.
+// Neither the names of The Khronos Group, nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// Software without specific prior written permission.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH
+// THE SOFTWARE.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements a single instruction traversal that combines the
+// lowerings of SPIRVLowerBool, SPIRVLowerMemmove and SPIRVLowerLLVMIntrinsic.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SPIRV_SPIRVLOWERFUSED_H
+#define SPIRV_SPIRVLOWERFUSED_H
+
+#include "LLVMSPIRVOpts.h"
+#include "SPIRVLowerBool.h"
+#include "SPIRVLowerLLVMIntrinsic.h"
+#include "SPIRVLowerMemmove.h"
+
+#include "llvm/IR/InstVisitor.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/PassManager.h"
+
+#include <vector>
+
+namespace SPIRV {
+
+/// Runs the lowerings of SPIRVLowerBool, SPIRVLowerMemmove and
+/// SPIRVLowerLLVMIntrinsic during one walk over the instructions of the
+/// module instead of one walk per pass. None of them depends on the result of
+/// another, so the output is equivalent to running the passes one by one, as
+/// long as the emulation functions linked in by the intrinsic lowering are
+/// only given the intrinsic lowering, like in the separate pipeline.
+class SPIRVLowerFusedBase : public llvm::InstVisitor<SPIRVLowerFusedBase> {
+public:
+  SPIRVLowerFusedBase(const SPIRV::TranslatorOpts &Opts)
+      : LowerLLVMIntrinsic(Opts) {}
+
+  void visitTruncInst(llvm::TruncInst &I) { LowerBool.visitTruncInst(I); }
+  void visitZExtInst(llvm::ZExtInst &I) { LowerBool.visitZExtInst(I); }
+  void visitSExtInst(llvm::SExtInst &I) { LowerBool.visitSExtInst(I); }
+  void visitUIToFPInst(llvm::UIToFPInst &I) { LowerBool.visitUIToFPInst(I); }
+  void visitSIToFPInst(llvm::SIToFPInst &I) { LowerBool.visitSIToFPInst(I); }
+  // Expanding a memmove may split its basic block, which the traversal can't
+  // cope with, so memmoves are only collected here.
+  void visitMemMoveInst(llvm::MemMoveInst &I) { MemMoves.push_back(&I); }
+  void visitIntrinsicInst(llvm::IntrinsicInst &I) {
+    LowerLLVMIntrinsic.visitIntrinsicInst(I);
+  }
+
+  bool runLowerFused(llvm::Module &M);
+
+private:
+  SPIRVLowerBoolBase LowerBool;
+  SPIRVLowerMemmoveBase LowerMemmove;
+  SPIRVLowerLLVMIntrinsicBase LowerLLVMIntrinsic;
+  std::vector<llvm::MemMoveInst *> MemMoves;
+};
+
+class SPIRVLowerFusedPass : public llvm::PassInfoMixin<SPIRVLowerFusedPass>,
+                            public SPIRVLowerFusedBase {
+public:
+  SPIRVLowerFusedPass(const SPIRV::TranslatorOpts &Opts)
+      : SPIRVLowerFusedBase(Opts) {}
+
+  llvm::PreservedAnalyses run(llvm::Module &M,
+                              llvm::ModuleAnalysisManager &MAM) {
+    return runLowerFused(M) ? llvm::PreservedAnalyses::none()
+                            : llvm::PreservedAnalyses::all();
+  }
+
+  static bool isRequired() { return true; }
+};
+
+} // namespace SPIRV
+
+#endif // SPIRV_SPIRVLOWERFUSED_H
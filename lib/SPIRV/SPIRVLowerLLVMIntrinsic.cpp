@@ -37,13 +37,19 @@
 #include "SPIRVError.h"
 #include "libSPIRV/SPIRVDebug.h"
 
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
 #include "llvm/IR/InstVisitor.h"
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IRReader/IRReader.h"
 #include "llvm/Linker/Linker.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/SourceMgr.h"
 
+#include <map>
+#include <mutex>
+
 using namespace llvm;
 using namespace SPIRV;
 
@@ -122,6 +128,36 @@ const std::map<const StringRef, const LLVMIntrinsicMapValueType> LLVMIntrinsicMa
 };
 // clang-format on
 
+/// Returns the bitcode of the emulation module given by ModuleText. Parsing
+/// textual IR is expensive, so each emulation module is parsed only once per
+/// process and kept as bitcode, which can then be lazily loaded into any
+/// context. On failure, an empty string is returned and ErrMsg is set.
+StringRef getEmulationModuleBitcode(const char *ModuleText,
+                                    std::string &ErrMsg) {
+  static std::mutex CacheMutex;
+  static std::map<const char *, SmallVector<char, 0>> Cache;
+  std::lock_guard<std::mutex> Lock(CacheMutex);
+  auto Loc = Cache.find(ModuleText);
+  if (Loc != Cache.end())
+    return StringRef(Loc->second.data(), Loc->second.size());
+
+  LLVMContext Ctx;
+  SMDiagnostic Err;
+  auto MB = MemoryBuffer::getMemBuffer(ModuleText);
+  auto EmulationModule = parseIR(MB->getMemBufferRef(), Err, Ctx);
+  if (!EmulationModule) {
+    raw_string_ostream ErrStream(ErrMsg);
+    Err.print("", ErrStream);
+    return StringRef();
+  }
+
+  // Entries are never removed, so the buffer outlives the lock.
+  SmallVector<char, 0> &Bitcode = Cache[ModuleText];
+  raw_svector_ostream OS(Bitcode);
+  WriteBitcodeToFile(*EmulationModule, OS);
+  return StringRef(Bitcode.data(), Bitcode.size());
+}
+
 } // namespace
 
 void SPIRVLowerLLVMIntrinsicBase::visitIntrinsicInst(CallInst &I) {
@@ -157,21 +193,22 @@ void SPIRVLowerLLVMIntrinsicBase::visitIntrinsicInst(CallInst &I) {
       Mod->getOrInsertFunction(SPIRVFuncName, I.getFunctionType());
   I.setCalledFunction(FC);
 
-  // Read LLVM IR with the intrinsic's implementation
-  SMDiagnostic Err;
-  auto MB = MemoryBuffer::getMemBuffer(MapEntry->ModuleText);
-  auto EmulationModule = parseIR(MB->getMemBufferRef(), Err, *Context,
-                                 ParserCallbacks([&](StringRef, StringRef) {
-                                   return Mod->getDataLayoutStr();
-                                 }));
-  if (!EmulationModule) {
-    std::string ErrMsg;
-    raw_string_ostream ErrStream(ErrMsg);
-    Err.print("", ErrStream);
-    SPIRVErrorLog EL;
-    EL.checkError(false, SPIRVEC_InvalidLlvmModule, ErrMsg);
+  // Load the intrinsic's implementation. Functions are materialized lazily,
+  // so only the ones the linker needs are read from the bitcode.
+  std::string ErrMsg;
+  StringRef Bitcode = getEmulationModuleBitcode(MapEntry->ModuleText, ErrMsg);
+  SPIRVErrorLog EL;
+  if (!EL.checkError(!Bitcode.empty(), SPIRVEC_InvalidLlvmModule, ErrMsg))
+    return;
+  auto EmulationModuleOrErr = getOwningLazyBitcodeModule(
+      MemoryBuffer::getMemBuffer(Bitcode, "", false), *Context);
+  if (!EmulationModuleOrErr) {
+    EL.checkError(false, SPIRVEC_InvalidLlvmModule,
+                  toString(EmulationModuleOrErr.takeError()));
     return;
   }
+  std::unique_ptr<Module> EmulationModule = std::move(*EmulationModuleOrErr);
+  EmulationModule->setDataLayout(Mod->getDataLayout());
 
   // Link in the intrinsic's implementation.
   if (!Linker::linkModules(*Mod, std::move(EmulationModule),
@@ -179,9 +216,13 @@ void SPIRVLowerLLVMIntrinsicBase::visitIntrinsicInst(CallInst &I) {
     TheModuleIsModified = true;
 }
 
-bool SPIRVLowerLLVMIntrinsicBase::runLowerLLVMIntrinsic(Module &M) {
+void SPIRVLowerLLVMIntrinsicBase::initialize(Module &M) {
   Context = &M.getContext();
   Mod = &M;
+}
+
+bool SPIRVLowerLLVMIntrinsicBase::runLowerLLVMIntrinsic(Module &M) {
+  initialize(M);
   visit(M);
 
   verifyRegularizationPass(M, "SPIRVLowerLLVMIntrinsic");
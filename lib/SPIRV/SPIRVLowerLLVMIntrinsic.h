@@ -52,6 +52,7 @@ public:
   virtual ~SPIRVLowerLLVMIntrinsicBase() {}
   virtual void visitIntrinsicInst(llvm::CallInst &I);
 
+  void initialize(llvm::Module &M);
   bool runLowerLLVMIntrinsic(llvm::Module &M);
 
 private:
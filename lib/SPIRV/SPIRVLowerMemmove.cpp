@@ -101,25 +101,32 @@ void SPIRVLowerMemmoveBase::LowerMemMoveInst(MemMoveInst &I) {
   I.eraseFromParent();
 }
 
+void SPIRVLowerMemmoveBase::expandMemMove(MemMoveInst &I) {
+  if (!isa<ConstantInt>(I.getLength())) {
+    expandMemMoveAsLoop(&I,
+                        TargetTransformInfo(I.getModule()->getDataLayout()));
+    I.eraseFromParent();
+  } else {
+    LowerMemMoveInst(I);
+  }
+}
+
 bool SPIRVLowerMemmoveBase::expandMemMoveIntrinsicUses(Function &F) {
   bool Changed = false;
 
   for (User *U : make_early_inc_range(F.users())) {
-    MemMoveInst *Inst = cast<MemMoveInst>(U);
-    if (!isa<ConstantInt>(Inst->getLength())) {
-      expandMemMoveAsLoop(Inst,
-                          TargetTransformInfo(F.getParent()->getDataLayout()));
-      Inst->eraseFromParent();
-    } else {
-      LowerMemMoveInst(*Inst);
-    }
+    expandMemMove(*cast<MemMoveInst>(U));
     Changed = true;
   }
   return Changed;
 }
 
-bool SPIRVLowerMemmoveBase::runLowerMemmove(Module &M) {
+void SPIRVLowerMemmoveBase::initialize(Module &M) {
   Context = &M.getContext();
+}
+
+bool SPIRVLowerMemmoveBase::runLowerMemmove(Module &M) {
+  initialize(M);
   bool Changed = false;
 
   for (Function &F : M) {
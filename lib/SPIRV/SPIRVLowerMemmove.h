@@ -51,7 +51,9 @@ public:
   SPIRVLowerMemmoveBase() : Context(nullptr) {}
 
   void LowerMemMoveInst(llvm::MemMoveInst &I);
+  void expandMemMove(llvm::MemMoveInst &I);
   bool expandMemMoveIntrinsicUses(llvm::Function &F);
+  void initialize(llvm::Module &M);
   bool runLowerMemmove(llvm::Module &M);
 
 private:
@@ -47,6 +47,7 @@
 #include "SPIRVMDBuilder.h"
 #include "SPIRVMemAliasingINTEL.h"
 #include "SPIRVModule.h"
+#include "SPIRVTimeReport.h"
 #include "SPIRVToLLVMDbgTran.h"
 #include "SPIRVToOCL.h"
 #include "SPIRVType.h"
@@ -325,6 +326,8 @@ Type *SPIRVToLLVM::transType(SPIRVType *T, bool UseTPT) {
   if (Loc != TypeMap.end() && !UseTPT)
     return Loc->second;
 
+  SPIRVPhaseTimer Timer(BM->getTimeReport(), "type translation",
+                        &TypeTransDepth);
   SPIRVDBG(spvdbgs() << "[transType] " << *T << " -> ";)
   T->validate();
   switch (static_cast<SPIRVWord>(T->getOpCode())) {
@@ -620,6 +623,16 @@ std::vector<Value *>
 SPIRVToLLVM::transValue(const std::vector<SPIRVValue *> &BV, Function *F,
                         BasicBlock *BB) {
   std::vector<Value *> V;
+  V.reserve(BV.size());
+  for (auto *I : BV)
+    V.push_back(transValue(I, F, BB));
+  return V;
+}
+
+std::vector<Value *> SPIRVToLLVM::transValue(SPIRVValueRange BV, Function *F,
+                                             BasicBlock *BB) {
+  std::vector<Value *> V;
+  V.reserve(llvm::size(BV));
   for (auto *I : BV)
     V.push_back(transValue(I, F, BB));
   return V;
@@ -1000,6 +1013,8 @@ Value *SPIRVToLLVM::transValue(SPIRVValue *BV, Function *F, BasicBlock *BB,
     return Loc->second;
 
   SPIRVDBG(spvdbgs() << "[transValue] " << *BV << " -> ";)
+  SPIRVTRACE(SPIRVTC_Reader, "transValue", BV->getOpCode(),
+             BV->hasId() ? BV->getId() : 0);
   BV->validate();
 
   auto *V = transValueWithoutDecoration(BV, F, BB, CreatePlaceHolder);
@@ -2168,11 +2183,12 @@ Value *SPIRVToLLVM::transValueWithoutDecoration(SPIRVValue *BV, Function *F,
   case OpPtrEqual:
   case OpPtrNotEqual: {
     auto *BC = static_cast<SPIRVBinary *>(BV);
-    auto Ops = transValue(BC->getOperands(), F, BB);
+    Value *Ptr1 = transValue(BC->getOperand(0), F, BB);
+    Value *Ptr2 = transValue(BC->getOperand(1), F, BB);
 
     IRBuilder<> Builder(BB);
-    Value *Op1 = Builder.CreatePtrToInt(Ops[0], Type::getInt64Ty(*Context));
-    Value *Op2 = Builder.CreatePtrToInt(Ops[1], Type::getInt64Ty(*Context));
+    Value *Op1 = Builder.CreatePtrToInt(Ptr1, Type::getInt64Ty(*Context));
+    Value *Op2 = Builder.CreatePtrToInt(Ptr2, Type::getInt64Ty(*Context));
     CmpInst::Predicate P =
         OC == OpPtrEqual ? ICmpInst::ICMP_EQ : ICmpInst::ICMP_NE;
     Value *V = Builder.CreateICmp(P, Op1, Op2);
@@ -2181,15 +2197,16 @@ Value *SPIRVToLLVM::transValueWithoutDecoration(SPIRVValue *BV, Function *F,
 
   case OpPtrDiff: {
     auto *BC = static_cast<SPIRVBinary *>(BV);
-    auto Ops = transValue(BC->getOperands(), F, BB);
+    Value *Ptr1 = transValue(BC->getOperand(0), F, BB);
+    Value *Ptr2 = transValue(BC->getOperand(1), F, BB);
     IRBuilder<> Builder(BB);
-    Value *V = Builder.CreatePtrDiff(transType(BC->getType()), Ops[0], Ops[1]);
+    Value *V = Builder.CreatePtrDiff(transType(BC->getType()), Ptr1, Ptr2);
     return mapValue(BV, V);
   }
 
   case OpCompositeConstruct: {
     auto *CC = static_cast<SPIRVCompositeConstruct *>(BV);
-    auto Constituents = transValue(CC->getOperands(), F, BB);
+    auto Constituents = transValue(CC->getOperandRange(), F, BB);
     std::vector<Constant *> CV;
     bool HasRtValues = false;
     for (const auto &I : Constituents) {
@@ -2384,7 +2401,7 @@ Value *SPIRVToLLVM::transValueWithoutDecoration(SPIRVValue *BV, Function *F,
 
   case OpFunctionCall: {
     SPIRVFunctionCall *BC = static_cast<SPIRVFunctionCall *>(BV);
-    std::vector<Value *> Args = transValue(BC->getArgumentValues(), F, BB);
+    std::vector<Value *> Args = transValue(BC->getArgumentValueRange(), F, BB);
     auto *Call = CallInst::Create(transFunction(BC->getFunction()), Args,
                                   BC->getName(), BB);
     setCallingConv(Call);
@@ -2403,7 +2420,8 @@ Value *SPIRVToLLVM::transValueWithoutDecoration(SPIRVValue *BV, Function *F,
     auto *SpirvFnTy = BC->getCalledValue()->getType()->getPointerElementType();
     auto *FnTy = cast<FunctionType>(transType(SpirvFnTy));
     auto *Call = CallInst::Create(
-        FnTy, V, transValue(BC->getArgumentValues(), F, BB), BC->getName(), BB);
+        FnTy, V, transValue(BC->getArgumentValueRange(), F, BB), BC->getName(),
+        BB);
     transFunctionPointerCallArgumentAttributes(
         BV, Call, static_cast<SPIRVTypeFunction *>(SpirvFnTy));
     // Assuming we are calling a regular device function
@@ -2888,7 +2906,7 @@ Value *SPIRVToLLVM::transArbFloatInst(SPIRVInstruction *BI, BasicBlock *BB,
   // Words contain:
   // A<id> [Literal MA] [B<id>] [Literal MB] [Literal Mout] [Literal Sign]
   //   [Literal EnableSubnormals Literal RoundingMode Literal RoundingAccuracy]
-  const std::vector<SPIRVWord> Words = Inst->getOpWords();
+  ArrayRef<SPIRVWord> Words = Inst->getOpWords();
   auto WordsItr = Words.begin() + 1; /* Skip word for A input id */
 
   SmallVector<Type *, 8> ArgTys;
@@ -3028,8 +3046,7 @@ Function *SPIRVToLLVM::transFunction(SPIRVFunction *BF) {
     // search for a previous function with the same name
     // upgrade it to a kernel and drop this if it's found
     for (auto &I : FuncMap) {
-      auto BFName = I.getFirst()->getName();
-      if (BF->getName() == BFName) {
+      if (BF->hasSameName(I.getFirst())) {
         auto *F = I.getSecond();
         F->setCallingConv(CallingConv::SPIR_KERNEL);
         F->setLinkage(GlobalValue::ExternalLinkage);
@@ -3119,7 +3136,7 @@ CallInst *SPIRVToLLVM::transAsmCallINTEL(SPIRVAsmCallINTEL *BI, Function *F,
                                          BasicBlock *BB) {
   assert(BI);
   auto *IA = cast<InlineAsm>(transValue(BI->getAsm(), F, BB));
-  auto Args = transValue(BM->getValues(BI->getArguments()), F, BB);
+  auto Args = transValue(BM->getValueRange(BI->getArguments()), F, BB);
   return CallInst::Create(cast<FunctionType>(IA->getFunctionType()), IA, Args,
                           BI->getName(), BB);
 }
@@ -3351,7 +3368,7 @@ std::string getSPIRVFuncSuffix(SPIRVInstruction *BI) {
   if (BI->getOpCode() == OpBuildNDRange) {
     Suffix += kSPIRVPostfix::Divider;
     auto *NDRangeInst = static_cast<SPIRVBuildNDRange *>(BI);
-    auto *EleTy = ((NDRangeInst->getOperands())[0])->getType();
+    auto *EleTy = NDRangeInst->getOperand(0)->getType();
     int Dim = EleTy->isTypeArray() ? EleTy->getArrayLength() : 1;
     assert((EleTy->isTypeInt() && Dim == 1) ||
            (EleTy->isTypeArray() && Dim >= 2 && Dim <= 3));
@@ -3439,17 +3456,21 @@ bool SPIRVToLLVM::translate() {
   if (!transAddressingModel())
     return false;
 
-  // Entry Points should be translated before all debug intrinsics.
-  for (SPIRVExtInst *EI : BM->getDebugInstVec()) {
-    if (EI->getExtOp() == SPIRVDebug::EntryPoint)
-      DbgTran->transDebugInst(EI);
-  }
+  TranslationTimeReport *TimeReport = BM->getTimeReport();
+  {
+    SPIRVPhaseTimer Timer(TimeReport, "debug info translation");
+    // Entry Points should be translated before all debug intrinsics.
+    for (SPIRVExtInst *EI : BM->getDebugInstVec()) {
+      if (EI->getExtOp() == SPIRVDebug::EntryPoint)
+        DbgTran->transDebugInst(EI);
+    }
 
-  // Compile unit might be needed during translation of debug intrinsics.
-  for (SPIRVExtInst *EI : BM->getDebugInstVec()) {
-    // Translate Compile Units first.
-    if (EI->getExtOp() == SPIRVDebug::CompilationUnit)
-      DbgTran->transDebugInst(EI);
+    // Compile unit might be needed during translation of debug intrinsics.
+    for (SPIRVExtInst *EI : BM->getDebugInstVec()) {
+      // Translate Compile Units first.
+      if (EI->getExtOp() == SPIRVDebug::CompilationUnit)
+        DbgTran->transDebugInst(EI);
+    }
   }
 
   for (unsigned I = 0, E = BM->getNumVariables(); I != E; ++I) {
@@ -3459,14 +3480,20 @@ bool SPIRVToLLVM::translate() {
     transGlobalCtorDtors(BV);
   }
 
-  // Then translate all debug instructions.
-  for (SPIRVExtInst *EI : BM->getDebugInstVec()) {
-    DbgTran->transDebugInst(EI);
+  {
+    SPIRVPhaseTimer Timer(TimeReport, "debug info translation");
+    // Then translate all debug instructions.
+    for (SPIRVExtInst *EI : BM->getDebugInstVec()) {
+      DbgTran->transDebugInst(EI);
+    }
   }
 
-  for (unsigned I = 0, E = BM->getNumFunctions(); I != E; ++I) {
-    transFunction(BM->getFunction(I));
-    transUserSemantic(BM->getFunction(I));
+  {
+    SPIRVPhaseTimer Timer(TimeReport, "function translation");
+    for (unsigned I = 0, E = BM->getNumFunctions(); I != E; ++I) {
+      transFunction(BM->getFunction(I));
+      transUserSemantic(BM->getFunction(I));
+    }
   }
 
   transGlobalAnnotations();
@@ -3495,6 +3522,7 @@ bool SPIRVToLLVM::translate() {
 
   eraseUselessFunctions(M);
 
+  SPIRVPhaseTimer Timer(TimeReport, "debug info translation");
   DbgTran->addDbgInfoVersion();
   DbgTran->finalize();
 
@@ -4927,12 +4955,11 @@ std::optional<SPIRVModuleReport> getSpirvReport(std::istream &IS) {
   return getSpirvReport(IS, IgnoreErrCode);
 }
 
-std::optional<SPIRVModuleReport> getSpirvReport(std::istream &IS,
-                                                int &ErrCode) {
+template <typename FormatTy>
+static std::optional<SPIRVModuleReport>
+readSpirvReport(SPIRVDecoder<FormatTy> &D, int &ErrCode) {
   SPIRVWord Word;
   std::string Name;
-  std::unique_ptr<SPIRVModule> BM(SPIRVModule::createSPIRVModule());
-  SPIRVDecoder D(IS, *BM);
   D >> Word;
   if (Word != MagicNumber) {
     ErrCode = SPIRVEC_InvalidMagicNumber;
@@ -4949,7 +4976,7 @@ std::optional<SPIRVModuleReport> getSpirvReport(std::istream &IS,
   D.ignore(3);
 
   bool IsReportGenCompleted = false, IsMemoryModelDefined = false;
-  while (!IS.bad() && !IsReportGenCompleted && D.getWordCountAndOpCode()) {
+  while (!D.IS.bad() && !IsReportGenCompleted && D.getWordCountAndOpCode()) {
     switch (D.OpCode) {
     case OpCapability:
       D >> Word;
@@ -4992,7 +5019,7 @@ std::optional<SPIRVModuleReport> getSpirvReport(std::istream &IS,
       IsReportGenCompleted = true;
     }
   }
-  if (IS.bad()) {
+  if (D.IS.bad()) {
     ErrCode = SPIRVEC_InvalidModule;
     return {};
   }
@@ -5004,6 +5031,20 @@ std::optional<SPIRVModuleReport> getSpirvReport(std::istream &IS,
   return std::make_optional(std::move(Report));
 }
 
+std::optional<SPIRVModuleReport> getSpirvReport(std::istream &IS,
+                                                int &ErrCode) {
+  std::unique_ptr<SPIRVModule> BM(SPIRVModule::createSPIRVModule());
+  SPIRVDbgScope DbgScope(BM->isDebugOutputEnabled());
+#ifdef _SPIRV_SUPPORT_TEXT_FMT
+  if (BM->isTextFormat()) {
+    SPIRVTextDecoder D(IS, *BM);
+    return readSpirvReport(D, ErrCode);
+  }
+#endif
+  SPIRVBinaryDecoder D(IS, *BM);
+  return readSpirvReport(D, ErrCode);
+}
+
 constexpr std::string_view formatAddressingModel(uint32_t AddrModel) {
   switch (AddrModel) {
   case AddressingModelLogical:
@@ -5058,11 +5099,16 @@ std::unique_ptr<SPIRVModule> readSpirvModule(std::istream &IS,
                                              std::string &ErrMsg) {
   std::unique_ptr<SPIRVModule> BM(SPIRVModule::createSPIRVModule(Opts));
 
-  IS >> *BM;
+  {
+    SPIRVPhaseTimer Timer(Opts.getTimeReport(), "decode");
+    IS >> *BM;
+  }
   if (!BM->isModuleValid()) {
     BM->getError(ErrMsg);
     return nullptr;
   }
+  if (SPIRVMemoryReport *Report = Opts.getMemoryReport())
+    *Report = BM->getMemoryReport();
   return BM;
 }
 
@@ -5079,6 +5125,8 @@ llvm::convertSpirvToLLVM(LLVMContext &C, SPIRVModule &BM,
                          const SPIRV::TranslatorOpts &Opts,
                          std::string &ErrMsg) {
   std::unique_ptr<Module> M(new Module("", C));
+  SPIRVTimeReportScope TimeReportScope(Opts.getTimeReport());
+  SPIRVDbgScope DbgScope(BM.isDebugOutputEnabled());
 
   SPIRVToLLVM BTL(M.get(), &BM);
 
@@ -5087,10 +5135,14 @@ llvm::convertSpirvToLLVM(LLVMContext &C, SPIRVModule &BM,
     return nullptr;
   }
 
+  llvm::PassInstrumentationCallbacks PIC;
+  SPIRVPassTimeReporter PassTimes(Opts.getTimeReport());
+  PassTimes.registerCallbacks(PIC);
+
   llvm::ModulePassManager PassMgr;
   addSPIRVBIsLoweringPass(PassMgr, Opts.getDesiredBIsRepresentation());
   llvm::ModuleAnalysisManager MAM;
-  MAM.registerPass([&] { return PassInstrumentationAnalysis(); });
+  MAM.registerPass([&] { return PassInstrumentationAnalysis(&PIC); });
   PassMgr.run(*M, MAM);
 
   return M;
@@ -5129,11 +5181,9 @@ bool llvm::readSpirv(LLVMContext &C, const SPIRV::TranslatorOpts &Opts,
   return true;
 }
 
-bool llvm::getSpecConstInfo(std::istream &IS,
-                            std::vector<SpecConstInfoTy> &SpecConstInfo) {
-  std::unique_ptr<SPIRVModule> BM(SPIRVModule::createSPIRVModule());
-  BM->setAutoAddExtensions(false);
-  SPIRVDecoder D(IS, *BM);
+template <typename FormatTy>
+static bool readSpecConstInfo(SPIRVModule *BM, SPIRVDecoder<FormatTy> &D,
+                              std::vector<SpecConstInfoTy> &SpecConstInfo) {
   SPIRVWord Magic;
   D >> Magic;
   if (!BM->getErrorLog().checkError(Magic == MagicNumber, SPIRVEC_InvalidModule,
@@ -5207,7 +5257,22 @@ bool llvm::getSpecConstInfo(std::istream &IS,
       D.ignoreInstruction();
     }
   }
-  return !IS.bad();
+  return !D.IS.bad();
+}
+
+bool llvm::getSpecConstInfo(std::istream &IS,
+                            std::vector<SpecConstInfoTy> &SpecConstInfo) {
+  std::unique_ptr<SPIRVModule> BM(SPIRVModule::createSPIRVModule());
+  BM->setAutoAddExtensions(false);
+  SPIRVDbgScope DbgScope(BM->isDebugOutputEnabled());
+#ifdef _SPIRV_SUPPORT_TEXT_FMT
+  if (BM->isTextFormat()) {
+    SPIRVTextDecoder D(IS, *BM);
+    return readSpecConstInfo(BM.get(), D, SpecConstInfo);
+  }
+#endif
+  SPIRVBinaryDecoder D(IS, *BM);
+  return readSpecConstInfo(BM.get(), D, SpecConstInfo);
 }
 
 // clang-format off
@@ -103,6 +103,7 @@ public:
   void transAuxDataInst(SPIRVExtInst *BC);
   std::vector<Value *> transValue(const std::vector<SPIRVValue *> &,
                                   Function *F, BasicBlock *);
+  std::vector<Value *> transValue(SPIRVValueRange, Function *F, BasicBlock *);
   Function *transFunction(SPIRVFunction *F);
   void transFunctionAttrs(SPIRVFunction *BF, Function *F);
   Value *transBlockInvoke(SPIRVValue *Invoke, BasicBlock *BB);
@@ -175,6 +176,8 @@ private:
   SPIRVBlockToLLVMStructMap BlockMap;
   SPIRVToLLVMPlaceholderMap PlaceholderMap;
   std::unique_ptr<SPIRVToLLVMDbgTran> DbgTran;
+  // Nesting level of transType calls, only the outermost one is timed
+  unsigned TypeTransDepth = 0;
   // GlobalAnnotations collects array of annotation entries for global variables
   // and functions. They are used in translation of llvm.global.annotations
   // instruction.
@@ -0,0 +1,184 @@
+//===- SPIRVTimeReport.cpp - Translation phase timing ---------------------===//
+//
+//                     The LLVM/SPIR-V Translator
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+// Copyright (c) 2024 The Khronos Group Inc.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimers.
+// Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimers in the documentation
+// and/or other materials provided with the distribution.
+// Neither the names of The Khronos Group, nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// Software without specific prior written permission.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH
+// THE SOFTWARE.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements TranslationTimeReport and the helpers that fill it
+// during a translation.
+//
+//===----------------------------------------------------------------------===//
+
+#include "SPIRVTimeReport.h"
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/IR/PassInstrumentation.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+
+using namespace llvm;
+using namespace SPIRV;
+
+namespace {
+const char *const CounterNames[TranslationTimeReport::NumCounters] = {
+    "instructions", "types", "constants", "builtins_mangled"};
+
+const char *const CounterDescs[TranslationTimeReport::NumCounters] = {
+    "SPIR-V instructions created", "SPIR-V types created",
+    "SPIR-V constants created", "builtins mangled"};
+
+thread_local TranslationTimeReport *ThreadTimeReport = nullptr;
+} // namespace
+
+void TranslationTimeReport::addTime(StringRef Phase, double Seconds) {
+  std::lock_guard<std::mutex> Guard(Lock);
+  auto It = std::find_if(Phases.begin(), Phases.end(),
+                         [&](const auto &P) { return P.first == Phase; });
+  if (It == Phases.end())
+    Phases.emplace_back(Phase.str(), Seconds);
+  else
+    It->second += Seconds;
+}
+
+double TranslationTimeReport::getTime(StringRef Phase) const {
+  std::lock_guard<std::mutex> Guard(Lock);
+  for (const auto &P : Phases)
+    if (P.first == Phase)
+      return P.second;
+  return 0;
+}
+
+void TranslationTimeReport::print(raw_ostream &OS) const {
+  std::lock_guard<std::mutex> Guard(Lock);
+  OS << "===- SPIR-V translation time report -===\n"
+     << "  Wall time (s)  Phase\n";
+  for (const auto &P : Phases)
+    OS << format("  %13.6f", P.second) << "  " << P.first << '\n';
+  OS << "  Count          Counter\n";
+  for (unsigned C = 0; C != NumCounters; ++C)
+    OS << format("  %13llu",
+                 static_cast<unsigned long long>(Counters[C].load()))
+       << "  " << CounterDescs[C] << '\n';
+}
+
+void TranslationTimeReport::printJSON(raw_ostream &OS) const {
+  std::lock_guard<std::mutex> Guard(Lock);
+  json::OStream J(OS, /*IndentSize=*/2);
+  J.object([&] {
+    J.attributeArray("phases", [&] {
+      for (const auto &P : Phases)
+        J.object([&] {
+          J.attribute("name", P.first);
+          J.attribute("seconds", P.second);
+        });
+    });
+    J.attributeObject("counters", [&] {
+      for (unsigned C = 0; C != NumCounters; ++C)
+        J.attribute(CounterNames[C], static_cast<int64_t>(Counters[C].load()));
+    });
+  });
+  OS << '\n';
+}
+
+SPIRVPhaseTimer::SPIRVPhaseTimer(TranslationTimeReport *Report,
+                                 StringRef Phase, unsigned *Depth)
+    : Report(Report), Phase(Phase), Depth(Report ? Depth : nullptr) {
+  if (!Report)
+    return;
+  if (Depth && (*Depth)++) {
+    // Nested in a timer of the same phase, which measures this one too.
+    this->Report = nullptr;
+    return;
+  }
+  Start = std::chrono::steady_clock::now();
+}
+
+SPIRVPhaseTimer::~SPIRVPhaseTimer() {
+  if (Depth)
+    --*Depth;
+  if (!Report)
+    return;
+  std::chrono::duration<double> Elapsed =
+      std::chrono::steady_clock::now() - Start;
+  Report->addTime(Phase, Elapsed.count());
+}
+
+SPIRVTimeReportScope::SPIRVTimeReportScope(TranslationTimeReport *Report)
+    : Saved(ThreadTimeReport) {
+  ThreadTimeReport = Report;
+}
+
+SPIRVTimeReportScope::~SPIRVTimeReportScope() { ThreadTimeReport = Saved; }
+
+TranslationTimeReport *SPIRV::getThreadTimeReport() { return ThreadTimeReport; }
+
+SPIRVPassTimeReporter::SPIRVPassTimeReporter(TranslationTimeReport *Report,
+                                             ArrayRef<StringRef> Ignored)
+    : Report(Report), Ignored(Ignored.begin(), Ignored.end()) {}
+
+bool SPIRVPassTimeReporter::isIgnored(StringRef PassID) const {
+  return isSpecialPass(PassID, {"PassManager", "PassAdaptor",
+                                "AnalysisManagerProxy"}) ||
+         is_contained(Ignored, PassID);
+}
+
+void SPIRVPassTimeReporter::startPass(StringRef PassID) {
+  if (!isIgnored(PassID))
+    Starts.push_back(std::chrono::steady_clock::now());
+}
+
+void SPIRVPassTimeReporter::stopPass(StringRef PassID) {
+  if (isIgnored(PassID))
+    return;
+  assert(!Starts.empty() && "Pass stopped before it started");
+  std::chrono::duration<double> Elapsed =
+      std::chrono::steady_clock::now() - Starts.pop_back_val();
+  Report->addTime(("pass: " + PassID).str(), Elapsed.count());
+}
+
+void SPIRVPassTimeReporter::registerCallbacks(
+    PassInstrumentationCallbacks &PIC) {
+  if (!Report)
+    return;
+  PIC.registerBeforeNonSkippedPassCallback(
+      [this](StringRef PassID, Any) { startPass(PassID); });
+  PIC.registerAfterPassCallback(
+      [this](StringRef PassID, Any, const PreservedAnalyses &) {
+        stopPass(PassID);
+      });
+  PIC.registerAfterPassInvalidatedCallback(
+      [this](StringRef PassID, const PreservedAnalyses &) {
+        stopPass(PassID);
+      });
+}
@@ -0,0 +1,116 @@
+//===- SPIRVTimeReport.h - Translation phase timing -------------*- C++ -*-===//
+//
+//                     The LLVM/SPIR-V Translator
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+// Copyright (c) 2024 The Khronos Group Inc.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimers.
+// Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimers in the documentation
+// and/or other materials provided with the distribution.
+// Neither the names of The Khronos Group, nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// Software without specific prior written permission.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH
+// THE SOFTWARE.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares helpers that record the wall time of translation phases
+// and translation counters into a SPIRV::TranslationTimeReport.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SPIRV_SPIRVTIMEREPORT_H
+#define SPIRV_SPIRVTIMEREPORT_H
+
+#include "LLVMSPIRVLib.h"
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+
+#include <chrono>
+
+namespace llvm {
+class PassInstrumentationCallbacks;
+} // namespace llvm
+
+namespace SPIRV {
+
+/// Adds the wall time of its lifetime to a phase of \p Report, if there is a
+/// report. Recursive phases share a \p Depth counter, so that only the
+/// outermost timer of a nest measures.
+class SPIRVPhaseTimer {
+public:
+  SPIRVPhaseTimer(TranslationTimeReport *Report, llvm::StringRef Phase,
+                  unsigned *Depth = nullptr);
+  ~SPIRVPhaseTimer();
+  SPIRVPhaseTimer(const SPIRVPhaseTimer &) = delete;
+  SPIRVPhaseTimer &operator=(const SPIRVPhaseTimer &) = delete;
+
+private:
+  TranslationTimeReport *Report;
+  llvm::StringRef Phase;
+  unsigned *Depth;
+  std::chrono::steady_clock::time_point Start;
+};
+
+/// Makes \p Report the report of the current thread for the lifetime of the
+/// object. Code that has no access to the translator options, such as the
+/// builtin mangler, updates its counters through getThreadTimeReport().
+class SPIRVTimeReportScope {
+public:
+  explicit SPIRVTimeReportScope(TranslationTimeReport *Report);
+  ~SPIRVTimeReportScope();
+  SPIRVTimeReportScope(const SPIRVTimeReportScope &) = delete;
+  SPIRVTimeReportScope &operator=(const SPIRVTimeReportScope &) = delete;
+
+private:
+  TranslationTimeReport *Saved;
+};
+
+/// \returns the report installed for the current thread, or null.
+TranslationTimeReport *getThreadTimeReport();
+
+/// Records the wall time of every pass of a pipeline as the "pass: <name>"
+/// phase, similarly to llvm::TimePassesHandler. Passes listed in \p Ignored
+/// are not recorded, which lets a pipeline report the phases of such a pass
+/// separately.
+class SPIRVPassTimeReporter {
+public:
+  SPIRVPassTimeReporter(TranslationTimeReport *Report,
+                        llvm::ArrayRef<llvm::StringRef> Ignored = {});
+
+  void registerCallbacks(llvm::PassInstrumentationCallbacks &PIC);
+
+private:
+  void startPass(llvm::StringRef PassID);
+  void stopPass(llvm::StringRef PassID);
+  bool isIgnored(llvm::StringRef PassID) const;
+
+  TranslationTimeReport *Report;
+  llvm::SmallVector<llvm::StringRef, 2> Ignored;
+  // Start times of the passes being run, passes may nest through adaptors.
+  llvm::SmallVector<std::chrono::steady_clock::time_point, 4> Starts;
+};
+
+} // namespace SPIRV
+
+#endif // SPIRV_SPIRVTIMEREPORT_H
@@ -0,0 +1,196 @@
+//===- SPIRVTranslationCache.cpp - On-disk translation cache --------------===//
+//
+//                     The LLVM/SPIR-V Translator
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+// Copyright (c) 2024 The Khronos Group Inc.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimers.
+// Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimers in the documentation
+// and/or other materials provided with the distribution.
+// Neither the names of The Khronos Group, nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// Software without specific prior written permission.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH
+// THE SOFTWARE.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements a content-addressed on-disk cache of translation
+// results. Entries are named "llvmcache-<hash>" so that the cache directory
+// can be pruned with LLVM's CachePruning facility.
+//
+//===----------------------------------------------------------------------===//
+
+#include "LLVMSPIRVLib.h"
+
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/CachePruning.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/SHA256.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+using namespace SPIRV;
+
+// Set by the build to the version and the VCS revision of the translator.
+#ifndef LLVM_SPIRV_VERSION
+#define LLVM_SPIRV_VERSION ""
+#endif
+#ifndef LLVM_SPIRV_REVISION
+#define LLVM_SPIRV_REVISION ""
+#endif
+
+namespace {
+// Bump whenever the layout of cache entries or keys changes.
+const char CacheFormatVersion[] = "spirv-translation-cache-4";
+const char EntryPrefix[] = "llvmcache-";
+} // namespace
+
+TranslationCache::TranslationCache(const std::string &Dir,
+                                   uint64_t MaxSizeBytes)
+    : Dir(Dir), MaxSizeBytes(MaxSizeBytes) {}
+
+std::string TranslationCache::getKey(StringRef Input,
+                                     const TranslatorOpts &Opts,
+                                     bool IsReverse) const {
+  SHA256 Hasher;
+  auto AddField = [&](StringRef Field) {
+    Hasher.update(Field);
+    Hasher.update(StringRef("\0", 1));
+  };
+  AddField(CacheFormatVersion);
+  AddField(LLVM_VERSION_STRING);
+  AddField(LLVM_SPIRV_VERSION);
+  AddField(LLVM_SPIRV_REVISION);
+  AddField(IsReverse ? "reverse" : "forward");
+  AddField(Opts.getCanonicalString());
+  Hasher.update(Input);
+  return toHex(Hasher.final(), /*LowerCase=*/true);
+}
+
+std::string TranslationCache::getEntryPath(const std::string &Key) const {
+  SmallString<128> Path(Dir);
+  sys::path::append(Path, EntryPrefix + Key);
+  return std::string(Path);
+}
+
+uint64_t TranslationCache::getDirectorySize() const {
+  uint64_t Size = 0;
+  std::error_code EC;
+  for (sys::fs::directory_iterator It(Dir, EC), End; It != End && !EC;
+       It.increment(EC)) {
+    if (!sys::path::filename(It->path()).starts_with(EntryPrefix))
+      continue;
+    ErrorOr<sys::fs::basic_file_status> Status = It->status();
+    if (Status)
+      Size += Status->getSize();
+  }
+  return Size;
+}
+
+bool TranslationCache::lookup(const std::string &Key, std::string &Result) {
+  std::string Path = getEntryPath(Key);
+  int FD;
+  if (sys::fs::openFileForRead(Path, FD)) {
+    ++Misses;
+    return false;
+  }
+  ErrorOr<std::unique_ptr<MemoryBuffer>> MB = MemoryBuffer::getOpenFile(
+      FD, Path, /*FileSize=*/-1, /*RequiresNullTerminator=*/false);
+  // Pruning removes the least recently used entries first. Many file systems
+  // don't record reads, so mark the entry as used explicitly.
+  if (MB)
+    sys::fs::setLastAccessAndModificationTime(FD,
+                                              std::chrono::system_clock::now());
+  sys::Process::SafelyCloseFileDescriptor(FD);
+  if (!MB) {
+    ++Misses;
+    return false;
+  }
+  Result = (*MB)->getBuffer().str();
+  ++Hits;
+  return true;
+}
+
+bool TranslationCache::store(const std::string &Key, StringRef Result) {
+  if (sys::fs::create_directories(Dir))
+    return false;
+
+  // Write into a temporary file first and rename it into place, so readers
+  // never observe a partially written entry.
+  SmallString<128> TempPattern(Dir);
+  sys::path::append(TempPattern, "spirv-cache-tmp-%%%%%%%%");
+  Expected<sys::fs::TempFile> Temp = sys::fs::TempFile::create(TempPattern);
+  if (!Temp) {
+    consumeError(Temp.takeError());
+    return false;
+  }
+  {
+    raw_fd_ostream OS(Temp->FD, /*shouldClose=*/false);
+    OS << Result;
+    OS.flush();
+    if (OS.has_error()) {
+      OS.clear_error();
+      consumeError(Temp->discard());
+      return false;
+    }
+  }
+  if (Error E = Temp->keep(getEntryPath(Key))) {
+    // Another writer may have stored the same entry concurrently.
+    consumeError(std::move(E));
+    consumeError(Temp->discard());
+    return false;
+  }
+  ++Stores;
+
+  if (!MaxSizeBytes)
+    return true;
+  std::lock_guard<std::mutex> Lock(SizeMutex);
+  if (CacheSizeKnown)
+    CacheSize += Result.size();
+  else
+    CacheSize = getDirectorySize();
+  CacheSizeKnown = true;
+  if (CacheSize <= MaxSizeBytes)
+    return true;
+
+  // Prune below the limit, so that not every following store has to prune
+  // again. Entries are removed by size only, never by age.
+  CachePruningPolicy Policy;
+  Policy.Interval = std::chrono::seconds(0);
+  Policy.Expiration = std::chrono::seconds(0);
+  Policy.MaxSizePercentageOfAvailableSpace = 0;
+  Policy.MaxSizeBytes = MaxSizeBytes - MaxSizeBytes / 8;
+  pruneCache(Dir, Policy);
+  CacheSize = getDirectorySize();
+  return true;
+}
+
+TranslationCache::Statistics TranslationCache::getStatistics() const {
+  Statistics S;
+  S.Hits = Hits;
+  S.Misses = Misses;
+  S.Stores = Stores;
+  return S;
+}
@@ -403,6 +403,9 @@ void SPIRVTypeScavenger::typeModule(Module &M) {
         correctUseTypes(I);
       }
     }
+    // Type rules only ever refer to values of the same function (or to
+    // globals and arguments, which are fully typed by now).
+    TypeRuleCache.clear();
   }
 
   // If there are any type variables we couldn't resolve, fallback to assigning
@@ -785,33 +788,60 @@ Type *SPIRVTypeScavenger::getTypeAfterRules(Value *V) {
   if (!isa<Instruction>(V))
     return getUnknownTyped(Ty);
 
-  assert(!is_contained(VisitStack, V) && "Found cycle in type scavenger");
-  VisitStack.push_back(V);
+  // The type of an instruction may depend on the type of one of its operands,
+  // which may in turn depend on another instruction. Rather than recursing,
+  // resolve such chains with an explicit worklist: the instruction on top of
+  // the worklist is revisited once the operand it is waiting for is typed.
+  assert(VisitStack.empty() && "Reentrant type deduction");
+  SmallVector<Instruction *, 8> Worklist;
+  Worklist.push_back(cast<Instruction>(V));
+  VisitStack.insert(V);
+  while (!Worklist.empty()) {
+    Instruction *I = Worklist.back();
+    if (Instruction *Dependency = typeFromReturnRules(*I)) {
+      assert(!VisitStack.contains(Dependency) &&
+             "Found cycle in type scavenger");
+      Worklist.push_back(Dependency);
+      VisitStack.insert(Dependency);
+      continue;
+    }
+    VisitStack.erase(I);
+    Worklist.pop_back();
+  }
+
+  return DeducedTypes.lookup(V);
+}
+
+Instruction *SPIRVTypeScavenger::typeFromReturnRules(Instruction &I) {
+  Type *Ty = I.getType();
+  Type *KnownType = nullptr;
 
   // Try to propagate from type rules constraining the return value.
-  SmallVector<TypeRule, 4> TypeRules;
-  getTypeRules(*cast<Instruction>(V), TypeRules);
-  for (TypeRule &Rule : TypeRules) {
+  for (const TypeRule &Rule : getCachedTypeRules(I)) {
     if (Rule.OpNo != RETURN_OPERAND)
       continue;
 
-    // Get the target type from the rule. If it comes from an operand,
-    // recursively attempt to find the type from the operand (but avoid any
-    // cycles).
+    // Get the target type from the rule. If it comes from an operand, the type
+    // of the operand needs to be found first (but avoid any cycles).
     Type *TargetTy;
     if (auto *UsedTy = dyn_cast<Type *>(Rule.Target)) {
       TargetTy = allocateTypeVariable(UsedTy);
     } else {
-      Value *Arg = cast<Use *>(Rule.Target)->get();
-      if (is_contained(VisitStack, Arg))
+      Value *Source = cast<Use *>(Rule.Target)->get();
+      if (VisitStack.contains(Source))
         continue;
 
-      Value *Source = cast<Use *>(Rule.Target)->get();
       // If the source argument is null, undef, or poison, then move on to
       // another rule to give better type hints.
       if (doesNotImplyType(Source))
         continue;
 
+      // If the source is an instruction that hasn't been typed yet, defer
+      // until it is.
+      if (isa<Instruction>(Source) && hasPointerType(Source->getType()) &&
+          !DeducedTypes.count(Source))
+        return cast<Instruction>(Source);
+
       TargetTy = substituteTypeVariables(getTypeAfterRules(Source));
     }
 
@@ -829,15 +859,22 @@ Type *SPIRVTypeScavenger::getTypeAfterRules(Value *V) {
   // If we still haven't gotten a type at this point, just construct a new type
   // variable and rely on later uses to recover the type.
   if (!KnownType) {
-    LLVM_DEBUG(dbgs() << *V << " matched no typing rules\n");
+    LLVM_DEBUG(dbgs() << I << " matched no typing rules\n");
     KnownType = allocateTypeVariable(Ty);
   }
 
-  DeducedTypes[V] = KnownType;
-  VisitStack.pop_back();
+  DeducedTypes[&I] = KnownType;
+
+  LLVM_DEBUG(dbgs() << "Assigned type " << *KnownType << " to " << I << "\n");
+  return nullptr;
+}
 
-  LLVM_DEBUG(dbgs() << "Assigned type " << *KnownType << " to " << *V << "\n");
-  return KnownType;
+const SmallVectorImpl<SPIRVTypeScavenger::TypeRule> &
+SPIRVTypeScavenger::getCachedTypeRules(Instruction &I) {
+  auto [It, Inserted] = TypeRuleCache.try_emplace(&I);
+  if (Inserted)
+    getTypeRules(I, It->second);
+  return It->second;
 }
 
 void SPIRVTypeScavenger::getTypeRules(Instruction &I,
@@ -986,8 +1023,7 @@ SPIRVTypeScavenger::getTypeCheck(Instruction &I, const TypeRule &Rule) {
 void SPIRVTypeScavenger::correctUseTypes(Instruction &I) {
   // This represents the types of all pointer-valued operands of the
   // instruction.
-  SmallVector<TypeRule, 4> TypeRules;
-  getTypeRules(I, TypeRules);
+  const SmallVectorImpl<TypeRule> &TypeRules = getCachedTypeRules(I);
 
   if (!TypeRules.empty())
     LLVM_DEBUG(dbgs() << "Typing uses of " << I << "\n");
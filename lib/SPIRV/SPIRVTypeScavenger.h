@@ -43,10 +43,13 @@
 
 #include "llvm/ADT/IntEqClasses.h"
 #include "llvm/ADT/PointerUnion.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/ValueMap.h"
 
+#include <unordered_map>
+
 using namespace llvm;
 
 /// This class allows for the recovery of typed pointer types from LLVM opaque
@@ -168,6 +171,23 @@ class SPIRVTypeScavenger {
   /// Retrieve the list of typing rules for an instruction.
   void getTypeRules(Instruction &I, SmallVectorImpl<TypeRule> &Rules);
 
+  /// Type rules of the instructions of the function currently being typed.
+  /// Both return value typing and use correction consult the rules of an
+  /// instruction, so they are computed once and dropped when the function is
+  /// done. Typing an instruction may look up the rules of others while its
+  /// own list is in use, so this needs a map whose entries stay in place.
+  std::unordered_map<Instruction *, SmallVector<TypeRule, 4>> TypeRuleCache;
+
+  /// Retrieve the (cached) list of typing rules for an instruction. The
+  /// returned reference stays valid until the cache is cleared.
+  const SmallVectorImpl<TypeRule> &getCachedTypeRules(Instruction &I);
+
+  /// Try to deduce the type of I from the type rules constraining its return
+  /// value. If the first applicable rule refers to an instruction whose type
+  /// is not yet known, nothing is deduced and that instruction is returned
+  /// instead, so that the caller can type it first.
+  Instruction *typeFromReturnRules(Instruction &I);
+
   /// Get the best guess for the type of the value, applying any type rules to
   /// the return value of an instruction that exist. The return type may refer
   /// to type variables that have yet to be resolved, if the type rules are
@@ -204,9 +224,9 @@ class SPIRVTypeScavenger {
   /// Compute pointer element types for all pertinent values in the module.
   void typeModule(Module &M);
 
-  /// This stores a list of instructions whose pointer element types are
+  /// This stores the set of instructions whose pointer element types are
   /// currently being investigated, to avoid the possibility of infinite cycles.
-  std::vector<Value *> VisitStack;
+  SmallPtrSet<Value *, 16> VisitStack;
 
 public:
   explicit SPIRVTypeScavenger(Module &M) : UnifiedTypeVars(1024) {
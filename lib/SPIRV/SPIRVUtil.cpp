@@ -49,6 +49,7 @@
 #include "ParameterType.h"
 #include "SPIRVInternal.h"
 #include "SPIRVMDWalker.h"
+#include "SPIRVTimeReport.h"
 #include "libSPIRV/SPIRVDecorate.h"
 #include "libSPIRV/SPIRVValue.h"
 
@@ -79,12 +80,24 @@ cl::opt<bool, true>
                   cl::location(SPIRVUseTextFormat));
 #endif
 
-#ifdef _SPIRVDBG
+#if _SPIRVDBG
 cl::opt<bool, true> EnableDbgOutput("spirv-debug",
                                     cl::desc("Enable SPIR-V debug output"),
                                     cl::location(SPIRVDbgEnable));
 #endif
 
+#if _SPIRVTRACE
+cl::bits<SPIRVTraceCategory, unsigned> TraceCategories(
+    "spirv-trace", cl::CommaSeparated,
+    cl::desc("Record a trace of the given categories, printed if the "
+             "translation fails"),
+    cl::location(SPIRVTraceMask),
+    cl::values(clEnumValN(SPIRVTC_Decode, "decode", "Entries read"),
+               clEnumValN(SPIRVTC_Encode, "encode", "Entries written"),
+               clEnumValN(SPIRVTC_Reader, "reader", "SPIR-V to LLVM values"),
+               clEnumValN(SPIRVTC_Writer, "writer", "LLVM to SPIR-V values")));
+#endif
+
 bool isSupportedTriple(Triple T) { return T.isSPIR() || T.isSPIRV(); }
 
 void addFnAttr(CallInst *Call, Attribute::AttrKind Attr) {
@@ -1698,6 +1711,8 @@ std::string mangleBuiltin(StringRef UniqName, ArrayRef<Type *> ArgTypes,
   BtnInfo->init(UniqName);
   if (BtnInfo->avoidMangling())
     return std::string(UniqName);
+  if (TranslationTimeReport *Report = getThreadTimeReport())
+    Report->addCount(TranslationTimeReport::BuiltinsMangled);
   std::string MangledName;
   LLVM_DEBUG(dbgs() << "[mangle] " << UniqName << " => ");
   SPIR::FunctionDescriptor FD;
@@ -54,6 +54,7 @@
 #include "SPIRVLowerBitCastToNonStandardType.h"
 #include "SPIRVLowerBool.h"
 #include "SPIRVLowerConstExpr.h"
+#include "SPIRVLowerFused.h"
 #include "SPIRVLowerLLVMIntrinsic.h"
 #include "SPIRVLowerMemmove.h"
 #include "SPIRVLowerOCLBlocks.h"
@@ -61,6 +62,7 @@
 #include "SPIRVMemAliasingINTEL.h"
 #include "SPIRVModule.h"
 #include "SPIRVRegularizeLLVM.h"
+#include "SPIRVTimeReport.h"
 #include "SPIRVType.h"
 #include "SPIRVUtil.h"
 #include "SPIRVValue.h"
@@ -81,6 +83,8 @@
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Operator.h"
+#include "llvm/IR/PassInstrumentation.h"
+#include "llvm/IR/PassTimingInfo.h"
 #include "llvm/IR/TypedPointerType.h"
 #include "llvm/Pass.h"
 #include "llvm/Passes/PassBuilder.h"
@@ -237,6 +241,8 @@ bool LLVMToSPIRVBase::runLLVMToSPIRV(Module &Mod) {
   Ctx = &M->getContext();
   DbgTran->setModule(M);
   assert(BM && "SPIR-V module not initialized");
+  // Also covers the legacy pass, which runs outside of writeSpirv.
+  SPIRVDbgScope DbgScope(BM->isDebugOutputEnabled());
   translate();
   return true;
 }
@@ -376,6 +382,8 @@ SPIRVType *LLVMToSPIRVBase::transType(Type *T) {
   if (Loc != TypeMap.end())
     return Loc->second;
 
+  SPIRVPhaseTimer Timer(BM->getTimeReport(), "type translation",
+                        &TypeTransDepth);
   SPIRVDBG(dbgs() << "[transType] " << *T << '\n');
   if (T->isVoidTy())
     return mapType(T, BM->addVoidType());
@@ -392,7 +400,8 @@ SPIRVType *LLVMToSPIRVBase::transType(Type *T) {
             ExtensionID::SPV_INTEL_arbitrary_precision_integers) ||
         BM->getErrorLog().checkError(
             BitWidth == 8 || BitWidth == 16 || BitWidth == 32 || BitWidth == 64,
-            SPIRVEC_InvalidBitWidth, std::to_string(BitWidth))) {
+            SPIRVEC_InvalidBitWidth,
+            [&] { return std::to_string(BitWidth); })) {
       return mapType(T, BM->addIntegerType(T->getIntegerBitWidth()));
     }
   }
@@ -635,7 +644,8 @@ SPIRVType *LLVMToSPIRVBase::transPointerType(Type *ET, unsigned AddrSpc) {
   Type *T = PointerType::get(ET, AddrSpc);
   if (ET->isFunctionTy() &&
       !BM->checkExtension(ExtensionID::SPV_INTEL_function_pointers,
-                          SPIRVEC_FunctionPointers, toString(T)))
+                          SPIRVEC_FunctionPointers,
+                          [&] { return toString(T); }))
     return nullptr;
 
   std::string TypeKey = (Twine((uintptr_t)ET) + Twine(AddrSpc)).str();
@@ -881,7 +891,8 @@ SPIRVFunction *LLVMToSPIRVBase::transFunctionDecl(Function *F) {
         BM->getErrorLog().checkError(
             BM->isAllowedToUseExtension(
                 ExtensionID::SPV_KHR_uniform_group_instructions),
-            SPIRVEC_RequiresExtension, "SPV_KHR_uniform_group_instructions\n");
+            SPIRVEC_RequiresExtension,
+            [] { return "SPV_KHR_uniform_group_instructions\n"; });
       BM->setName(BF, F->getName().str());
     }
   }
@@ -1459,6 +1470,8 @@ SPIRVValue *LLVMToSPIRVBase::transValue(Value *V, SPIRVBasicBlock *BB,
   auto *BV = transValueWithoutDecoration(V, BB, CreateForward, FuncTrans);
   if (!BV)
     return nullptr;
+  SPIRVTRACE(SPIRVTC_Writer, "transValue", BV->getOpCode(),
+             BV->hasId() ? BV->getId() : 0);
   // Only translate decorations for non-forward instructions.  Forward
   // instructions will have their decorations translated when the actual
   // instruction is seen and rewritten to a real SPIR-V instruction.
@@ -1966,7 +1979,8 @@ LLVMToSPIRVBase::transValueWithoutDecoration(Value *V, SPIRVBasicBlock *BB,
     if (FuncTrans == FuncTransMode::Decl)
       return transFunctionDecl(F);
     if (!BM->checkExtension(ExtensionID::SPV_INTEL_function_pointers,
-                            SPIRVEC_FunctionPointers, toString(V)))
+                            SPIRVEC_FunctionPointers,
+                            [&] { return toString(V); }))
       return nullptr;
     return BM->addConstantFunctionPointerINTEL(
         transPointerType(transScavengedType(F), F->getAddressSpace()),
@@ -2251,11 +2265,13 @@ LLVMToSPIRVBase::transValueWithoutDecoration(Value *V, SPIRVBasicBlock *BB,
         return mapValue(V, BM->addUnaryInst(OpBitcast, TranslatedTy, Arr, BB));
       }
 
-      if (!BM->checkExtension(ExtensionID::SPV_INTEL_variable_length_array,
-                              SPIRVEC_InvalidInstruction,
-                              toString(Alc) +
-                                  "\nTranslation of dynamic alloca requires "
-                                  "SPV_INTEL_variable_length_array extension."))
+      if (!BM->checkExtension(
+              ExtensionID::SPV_INTEL_variable_length_array,
+              SPIRVEC_InvalidInstruction, [&] {
+                return toString(Alc) +
+                       "\nTranslation of dynamic alloca requires "
+                       "SPV_INTEL_variable_length_array extension.";
+              }))
         return nullptr;
 
       return mapValue(V,
@@ -5716,10 +5732,13 @@ bool LLVMToSPIRVBase::translate() {
     else
       Defs.push_back(&F);
   }
-  for (auto *I : Decls)
-    transFunctionDecl(I);
-  for (auto *I : Defs)
-    transFunction(I);
+  {
+    SPIRVPhaseTimer Timer(BM->getTimeReport(), "function translation");
+    for (auto *I : Decls)
+      transFunctionDecl(I);
+    for (auto *I : Defs)
+      transFunction(I);
+  }
 
   if (!transMetadata())
     return false;
@@ -5727,7 +5746,10 @@ bool LLVMToSPIRVBase::translate() {
     return false;
 
   BM->resolveUnknownStructFields();
-  DbgTran->transDebugMetadata();
+  {
+    SPIRVPhaseTimer Timer(BM->getTimeReport(), "debug info translation");
+    DbgTran->transDebugMetadata();
+  }
   return true;
 }
 
@@ -6676,14 +6698,18 @@ void addPassesForSPIRV(ModulePassManager &PassMgr,
                        const SPIRV::TranslatorOpts &Opts) {
   if (Opts.isSPIRVMemToRegEnabled())
     PassMgr.addPass(createModuleToFunctionPassAdaptor(PromotePass()));
-  PassMgr.addPass(PreprocessMetadataPass());
+  PassMgr.addPass(PreprocessMetadataPass(Opts));
   PassMgr.addPass(SPIRVLowerOCLBlocksPass());
   PassMgr.addPass(OCLToSPIRVPass());
   PassMgr.addPass(SPIRVRegularizeLLVMPass());
-  PassMgr.addPass(SPIRVLowerConstExprPass());
-  PassMgr.addPass(SPIRVLowerBoolPass());
-  PassMgr.addPass(SPIRVLowerMemmovePass());
-  PassMgr.addPass(SPIRVLowerLLVMIntrinsicPass(Opts));
+  PassMgr.addPass(SPIRVLowerConstExprPass(Opts));
+  if (Opts.isFusedLoweringEnabled()) {
+    PassMgr.addPass(SPIRVLowerFusedPass(Opts));
+  } else {
+    PassMgr.addPass(SPIRVLowerBoolPass());
+    PassMgr.addPass(SPIRVLowerMemmovePass());
+    PassMgr.addPass(SPIRVLowerLLVMIntrinsicPass(Opts));
+  }
   PassMgr.addPass(createModuleToFunctionPassAdaptor(
       SPIRVLowerBitCastToNonStandardTypePass(Opts)));
 }
@@ -6732,6 +6758,7 @@ bool runSpirvWriterPasses(Module *M, std::ostream *OS, std::string &ErrMsg,
   bool WriteSpirv = OS != nullptr;
 
   std::unique_ptr<SPIRVModule> BM(SPIRVModule::createSPIRVModule(Opts));
+  SPIRVDbgScope DbgScope(BM->isDebugOutputEnabled());
   if (!isValidLLVMModule(M, BM->getErrorLog()))
     return false;
 
@@ -6765,7 +6792,18 @@ bool runSpirvWriterPasses(Module *M, std::ostream *OS, std::string &ErrMsg,
   FunctionAnalysisManager FAM;
   ModuleAnalysisManager MAM;
 
-  PassBuilder PB;
+  // Report the time spent in each regularization pass when requested with
+  // -time-passes or with a time report. The phases of the translation itself
+  // are reported separately.
+  PassInstrumentationCallbacks PIC;
+  TimePassesHandler TimePasses(TimePassesIsEnabled);
+  TimePasses.registerCallbacks(PIC);
+  SPIRVTimeReportScope TimeReportScope(Opts.getTimeReport());
+  SPIRVPassTimeReporter PassTimes(Opts.getTimeReport(),
+                                  {LLVMToSPIRVPass::name()});
+  PassTimes.registerCallbacks(PIC);
+
+  PassBuilder PB(nullptr, PipelineTuningOptions(), std::nullopt, &PIC);
   PB.registerModuleAnalyses(MAM);
   PB.registerCGSCCAnalyses(CGAM);
   PB.registerFunctionAnalyses(FAM);
@@ -6774,12 +6812,18 @@ bool runSpirvWriterPasses(Module *M, std::ostream *OS, std::string &ErrMsg,
   PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
 
   PassMgr.run(*M, MAM);
+  if (TimePassesIsEnabled)
+    TimePasses.print();
 
   if (BM->getError(ErrMsg) != SPIRVEC_Success)
     return false;
 
-  if (WriteSpirv)
+  if (WriteSpirv) {
+    if (SPIRVMemoryReport *Report = Opts.getMemoryReport())
+      *Report = BM->getMemoryReport();
+    SPIRVPhaseTimer Timer(Opts.getTimeReport(), "encoding");
     *OS << *BM;
+  }
 
   return true;
 }
@@ -199,6 +199,8 @@ private:
   OCLTypeToSPIRVBase *OCLTypeToSPIRVPtr = nullptr;
   std::vector<llvm::Instruction *> UnboundInst;
   std::unique_ptr<SPIRVTypeScavenger> Scavenger;
+  // Nesting level of transType calls, only the outermost one is timed
+  unsigned TypeTransDepth = 0;
 
   enum class FPContract { UNDEF, DISABLED, ENABLED };
   DenseMap<Function *, FPContract> FPContractMap;
@@ -54,10 +54,6 @@ SPIRVBasicBlock::SPIRVBasicBlock(SPIRVId TheId, SPIRVFunction *Func)
   validate();
 }
 
-SPIRVDecoder SPIRVBasicBlock::getDecoder(std::istream &IS) {
-  return SPIRVDecoder(IS, *this);
-}
-
 /// Assume I contains valid Id.
 SPIRVInstruction *
 SPIRVBasicBlock::addInstruction(SPIRVInstruction *I,
@@ -79,12 +75,22 @@ SPIRVBasicBlock::addInstruction(SPIRVInstruction *I,
   return I;
 }
 
-void SPIRVBasicBlock::encodeChildren(spv_ostream &O) const {
+template <typename FormatTy>
+void SPIRVBasicBlock::encodeChildrenImpl(
+    const SPIRVEncoder<FormatTy> &O) const {
   O << SPIRVNL();
   for (size_t I = 0, E = InstVec.size(); I != E; ++I)
     O << *InstVec[I];
 }
 
+void SPIRVBasicBlock::encodeChildren(const SPIRVBinaryEncoder &O) const {
+  encodeChildrenImpl(O);
+}
+
+void SPIRVBasicBlock::encodeChildren(const SPIRVTextEncoder &O) const {
+  encodeChildrenImpl(O);
+}
+
 _SPIRV_IMP_ENCDEC1(SPIRVBasicBlock, Id)
 
 SPIRVInstruction *SPIRVBasicBlock::getVariableInsertionPoint() const {
@@ -46,7 +46,6 @@
 namespace SPIRV {
 class SPIRVFunction;
 class SPIRVInstruction;
-class SPIRVDecoder;
 class SPIRVBasicBlock : public SPIRVValue {
 
 public:
@@ -54,7 +53,6 @@ public:
 
   SPIRVBasicBlock() : SPIRVValue(OpLabel), ParentF(NULL) { setAttr(); }
 
-  SPIRVDecoder getDecoder(std::istream &IS) override;
   SPIRVFunction *getParent() const { return ParentF; }
   size_t getNumInst() const { return InstVec.size(); }
   SPIRVInstruction *getInst(size_t I) const { return InstVec[I]; }
@@ -95,11 +93,15 @@ public:
 
   void setAttr() { setHasNoType(); }
   _SPIRV_DCL_ENCDEC
-  void encodeChildren(spv_ostream &) const override;
+  template <typename FormatTy>
+  void encodeChildrenImpl(const SPIRVEncoder<FormatTy> &O) const;
+  void encodeChildren(const SPIRVBinaryEncoder &O) const override;
+  void encodeChildren(const SPIRVTextEncoder &O) const override;
   void validate() const override {
     SPIRVValue::validate();
     assert(ParentF && "Invalid parent function");
   }
+  size_t getOperandMemoryUsage() const override { return getHeapSize(InstVec); }
 
 private:
   SPIRVFunction *ParentF;
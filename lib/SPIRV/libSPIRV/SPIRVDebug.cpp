@@ -43,14 +43,72 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include <memory>
+
 #define DEBUG_TYPE "spirv-regularization"
 
 using namespace SPIRV;
 
 bool SPIRV::SPIRVDbgEnable = false;
+thread_local int8_t SPIRV::SPIRVDbgEnableOverride = -1;
 SPIRV::SPIRVDbgErrorHandlingKinds SPIRV::SPIRVDbgError =
     SPIRVDbgErrorHandlingKinds::Exit;
 bool SPIRV::SPIRVDbgErrorMsgIncludesSourceInfo = true;
+unsigned SPIRV::SPIRVTraceMask = 0;
+
+namespace {
+// Number of events kept per thread. Must be a power of two.
+constexpr size_t SPIRVTraceBufferSize = 256;
+
+struct SPIRVTraceBuffer {
+  SPIRVTraceEvent Events[SPIRVTraceBufferSize];
+  uint64_t Count = 0;
+};
+
+// Allocated by the first event recorded by a thread, so that threads which
+// do not trace do not pay for the buffer.
+thread_local std::unique_ptr<SPIRVTraceBuffer> TraceBuffer;
+
+const char *getTraceCategoryName(SPIRVTraceCategory Category) {
+  switch (Category) {
+  case SPIRVTC_Decode:
+    return "decode";
+  case SPIRVTC_Encode:
+    return "encode";
+  case SPIRVTC_Reader:
+    return "reader";
+  case SPIRVTC_Writer:
+    return "writer";
+  default:
+    return "unknown";
+  }
+}
+} // namespace
+
+void SPIRV::recordSPIRVTrace(SPIRVTraceCategory Category, const char *Name,
+                             uint32_t OpCode, uint32_t Id) {
+  if (!TraceBuffer)
+    TraceBuffer = std::make_unique<SPIRVTraceBuffer>();
+  TraceBuffer->Events[TraceBuffer->Count++ & (SPIRVTraceBufferSize - 1)] = {
+      Category, Name, OpCode, Id};
+}
+
+void SPIRV::dumpSPIRVTrace(std::ostream &O) {
+  if (!TraceBuffer || !TraceBuffer->Count)
+    return;
+  uint64_t Count = TraceBuffer->Count;
+  uint64_t First =
+      Count > SPIRVTraceBufferSize ? Count - SPIRVTraceBufferSize : 0;
+  O << "SPIR-V trace, last " << Count - First << " of " << Count
+    << " events:\n";
+  for (uint64_t I = First; I != Count; ++I) {
+    const SPIRVTraceEvent &E =
+        TraceBuffer->Events[I & (SPIRVTraceBufferSize - 1)];
+    O << "  #" << I << ' ' << getTraceCategoryName(E.Category) << ' '
+      << E.Name << " op=" << E.OpCode << " id=" << E.Id << '\n';
+  }
+  TraceBuffer->Count = 0;
+}
 
 namespace SPIRV {
 llvm::cl::opt<bool> VerifyRegularizationPasses(
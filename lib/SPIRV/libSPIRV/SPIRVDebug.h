@@ -42,6 +42,7 @@
 
 #include "SPIRVUtil.h"
 
+#include <cstdint>
 #include <iostream>
 #include <string>
 
@@ -61,8 +62,35 @@ extern SPIRVDbgErrorHandlingKinds SPIRVDbgError;
 // Enable debug output.
 extern bool SPIRVDbgEnable;
 
+// Per-thread override of SPIRVDbgEnable set while a module is read or
+// written, -1 if the thread uses the process-wide setting.
+extern thread_local int8_t SPIRVDbgEnableOverride;
+
+inline bool isSPIRVDbgEnabled() {
+  return SPIRVDbgEnableOverride < 0 ? SPIRVDbgEnable
+                                    : SPIRVDbgEnableOverride != 0;
+}
+
+// Makes the current thread print SPIRVDBG output according to Enable for the
+// lifetime of the object. Translations install it from their options, so
+// threads translating with different options don't affect each other.
+class SPIRVDbgScope {
+public:
+  explicit SPIRVDbgScope(bool Enable) : Saved(SPIRVDbgEnableOverride) {
+    SPIRVDbgEnableOverride = Enable;
+  }
+  ~SPIRVDbgScope() { SPIRVDbgEnableOverride = Saved; }
+  SPIRVDbgScope(const SPIRVDbgScope &) = delete;
+  SPIRVDbgScope &operator=(const SPIRVDbgScope &) = delete;
+
+private:
+  int8_t Saved;
+};
+
 void verifyRegularizationPass(llvm::Module &, const std::string &);
 
+// The build may define _SPIRVDBG to 0 to compile out SPIRVDBG also in builds
+// with assertions, see LLVM_SPIRV_DISABLE_DEBUG_OUTPUT.
 #ifndef _SPIRVDBG
 #if !defined(NDEBUG) || defined(_DEBUG)
 #define _SPIRVDBG true
@@ -71,10 +99,58 @@ void verifyRegularizationPass(llvm::Module &, const std::string &);
 #endif
 #endif
 
+// Structured trace of the translation, compiled in with
+// LLVM_SPIRV_ENABLE_TRACE. Unlike SPIRVDBG output, events are not formatted
+// when they happen. Each thread keeps its last events in a ring buffer which
+// is printed if the translation fails, or on request.
+#ifndef _SPIRVTRACE
+#define _SPIRVTRACE false
+#endif
+
+// Trace categories. SPIRVTraceMask has bit (1 << Category) set for every
+// category that is recorded.
+enum SPIRVTraceCategory : unsigned {
+  SPIRVTC_Decode, // Entries read from a SPIR-V module
+  SPIRVTC_Encode, // Entries written to a SPIR-V module
+  SPIRVTC_Reader, // Values translated from SPIR-V to LLVM IR
+  SPIRVTC_Writer, // Values translated from LLVM IR to SPIR-V
+  SPIRVTC_Count
+};
+
+// Categories recorded by SPIRVTRACE, none by default.
+extern unsigned SPIRVTraceMask;
+
+struct SPIRVTraceEvent {
+  SPIRVTraceCategory Category;
+  const char *Name; // A string literal naming the event
+  uint32_t OpCode;  // Op of the entry the event is about
+  uint32_t Id;      // Id of that entry, or 0
+};
+
+// Records an event in the trace buffer of the calling thread.
+void recordSPIRVTrace(SPIRVTraceCategory Category, const char *Name,
+                      uint32_t OpCode, uint32_t Id);
+
+// Prints the events in the trace buffer of the calling thread, oldest first,
+// and empties the buffer.
+void dumpSPIRVTrace(std::ostream &O);
+
+#if _SPIRVTRACE
+#define SPIRVTRACE(Category, Name, OpCode, Id)                                 \
+  do {                                                                         \
+    if (SPIRVTraceMask & (1u << (Category)))                                   \
+      recordSPIRVTrace(Category, Name, OpCode, Id);                            \
+  } while (false)
+#else
+#define SPIRVTRACE(Category, Name, OpCode, Id)                                 \
+  do {                                                                         \
+  } while (false)
+#endif
+
 #if _SPIRVDBG
 
 #define SPIRVDBG(x)                                                            \
-  if (SPIRVDbgEnable) {                                                        \
+  if (isSPIRVDbgEnabled()) {                                                   \
     x;                                                                         \
   }
 
@@ -43,8 +43,9 @@
 #include "SPIRVValue.h"
 
 namespace SPIRV {
-template <class T>
-spv_ostream &operator<<(spv_ostream &O, const std::vector<T *> &V) {
+template <typename FormatTy, class T>
+const SPIRVEncoder<FormatTy> &operator<<(const SPIRVEncoder<FormatTy> &O,
+                                         const std::vector<T *> &V) {
   for (auto &I : V)
     O << *I;
   return O;
@@ -108,8 +109,8 @@ std::vector<SPIRVWord> SPIRVDecorateGeneric::getVecLiteral() const {
 
 size_t SPIRVDecorateGeneric::getLiteralCount() const { return Literals.size(); }
 
-void SPIRVDecorate::encode(spv_ostream &O) const {
-  SPIRVEncoder Encoder = getEncoder(O);
+template <typename FormatTy>
+void SPIRVDecorate::encodeImpl(const SPIRVEncoder<FormatTy> &Encoder) const {
   Encoder << Target << Dec;
   switch (static_cast<size_t>(Dec)) {
   case DecorationLinkageAttributes:
@@ -143,8 +144,8 @@ void SPIRVDecorate::setWordCount(SPIRVWord Count) {
   Literals.resize(WordCount - FixedWC);
 }
 
-void SPIRVDecorate::decode(std::istream &I) {
-  SPIRVDecoder Decoder = getDecoder(I);
+template <typename FormatTy>
+void SPIRVDecorate::decodeImpl(const SPIRVDecoder<FormatTy> &Decoder) {
   Decoder >> Target >> Dec;
   switch (static_cast<size_t>(Dec)) {
   case DecorationLinkageAttributes:
@@ -171,8 +172,10 @@ void SPIRVDecorate::decode(std::istream &I) {
   getOrCreateTarget()->addDecorate(this);
 }
 
-void SPIRVDecorateId::encode(spv_ostream &O) const {
-  SPIRVEncoder Encoder = getEncoder(O);
+_SPIRV_IMP_ENCDEC_FORMATS(SPIRVDecorate)
+
+template <typename FormatTy>
+void SPIRVDecorateId::encodeImpl(const SPIRVEncoder<FormatTy> &Encoder) const {
   Encoder << Target << Dec << Literals;
 }
 
@@ -181,14 +184,17 @@ void SPIRVDecorateId::setWordCount(SPIRVWord Count) {
   Literals.resize(WordCount - FixedWC);
 }
 
-void SPIRVDecorateId::decode(std::istream &I) {
-  SPIRVDecoder Decoder = getDecoder(I);
+template <typename FormatTy>
+void SPIRVDecorateId::decodeImpl(const SPIRVDecoder<FormatTy> &Decoder) {
   Decoder >> Target >> Dec >> Literals;
   getOrCreateTarget()->addDecorate(this);
 }
 
-void SPIRVMemberDecorate::encode(spv_ostream &O) const {
-  SPIRVEncoder Encoder = getEncoder(O);
+_SPIRV_IMP_ENCDEC_FORMATS(SPIRVDecorateId)
+
+template <typename FormatTy>
+void SPIRVMemberDecorate::encodeImpl(
+    const SPIRVEncoder<FormatTy> &Encoder) const {
   Encoder << Target << MemberNumber << Dec;
   switch (Dec) {
   case DecorationMemoryINTEL:
@@ -210,8 +216,8 @@ void SPIRVMemberDecorate::setWordCount(SPIRVWord Count) {
   Literals.resize(WordCount - FixedWC);
 }
 
-void SPIRVMemberDecorate::decode(std::istream &I) {
-  SPIRVDecoder Decoder = getDecoder(I);
+template <typename FormatTy>
+void SPIRVMemberDecorate::decodeImpl(const SPIRVDecoder<FormatTy> &Decoder) {
   Decoder >> Target >> MemberNumber >> Dec;
   switch (Dec) {
   case DecorationMemoryINTEL:
@@ -229,27 +235,50 @@ void SPIRVMemberDecorate::decode(std::istream &I) {
   getOrCreateTarget()->addMemberDecorate(this);
 }
 
-void SPIRVDecorationGroup::encode(spv_ostream &O) const { getEncoder(O) << Id; }
+_SPIRV_IMP_ENCDEC_FORMATS(SPIRVMemberDecorate)
 
-void SPIRVDecorationGroup::decode(std::istream &I) {
-  getDecoder(I) >> Id;
+template <typename FormatTy>
+void SPIRVDecorationGroup::encodeImpl(const SPIRVEncoder<FormatTy> &O) const {
+  O << Id;
+}
+
+template <typename FormatTy>
+void SPIRVDecorationGroup::decodeImpl(const SPIRVDecoder<FormatTy> &I) {
+  I >> Id;
   Module->addDecorationGroup(this);
 }
 
-void SPIRVDecorationGroup::encodeAll(spv_ostream &O) const {
+_SPIRV_IMP_ENCDEC_FORMATS(SPIRVDecorationGroup)
+
+template <typename FormatTy>
+void SPIRVDecorationGroup::encodeAllImpl(
+    const SPIRVEncoder<FormatTy> &O) const {
   O << Decorations;
   SPIRVEntry::encodeAll(O);
 }
 
-void SPIRVGroupDecorateGeneric::encode(spv_ostream &O) const {
-  getEncoder(O) << DecorationGroup << Targets;
+void SPIRVDecorationGroup::encodeAll(const SPIRVBinaryEncoder &O) const {
+  encodeAllImpl(O);
 }
 
-void SPIRVGroupDecorateGeneric::decode(std::istream &I) {
-  getDecoder(I) >> DecorationGroup >> Targets;
+void SPIRVDecorationGroup::encodeAll(const SPIRVTextEncoder &O) const {
+  encodeAllImpl(O);
+}
+
+template <typename FormatTy>
+void SPIRVGroupDecorateGeneric::encodeImpl(
+    const SPIRVEncoder<FormatTy> &O) const {
+  O << DecorationGroup << Targets;
+}
+
+template <typename FormatTy>
+void SPIRVGroupDecorateGeneric::decodeImpl(const SPIRVDecoder<FormatTy> &I) {
+  I >> DecorationGroup >> Targets;
   Module->addGroupDecorateGeneric(this);
 }
 
+_SPIRV_IMP_ENCDEC_FORMATS(SPIRVGroupDecorateGeneric)
+
 void SPIRVGroupDecorate::decorateTargets() {
   for (auto &I : Targets) {
     auto *Target = getOrCreate(I);
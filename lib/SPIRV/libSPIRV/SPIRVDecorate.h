@@ -108,6 +108,10 @@ public:
     }
   }
 
+  size_t getOperandMemoryUsage() const override {
+    return getHeapSize(Literals);
+  }
+
 protected:
   Decoration Dec;
   std::vector<SPIRVWord> Literals;
@@ -280,21 +284,20 @@ public:
     return (SPIRVLinkageTypeKind)Literals.back();
   }
 
-  static void encodeLiterals(SPIRVEncoder &Encoder,
+  template <typename FormatTy>
+  static void encodeLiterals(const SPIRVEncoder<FormatTy> &Encoder,
                              const std::vector<SPIRVWord> &Literals) {
-#ifdef _SPIRV_SUPPORT_TEXT_FMT
-    if (SPIRVUseTextFormat) {
+    if constexpr (FormatTy::IsText) {
       Encoder << getString(Literals.cbegin(), Literals.cend() - 1);
       Encoder << (SPIRVLinkageTypeKind)Literals.back();
     } else
-#endif
       Encoder << Literals;
   }
 
-  static void decodeLiterals(SPIRVDecoder &Decoder,
+  template <typename FormatTy>
+  static void decodeLiterals(const SPIRVDecoder<FormatTy> &Decoder,
                              std::vector<SPIRVWord> &Literals) {
-#ifdef _SPIRV_SUPPORT_TEXT_FMT
-    if (SPIRVUseTextFormat) {
+    if constexpr (FormatTy::IsText) {
       std::string Name;
       Decoder >> Name;
       SPIRVLinkageTypeKind Kind;
@@ -302,7 +305,6 @@ public:
       std::copy_n(getVec(Name).begin(), Literals.size() - 1, Literals.begin());
       Literals.back() = Kind;
     } else
-#endif
       Decoder >> Literals;
   }
 
@@ -394,7 +396,10 @@ public:
   }
   // Incomplete constructor
   SPIRVDecorationGroup() : SPIRVEntry(OC) {}
-  void encodeAll(spv_ostream &O) const override;
+  template <typename FormatTy>
+  void encodeAllImpl(const SPIRVEncoder<FormatTy> &O) const;
+  void encodeAll(const SPIRVBinaryEncoder &O) const override;
+  void encodeAll(const SPIRVTextEncoder &O) const override;
   _SPIRV_DCL_ENCDEC
   // Move the given decorates to the decoration group
   void takeDecorates(SPIRVDecorateVec &Decs) {
@@ -432,6 +437,9 @@ public:
     Targets.resize(WC - FixedWC);
   }
   virtual void decorateTargets() = 0;
+  size_t getOperandMemoryUsage() const override {
+    return getHeapSize(Targets);
+  }
   _SPIRV_DCL_ENCDEC
 protected:
   SPIRVDecorationGroup *DecorationGroup;
@@ -476,25 +484,23 @@ public:
   // Incomplete constructor
   SPIRVDecorateStrAttrBase() : SPIRVDecorate() {}
 
-  static void encodeLiterals(SPIRVEncoder &Encoder,
+  template <typename FormatTy>
+  static void encodeLiterals(const SPIRVEncoder<FormatTy> &Encoder,
                              const std::vector<SPIRVWord> &Literals) {
-#ifdef _SPIRV_SUPPORT_TEXT_FMT
-    if (SPIRVUseTextFormat) {
+    if constexpr (FormatTy::IsText) {
       Encoder << getString(Literals.cbegin(), Literals.cend());
     } else
-#endif
       Encoder << Literals;
   }
 
-  static void decodeLiterals(SPIRVDecoder &Decoder,
+  template <typename FormatTy>
+  static void decodeLiterals(const SPIRVDecoder<FormatTy> &Decoder,
                              std::vector<SPIRVWord> &Literals) {
-#ifdef _SPIRV_SUPPORT_TEXT_FMT
-    if (SPIRVUseTextFormat) {
+    if constexpr (FormatTy::IsText) {
       std::string Str;
       Decoder >> Str;
       std::copy_n(getVec(Str).begin(), Literals.size(), Literals.begin());
     } else
-#endif
       Decoder >> Literals;
   }
 };
@@ -530,24 +536,23 @@ public:
     WordCount += Literals.size();
   }
 
-  static void encodeLiterals(SPIRVEncoder &Encoder,
+  template <typename FormatTy>
+  static void encodeLiterals(const SPIRVEncoder<FormatTy> &Encoder,
                              const std::vector<SPIRVWord> &Literals) {
-#ifdef _SPIRV_SUPPORT_TEXT_FMT
-    if (SPIRVUseTextFormat) {
+    if constexpr (FormatTy::IsText) {
       std::string FirstString = getString(Literals.cbegin(), Literals.cend());
       Encoder << FirstString;
       Encoder.OS << " ";
       Encoder << getString(Literals.cbegin() + getVec(FirstString).size(),
                            Literals.cend());
     } else
-#endif
       Encoder << Literals;
   }
 
-  static void decodeLiterals(SPIRVDecoder &Decoder,
+  template <typename FormatTy>
+  static void decodeLiterals(const SPIRVDecoder<FormatTy> &Decoder,
                              std::vector<SPIRVWord> &Literals) {
-#ifdef _SPIRV_SUPPORT_TEXT_FMT
-    if (SPIRVUseTextFormat) {
+    if constexpr (FormatTy::IsText) {
       std::string Name;
       Decoder >> Name;
       std::string Direction;
@@ -555,7 +560,6 @@ public:
       std::string Buf = Name + ':' + Direction;
       std::copy_n(getVec(Buf).begin(), Literals.size(), Literals.begin());
     } else
-#endif
       Decoder >> Literals;
   }
 };
@@ -774,22 +778,21 @@ public:
                                const std::string &VarName)
       : SPIRVDecorateHostAccessINTELBase(DecorationHostAccessINTEL, TheTarget,
                                          AccessMode, VarName) {}
-  static void encodeLiterals(SPIRVEncoder &Encoder,
+  template <typename FormatTy>
+  static void encodeLiterals(const SPIRVEncoder<FormatTy> &Encoder,
                              const std::vector<SPIRVWord> &Literals) {
-#ifdef _SPIRV_SUPPORT_TEXT_FMT
-    if (SPIRVUseTextFormat) {
+    if constexpr (FormatTy::IsText) {
       Encoder << (HostAccessQualifier)Literals.front();
       std::string Name = getString(Literals.cbegin() + 1, Literals.cend());
       Encoder << Name;
     } else
-#endif
       Encoder << Literals;
   }
 
-  static void decodeLiterals(SPIRVDecoder &Decoder,
+  template <typename FormatTy>
+  static void decodeLiterals(const SPIRVDecoder<FormatTy> &Decoder,
                              std::vector<SPIRVWord> &Literals) {
-#ifdef _SPIRV_SUPPORT_TEXT_FMT
-    if (SPIRVUseTextFormat) {
+    if constexpr (FormatTy::IsText) {
       HostAccessQualifier Mode;
       Decoder >> Mode;
       std::string Name;
@@ -799,7 +802,6 @@ public:
                   Literals.begin() + 1);
 
     } else
-#endif
       Decoder >> Literals;
   }
 };
@@ -812,22 +814,21 @@ public:
                                      const std::string &VarName)
       : SPIRVDecorateHostAccessINTELBase(internal::DecorationHostAccessINTEL,
                                          TheTarget, AccessMode, VarName) {}
-  static void encodeLiterals(SPIRVEncoder &Encoder,
+  template <typename FormatTy>
+  static void encodeLiterals(const SPIRVEncoder<FormatTy> &Encoder,
                              const std::vector<SPIRVWord> &Literals) {
-#ifdef _SPIRV_SUPPORT_TEXT_FMT
-    if (SPIRVUseTextFormat) {
+    if constexpr (FormatTy::IsText) {
       Encoder << Literals.front();
       std::string Name = getString(Literals.cbegin() + 1, Literals.cend());
       Encoder << Name;
     } else
-#endif
       Encoder << Literals;
   }
 
-  static void decodeLiterals(SPIRVDecoder &Decoder,
+  template <typename FormatTy>
+  static void decodeLiterals(const SPIRVDecoder<FormatTy> &Decoder,
                              std::vector<SPIRVWord> &Literals) {
-#ifdef _SPIRV_SUPPORT_TEXT_FMT
-    if (SPIRVUseTextFormat) {
+    if constexpr (FormatTy::IsText) {
       SPIRVWord Mode;
       Decoder >> Mode;
       std::string Name;
@@ -837,7 +838,6 @@ public:
                   Literals.begin() + 1);
 
     } else
-#endif
       Decoder >> Literals;
   }
 };
@@ -860,25 +860,23 @@ public:
       : SPIRVDecorateInitModeINTELBase(DecorationInitModeINTEL, TheTarget,
                                        Trigger) {}
 
-  static void encodeLiterals(SPIRVEncoder &Encoder,
+  template <typename FormatTy>
+  static void encodeLiterals(const SPIRVEncoder<FormatTy> &Encoder,
                              const std::vector<SPIRVWord> &Literals) {
-#ifdef _SPIRV_SUPPORT_TEXT_FMT
-    if (SPIRVUseTextFormat) {
+    if constexpr (FormatTy::IsText) {
       Encoder << (InitializationModeQualifier)Literals.back();
     } else
-#endif
       Encoder << Literals;
   }
 
-  static void decodeLiterals(SPIRVDecoder &Decoder,
+  template <typename FormatTy>
+  static void decodeLiterals(const SPIRVDecoder<FormatTy> &Decoder,
                              std::vector<SPIRVWord> &Literals) {
-#ifdef _SPIRV_SUPPORT_TEXT_FMT
-    if (SPIRVUseTextFormat) {
+    if constexpr (FormatTy::IsText) {
       InitializationModeQualifier Q;
       Decoder >> Q;
       Literals.back() = Q;
     } else
-#endif
       Decoder >> Literals;
   }
 };
@@ -890,25 +888,23 @@ public:
       : SPIRVDecorateInitModeINTELBase(internal::DecorationInitModeINTEL,
                                        TheTarget, Trigger) {}
 
-  static void encodeLiterals(SPIRVEncoder &Encoder,
+  template <typename FormatTy>
+  static void encodeLiterals(const SPIRVEncoder<FormatTy> &Encoder,
                              const std::vector<SPIRVWord> &Literals) {
-#ifdef _SPIRV_SUPPORT_TEXT_FMT
-    if (SPIRVUseTextFormat) {
+    if constexpr (FormatTy::IsText) {
       Encoder << Literals.back();
     } else
-#endif
       Encoder << Literals;
   }
 
-  static void decodeLiterals(SPIRVDecoder &Decoder,
+  template <typename FormatTy>
+  static void decodeLiterals(const SPIRVDecoder<FormatTy> &Decoder,
                              std::vector<SPIRVWord> &Literals) {
-#ifdef _SPIRV_SUPPORT_TEXT_FMT
-    if (SPIRVUseTextFormat) {
+    if constexpr (FormatTy::IsText) {
       SPIRVWord Q;
       Decoder >> Q;
       Literals.back() = Q;
     } else
-#endif
       Decoder >> Literals;
   }
 };
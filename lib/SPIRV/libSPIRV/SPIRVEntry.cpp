@@ -38,6 +38,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "SPIRVEntry.h"
+#include "LLVMSPIRVLib.h"
 #include "SPIRVAsm.h"
 #include "SPIRVBasicBlock.h"
 #include "SPIRVDebug.h"
@@ -107,6 +108,80 @@ SPIRVEntry::createUnique(SPIRVExtInstSetKind Set, unsigned ExtOp) {
   return std::unique_ptr<SPIRVExtInst>(new SPIRVExtInst(Set, ExtOp));
 }
 
+size_t SPIRVEntry::getObjectSize(Op OC) {
+  static const std::unordered_map<Op, size_t> OpToSizeMap = {
+#define _SPIRV_OP(x, ...) {Op##x, sizeof(SPIRV##x)},
+#define _SPIRV_OP_INTERNAL(x, ...) {internal::Op##x, sizeof(SPIRV##x)},
+#include "SPIRVOpCodeEnum.h"
+#include "SPIRVOpCodeEnumInternal.h"
+#undef _SPIRV_OP_INTERNAL
+#undef _SPIRV_OP
+  };
+  auto Loc = OpToSizeMap.find(OC);
+  return Loc != OpToSizeMap.end() ? Loc->second : sizeof(SPIRVEntry);
+}
+
+static bool isDebugInfoExtInst(const SPIRVEntry *E) {
+  if (E->getOpCode() != OpExtInst)
+    return false;
+  switch (static_cast<const SPIRVExtInst *>(E)->getExtSetKind()) {
+  case SPIRVEIS_Debug:
+  case SPIRVEIS_OpenCL_DebugInfo_100:
+  case SPIRVEIS_NonSemantic_Shader_DebugInfo_100:
+  case SPIRVEIS_NonSemantic_Shader_DebugInfo_200:
+    return true;
+  default:
+    return false;
+  }
+}
+
+void SPIRVEntry::addMemoryUsage(SPIRVMemoryReport &Report) const {
+  SPIRVMemoryReport::Category ObjectCategory = SPIRVMemoryReport::Instructions;
+  SPIRVMemoryReport::Category StringCategory = SPIRVMemoryReport::Strings;
+  switch (OpCode) {
+  case OpDecorate:
+  case OpDecorateId:
+  case OpDecorateString:
+  case OpMemberDecorate:
+  case OpMemberDecorateString:
+  case OpDecorationGroup:
+  case OpGroupDecorate:
+  case OpGroupMemberDecorate:
+    ObjectCategory = SPIRVMemoryReport::Decorations;
+    break;
+  case OpString:
+    ObjectCategory = SPIRVMemoryReport::Strings;
+    break;
+  case OpName:
+  case OpMemberName:
+    ObjectCategory = StringCategory = SPIRVMemoryReport::Names;
+    break;
+  default:
+    if (isDebugInfoExtInst(this))
+      ObjectCategory = SPIRVMemoryReport::DebugInstructions;
+    break;
+  }
+  SPIRVMemoryReport::Category OperandCategory =
+      ObjectCategory == SPIRVMemoryReport::Instructions
+          ? SPIRVMemoryReport::OperandVectors
+          : ObjectCategory;
+
+  size_t ObjectSize = getObjectSize(OpCode);
+  size_t OperandSize = getOperandMemoryUsage();
+  size_t StringSize = getStringMemoryUsage();
+  // Names are counted once by SPIRVModule::getMemoryReport().
+  size_t DecorateSize = getHeapSize(Decorates) + getHeapSize(DecorateIds) +
+                        getHeapSize(MemberDecorates);
+  Report.add(ObjectCategory, ObjectSize, 1);
+  Report.add(OperandCategory, OperandSize);
+  Report.add(StringCategory, StringSize);
+  Report.add(SPIRVMemoryReport::Decorations, DecorateSize);
+
+  SPIRVMemoryReport::Usage &OpUsage = Report.Opcodes[OpCode];
+  ++OpUsage.Count;
+  OpUsage.Bytes += ObjectSize + OperandSize + StringSize;
+}
+
 SPIRVErrorLog &SPIRVEntry::getErrorLog() const { return Module->getErrorLog(); }
 
 bool SPIRVEntry::exist(SPIRVId TheId) const { return Module->exist(TheId); }
@@ -127,21 +202,16 @@ SPIRVType *SPIRVEntry::getValueType(SPIRVId TheId) const {
   return get<SPIRVValue>(TheId)->getType();
 }
 
-SPIRVEncoder SPIRVEntry::getEncoder(spv_ostream &O) const {
-  return SPIRVEncoder(O);
-}
-
-SPIRVDecoder SPIRVEntry::getDecoder(std::istream &I) {
-  return SPIRVDecoder(I, *Module);
-}
-
 void SPIRVEntry::setWordCount(SPIRVWord TheWordCount) {
   WordCount = TheWordCount;
 }
 
+const std::string SPIRVEntry::EmptyName;
+
 void SPIRVEntry::setName(const std::string &TheName) {
-  Name = TheName;
-  SPIRVDBG(spvdbgs() << "Set name for obj " << Id << " " << Name << '\n');
+  assert(Module && "Cannot name an entry without a module");
+  Name = TheName.empty() ? &EmptyName : &Module->internName(TheName);
+  SPIRVDBG(spvdbgs() << "Set name for obj " << Id << " " << *Name << '\n');
 }
 
 void SPIRVEntry::setModule(SPIRVModule *TheModule) {
@@ -152,15 +222,23 @@ void SPIRVEntry::setModule(SPIRVModule *TheModule) {
   Module = TheModule;
 }
 
-void SPIRVEntry::encode(spv_ostream &O) const {
+void SPIRVEntry::encode(const SPIRVBinaryEncoder &O) const {
   assert(0 && "Not implemented");
 }
 
-void SPIRVEntry::encodeName(spv_ostream &O) const {
-  if (!Name.empty())
-    O << SPIRVName(this, Name);
+void SPIRVEntry::encode(const SPIRVTextEncoder &O) const {
+  assert(0 && "Not implemented");
+}
+
+template <typename FormatTy>
+void SPIRVEntry::encodeName(const SPIRVEncoder<FormatTy> &O) const {
+  if (!Name->empty())
+    O << SPIRVName(this, *Name);
 }
 
+template void SPIRVEntry::encodeName(const SPIRVBinaryEncoder &O) const;
+template void SPIRVEntry::encodeName(const SPIRVTextEncoder &O) const;
+
 bool SPIRVEntry::isEndOfBlock() const {
   switch (OpCode) {
   case OpBranch:
@@ -176,7 +254,8 @@ bool SPIRVEntry::isEndOfBlock() const {
   }
 }
 
-void SPIRVEntry::encodeLine(spv_ostream &O) const {
+template <typename FormatTy>
+void SPIRVEntry::encodeLine(const SPIRVEncoder<FormatTy> &O) const {
   if (!Module)
     return;
   const std::shared_ptr<const SPIRVLine> &CurrLine = Module->getCurrentLine();
@@ -204,7 +283,8 @@ bool isDebugLineEqual(const SPIRVExtInst &DL1, const SPIRVExtInst &DL2) {
 }
 } // namespace
 
-void SPIRVEntry::encodeDebugLine(spv_ostream &O) const {
+template <typename FormatTy>
+void SPIRVEntry::encodeDebugLine(const SPIRVEncoder<FormatTy> &O) const {
   if (!Module)
     return;
   const std::shared_ptr<const SPIRVExtInst> &CurrDebugLine =
@@ -222,7 +302,9 @@ void SPIRVEntry::encodeDebugLine(spv_ostream &O) const {
     Module->setCurrentDebugLine(nullptr);
 }
 
-void SPIRVEntry::encodeAll(spv_ostream &O) const {
+template <typename FormatTy>
+void SPIRVEntry::encodeAllImpl(const SPIRVEncoder<FormatTy> &O) const {
+  SPIRVTRACE(SPIRVTC_Encode, "entry", OpCode, hasId() ? Id : 0);
   encodeLine(O);
   encodeDebugLine(O);
   encodeWordCountOpCode(O);
@@ -230,44 +312,64 @@ void SPIRVEntry::encodeAll(spv_ostream &O) const {
   encodeChildren(O);
 }
 
-void SPIRVEntry::encodeChildren(spv_ostream &O) const {}
+void SPIRVEntry::encodeAll(const SPIRVBinaryEncoder &O) const {
+  encodeAllImpl(O);
+}
+
+void SPIRVEntry::encodeAll(const SPIRVTextEncoder &O) const {
+  encodeAllImpl(O);
+}
+
+void SPIRVEntry::encodeChildren(const SPIRVBinaryEncoder &O) const {}
+
+void SPIRVEntry::encodeChildren(const SPIRVTextEncoder &O) const {}
 
-void SPIRVEntry::encodeWordCountOpCode(spv_ostream &O) const {
-#ifdef _SPIRV_SUPPORT_TEXT_FMT
-  if (SPIRVUseTextFormat) {
-    getEncoder(O) << WordCount << OpCode;
+template <typename FormatTy>
+void SPIRVEntry::encodeWordCountOpCode(const SPIRVEncoder<FormatTy> &O) const {
+  if constexpr (FormatTy::IsText) {
+    O << WordCount << OpCode;
     return;
   }
-#endif
   assert(WordCount < 65536 && "WordCount must fit into 16-bit value");
   SPIRVWord WordCountOpCode = (WordCount << WordCountShift) | OpCode;
-  getEncoder(O) << WordCountOpCode;
+  O << WordCountOpCode;
 }
 // Read words from SPIRV binary and create members for SPIRVEntry.
 // The word count and op code has already been read before calling this
 // function for creating the SPIRVEntry. Therefore the input stream only
 // contains the remaining part of the words for the SPIRVEntry.
-void SPIRVEntry::decode(std::istream &I) { assert(0 && "Not implemented"); }
+void SPIRVEntry::decode(const SPIRVBinaryDecoder &I) {
+  assert(0 && "Not implemented");
+}
+
+void SPIRVEntry::decode(const SPIRVTextDecoder &I) {
+  assert(0 && "Not implemented");
+}
+
+SPIRVValue *SPIRVIdToValue::operator()(SPIRVId Id) const {
+  return Module->getValue(Id);
+}
+
+SPIRVType *SPIRVIdToValueType::operator()(SPIRVId Id) const {
+  return Module->getValue(Id)->getType();
+}
 
 std::vector<SPIRVValue *>
 SPIRVEntry::getValues(const std::vector<SPIRVId> &IdVec) const {
-  std::vector<SPIRVValue *> ValueVec;
-  for (auto I : IdVec)
-    ValueVec.push_back(getValue(I));
-  return ValueVec;
+  SPIRVValueRange Values = getValueRange(IdVec);
+  return std::vector<SPIRVValue *>(Values.begin(), Values.end());
 }
 
 std::vector<SPIRVType *>
 SPIRVEntry::getValueTypes(const std::vector<SPIRVId> &IdVec) const {
-  std::vector<SPIRVType *> TypeVec;
-  for (auto I : IdVec)
-    TypeVec.push_back(getValue(I)->getType());
-  return TypeVec;
+  SPIRVValueTypeRange Types = getValueTypeRange(IdVec);
+  return std::vector<SPIRVType *>(Types.begin(), Types.end());
 }
 
 std::vector<SPIRVId>
-SPIRVEntry::getIds(const std::vector<SPIRVValue *> ValueVec) const {
+SPIRVEntry::getIds(const std::vector<SPIRVValue *> &ValueVec) const {
   std::vector<SPIRVId> IdVec;
+  IdVec.reserve(ValueVec.size());
   for (auto *I : ValueVec)
     IdVec.push_back(I->getId());
   return IdVec;
@@ -571,7 +673,8 @@ bool SPIRVEntry::isExtInst(const SPIRVExtInstSetKind InstSet,
   return false;
 }
 
-void SPIRVEntry::encodeDecorate(spv_ostream &O) const {
+template <typename FormatTy>
+void SPIRVEntry::encodeDecorate(const SPIRVEncoder<FormatTy> &O) const {
   for (auto &I : Decorates)
     O << *I.second;
   for (auto &I : DecorateIds)
@@ -591,7 +694,7 @@ SPIRVLinkageTypeKind SPIRVEntry::getLinkageType() const {
 void SPIRVEntry::setLinkageType(SPIRVLinkageTypeKind LT) {
   assert(isValid(LT));
   assert(hasLinkageType());
-  addDecorate(new SPIRVDecorateLinkageAttr(this, Name, LT));
+  addDecorate(new SPIRVDecorateLinkageAttr(this, *Name, LT));
 }
 
 void SPIRVEntry::updateModuleVersion() const {
@@ -601,18 +704,6 @@ void SPIRVEntry::updateModuleVersion() const {
   Module->setMinSPIRVVersion(getRequiredSPIRVVersion());
 }
 
-spv_ostream &operator<<(spv_ostream &O, const SPIRVEntry &E) {
-  E.validate();
-  E.encodeAll(O);
-  O << SPIRVNL();
-  return O;
-}
-
-std::istream &operator>>(std::istream &I, SPIRVEntry &E) {
-  E.decode(I);
-  return I;
-}
-
 SPIRVEntryPoint::SPIRVEntryPoint(SPIRVModule *TheModule,
                                  SPIRVExecutionModelKind TheExecModel,
                                  SPIRVId TheId, const std::string &TheName,
@@ -621,24 +712,30 @@ SPIRVEntryPoint::SPIRVEntryPoint(SPIRVModule *TheModule,
                       getSizeInWords(TheName) + Variables.size() + 3),
       ExecModel(TheExecModel), Name(TheName), Variables(Variables) {}
 
-void SPIRVEntryPoint::encode(spv_ostream &O) const {
-  getEncoder(O) << ExecModel << Target << Name << Variables;
+template <typename FormatTy>
+void SPIRVEntryPoint::encodeImpl(const SPIRVEncoder<FormatTy> &O) const {
+  O << ExecModel << Target << Name << Variables;
 }
 
-void SPIRVEntryPoint::decode(std::istream &I) {
-  getDecoder(I) >> ExecModel >> Target >> Name;
+template <typename FormatTy>
+void SPIRVEntryPoint::decodeImpl(const SPIRVDecoder<FormatTy> &I) {
+  I >> ExecModel >> Target >> Name;
   Variables.resize(WordCount - FixedWC - getSizeInWords(Name) + 1);
-  getDecoder(I) >> Variables;
+  I >> Variables;
   Module->setName(getOrCreateTarget(), Name);
   Module->addEntryPoint(ExecModel, Target, Name, Variables);
 }
 
-void SPIRVExecutionMode::encode(spv_ostream &O) const {
-  getEncoder(O) << Target << ExecMode << WordLiterals;
+_SPIRV_IMP_ENCDEC_FORMATS(SPIRVEntryPoint)
+
+template <typename FormatTy>
+void SPIRVExecutionMode::encodeImpl(const SPIRVEncoder<FormatTy> &O) const {
+  O << Target << ExecMode << WordLiterals;
 }
 
-void SPIRVExecutionMode::decode(std::istream &I) {
-  getDecoder(I) >> Target >> ExecMode;
+template <typename FormatTy>
+void SPIRVExecutionMode::decodeImpl(const SPIRVDecoder<FormatTy> &I) {
+  I >> Target >> ExecMode;
   switch (static_cast<uint32_t>(ExecMode)) {
   case ExecutionModeLocalSize:
   case ExecutionModeLocalSizeHint:
@@ -675,10 +772,12 @@ void SPIRVExecutionMode::decode(std::istream &I) {
     // Do nothing. Keep this to avoid VS2013 warning.
     break;
   }
-  getDecoder(I) >> WordLiterals;
+  I >> WordLiterals;
   getOrCreateTarget()->addExecutionMode(Module->add(this));
 }
 
+_SPIRV_IMP_ENCDEC_FORMATS(SPIRVExecutionMode)
+
 SPIRVForward *SPIRVAnnotationGeneric::getOrCreateTarget() const {
   SPIRVEntry *Entry = nullptr;
   bool Found = Module->exist(Target, &Entry);
@@ -693,13 +792,19 @@ SPIRVName::SPIRVName(const SPIRVEntry *TheTarget, const std::string &TheStr)
     : SPIRVAnnotation(OpName, TheTarget, getSizeInWords(TheStr) + 2),
       Str(TheStr) {}
 
-void SPIRVName::encode(spv_ostream &O) const { getEncoder(O) << Target << Str; }
+template <typename FormatTy>
+void SPIRVName::encodeImpl(const SPIRVEncoder<FormatTy> &O) const {
+  O << Target << Str;
+}
 
-void SPIRVName::decode(std::istream &I) {
-  getDecoder(I) >> Target >> Str;
+template <typename FormatTy>
+void SPIRVName::decodeImpl(const SPIRVDecoder<FormatTy> &I) {
+  I >> Target >> Str;
   Module->setName(getOrCreateTarget(), Str);
 }
 
+_SPIRV_IMP_ENCDEC_FORMATS(SPIRVName)
+
 void SPIRVName::validate() const {
   assert(WordCount == getSizeInWords(Str) + 2 && "Incorrect word count");
 }
@@ -707,14 +812,18 @@ void SPIRVName::validate() const {
 _SPIRV_IMP_ENCDEC2(SPIRVString, Id, Str)
 _SPIRV_IMP_ENCDEC3(SPIRVMemberName, Target, MemberNumber, Str)
 
-void SPIRVLine::encode(spv_ostream &O) const {
-  getEncoder(O) << FileName << Line << Column;
+template <typename FormatTy>
+void SPIRVLine::encodeImpl(const SPIRVEncoder<FormatTy> &O) const {
+  O << FileName << Line << Column;
 }
 
-void SPIRVLine::decode(std::istream &I) {
-  getDecoder(I) >> FileName >> Line >> Column;
+template <typename FormatTy>
+void SPIRVLine::decodeImpl(const SPIRVDecoder<FormatTy> &I) {
+  I >> FileName >> Line >> Column;
 }
 
+_SPIRV_IMP_ENCDEC_FORMATS(SPIRVLine)
+
 void SPIRVLine::validate() const {
   assert(OpCode == OpLine);
   assert(WordCount == 4);
@@ -738,32 +847,40 @@ SPIRVExtInstImport::SPIRVExtInstImport(SPIRVModule *TheModule, SPIRVId TheId,
   validate();
 }
 
-void SPIRVExtInstImport::encode(spv_ostream &O) const {
-  getEncoder(O) << Id << Str;
+template <typename FormatTy>
+void SPIRVExtInstImport::encodeImpl(const SPIRVEncoder<FormatTy> &O) const {
+  O << Id << Str;
 }
 
-void SPIRVExtInstImport::decode(std::istream &I) {
-  getDecoder(I) >> Id >> Str;
+template <typename FormatTy>
+void SPIRVExtInstImport::decodeImpl(const SPIRVDecoder<FormatTy> &I) {
+  I >> Id >> Str;
   Module->importBuiltinSetWithId(Str, Id);
 }
 
+_SPIRV_IMP_ENCDEC_FORMATS(SPIRVExtInstImport)
+
 void SPIRVExtInstImport::validate() const {
   SPIRVEntry::validate();
   assert(!Str.empty() && "Invalid builtin set");
 }
 
-void SPIRVMemoryModel::encode(spv_ostream &O) const {
-  getEncoder(O) << Module->getAddressingModel() << Module->getMemoryModel();
+template <typename FormatTy>
+void SPIRVMemoryModel::encodeImpl(const SPIRVEncoder<FormatTy> &O) const {
+  O << Module->getAddressingModel() << Module->getMemoryModel();
 }
 
-void SPIRVMemoryModel::decode(std::istream &I) {
+template <typename FormatTy>
+void SPIRVMemoryModel::decodeImpl(const SPIRVDecoder<FormatTy> &I) {
   SPIRVAddressingModelKind AddrModel;
   SPIRVMemoryModelKind MemModel;
-  getDecoder(I) >> AddrModel >> MemModel;
+  I >> AddrModel >> MemModel;
   Module->setAddressingModel(AddrModel);
   Module->setMemoryModel(MemModel);
 }
 
+_SPIRV_IMP_ENCDEC_FORMATS(SPIRVMemoryModel)
+
 void SPIRVMemoryModel::validate() const {
   auto AM = Module->getAddressingModel();
   auto MM = Module->getMemoryModel();
@@ -772,63 +889,107 @@ void SPIRVMemoryModel::validate() const {
   SPIRVCK(isValid(MM), InvalidMemoryModel, "Actual is " + std::to_string(MM));
 }
 
-void SPIRVSource::encode(spv_ostream &O) const {
+template <typename FormatTy>
+void SPIRVSource::encodeImpl(const SPIRVEncoder<FormatTy> &O) const {
   SPIRVWord Ver = SPIRVWORD_MAX;
   auto Language = Module->getSourceLanguage(&Ver);
-  getEncoder(O) << Language << Ver;
+  O << Language << Ver;
 }
 
-void SPIRVSource::decode(std::istream &I) {
+template <typename FormatTy>
+void SPIRVSource::decodeImpl(const SPIRVDecoder<FormatTy> &I) {
   SourceLanguage Lang = SourceLanguageUnknown;
   SPIRVWord Ver = SPIRVWORD_MAX;
-  getDecoder(I) >> Lang >> Ver;
+  I >> Lang >> Ver;
   Module->setSourceLanguage(Lang, Ver);
 }
 
+_SPIRV_IMP_ENCDEC_FORMATS(SPIRVSource)
+
 SPIRVSourceExtension::SPIRVSourceExtension(SPIRVModule *M,
                                            const std::string &SS)
     : SPIRVEntryNoId(M, 1 + getSizeInWords(SS)), S(SS) {}
 
-void SPIRVSourceExtension::encode(spv_ostream &O) const { getEncoder(O) << S; }
+template <typename FormatTy>
+void SPIRVSourceExtension::encodeImpl(const SPIRVEncoder<FormatTy> &O) const {
+  O << S;
+}
 
-void SPIRVSourceExtension::decode(std::istream &I) {
-  getDecoder(I) >> S;
+template <typename FormatTy>
+void SPIRVSourceExtension::decodeImpl(const SPIRVDecoder<FormatTy> &I) {
+  I >> S;
   Module->getSourceExtension().insert(S);
 }
 
+_SPIRV_IMP_ENCDEC_FORMATS(SPIRVSourceExtension)
+
 SPIRVExtension::SPIRVExtension(SPIRVModule *M, const std::string &SS)
     : SPIRVEntryNoId(M, 1 + getSizeInWords(SS)), S(SS) {}
 
-void SPIRVExtension::encode(spv_ostream &O) const { getEncoder(O) << S; }
+template <typename FormatTy>
+void SPIRVExtension::encodeImpl(const SPIRVEncoder<FormatTy> &O) const {
+  O << S;
+}
 
-void SPIRVExtension::decode(std::istream &I) {
-  getDecoder(I) >> S;
+template <typename FormatTy>
+void SPIRVExtension::decodeImpl(const SPIRVDecoder<FormatTy> &I) {
+  I >> S;
   Module->getExtension().insert(S);
 }
 
+_SPIRV_IMP_ENCDEC_FORMATS(SPIRVExtension)
+
 SPIRVCapability::SPIRVCapability(SPIRVModule *M, SPIRVCapabilityKind K)
     : SPIRVEntryNoId(M, 2), Kind(K) {
   updateModuleVersion();
 }
 
-void SPIRVCapability::encode(spv_ostream &O) const { getEncoder(O) << Kind; }
+template <typename FormatTy>
+void SPIRVCapability::encodeImpl(const SPIRVEncoder<FormatTy> &O) const {
+  O << Kind;
+}
 
-void SPIRVCapability::decode(std::istream &I) {
-  getDecoder(I) >> Kind;
+template <typename FormatTy>
+void SPIRVCapability::decodeImpl(const SPIRVDecoder<FormatTy> &I) {
+  I >> Kind;
   Module->addCapability(Kind);
 }
 
+_SPIRV_IMP_ENCDEC_FORMATS(SPIRVCapability)
+
 template <spv::Op OC> void SPIRVContinuedInstINTELBase<OC>::validate() const {
   SPIRVEntry::validate();
 }
 
 template <spv::Op OC>
-void SPIRVContinuedInstINTELBase<OC>::encode(spv_ostream &O) const {
-  SPIRVEntry::getEncoder(O) << (Elements);
+template <typename FormatTy>
+void SPIRVContinuedInstINTELBase<OC>::encodeImpl(
+    const SPIRVEncoder<FormatTy> &O) const {
+  O << (Elements);
+}
+template <spv::Op OC>
+template <typename FormatTy>
+void SPIRVContinuedInstINTELBase<OC>::decodeImpl(
+    const SPIRVDecoder<FormatTy> &I) {
+  I >> (Elements);
+}
+
+template <spv::Op OC>
+void SPIRVContinuedInstINTELBase<OC>::encode(
+    const SPIRVBinaryEncoder &O) const {
+  encodeImpl(O);
 }
 template <spv::Op OC>
-void SPIRVContinuedInstINTELBase<OC>::decode(std::istream &I) {
-  SPIRVEntry::getDecoder(I) >> (Elements);
+void SPIRVContinuedInstINTELBase<OC>::encode(const SPIRVTextEncoder &O) const {
+  encodeImpl(O);
+}
+template <spv::Op OC>
+void SPIRVContinuedInstINTELBase<OC>::decode(const SPIRVBinaryDecoder &I) {
+  decodeImpl(I);
+}
+template <spv::Op OC>
+void SPIRVContinuedInstINTELBase<OC>::decode(const SPIRVTextDecoder &I) {
+  decodeImpl(I);
 }
 
 SPIRVType *SPIRVTypeStructContinuedINTEL::getMemberType(size_t I) const {
@@ -840,15 +1001,19 @@ void SPIRVModuleProcessed::validate() const {
          "Incorrect word count in OpModuleProcessed");
 }
 
-void SPIRVModuleProcessed::encode(spv_ostream &O) const {
-  getEncoder(O) << ProcessStr;
+template <typename FormatTy>
+void SPIRVModuleProcessed::encodeImpl(const SPIRVEncoder<FormatTy> &O) const {
+  O << ProcessStr;
 }
 
-void SPIRVModuleProcessed::decode(std::istream &I) {
-  getDecoder(I) >> ProcessStr;
+template <typename FormatTy>
+void SPIRVModuleProcessed::decodeImpl(const SPIRVDecoder<FormatTy> &I) {
+  I >> ProcessStr;
   Module->addModuleProcessed(ProcessStr);
 }
 
+_SPIRV_IMP_ENCDEC_FORMATS(SPIRVModuleProcessed)
+
 std::string SPIRVModuleProcessed::getProcessStr() { return ProcessStr; }
 
 } // namespace SPIRV
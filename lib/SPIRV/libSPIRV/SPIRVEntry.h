@@ -45,6 +45,11 @@
 #include "SPIRVError.h"
 #include "SPIRVIsValidEnum.h"
 
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/iterator_range.h"
+
 #include <cassert>
 #include <iostream>
 #include <map>
@@ -57,8 +62,14 @@
 namespace SPIRV {
 
 class SPIRVModule;
-class SPIRVEncoder;
-class SPIRVDecoder;
+struct SPIRVBinaryFormat;
+struct SPIRVTextFormat;
+template <typename FormatTy> class SPIRVEncoder;
+template <typename FormatTy> class SPIRVDecoder;
+typedef SPIRVEncoder<SPIRVBinaryFormat> SPIRVBinaryEncoder;
+typedef SPIRVEncoder<SPIRVTextFormat> SPIRVTextEncoder;
+typedef SPIRVDecoder<SPIRVBinaryFormat> SPIRVBinaryDecoder;
+typedef SPIRVDecoder<SPIRVTextFormat> SPIRVTextDecoder;
 class SPIRVType;
 class SPIRVValue;
 class SPIRVDecorate;
@@ -69,136 +80,242 @@ class SPIRVLine;
 class SPIRVString;
 class SPIRVExtInst;
 
+/// Maps an id to the value it refers to in a module.
+struct SPIRVIdToValue {
+  const SPIRVModule *Module;
+  SPIRVValue *operator()(SPIRVId Id) const;
+};
+
+/// Maps an id to the type of the value it refers to in a module.
+struct SPIRVIdToValueType {
+  const SPIRVModule *Module;
+  SPIRVType *operator()(SPIRVId Id) const;
+};
+
+/// The values, or value types, of a list of ids. The entries are looked up
+/// while iterating, so no vector is built.
+typedef llvm::iterator_range<
+    llvm::mapped_iterator<llvm::ArrayRef<SPIRVId>::iterator, SPIRVIdToValue>>
+    SPIRVValueRange;
+typedef llvm::iterator_range<llvm::mapped_iterator<
+    llvm::ArrayRef<SPIRVId>::iterator, SPIRVIdToValueType>>
+    SPIRVValueTypeRange;
+
 // Add declaration of encode/decode functions to a class.
-// Used inside class definition.
+// Used inside class definition. The functions are written once, as the
+// member templates encodeImpl and decodeImpl over the stream format, and the
+// virtual encode and decode functions of every format call them, so the
+// format of the stream is known at compile time when the operands are read
+// and written.
 #define _SPIRV_DCL_ENCDEC                                                      \
-  void encode(spv_ostream &O) const override;                                  \
-  void decode(std::istream &I) override;
+  void encode(const SPIRVBinaryEncoder &O) const override;                     \
+  void encode(const SPIRVTextEncoder &O) const override;                       \
+  void decode(const SPIRVBinaryDecoder &I) override;                           \
+  void decode(const SPIRVTextDecoder &I) override;                             \
+  template <typename FormatTy>                                                 \
+  void encodeImpl(const SPIRVEncoder<FormatTy> &O) const;                      \
+  template <typename FormatTy> void decodeImpl(const SPIRVDecoder<FormatTy> &I);
 
 #define _REQ_SPIRV_VER(Version)                                                \
   VersionNumber getRequiredSPIRVVersion() const override { return Version; }
 
+// Add the encode/decode functions of every stream format, which call
+// encodeImpl and decodeImpl, to a class. Used out side of class definition.
+#define _SPIRV_IMP_ENCDEC_FORMATS(Ty)                                          \
+  void Ty::encode(const SPIRVBinaryEncoder &O) const { encodeImpl(O); }        \
+  void Ty::encode(const SPIRVTextEncoder &O) const { encodeImpl(O); }          \
+  void Ty::decode(const SPIRVBinaryDecoder &I) { decodeImpl(I); }              \
+  void Ty::decode(const SPIRVTextDecoder &I) { decodeImpl(I); }
+
 // Add implementation of encode/decode functions to a class.
 // Used out side of class definition.
 #define _SPIRV_IMP_ENCDEC0(Ty)                                                 \
-  void Ty::encode(spv_ostream &O) const {}                                     \
-  void Ty::decode(std::istream &I) {}
+  template <typename FormatTy>                                                 \
+  void Ty::encodeImpl(const SPIRVEncoder<FormatTy> &O) const {}                \
+  template <typename FormatTy>                                                 \
+  void Ty::decodeImpl(const SPIRVDecoder<FormatTy> &I) {}                      \
+  _SPIRV_IMP_ENCDEC_FORMATS(Ty)
 #define _SPIRV_IMP_ENCDEC1(Ty, x)                                              \
-  void Ty::encode(spv_ostream &O) const { getEncoder(O) << (x); }              \
-  void Ty::decode(std::istream &I) { getDecoder(I) >> (x); }
+  template <typename FormatTy>                                                 \
+  void Ty::encodeImpl(const SPIRVEncoder<FormatTy> &O) const { O << (x); }     \
+  template <typename FormatTy>                                                 \
+  void Ty::decodeImpl(const SPIRVDecoder<FormatTy> &I) { I >> (x); }           \
+  _SPIRV_IMP_ENCDEC_FORMATS(Ty)
 #define _SPIRV_IMP_ENCDEC2(Ty, x, y)                                           \
-  void Ty::encode(spv_ostream &O) const { getEncoder(O) << (x) << (y); }       \
-  void Ty::decode(std::istream &I) { getDecoder(I) >> (x) >> (y); }
+  template <typename FormatTy>                                                 \
+  void Ty::encodeImpl(const SPIRVEncoder<FormatTy> &O) const {                 \
+    O << (x) << (y);                                                           \
+  }                                                                            \
+  template <typename FormatTy>                                                 \
+  void Ty::decodeImpl(const SPIRVDecoder<FormatTy> &I) { I >> (x) >> (y); }    \
+  _SPIRV_IMP_ENCDEC_FORMATS(Ty)
 #define _SPIRV_IMP_ENCDEC3(Ty, x, y, z)                                        \
-  void Ty::encode(spv_ostream &O) const {                                      \
-    getEncoder(O) << (x) << (y) << (z);                                        \
+  template <typename FormatTy>                                                 \
+  void Ty::encodeImpl(const SPIRVEncoder<FormatTy> &O) const {                 \
+    O << (x) << (y) << (z);                                                    \
   }                                                                            \
-  void Ty::decode(std::istream &I) { getDecoder(I) >> (x) >> (y) >> (z); }
+  template <typename FormatTy>                                                 \
+  void Ty::decodeImpl(const SPIRVDecoder<FormatTy> &I) {                       \
+    I >> (x) >> (y) >> (z);                                                    \
+  }                                                                            \
+  _SPIRV_IMP_ENCDEC_FORMATS(Ty)
 #define _SPIRV_IMP_ENCDEC4(Ty, x, y, z, u)                                     \
-  void Ty::encode(spv_ostream &O) const {                                      \
-    getEncoder(O) << (x) << (y) << (z) << (u);                                 \
+  template <typename FormatTy>                                                 \
+  void Ty::encodeImpl(const SPIRVEncoder<FormatTy> &O) const {                 \
+    O << (x) << (y) << (z) << (u);                                             \
   }                                                                            \
-  void Ty::decode(std::istream &I) {                                           \
-    getDecoder(I) >> (x) >> (y) >> (z) >> (u);                                 \
-  }
+  template <typename FormatTy>                                                 \
+  void Ty::decodeImpl(const SPIRVDecoder<FormatTy> &I) {                       \
+    I >> (x) >> (y) >> (z) >> (u);                                             \
+  }                                                                            \
+  _SPIRV_IMP_ENCDEC_FORMATS(Ty)
 #define _SPIRV_IMP_ENCDEC5(Ty, x, y, z, u, v)                                  \
-  void Ty::encode(spv_ostream &O) const {                                      \
-    getEncoder(O) << (x) << (y) << (z) << (u) << (v);                          \
+  template <typename FormatTy>                                                 \
+  void Ty::encodeImpl(const SPIRVEncoder<FormatTy> &O) const {                 \
+    O << (x) << (y) << (z) << (u) << (v);                                      \
   }                                                                            \
-  void Ty::decode(std::istream &I) {                                           \
-    getDecoder(I) >> (x) >> (y) >> (z) >> (u) >> (v);                          \
-  }
+  template <typename FormatTy>                                                 \
+  void Ty::decodeImpl(const SPIRVDecoder<FormatTy> &I) {                       \
+    I >> (x) >> (y) >> (z) >> (u) >> (v);                                      \
+  }                                                                            \
+  _SPIRV_IMP_ENCDEC_FORMATS(Ty)
 #define _SPIRV_IMP_ENCDEC6(Ty, x, y, z, u, v, w)                               \
-  void Ty::encode(spv_ostream &O) const {                                      \
-    getEncoder(O) << (x) << (y) << (z) << (u) << (v) << (w);                   \
+  template <typename FormatTy>                                                 \
+  void Ty::encodeImpl(const SPIRVEncoder<FormatTy> &O) const {                 \
+    O << (x) << (y) << (z) << (u) << (v) << (w);                               \
   }                                                                            \
-  void Ty::decode(std::istream &I) {                                           \
-    getDecoder(I) >> (x) >> (y) >> (z) >> (u) >> (v) >> (w);                   \
-  }
+  template <typename FormatTy>                                                 \
+  void Ty::decodeImpl(const SPIRVDecoder<FormatTy> &I) {                       \
+    I >> (x) >> (y) >> (z) >> (u) >> (v) >> (w);                               \
+  }                                                                            \
+  _SPIRV_IMP_ENCDEC_FORMATS(Ty)
 #define _SPIRV_IMP_ENCDEC7(Ty, x, y, z, u, v, w, r)                            \
-  void Ty::encode(spv_ostream &O) const {                                      \
-    getEncoder(O) << (x) << (y) << (z) << (u) << (v) << (w) << (r);            \
+  template <typename FormatTy>                                                 \
+  void Ty::encodeImpl(const SPIRVEncoder<FormatTy> &O) const {                 \
+    O << (x) << (y) << (z) << (u) << (v) << (w) << (r);                        \
   }                                                                            \
-  void Ty::decode(std::istream &I) {                                           \
-    getDecoder(I) >> (x) >> (y) >> (z) >> (u) >> (v) >> (w) >> (r);            \
-  }
+  template <typename FormatTy>                                                 \
+  void Ty::decodeImpl(const SPIRVDecoder<FormatTy> &I) {                       \
+    I >> (x) >> (y) >> (z) >> (u) >> (v) >> (w) >> (r);                        \
+  }                                                                            \
+  _SPIRV_IMP_ENCDEC_FORMATS(Ty)
 #define _SPIRV_IMP_ENCDEC8(Ty, x, y, z, u, v, w, r, s)                         \
-  void Ty::encode(spv_ostream &O) const {                                      \
-    getEncoder(O) << (x) << (y) << (z) << (u) << (v) << (w) << (r) << (s);     \
+  template <typename FormatTy>                                                 \
+  void Ty::encodeImpl(const SPIRVEncoder<FormatTy> &O) const {                 \
+    O << (x) << (y) << (z) << (u) << (v) << (w) << (r) << (s);                 \
   }                                                                            \
-  void Ty::decode(std::istream &I) {                                           \
-    getDecoder(I) >> (x) >> (y) >> (z) >> (u) >> (v) >> (w) >> (r) >> (s);     \
-  }
+  template <typename FormatTy>                                                 \
+  void Ty::decodeImpl(const SPIRVDecoder<FormatTy> &I) {                       \
+    I >> (x) >> (y) >> (z) >> (u) >> (v) >> (w) >> (r) >> (s);                 \
+  }                                                                            \
+  _SPIRV_IMP_ENCDEC_FORMATS(Ty)
 #define _SPIRV_IMP_ENCDEC9(Ty, x, y, z, u, v, w, r, s, t)                      \
-  void Ty::encode(spv_ostream &O) const {                                      \
-    getEncoder(O) << (x) << (y) << (z) << (u) << (v) << (w) << (r) << (s)      \
-                  << (t);                                                      \
+  template <typename FormatTy>                                                 \
+  void Ty::encodeImpl(const SPIRVEncoder<FormatTy> &O) const {                 \
+    O << (x) << (y) << (z) << (u) << (v) << (w) << (r) << (s) << (t);          \
   }                                                                            \
-  void Ty::decode(std::istream &I) {                                           \
-    getDecoder(I) >> (x) >> (y) >> (z) >> (u) >> (v) >> (w) >> (r) >> (s) >>   \
-        (t);                                                                   \
-  }
+  template <typename FormatTy>                                                 \
+  void Ty::decodeImpl(const SPIRVDecoder<FormatTy> &I) {                       \
+    I >> (x) >> (y) >> (z) >> (u) >> (v) >> (w) >> (r) >> (s) >> (t);          \
+  }                                                                            \
+  _SPIRV_IMP_ENCDEC_FORMATS(Ty)
+
+// Add the encode/decode functions of every stream format, which call
+// encodeImpl and decodeImpl, to a class. Used inside class definition.
+#define _SPIRV_DEF_ENCDEC_FORMATS                                              \
+  void encode(const SPIRVBinaryEncoder &O) const override { encodeImpl(O); }   \
+  void encode(const SPIRVTextEncoder &O) const override { encodeImpl(O); }     \
+  void decode(const SPIRVBinaryDecoder &I) override { decodeImpl(I); }         \
+  void decode(const SPIRVTextDecoder &I) override { decodeImpl(I); }
 
 // Add definition of encode/decode functions to a class.
 // Used inside class definition.
 #define _SPIRV_DEF_ENCDEC0                                                     \
-  void encode(spv_ostream &O) const override {}                                \
-  void decode(std::istream &I) override {}
+  template <typename FormatTy>                                                 \
+  void encodeImpl(const SPIRVEncoder<FormatTy> &O) const {}                    \
+  template <typename FormatTy>                                                 \
+  void decodeImpl(const SPIRVDecoder<FormatTy> &I) {}                          \
+  _SPIRV_DEF_ENCDEC_FORMATS
 #define _SPIRV_DEF_ENCDEC1(x)                                                  \
-  void encode(spv_ostream &O) const override { getEncoder(O) << (x); }         \
-  void decode(std::istream &I) override { getDecoder(I) >> (x); }
+  template <typename FormatTy>                                                 \
+  void encodeImpl(const SPIRVEncoder<FormatTy> &O) const { O << (x); }         \
+  template <typename FormatTy>                                                 \
+  void decodeImpl(const SPIRVDecoder<FormatTy> &I) { I >> (x); }               \
+  _SPIRV_DEF_ENCDEC_FORMATS
 #define _SPIRV_DEF_ENCDEC2(x, y)                                               \
-  void encode(spv_ostream &O) const override { getEncoder(O) << (x) << (y); }  \
-  void decode(std::istream &I) override { getDecoder(I) >> (x) >> (y); }
+  template <typename FormatTy>                                                 \
+  void encodeImpl(const SPIRVEncoder<FormatTy> &O) const { O << (x) << (y); }  \
+  template <typename FormatTy>                                                 \
+  void decodeImpl(const SPIRVDecoder<FormatTy> &I) { I >> (x) >> (y); }        \
+  _SPIRV_DEF_ENCDEC_FORMATS
 #define _SPIRV_DEF_ENCDEC3(x, y, z)                                            \
-  void encode(spv_ostream &O) const override {                                 \
-    getEncoder(O) << (x) << (y) << (z);                                        \
+  template <typename FormatTy>                                                 \
+  void encodeImpl(const SPIRVEncoder<FormatTy> &O) const {                     \
+    O << (x) << (y) << (z);                                                    \
   }                                                                            \
-  void decode(std::istream &I) override { getDecoder(I) >> (x) >> (y) >> (z); }
+  template <typename FormatTy>                                                 \
+  void decodeImpl(const SPIRVDecoder<FormatTy> &I) { I >> (x) >> (y) >> (z); } \
+  _SPIRV_DEF_ENCDEC_FORMATS
 #define _SPIRV_DEF_ENCDEC4(x, y, z, u)                                         \
-  void encode(spv_ostream &O) const override {                                 \
-    getEncoder(O) << (x) << (y) << (z) << (u);                                 \
+  template <typename FormatTy>                                                 \
+  void encodeImpl(const SPIRVEncoder<FormatTy> &O) const {                     \
+    O << (x) << (y) << (z) << (u);                                             \
   }                                                                            \
-  void decode(std::istream &I) override {                                      \
-    getDecoder(I) >> (x) >> (y) >> (z) >> (u);                                 \
-  }
+  template <typename FormatTy>                                                 \
+  void decodeImpl(const SPIRVDecoder<FormatTy> &I) {                           \
+    I >> (x) >> (y) >> (z) >> (u);                                             \
+  }                                                                            \
+  _SPIRV_DEF_ENCDEC_FORMATS
 #define _SPIRV_DEF_ENCDEC5(x, y, z, u, v)                                      \
-  void encode(spv_ostream &O) const override {                                 \
-    getEncoder(O) << (x) << (y) << (z) << (u) << (v);                          \
+  template <typename FormatTy>                                                 \
+  void encodeImpl(const SPIRVEncoder<FormatTy> &O) const {                     \
+    O << (x) << (y) << (z) << (u) << (v);                                      \
   }                                                                            \
-  void decode(std::istream &I) override {                                      \
-    getDecoder(I) >> (x) >> (y) >> (z) >> (u) >> (v);                          \
-  }
+  template <typename FormatTy>                                                 \
+  void decodeImpl(const SPIRVDecoder<FormatTy> &I) {                           \
+    I >> (x) >> (y) >> (z) >> (u) >> (v);                                      \
+  }                                                                            \
+  _SPIRV_DEF_ENCDEC_FORMATS
 #define _SPIRV_DEF_ENCDEC6(x, y, z, u, v, w)                                   \
-  void encode(spv_ostream &O) const override {                                 \
-    getEncoder(O) << (x) << (y) << (z) << (u) << (v) << (w);                   \
+  template <typename FormatTy>                                                 \
+  void encodeImpl(const SPIRVEncoder<FormatTy> &O) const {                     \
+    O << (x) << (y) << (z) << (u) << (v) << (w);                               \
   }                                                                            \
-  void decode(std::istream &I) override {                                      \
-    getDecoder(I) >> (x) >> (y) >> (z) >> (u) >> (v) >> (w);                   \
-  }
+  template <typename FormatTy>                                                 \
+  void decodeImpl(const SPIRVDecoder<FormatTy> &I) {                           \
+    I >> (x) >> (y) >> (z) >> (u) >> (v) >> (w);                               \
+  }                                                                            \
+  _SPIRV_DEF_ENCDEC_FORMATS
 #define _SPIRV_DEF_ENCDEC7(x, y, z, u, v, w, r)                                \
-  void encode(spv_ostream &O) const override {                                 \
-    getEncoder(O) << (x) << (y) << (z) << (u) << (v) << (w) << (r);            \
+  template <typename FormatTy>                                                 \
+  void encodeImpl(const SPIRVEncoder<FormatTy> &O) const {                     \
+    O << (x) << (y) << (z) << (u) << (v) << (w) << (r);                        \
   }                                                                            \
-  void decode(std::istream &I) override {                                      \
-    getDecoder(I) >> (x) >> (y) >> (z) >> (u) >> (v) >> (w) >> (r);            \
-  }
+  template <typename FormatTy>                                                 \
+  void decodeImpl(const SPIRVDecoder<FormatTy> &I) {                           \
+    I >> (x) >> (y) >> (z) >> (u) >> (v) >> (w) >> (r);                        \
+  }                                                                            \
+  _SPIRV_DEF_ENCDEC_FORMATS
 #define _SPIRV_DEF_ENCDEC8(x, y, z, u, v, w, r, s)                             \
-  void encode(spv_ostream &O) const override {                                 \
-    getEncoder(O) << (x) << (y) << (z) << (u) << (v) << (w) << (r) << (s);     \
+  template <typename FormatTy>                                                 \
+  void encodeImpl(const SPIRVEncoder<FormatTy> &O) const {                     \
+    O << (x) << (y) << (z) << (u) << (v) << (w) << (r) << (s);                 \
   }                                                                            \
-  void decode(std::istream &I) override {                                      \
-    getDecoder(I) >> (x) >> (y) >> (z) >> (u) >> (v) >> (w) >> (r) >> (s);     \
-  }
+  template <typename FormatTy>                                                 \
+  void decodeImpl(const SPIRVDecoder<FormatTy> &I) {                           \
+    I >> (x) >> (y) >> (z) >> (u) >> (v) >> (w) >> (r) >> (s);                 \
+  }                                                                            \
+  _SPIRV_DEF_ENCDEC_FORMATS
 #define _SPIRV_DEF_ENCDEC9(x, y, z, u, v, w, r, s, t)                          \
-  void encode(spv_ostream &O) const override {                                 \
-    getEncoder(O) << (x) << (y) << (z) << (u) << (v) << (w) << (r) << (s)      \
-                  << (t);                                                      \
+  template <typename FormatTy>                                                 \
+  void encodeImpl(const SPIRVEncoder<FormatTy> &O) const {                     \
+    O << (x) << (y) << (z) << (u) << (v) << (w) << (r) << (s) << (t);          \
   }                                                                            \
-  void decode(std::istream &I) override {                                      \
-    getDecoder(I) >> (x) >> (y) >> (z) >> (u) >> (v) >> (w) >> (r) >> (s) >>   \
-        (t);                                                                   \
-  }
+  template <typename FormatTy>                                                 \
+  void decodeImpl(const SPIRVDecoder<FormatTy> &I) {                           \
+    I >> (x) >> (y) >> (z) >> (u) >> (v) >> (w) >> (r) >> (s) >> (t);          \
+  }                                                                            \
+  _SPIRV_DEF_ENCDEC_FORMATS
 
 /// All SPIR-V in-memory-representation entities inherits from SPIRVEntry.
 /// Usually there are two flavors of constructors of SPIRV objects:
@@ -213,7 +330,7 @@ class SPIRVExtInst;
 ///    It is usually called by SPIRVEntry::make(opcode) to create an incomplete
 ///    object which should not be validated. Then setWordCount(count) is
 ///    called to fix the size of the object if it is variable, and then the
-///    information is filled by the virtual function decode(istream).
+///    information is filled by the virtual function decode(decoder).
 ///    After that the object can be validated.
 ///
 /// To add a new SPIRV class:
@@ -223,7 +340,10 @@ class SPIRVExtInst;
 ///    the table of the factory function SPIRVEntry::create().
 /// 2. Inherit from proper SPIRV class such as SPIRVType, SPIRVValue,
 ///    SPIRVInstruction, etc.
-/// 3. Implement virtual function encode(), decode(), validate().
+/// 3. Implement virtual function encode(), decode(), validate(). encode() and
+///    decode() are usually defined with the _SPIRV_DEF_ENCDEC macros, or
+///    declared with _SPIRV_DCL_ENCDEC and written as the member templates
+///    encodeImpl() and decodeImpl().
 /// 4. If the object has variable size, implement virtual function
 ///    setWordCount().
 /// 5. If the class has special attributes, e.g. having no id, or having no
@@ -245,25 +365,26 @@ public:
 
   // Complete constructor for objects with id
   SPIRVEntry(SPIRVModule *M, unsigned TheWordCount, Op TheOpCode, SPIRVId TheId)
-      : Module(M), OpCode(TheOpCode), Id(TheId), Attrib(SPIRVEA_DEFAULT),
-        WordCount(TheWordCount), Line(nullptr) {
+      : Module(M), OpCode(TheOpCode), Id(TheId), Name(&EmptyName),
+        Attrib(SPIRVEA_DEFAULT), WordCount(TheWordCount), Line(nullptr) {
     SPIRVEntry::validate();
   }
 
   // Complete constructor for objects without id
   SPIRVEntry(SPIRVModule *M, unsigned TheWordCount, Op TheOpCode)
-      : Module(M), OpCode(TheOpCode), Id(SPIRVID_INVALID), Attrib(SPIRVEA_NOID),
-        WordCount(TheWordCount), Line(nullptr) {
+      : Module(M), OpCode(TheOpCode), Id(SPIRVID_INVALID), Name(&EmptyName),
+        Attrib(SPIRVEA_NOID), WordCount(TheWordCount), Line(nullptr) {
     SPIRVEntry::validate();
   }
 
   // Incomplete constructor
   SPIRVEntry(Op TheOpCode)
       : Module(NULL), OpCode(TheOpCode), Id(SPIRVID_INVALID),
-        Attrib(SPIRVEA_DEFAULT), WordCount(0), Line(nullptr) {}
+        Name(&EmptyName), Attrib(SPIRVEA_DEFAULT), WordCount(0),
+        Line(nullptr) {}
 
   SPIRVEntry()
-      : Module(NULL), OpCode(OpNop), Id(SPIRVID_INVALID),
+      : Module(NULL), OpCode(OpNop), Id(SPIRVID_INVALID), Name(&EmptyName),
         Attrib(SPIRVEA_DEFAULT), WordCount(0), Line(nullptr) {}
 
   virtual ~SPIRVEntry() {}
@@ -277,12 +398,16 @@ public:
   SPIRVEntry *getOrCreate(SPIRVId TheId) const;
   SPIRVValue *getValue(SPIRVId TheId) const;
   std::vector<SPIRVValue *> getValues(const std::vector<SPIRVId> &) const;
-  std::vector<SPIRVId> getIds(const std::vector<SPIRVValue *>) const;
+  SPIRVValueRange getValueRange(llvm::ArrayRef<SPIRVId> Ids) const {
+    return llvm::map_range(Ids, SPIRVIdToValue{Module});
+  }
+  std::vector<SPIRVId> getIds(const std::vector<SPIRVValue *> &) const;
   SPIRVType *getValueType(SPIRVId TheId) const;
   std::vector<SPIRVType *> getValueTypes(const std::vector<SPIRVId> &) const;
+  SPIRVValueTypeRange getValueTypeRange(llvm::ArrayRef<SPIRVId> Ids) const {
+    return llvm::map_range(Ids, SPIRVIdToValueType{Module});
+  }
 
-  virtual SPIRVDecoder getDecoder(std::istream &);
-  virtual SPIRVEncoder getEncoder(spv_ostream &) const;
   SPIRVErrorLog &getErrorLog() const;
   SPIRVId getId() const {
     assert(hasId());
@@ -295,7 +420,13 @@ public:
   SPIRVModule *getModule() const { return Module; }
   virtual SPIRVCapVec getRequiredCapability() const { return SPIRVCapVec(); }
   virtual std::optional<ExtensionID> getRequiredExtension() const { return {}; }
-  const std::string &getName() const { return Name; }
+  const std::string &getName() const { return *Name; }
+  /// Check whether \p E has the same name. Names of entries of one module
+  /// are interned by SPIRVModule::internName(), so only their addresses are
+  /// compared.
+  bool hasSameName(const SPIRVEntry *E) const {
+    return Name == E->Name || (Module != E->Module && *Name == *E->Name);
+  }
   size_t getNumDecorations() const { return Decorates.size(); }
   bool hasDecorate(Decoration Kind, size_t Index = 0,
                    SPIRVWord *Result = 0) const;
@@ -386,19 +517,30 @@ public:
   static std::unique_ptr<SPIRVExtInst> createUnique(SPIRVExtInstSetKind Set,
                                                     unsigned ExtOp);
 
-  friend spv_ostream &operator<<(spv_ostream &O, const SPIRVEntry &E);
-  friend std::istream &operator>>(std::istream &I, SPIRVEntry &E);
-  virtual void encodeLine(spv_ostream &O) const;
-  virtual void encodeDebugLine(spv_ostream &O) const;
-  virtual void encodeAll(spv_ostream &O) const;
-  virtual void encodeName(spv_ostream &O) const;
-  virtual void encodeChildren(spv_ostream &O) const;
-  virtual void encodeDecorate(spv_ostream &O) const;
-  virtual void encodeWordCountOpCode(spv_ostream &O) const;
-  virtual void encode(spv_ostream &O) const;
-  virtual void decode(std::istream &I);
-
-  friend class SPIRVDecoder;
+  template <typename FormatTy>
+  void encodeLine(const SPIRVEncoder<FormatTy> &O) const;
+  template <typename FormatTy>
+  void encodeDebugLine(const SPIRVEncoder<FormatTy> &O) const;
+  template <typename FormatTy>
+  void encodeName(const SPIRVEncoder<FormatTy> &O) const;
+  template <typename FormatTy>
+  void encodeDecorate(const SPIRVEncoder<FormatTy> &O) const;
+  template <typename FormatTy>
+  void encodeWordCountOpCode(const SPIRVEncoder<FormatTy> &O) const;
+  template <typename FormatTy>
+  void encodeAllImpl(const SPIRVEncoder<FormatTy> &O) const;
+  // The virtual functions exist once for every stream format. The module
+  // reader and writer select the format once for all the entries.
+  virtual void encodeAll(const SPIRVBinaryEncoder &O) const;
+  virtual void encodeAll(const SPIRVTextEncoder &O) const;
+  virtual void encodeChildren(const SPIRVBinaryEncoder &O) const;
+  virtual void encodeChildren(const SPIRVTextEncoder &O) const;
+  virtual void encode(const SPIRVBinaryEncoder &O) const;
+  virtual void encode(const SPIRVTextEncoder &O) const;
+  virtual void decode(const SPIRVBinaryDecoder &I);
+  virtual void decode(const SPIRVTextDecoder &I);
+
+  template <typename FormatTy> friend class SPIRVDecoder;
 
   /// Checks the integrity of the object.
   virtual void validate() const {
@@ -408,7 +550,7 @@ public:
     if (WordCount > 65535) {
       std::stringstream SS;
       SS << "Id: " << Id << ", OpCode: " << OpCodeNameMap::map(OpCode)
-         << ", Name: \"" << Name << "\"\n";
+         << ", Name: \"" << *Name << "\"\n";
       getErrorLog().checkError(false, SPIRVEC_InvalidWordCount, SS.str());
     }
   }
@@ -421,16 +563,36 @@ public:
     return VersionNumber::SPIRV_1_0;
   }
 
-  virtual std::vector<SPIRVEntry *> getNonLiteralOperands() const {
-    return std::vector<SPIRVEntry *>();
+  std::vector<SPIRVEntry *> getNonLiteralOperands() const {
+    llvm::SmallVector<SPIRVEntry *, 4> Ops;
+    addNonLiteralOperands(Ops);
+    return std::vector<SPIRVEntry *>(Ops.begin(), Ops.end());
   }
+  /// Appends the entries referred to by the non-literal operands to \p Ops.
+  virtual void
+  addNonLiteralOperands(llvm::SmallVectorImpl<SPIRVEntry *> &Ops) const {}
+
+  /// Returns the size of the object create() makes for \p OC.
+  static size_t getObjectSize(Op OC);
+
+  /// Adds the memory held by the entry to \p Report.
+  void addMemoryUsage(SPIRVMemoryReport &Report) const;
+
+  /// Heap bytes of the operand and literal vectors owned by the entry.
+  virtual size_t getOperandMemoryUsage() const { return 0; }
+
+  /// Heap bytes of the string literals owned by the entry, except its name.
+  virtual size_t getStringMemoryUsage() const { return 0; }
 
 protected:
-  /// An entry may have multiple FuncParamAttr decorations.
-  typedef std::multimap<Decoration, const SPIRVDecorate *> DecorateMapType;
-  typedef std::multimap<Decoration, const SPIRVDecorateId *> DecorateIdMapType;
-  typedef std::multimap<std::pair<SPIRVWord, Decoration>,
-                        const SPIRVMemberDecorate *>
+  /// An entry may have multiple FuncParamAttr decorations. Most entries have
+  /// only a few decorations, which are kept in the entry itself.
+  typedef SPIRVFlatMultiMap<Decoration, const SPIRVDecorate *, 2>
+      DecorateMapType;
+  typedef SPIRVFlatMultiMap<Decoration, const SPIRVDecorateId *, 1>
+      DecorateIdMapType;
+  typedef SPIRVFlatMultiMap<std::pair<SPIRVWord, Decoration>,
+                            const SPIRVMemberDecorate *, 0>
       MemberDecorateMapType;
 
   bool canHaveMemberDecorates() const {
@@ -446,7 +608,9 @@ protected:
   SPIRVModule *Module;
   Op OpCode;
   SPIRVId Id;
-  std::string Name;
+  // Owned by the module, see SPIRVModule::internName().
+  const std::string *Name;
+  static const std::string EmptyName;
   unsigned Attrib;
   SPIRVWord WordCount;
 
@@ -540,6 +704,11 @@ public:
                   std::vector<SPIRVId> Variables);
   SPIRVEntryPoint() : SPIRVAnnotation(OpEntryPoint) {}
 
+  size_t getOperandMemoryUsage() const override {
+    return getHeapSize(Variables);
+  }
+  size_t getStringMemoryUsage() const override { return getHeapSize(Name); }
+
   _SPIRV_DCL_ENCDEC
 protected:
   SPIRVExecutionModelKind ExecModel = ExecutionModelMax;
@@ -556,6 +725,8 @@ public:
   // Incomplete constructor
   SPIRVName() : SPIRVAnnotation(OpName) {}
 
+  size_t getStringMemoryUsage() const override { return getHeapSize(Str); }
+
 protected:
   _SPIRV_DCL_ENCDEC
   void validate() const override;
@@ -576,6 +747,8 @@ public:
   // Incomplete constructor
   SPIRVMemberName() : SPIRVAnnotation(OpName), MemberNumber(SPIRVWORD_MAX) {}
 
+  size_t getStringMemoryUsage() const override { return getHeapSize(Str); }
+
 protected:
   _SPIRV_DCL_ENCDEC
   void validate() const override;
@@ -595,6 +768,8 @@ public:
   _SPIRV_DCL_ENCDEC
   const std::string &getStr() const { return Str; }
 
+  size_t getStringMemoryUsage() const override { return getHeapSize(Str); }
+
 protected:
   std::string Str;
 };
@@ -707,6 +882,10 @@ public:
     }
   }
 
+  size_t getOperandMemoryUsage() const override {
+    return getHeapSize(WordLiterals);
+  }
+
 protected:
   _SPIRV_DCL_ENCDEC
   SPIRVExecutionModeKind ExecMode;
@@ -821,6 +1000,8 @@ public:
   // Incomplete constructor
   SPIRVExtInstImport() : SPIRVEntry(OC) {}
 
+  size_t getStringMemoryUsage() const override { return getHeapSize(Str); }
+
 protected:
   _SPIRV_DCL_ENCDEC
   void validate() const override;
@@ -847,6 +1028,7 @@ class SPIRVSourceExtension : public SPIRVEntryNoId<OpSourceExtension> {
 public:
   SPIRVSourceExtension(SPIRVModule *M, const std::string &SS);
   SPIRVSourceExtension() {}
+  size_t getStringMemoryUsage() const override { return getHeapSize(S); }
   _SPIRV_DCL_ENCDEC
 private:
   std::string S;
@@ -858,6 +1040,7 @@ public:
   SPIRVExtension() {}
 
   std::string getExtensionName() const { return S; }
+  size_t getStringMemoryUsage() const override { return getHeapSize(S); }
 
   _SPIRV_DCL_ENCDEC
 private:
@@ -963,6 +1146,10 @@ public:
 
   SPIRVWord getNumElements() const { return Elements.size(); }
 
+  size_t getOperandMemoryUsage() const override {
+    return getHeapSize(Elements);
+  }
+
 protected:
   void validate() const override;
   void setWordCount(SPIRVWord WordCount) override {
@@ -1027,6 +1214,9 @@ public:
   }
 
   std::string getProcessStr();
+  size_t getStringMemoryUsage() const override {
+    return getHeapSize(ProcessStr);
+  }
 
 private:
   std::string ProcessStr;
@@ -41,6 +41,7 @@
 
 #include "SPIRVDebug.h"
 #include "SPIRVUtil.h"
+#include "llvm/ADT/STLFunctionalExtras.h"
 #include "llvm/IR/Instruction.h"
 #include <iostream>
 #include <sstream>
@@ -48,17 +49,22 @@
 
 namespace SPIRV {
 
+// Wrap an error message expression so that it is only evaluated if the
+// check fails.
+#define SPIRV_LAZY_MSG(ErrMsg)                                                 \
+  [&]() -> std::string { return std::string() + (ErrMsg); }
+
 // Check condition and set error code and error msg.
 // To use this macro, function checkError must be defined in the scope.
 // Emit absolute path only in debug mode.
 #ifdef NDEBUG
 #define SPIRVCK(Condition, ErrCode, ErrMsg)                                    \
   getErrorLog().checkError(Condition, SPIRVEC_##ErrCode,                       \
-                           std::string() + (ErrMsg), #Condition)
+                           SPIRV_LAZY_MSG(ErrMsg), #Condition)
 #else
 #define SPIRVCK(Condition, ErrCode, ErrMsg)                                    \
   getErrorLog().checkError(Condition, SPIRVEC_##ErrCode,                       \
-                           std::string() + (ErrMsg), #Condition, __FILE__,     \
+                           SPIRV_LAZY_MSG(ErrMsg), #Condition, __FILE__,       \
                            __LINE__)
 #endif // NDEBUG
 
@@ -67,13 +73,13 @@ namespace SPIRV {
 #ifdef NDEBUG
 #define SPIRVCKRT(Condition, ErrCode, ErrMsg)                                  \
   if (!getErrorLog().checkError(Condition, SPIRVEC_##ErrCode,                  \
-                                std::string() + (ErrMsg), #Condition))         \
+                                SPIRV_LAZY_MSG(ErrMsg), #Condition))           \
     return false;
 #else
 #define SPIRVCKRT(Condition, ErrCode, ErrMsg)                                  \
   if (!getErrorLog().checkError(Condition, SPIRVEC_##ErrCode,                  \
-                                std::string() + (ErrMsg), #Condition,          \
-                                __FILE__, __LINE__))                           \
+                                SPIRV_LAZY_MSG(ErrMsg), #Condition, __FILE__,  \
+                                __LINE__))                                     \
     return false;
 #endif // NDEBUG
 
@@ -110,6 +116,13 @@ public:
                   const std::string &DetailedMsg = "",
                   const char *CondString = nullptr,
                   const char *FileName = nullptr, unsigned LineNumber = 0);
+  // Check if Condition is satisfied and set ErrCode and the message returned
+  // by DetailedMsg if not. DetailedMsg is only called on failure, so checks on
+  // hot paths do not build messages. Returns true if no error.
+  bool checkError(bool Condition, SPIRVErrorCode ErrCode,
+                  llvm::function_ref<std::string()> DetailedMsg,
+                  const char *CondString = nullptr,
+                  const char *FileName = nullptr, unsigned LineNumber = 0);
   // Check if Condition is satisfied and set ErrCode and DetailedMsg with Value
   // text representation if not. Returns true if no error.
   bool checkError(bool Condition, SPIRVErrorCode ErrCode, llvm::Value *Value,
@@ -118,6 +131,10 @@ public:
                   const char *FileName = nullptr, unsigned LineNumber = 0);
 
 protected:
+  void reportError(SPIRVErrorCode ErrCode, const std::string &Msg,
+                   const char *CondString, const char *FileName,
+                   unsigned LineNo);
+
   SPIRVErrorCode ErrorCode;
   std::string ErrorMsg;
 };
@@ -143,16 +160,41 @@ inline bool SPIRVErrorLog::checkError(bool Cond, SPIRVErrorCode ErrCode,
                                       const std::string &Msg,
                                       const char *CondString,
                                       const char *FileName, unsigned LineNo) {
-  std::stringstream SS;
   if (Cond)
     return Cond;
   // Do not overwrite previous failure.
   if (ErrorCode != SPIRVEC_Success)
     return Cond;
+  reportError(ErrCode, Msg, CondString, FileName, LineNo);
+  return Cond;
+}
+
+inline bool
+SPIRVErrorLog::checkError(bool Cond, SPIRVErrorCode ErrCode,
+                          llvm::function_ref<std::string()> DetailedMsg,
+                          const char *CondString, const char *FileName,
+                          unsigned LineNo) {
+  if (Cond)
+    return Cond;
+  // Do not overwrite previous failure.
+  if (ErrorCode != SPIRVEC_Success)
+    return Cond;
+  reportError(ErrCode, DetailedMsg(), CondString, FileName, LineNo);
+  return Cond;
+}
+
+inline void SPIRVErrorLog::reportError(SPIRVErrorCode ErrCode,
+                                       const std::string &Msg,
+                                       const char *CondString,
+                                       const char *FileName, unsigned LineNo) {
+  std::stringstream SS;
   SS << SPIRVErrorMap::map(ErrCode) << " " << Msg;
   if (SPIRVDbgErrorMsgIncludesSourceInfo && FileName)
     SS << " [Src: " << FileName << ":" << LineNo << " " << CondString << " ]";
   setError(ErrCode, SS.str());
+  // The trace is meant for release builds, so it does not go to spvdbgs().
+  if (_SPIRVTRACE && SPIRVTraceMask)
+    dumpSPIRVTrace(std::cerr);
   switch (SPIRVDbgError) {
   case SPIRVDbgErrorHandlingKinds::Abort:
     std::cerr << SS.str() << std::endl;
@@ -171,7 +213,6 @@ inline bool SPIRVErrorLog::checkError(bool Cond, SPIRVErrorCode ErrCode,
     spvdbgs().flush();
     break;
   }
-  return Cond;
 }
 
 } // namespace SPIRV
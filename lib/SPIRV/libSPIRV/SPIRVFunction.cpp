@@ -66,15 +66,13 @@ void SPIRVFunctionParameter::foreachAttr(
   }
 }
 
-SPIRVDecoder SPIRVFunction::getDecoder(std::istream &IS) {
-  return SPIRVDecoder(IS, *this);
+template <typename FormatTy>
+void SPIRVFunction::encodeImpl(const SPIRVEncoder<FormatTy> &O) const {
+  O << Type << Id << FCtrlMask << FuncType;
 }
 
-void SPIRVFunction::encode(spv_ostream &O) const {
-  getEncoder(O) << Type << Id << FCtrlMask << FuncType;
-}
-
-void SPIRVFunction::encodeChildren(spv_ostream &O) const {
+template <typename FormatTy>
+void SPIRVFunction::encodeChildrenImpl(const SPIRVEncoder<FormatTy> &O) const {
   O << SPIRVNL();
   for (auto &I : Parameters)
     O << *I;
@@ -84,19 +82,35 @@ void SPIRVFunction::encodeChildren(spv_ostream &O) const {
   O << SPIRVFunctionEnd();
 }
 
-void SPIRVFunction::encodeExecutionModes(spv_ostream &O) const {
+void SPIRVFunction::encodeChildren(const SPIRVBinaryEncoder &O) const {
+  encodeChildrenImpl(O);
+}
+
+void SPIRVFunction::encodeChildren(const SPIRVTextEncoder &O) const {
+  encodeChildrenImpl(O);
+}
+
+template <typename FormatTy>
+void SPIRVFunction::encodeExecutionModes(
+    const SPIRVEncoder<FormatTy> &O) const {
   for (auto &I : ExecModes)
     O << *I.second;
 }
 
-void SPIRVFunction::decode(std::istream &I) {
-  SPIRVDecoder Decoder = getDecoder(I);
+template void
+SPIRVFunction::encodeExecutionModes(const SPIRVBinaryEncoder &O) const;
+template void
+SPIRVFunction::encodeExecutionModes(const SPIRVTextEncoder &O) const;
+
+template <typename FormatTy>
+void SPIRVFunction::decodeImpl(const SPIRVDecoder<FormatTy> &I) {
+  SPIRVDecoder<FormatTy> Decoder(I.IS, *this);
   Decoder >> Type >> Id >> FCtrlMask >> FuncType;
   Module->addFunction(this);
   SPIRVDBG(spvdbgs() << "Decode function: " << Id << '\n');
 
   Decoder.getWordCountAndOpCode();
-  while (!I.eof()) {
+  while (!I.IS.eof()) {
     if (Decoder.OpCode == OpFunctionEnd)
       break;
 
@@ -123,7 +137,8 @@ void SPIRVFunction::decode(std::istream &I) {
 
 /// Decode basic block and contained instructions.
 /// Do it here instead of in BB:decode to avoid back track in input stream.
-bool SPIRVFunction::decodeBB(SPIRVDecoder &Decoder) {
+template <typename FormatTy>
+bool SPIRVFunction::decodeBB(SPIRVDecoder<FormatTy> &Decoder) {
   SPIRVBasicBlock *BB = static_cast<SPIRVBasicBlock *>(Decoder.getEntry());
   assert(BB);
   addBasicBlock(BB);
@@ -148,9 +163,9 @@ bool SPIRVFunction::decodeBB(SPIRVDecoder &Decoder) {
       continue;
     }
 
-    if (!Module->getErrorLog().checkError(Entry->isImplemented(),
-                                          SPIRVEC_UnimplementedOpCode,
-                                          std::to_string(Entry->getOpCode()))) {
+    if (!Module->getErrorLog().checkError(
+            Entry->isImplemented(), SPIRVEC_UnimplementedOpCode,
+            [&] { return std::to_string(Entry->getOpCode()); })) {
       // Bail out if the opcode is not implemented.
       Module->setInvalid();
       delete Entry;
@@ -199,6 +214,8 @@ bool SPIRVFunction::decodeBB(SPIRVDecoder &Decoder) {
   return true;
 }
 
+_SPIRV_IMP_ENCDEC_FORMATS(SPIRVFunction)
+
 void SPIRVFunction::foreachReturnValueAttr(
     std::function<void(SPIRVFuncParamAttrKind)> Func) {
   auto Locs = Decorates.equal_range(DecorationFuncParamAttr);
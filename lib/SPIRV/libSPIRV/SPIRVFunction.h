@@ -45,7 +45,6 @@
 namespace SPIRV {
 
 class BIFunction;
-class SPIRVDecoder;
 
 class SPIRVFunctionParameter : public SPIRVValue {
 public:
@@ -96,7 +95,6 @@ public:
       : SPIRVValue(OpFunction), FuncType(NULL),
         FCtrlMask(FunctionControlMaskNone) {}
 
-  SPIRVDecoder getDecoder(std::istream &IS) override;
   SPIRVTypeFunction *getFunctionType() const { return FuncType; }
   SPIRVWord getFuncCtlMask() const { return FCtrlMask; }
   size_t getNumBasicBlock() const { return BBVec.size(); }
@@ -105,11 +103,11 @@ public:
     return getFunctionType()->getNumParameters();
   }
   SPIRVId getArgumentId(size_t I) const { return Parameters[I]->getId(); }
-  const std::vector<SPIRVId> getVariables() const {
-    std::vector<SPIRVId> Ids;
-    for (auto Variable : Variables)
-      Ids.push_back(Variable->getId());
-    return Ids;
+  /// The ids of the variables of the function. They are read while
+  /// iterating, so no vector is built.
+  auto getVariables() const {
+    return llvm::map_range(Variables,
+                           [](const SPIRVValue *V) { return V->getId(); });
   }
   void addVariable(const SPIRVValue *Variable) {
     Variables.push_back(Variable);
@@ -136,14 +134,22 @@ public:
     return BB;
   }
 
-  void encodeChildren(spv_ostream &) const override;
-  void encodeExecutionModes(spv_ostream &) const;
+  template <typename FormatTy>
+  void encodeChildrenImpl(const SPIRVEncoder<FormatTy> &O) const;
+  void encodeChildren(const SPIRVBinaryEncoder &O) const override;
+  void encodeChildren(const SPIRVTextEncoder &O) const override;
+  template <typename FormatTy>
+  void encodeExecutionModes(const SPIRVEncoder<FormatTy> &O) const;
   _SPIRV_DCL_ENCDEC
   void validate() const override {
     SPIRVValue::validate();
     validateFunctionControlMask(FCtrlMask);
     assert(FuncType && "Invalid func type");
   }
+  size_t getOperandMemoryUsage() const override {
+    return getHeapSize(Parameters) + getHeapSize(Variables) +
+           getHeapSize(BBVec);
+  }
 
 private:
   SPIRVFunctionParameter *addArgument(unsigned TheArgNo, SPIRVId TheId) {
@@ -158,7 +164,7 @@ private:
     for (size_t I = 0, E = getFunctionType()->getNumParameters(); I != E; ++I)
       addArgument(I, FirstArgId + I);
   }
-  bool decodeBB(SPIRVDecoder &);
+  template <typename FormatTy> bool decodeBB(SPIRVDecoder<FormatTy> &);
 
   SPIRVTypeFunction *FuncType; // Function type
   SPIRVWord FCtrlMask;         // Function control mask
@@ -0,0 +1,593 @@
+//===- SPIRVIdScanner.cpp - Word-level access to SPIR-V ---------*- C++ -*-===//
+//
+//                     The LLVM/SPIR-V Translator
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+// Copyright (c) 2024 The Khronos Group Inc.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimers.
+// Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimers in the documentation
+// and/or other materials provided with the distribution.
+// Neither the names of The Khronos Group, nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// Software without specific prior written permission.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH
+// THE SOFTWARE.
+//
+//===----------------------------------------------------------------------===//
+/// \file
+///
+/// This file implements helpers working directly on SPIR-V binary words.
+///
+//===----------------------------------------------------------------------===//
+
+#include "SPIRVIdScanner.h"
+#include "SPIRVAsm.h"
+#include "SPIRVBasicBlock.h"
+#include "SPIRVDecorate.h"
+#include "SPIRVExtInst.h"
+#include "SPIRVFunction.h"
+#include "SPIRVInstruction.h"
+#include "SPIRVMemAliasingINTEL.h"
+#include "SPIRVType.h"
+#include "SPIRVValue.h"
+
+#include <cstring>
+#include <memory>
+#include <type_traits>
+
+using namespace SPIRV;
+
+namespace {
+
+/// Operand layout of an instruction implemented with SPIRVInstTemplate.
+struct SPIRVTemplateLayout {
+  enum KindTy {
+    // Operands are ids unless marked in LiteralMask.
+    Generic,
+    // SPV_INTEL_arbitrary_precision_floating_point: only the A and B inputs
+    // are ids, the rest are literals.
+    ArbitraryFloat,
+    // SPV_INTEL_arbitrary_precision_fixed_point: only the input is an id.
+    FixedPoint
+  };
+  KindTy Kind;
+  bool HasType;
+  bool HasId;
+  uint64_t LiteralMask;
+};
+
+typedef std::unordered_map<Op, SPIRVTemplateLayout> SPIRVTemplateLayoutMap;
+
+template <typename T>
+void addTemplateLayout(SPIRVTemplateLayoutMap &Map, Op OC) {
+  // OpSpecConstantOp decides on its literals by its first operand, so it
+  // cannot be asked without one. It is handled by SPIRVIdScanner directly.
+  if (!std::is_base_of<SPIRVInstTemplateBase, T>::value ||
+      OC == OpSpecConstantOp)
+    return;
+  std::unique_ptr<SPIRVInstTemplateBase> Inst(
+      SPIRVInstTemplateBase::create(OC));
+  SPIRVTemplateLayout Layout;
+  Layout.Kind = std::is_base_of<SPIRVArbFloatIntelInst, T>::value
+                    ? SPIRVTemplateLayout::ArbitraryFloat
+                : std::is_base_of<SPIRVFixedPointIntelInst, T>::value
+                    ? SPIRVTemplateLayout::FixedPoint
+                    : SPIRVTemplateLayout::Generic;
+  Layout.HasType = Inst->hasType();
+  Layout.HasId = Inst->hasId();
+  Layout.LiteralMask = 0;
+  for (unsigned I = 0; I < 64; ++I)
+    if (Inst->isOperandLiteral(I))
+      Layout.LiteralMask |= uint64_t(1) << I;
+  Map[OC] = Layout;
+}
+
+/// Layouts of all instructions implemented with SPIRVInstTemplate, taken
+/// from the instruction classes themselves.
+const SPIRVTemplateLayoutMap &getTemplateLayouts() {
+  static const SPIRVTemplateLayoutMap Layouts = [] {
+    SPIRVTemplateLayoutMap Map;
+#define _SPIRV_OP(x, ...) addTemplateLayout<SPIRV##x>(Map, Op##x);
+#define _SPIRV_OP_INTERNAL(x, ...)                                             \
+  addTemplateLayout<SPIRV##x>(Map, internal::Op##x);
+#include "SPIRVOpCodeEnum.h"
+#include "SPIRVOpCodeEnumInternal.h"
+#undef _SPIRV_OP_INTERNAL
+#undef _SPIRV_OP
+    return Map;
+  }();
+  return Layouts;
+}
+
+void addIds(llvm::ArrayRef<SPIRVWord> Inst, unsigned From, SPIRVInstIds &Ids,
+            unsigned To = ~0U) {
+  for (unsigned I = From, E = std::min<size_t>(To, Inst.size()); I < E; ++I)
+    Ids.Operands.push_back(I);
+}
+
+/// Add the ids among the memory operands starting at word \p I. Several masks
+/// may follow each other, e.g. in OpCopyMemory.
+void addMemoryAccessIds(llvm::ArrayRef<SPIRVWord> Inst, unsigned I,
+                        SPIRVInstIds &Ids) {
+  // Ids follow the mask in the order of the mask bits.
+  static const SPIRVWord IdMasks[] = {
+      MemoryAccessMakePointerAvailableMask, MemoryAccessMakePointerVisibleMask,
+      MemoryAccessAliasScopeINTELMaskMask, MemoryAccessNoAliasINTELMaskMask};
+  while (I < Inst.size()) {
+    SPIRVWord Mask = Inst[I++];
+    if (Mask & MemoryAccessAlignedMask)
+      ++I;
+    for (SPIRVWord IdMask : IdMasks)
+      if ((Mask & IdMask) && I < Inst.size())
+        Ids.Operands.push_back(I++);
+  }
+}
+
+/// Get the index of the first memory operand word of instructions whose
+/// operand layout is otherwise described by their SPIRVInstTemplate.
+/// \returns 0 if \p OC has no memory operands.
+unsigned getMemoryOperandsIndex(Op OC) {
+  switch (static_cast<unsigned>(OC)) {
+  case OpCooperativeMatrixLoadKHR:
+    return 6;
+  case OpCooperativeMatrixStoreKHR:
+    return 5;
+  case internal::IOpJointMatrixLoadINTEL:
+    return 7;
+  case internal::IOpJointMatrixStoreINTEL:
+    return 6;
+  case internal::IOpCooperativeMatrixLoadCheckedINTEL:
+    return 10;
+  case internal::IOpCooperativeMatrixStoreCheckedINTEL:
+    return 9;
+  default:
+    return 0;
+  }
+}
+
+bool isOpenCLExtInstLiteral(SPIRVWord ExtOp, unsigned Index) {
+  // Mirrors SPIRVExtInst::isOperandLiteral.
+  switch (ExtOp) {
+  case OpenCLLIB::Vloadn:
+  case OpenCLLIB::Vload_halfn:
+  case OpenCLLIB::Vloada_halfn:
+    return Index == 2;
+  case OpenCLLIB::Vstore_half_r:
+  case OpenCLLIB::Vstore_halfn_r:
+  case OpenCLLIB::Vstorea_halfn_r:
+    return Index == 3;
+  default:
+    return false;
+  }
+}
+
+} // namespace
+
+namespace SPIRV {
+
+bool readSPIRVWords(llvm::StringRef Binary, std::vector<SPIRVWord> &Words,
+                    std::string &ErrMsg) {
+  if (Binary.size() % sizeof(SPIRVWord) != 0 ||
+      Binary.size() < SPIRVHW_Count * sizeof(SPIRVWord)) {
+    ErrMsg = "invalid SPIR-V binary size";
+    return false;
+  }
+  Words.resize(Binary.size() / sizeof(SPIRVWord));
+  std::memcpy(Words.data(), Binary.data(), Binary.size());
+  if (Words[SPIRVHW_Magic] != MagicNumber) {
+    ErrMsg = "invalid magic number";
+    return false;
+  }
+  SPIRVWord Version = Words[SPIRVHW_Version];
+  if (!isSPIRVVersionKnown(static_cast<VersionNumber>(Version))) {
+    ErrMsg = "unknown SPIR-V version " + std::to_string(Version);
+    return false;
+  }
+  return true;
+}
+
+unsigned getSPIRVStringWordCount(llvm::ArrayRef<SPIRVWord> Inst, unsigned I) {
+  unsigned Count = 0;
+  while (I + Count < Inst.size()) {
+    SPIRVWord Word = Inst[I + Count++];
+    // The string ends with the first word having a zero byte.
+    if (!(Word & 0xFF) || !(Word & 0xFF00) || !(Word & 0xFF0000) ||
+        !(Word & 0xFF000000))
+      break;
+  }
+  return Count;
+}
+
+std::string getSPIRVString(llvm::ArrayRef<SPIRVWord> Inst, unsigned I) {
+  std::string Str;
+  for (; I < Inst.size(); ++I)
+    for (unsigned J = 0; J < 32; J += 8) {
+      char Char = static_cast<char>((Inst[I] >> J) & 0xFF);
+      if (Char == '\0')
+        return Str;
+      Str += Char;
+    }
+  return Str;
+}
+
+SPIRVExtInstSetKind SPIRVIdScanner::getExtInstSet(SPIRVId Id) const {
+  auto Loc = ExtInstSets.find(Id);
+  return Loc == ExtInstSets.end() ? SPIRVEIS_Count : Loc->second;
+}
+
+bool SPIRVIdScanner::scan(llvm::ArrayRef<SPIRVWord> Inst, SPIRVInstIds &Ids) {
+  Ids = SPIRVInstIds();
+  if (Inst.empty() || !scanOperands(Inst, Ids))
+    return false;
+  if (Ids.ResultType >= Inst.size() || Ids.Result >= Inst.size())
+    return false;
+
+  Op OC = getSPIRVInstOpCode(Inst.data());
+  if (OC == OpTypeInt && Inst.size() > 2 && Inst[2] == 64)
+    WideIntTypes.insert(Inst[1]);
+  else if (Ids.ResultType && WideIntTypes.count(Inst[Ids.ResultType]))
+    WideIntValues.insert(Inst[Ids.Result]);
+  else if (OC == OpExtInstImport) {
+    std::string Name = getSPIRVString(Inst, 2);
+    SPIRVExtInstSetKind Kind = SPIRVEIS_Count;
+    SPIRVBuiltinSetNameMap::rfind(Name, &Kind);
+    ExtInstSets[Inst[1]] = Kind;
+    // Non-semantic instruction sets only have id operands by definition.
+    if (llvm::StringRef(Name).starts_with("NonSemantic."))
+      NonSemanticSets.insert(Inst[1]);
+  }
+  return true;
+}
+
+bool SPIRVIdScanner::scanOperands(llvm::ArrayRef<SPIRVWord> Inst,
+                                  SPIRVInstIds &Ids) {
+  const unsigned WC = Inst.size();
+  Op OC = getSPIRVInstOpCode(Inst.data());
+  switch (static_cast<unsigned>(OC)) {
+  // No ids at all.
+  case OpNop:
+  case OpCapability:
+  case OpExtension:
+  case OpMemoryModel:
+  case OpSourceContinued:
+  case OpSourceExtension:
+  case OpModuleProcessed:
+  case OpFunctionEnd:
+  case OpReturn:
+  case OpUnreachable:
+  case OpKill:
+  case OpNoLine:
+  case OpLoopControlINTEL:
+    return true;
+
+  case OpSource:
+    addIds(Inst, 3, Ids, 4);
+    return true;
+
+  // Only a result id.
+  case OpExtInstImport:
+  case OpString:
+  case OpLabel:
+  case OpDecorationGroup:
+  case OpAsmTargetINTEL:
+  case OpTypeVoid:
+  case OpTypeBool:
+  case OpTypeInt:
+  case OpTypeFloat:
+  case OpTypeSampler:
+  case OpTypeOpaque:
+  case OpTypeEvent:
+  case OpTypeDeviceEvent:
+  case OpTypeReserveId:
+  case OpTypeQueue:
+  case OpTypePipe:
+  case OpTypePipeStorage:
+  case OpTypeBufferSurfaceINTEL:
+  case OpTypeAvcImePayloadINTEL:
+  case OpTypeAvcRefPayloadINTEL:
+  case OpTypeAvcSicPayloadINTEL:
+  case OpTypeAvcMcePayloadINTEL:
+  case OpTypeAvcMceResultINTEL:
+  case OpTypeAvcImeResultINTEL:
+  case OpTypeAvcImeResultSingleReferenceStreamoutINTEL:
+  case OpTypeAvcImeResultDualReferenceStreamoutINTEL:
+  case OpTypeAvcImeSingleReferenceStreaminINTEL:
+  case OpTypeAvcImeDualReferenceStreaminINTEL:
+  case OpTypeAvcRefResultINTEL:
+  case OpTypeAvcSicResultINTEL:
+  case internal::IOpTypeTokenINTEL:
+  case internal::IOpTypeTaskSequenceINTEL:
+    Ids.Result = 1;
+    return true;
+
+  // A result id followed by ids.
+  case OpTypeVector:
+  case OpTypeMatrix:
+  case OpTypeImage:
+  case OpTypeSampledImage:
+  case OpTypeVmeImageINTEL:
+  case OpTypeRuntimeArray:
+    Ids.Result = 1;
+    addIds(Inst, 2, Ids, 3);
+    return true;
+  case OpTypeArray:
+  case OpTypeStruct:
+  case OpTypeFunction:
+  case OpTypeCooperativeMatrixKHR:
+  case internal::IOpTypeJointMatrixINTEL:
+  case internal::IOpTypeJointMatrixINTELv2:
+    Ids.Result = 1;
+    addIds(Inst, 2, Ids);
+    return true;
+  case OpTypePointer:
+    Ids.Result = 1;
+    addIds(Inst, 3, Ids, 4);
+    return true;
+  case OpTypeForwardPointer:
+    addIds(Inst, 1, Ids, 2);
+    return true;
+
+  // Only ids, no result.
+  case OpTypeStructContinuedINTEL:
+  case OpConstantCompositeContinuedINTEL:
+  case OpSpecConstantCompositeContinuedINTEL:
+  case OpStore:
+  case OpCopyMemory:
+  case OpCopyMemorySized:
+  case OpControlBarrier:
+  case OpAssumeTrueKHR:
+  case OpReturnValue:
+  case OpBranch:
+  case OpBranchConditional:
+  case OpLoopMerge:
+  case OpSelectionMerge:
+  case OpGroupDecorate:
+  case OpLifetimeStart:
+  case OpLifetimeStop:
+    break;
+
+  // A result type and a result id followed by literals.
+  case OpUndef:
+  case OpConstantTrue:
+  case OpConstantFalse:
+  case OpConstant:
+  case OpConstantNull:
+  case OpConstantSampler:
+  case OpConstantPipeStorage:
+  case OpSpecConstantTrue:
+  case OpSpecConstantFalse:
+  case OpSpecConstant:
+  case OpFunctionParameter:
+    Ids.ResultType = 1;
+    Ids.Result = 2;
+    return true;
+
+  // A result type and a result id followed by ids.
+  case OpConstantComposite:
+  case OpSpecConstantComposite:
+  case OpConstantFunctionPointerINTEL:
+  case OpFunctionCall:
+  case OpFunctionPointerCallINTEL:
+  case OpAsmCallINTEL:
+  case OpPhi:
+  case OpVectorExtractDynamic:
+  case OpVectorInsertDynamic:
+  case OpCompositeConstruct:
+  case OpCopyObject:
+  case OpCopyLogical:
+  case OpTranspose:
+  case OpVectorTimesScalar:
+  case OpMatrixTimesScalar:
+  case OpVectorTimesMatrix:
+  case OpMatrixTimesVector:
+  case OpMatrixTimesMatrix:
+  case OpGroupAsyncCopy:
+    Ids.ResultType = 1;
+    Ids.Result = 2;
+    addIds(Inst, 3, Ids);
+    return true;
+
+  // A result id followed by ids.
+  case OpAliasDomainDeclINTEL:
+  case OpAliasScopeDeclINTEL:
+  case OpAliasScopeListDeclINTEL:
+    Ids.Result = 1;
+    addIds(Inst, 2, Ids);
+    return true;
+
+  case OpName:
+  case OpMemberName:
+  case OpLine:
+  case OpDecorate:
+  case OpDecorateString:
+  case OpMemberDecorate:
+  case OpMemberDecorateString:
+  case OpExecutionMode:
+    addIds(Inst, 1, Ids, 2);
+    return true;
+  case OpDecorateId:
+  case OpExecutionModeId:
+    addIds(Inst, 1, Ids, 2);
+    addIds(Inst, 3, Ids);
+    return true;
+  case OpGroupMemberDecorate:
+    // A group followed by pairs of a target id and a member literal.
+    addIds(Inst, 1, Ids, 2);
+    for (unsigned I = 2; I < WC; I += 2)
+      Ids.Operands.push_back(I);
+    return true;
+  case OpEntryPoint:
+    addIds(Inst, 2, Ids, 3);
+    addIds(Inst, 3 + getSPIRVStringWordCount(Inst, 3), Ids);
+    return true;
+
+  case OpFunction:
+    Ids.ResultType = 1;
+    Ids.Result = 2;
+    addIds(Inst, 4, Ids, 5);
+    return true;
+  case OpVariable:
+    Ids.ResultType = 1;
+    Ids.Result = 2;
+    addIds(Inst, 4, Ids, 5);
+    return true;
+  case OpLoad:
+    Ids.ResultType = 1;
+    Ids.Result = 2;
+    addIds(Inst, 3, Ids, 4);
+    addMemoryAccessIds(Inst, 4, Ids);
+    return true;
+  case OpAsmINTEL:
+    Ids.ResultType = 1;
+    Ids.Result = 2;
+    addIds(Inst, 3, Ids, 5);
+    return true;
+  case OpCompositeExtract:
+    Ids.ResultType = 1;
+    Ids.Result = 2;
+    addIds(Inst, 3, Ids, 4);
+    return true;
+  case OpCompositeInsert:
+  case OpVectorShuffle:
+    Ids.ResultType = 1;
+    Ids.Result = 2;
+    addIds(Inst, 3, Ids, 5);
+    return true;
+  case OpSpecConstantOp:
+    Ids.ResultType = 1;
+    Ids.Result = 2;
+    if (WC < 4)
+      return false;
+    switch (Inst[3]) {
+    case OpCompositeExtract:
+      addIds(Inst, 4, Ids, 5);
+      break;
+    case OpCompositeInsert:
+    case OpVectorShuffle:
+      addIds(Inst, 4, Ids, 6);
+      break;
+    default:
+      addIds(Inst, 4, Ids);
+    }
+    return true;
+
+  case OpSwitch: {
+    // A selector, a default label and pairs of a literal of the selector
+    // width and a label.
+    if (WC < 3)
+      return false;
+    addIds(Inst, 1, Ids, 3);
+    unsigned LiteralWords = WideIntValues.count(Inst[1]) ? 2 : 1;
+    for (unsigned I = 3 + LiteralWords; I < WC; I += LiteralWords + 1)
+      Ids.Operands.push_back(I);
+    return true;
+  }
+
+  case OpExtInst: {
+    Ids.ResultType = 1;
+    Ids.Result = 2;
+    if (WC < 5)
+      return false;
+    addIds(Inst, 3, Ids, 4);
+    SPIRVId Set = Inst[3];
+    if (NonSemanticSets.count(Set)) {
+      addIds(Inst, 5, Ids);
+      return true;
+    }
+    if (getExtInstSet(Set) != SPIRVEIS_OpenCL)
+      // OpenCL.DebugInfo.100 and SPIRV.debug mix ids and literals.
+      return false;
+    for (unsigned I = 5; I < WC; ++I)
+      if (!isOpenCLExtInstLiteral(Inst[4], I - 5))
+        Ids.Operands.push_back(I);
+    return true;
+  }
+
+  default: {
+    const SPIRVTemplateLayoutMap &Layouts = getTemplateLayouts();
+    auto Loc = Layouts.find(OC);
+    if (Loc == Layouts.end())
+      return false;
+    const SPIRVTemplateLayout &Layout = Loc->second;
+    unsigned First = 1;
+    if (Layout.HasType)
+      Ids.ResultType = First++;
+    if (Layout.HasId)
+      Ids.Result = First++;
+    switch (Layout.Kind) {
+    case SPIRVTemplateLayout::ArbitraryFloat:
+      // Inputs with two operands have the second one after the first
+      // operand's mantissa width.
+      addIds(Inst, First, Ids, First + 1);
+      if (WC == 7 || WC == 11)
+        addIds(Inst, First + 2, Ids, First + 3);
+      return true;
+    case SPIRVTemplateLayout::FixedPoint:
+      addIds(Inst, First, Ids, First + 1);
+      return true;
+    case SPIRVTemplateLayout::Generic:
+      break;
+    }
+    unsigned MemoryOperands = getMemoryOperandsIndex(OC);
+    unsigned End = MemoryOperands ? std::min(MemoryOperands, WC) : WC;
+    for (unsigned I = First; I < End; ++I)
+      if (I - First >= 64 ||
+          !(Layout.LiteralMask & (uint64_t(1) << (I - First))))
+        Ids.Operands.push_back(I);
+    if (MemoryOperands)
+      addMemoryAccessIds(Inst, MemoryOperands, Ids);
+    return true;
+  }
+  }
+
+  // Instructions without a result whose leading operands are ids.
+  switch (static_cast<unsigned>(OC)) {
+  case OpStore:
+    addIds(Inst, 1, Ids, 3);
+    addMemoryAccessIds(Inst, 3, Ids);
+    break;
+  case OpCopyMemory:
+    addIds(Inst, 1, Ids, 3);
+    addMemoryAccessIds(Inst, 3, Ids);
+    break;
+  case OpCopyMemorySized:
+    addIds(Inst, 1, Ids, 4);
+    addMemoryAccessIds(Inst, 4, Ids);
+    break;
+  case OpBranchConditional:
+    // Optional branch weights are literals.
+    addIds(Inst, 1, Ids, 4);
+    break;
+  case OpLoopMerge:
+    // Loop control parameters are literals.
+    addIds(Inst, 1, Ids, 3);
+    break;
+  case OpSelectionMerge:
+  case OpLifetimeStart:
+  case OpLifetimeStop:
+    addIds(Inst, 1, Ids, 2);
+    break;
+  default:
+    addIds(Inst, 1, Ids);
+  }
+  return true;
+}
+
+} // namespace SPIRV
@@ -0,0 +1,142 @@
+//===- SPIRVIdScanner.h - Word-level access to SPIR-V -----------*- C++ -*-===//
+//
+//                     The LLVM/SPIR-V Translator
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+// Copyright (c) 2024 The Khronos Group Inc.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimers.
+// Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimers in the documentation
+// and/or other materials provided with the distribution.
+// Neither the names of The Khronos Group, nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// Software without specific prior written permission.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH
+// THE SOFTWARE.
+//
+//===----------------------------------------------------------------------===//
+/// \file
+///
+/// This file declares helpers for tools that work directly on the words of a
+/// SPIR-V binary instead of decoding it into a SPIRVModule, e.g. the module
+/// linker.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef SPIRV_LIBSPIRV_SPIRVIDSCANNER_H
+#define SPIRV_LIBSPIRV_SPIRVIDSCANNER_H
+
+#include "SPIRVEnum.h"
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace SPIRV {
+
+/// Positions of the words of the SPIR-V module header.
+enum SPIRVHeaderWordKind {
+  SPIRVHW_Magic,
+  SPIRVHW_Version,
+  SPIRVHW_Generator,
+  SPIRVHW_Bound,
+  SPIRVHW_Schema,
+  SPIRVHW_Count
+};
+
+/// Copy a SPIR-V binary into a word buffer and check its header.
+/// \returns false and sets \p ErrMsg if \p Binary is not a SPIR-V binary.
+bool readSPIRVWords(llvm::StringRef Binary, std::vector<SPIRVWord> &Words,
+                    std::string &ErrMsg);
+
+/// Get the opcode of the instruction starting at \p Inst.
+inline Op getSPIRVInstOpCode(const SPIRVWord *Inst) {
+  return static_cast<Op>(*Inst & OpCodeMask);
+}
+
+/// Get the word count of the instruction starting at \p Inst.
+inline SPIRVWord getSPIRVInstWordCount(const SPIRVWord *Inst) {
+  return *Inst >> WordCountShift;
+}
+
+/// Call \p F with every instruction of a module, i.e. with the words following
+/// the header split by the instruction word counts.
+/// \returns false if an instruction is truncated or has a zero word count.
+template <typename FuncTy>
+bool forEachSPIRVInst(llvm::ArrayRef<SPIRVWord> Words, FuncTy F) {
+  size_t Pos = SPIRVHW_Count;
+  while (Pos < Words.size()) {
+    SPIRVWord WordCount = getSPIRVInstWordCount(&Words[Pos]);
+    if (WordCount == 0 || Pos + WordCount > Words.size())
+      return false;
+    F(Words.slice(Pos, WordCount));
+    Pos += WordCount;
+  }
+  return true;
+}
+
+/// Locations of the ids within one instruction, as indices of its words.
+/// Index 0 is the word count and opcode word, so 0 means "not present" for
+/// the result type and the result id.
+struct SPIRVInstIds {
+  unsigned ResultType = 0;
+  unsigned Result = 0;
+  llvm::SmallVector<unsigned, 8> Operands;
+};
+
+/// Tells ids from literals in the operands of instructions without decoding
+/// them into SPIRVEntry objects. Instructions have to be scanned in module
+/// order: the ids of extended instruction sets and the types of OpSwitch
+/// selectors are remembered on the way.
+class SPIRVIdScanner {
+public:
+  /// Find the ids of \p Inst.
+  /// \returns false if the operand layout of the instruction is unknown.
+  bool scan(llvm::ArrayRef<SPIRVWord> Inst, SPIRVInstIds &Ids);
+
+  /// Get the kind of the extended instruction set imported as \p Id.
+  /// \returns SPIRVEIS_Count for sets unknown to the translator.
+  SPIRVExtInstSetKind getExtInstSet(SPIRVId Id) const;
+
+private:
+  bool scanOperands(llvm::ArrayRef<SPIRVWord> Inst, SPIRVInstIds &Ids);
+
+  std::unordered_map<SPIRVId, SPIRVExtInstSetKind> ExtInstSets;
+  /// Ids of extended instruction sets whose operands are all ids.
+  std::unordered_set<SPIRVId> NonSemanticSets;
+  /// 64-bit integer types and values, which use two words in OpSwitch.
+  std::unordered_set<SPIRVId> WideIntTypes;
+  std::unordered_set<SPIRVId> WideIntValues;
+};
+
+/// Get the number of words taken by the literal string starting at word \p I
+/// of \p Inst.
+unsigned getSPIRVStringWordCount(llvm::ArrayRef<SPIRVWord> Inst, unsigned I);
+
+/// Get the literal string starting at word \p I of \p Inst.
+std::string getSPIRVString(llvm::ArrayRef<SPIRVWord> Inst, unsigned I);
+
+} // namespace SPIRV
+
+#endif // SPIRV_LIBSPIRV_SPIRVIDSCANNER_H
@@ -263,7 +263,7 @@ SPIRVSpecConstantOp *createSpecConstantOpInst(SPIRVInstruction *Inst) {
   // Literals, so we can pass them as is for further handling.
   if (OC == OpCompositeExtract || OC == OpCompositeInsert) {
     auto *SPIRVInst = static_cast<SPIRVInstTemplateBase *>(Inst);
-    Ops = SPIRVInst->getOpWords();
+    Ops = SPIRVInst->getOpWords().vec();
   } else {
     Ops = Inst->getIds(Inst->getOperands());
   }
@@ -276,11 +276,11 @@ SPIRVSpecConstantOp *createSpecConstantOpInst(SPIRVInstruction *Inst) {
 
 SPIRVInstruction *createInstFromSpecConstantOp(SPIRVSpecConstantOp *Inst) {
   assert(Inst->getOpCode() == OpSpecConstantOp && "Not OpSpecConstantOp");
-  auto Ops = Inst->getOpWords();
-  auto OC = static_cast<Op>(Ops[0]);
+  llvm::ArrayRef<SPIRVWord> Words = Inst->getOpWords();
+  auto OC = static_cast<Op>(Words[0]);
   assert(isSpecConstantOpAllowedOp(OC) &&
          "Op code not allowed for OpSpecConstantOp");
-  Ops.erase(Ops.begin(), Ops.begin() + 1);
+  std::vector<SPIRVWord> Ops = Words.drop_front().vec();
   auto *BM = Inst->getModule();
   auto *RetInst = SPIRVInstTemplateBase::create(
       OC, Inst->getType(), Inst->getId(), Ops, nullptr, BM);
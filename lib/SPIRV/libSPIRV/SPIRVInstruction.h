@@ -48,6 +48,10 @@
 #include "SPIRVStream.h"
 #include "SPIRVValue.h"
 
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+
 #include <cassert>
 #include <functional>
 #include <iostream>
@@ -240,10 +244,12 @@ public:
     addLit(Lit3);
     addLit(Lit4);
   }
-  bool isOperandLiteral(unsigned I) const override { return Lit.count(I); }
+  bool isOperandLiteral(unsigned I) const override {
+    return llvm::is_contained(Lit, I);
+  }
   void addLit(unsigned L) {
-    if (L != ~0U)
-      Lit.insert(L);
+    if (L != ~0U && !isOperandLiteral(L))
+      Lit.push_back(L);
   }
   /// \return Expected number of operands. If the instruction has variable
   /// number of words, return the minimum.
@@ -275,7 +281,7 @@ public:
       }
     } else
       SPIRVEntry::setWordCount(WC);
-    Ops = TheOps;
+    Ops.assign(TheOps.begin(), TheOps.end());
     // The required SPIR-V version depends on the operands for some
     // instructions.
     updateModuleVersion();
@@ -290,9 +296,7 @@ public:
     Ops.resize(NumOps);
   }
 
-  std::vector<SPIRVWord> &getOpWords() { return Ops; }
-
-  const std::vector<SPIRVWord> &getOpWords() const { return Ops; }
+  llvm::ArrayRef<SPIRVWord> getOpWords() const { return Ops; }
 
   SPIRVWord getOpWord(int I) const { return Ops[I]; }
 
@@ -310,17 +314,17 @@ public:
 
   std::vector<SPIRVValue *> getOperands() override {
     std::vector<SPIRVValue *> VOps;
+    VOps.reserve(Ops.size());
     for (size_t I = 0, E = Ops.size(); I != E; ++I)
       VOps.push_back(getOperand(I));
     return VOps;
   }
 
-  std::vector<SPIRVEntry *> getNonLiteralOperands() const override {
-    std::vector<SPIRVEntry *> Operands;
+  void addNonLiteralOperands(
+      llvm::SmallVectorImpl<SPIRVEntry *> &Operands) const override {
     for (size_t I = 0, E = Ops.size(); I < E; ++I)
       if (!isOperandLiteral(I))
         Operands.push_back(getEntry(Ops[I]));
-    return Operands;
   }
 
   virtual const SPIRVValue *getOperand(unsigned I) const {
@@ -353,26 +357,32 @@ public:
 
   void setHasVariableWordCount(bool VariWC) { HasVariWC = VariWC; }
 
+  size_t getOperandMemoryUsage() const override {
+    return getHeapSize(Ops) + getHeapSize(Lit);
+  }
+
 protected:
-  void encode(spv_ostream &O) const override {
-    auto E = getEncoder(O);
+  template <typename FormatTy>
+  void encodeImpl(const SPIRVEncoder<FormatTy> &E) const {
     if (hasType())
       E << Type;
     if (hasId())
       E << Id;
     E << Ops;
   }
-  void decode(std::istream &I) override {
-    auto D = getDecoder(I);
+  template <typename FormatTy>
+  void decodeImpl(const SPIRVDecoder<FormatTy> &D) {
     if (hasType())
       D >> Type;
     if (hasId())
       D >> Id;
     D >> Ops;
   }
-  std::vector<SPIRVWord> Ops;
+  _SPIRV_DEF_ENCDEC_FORMATS
+  // Most instructions have a few operands, which are then stored inline.
+  llvm::SmallVector<SPIRVWord, 4> Ops;
   bool HasVariWC;
-  std::unordered_set<unsigned> Lit; // Literal operand index
+  llvm::SmallVector<unsigned, 4> Lit; // Literal operand index
 };
 
 template <typename BT = SPIRVInstTemplateBase, Op OC = OpNop, bool HasId = true,
@@ -402,7 +412,7 @@ public:
       : TheMemoryAccessMask(0), Alignment(0), SrcAlignment(0),
         AliasScopeInstID(0), NoAliasInstID(0) {}
 
-  void memoryAccessUpdate(const std::vector<SPIRVWord> &MemoryAccess) {
+  void memoryAccessUpdate(llvm::ArrayRef<SPIRVWord> MemoryAccess) {
     if (!MemoryAccess.size())
       return;
     assert(MemoryAccess.size() > 0 && "Invalid memory access operand size");
@@ -473,7 +483,7 @@ public:
         StorageClass(TheStorageClass) {
     if (TheInitializer && !TheInitializer->isUndef())
       Initializer.push_back(TheInitializer->getId());
-    Name = TheName;
+    setName(TheName);
     validate();
   }
   // Incomplete constructor
@@ -507,10 +517,10 @@ public:
     else
       eraseDecorate(DecorationConstant);
   }
-  std::vector<SPIRVEntry *> getNonLiteralOperands() const override {
+  void addNonLiteralOperands(
+      llvm::SmallVectorImpl<SPIRVEntry *> &Ops) const override {
     if (SPIRVValue *V = getInitializer())
-      return std::vector<SPIRVEntry *>(1, V);
-    return std::vector<SPIRVEntry *>();
+      Ops.push_back(V);
   }
 
 protected:
@@ -525,6 +535,9 @@ protected:
     Initializer.resize(WordCount - 4);
   }
   _SPIRV_DEF_ENCDEC4(Type, Id, StorageClass, Initializer)
+  size_t getOperandMemoryUsage() const override {
+    return getHeapSize(Initializer);
+  }
 
   SPIRVStorageClassKind StorageClass;
   std::vector<SPIRVId> Initializer;
@@ -538,7 +551,8 @@ public:
              const std::vector<SPIRVWord> &TheMemoryAccess,
              SPIRVBasicBlock *TheBB)
       : SPIRVInstruction(FixedWords + TheMemoryAccess.size(), OpStore, TheBB),
-        SPIRVMemoryAccess(TheMemoryAccess), MemoryAccess(TheMemoryAccess),
+        SPIRVMemoryAccess(TheMemoryAccess),
+        MemoryAccess(TheMemoryAccess.begin(), TheMemoryAccess.end()),
         PtrId(PointerId), ValId(ValueId) {
     setAttr();
     validate();
@@ -564,14 +578,17 @@ protected:
     SPIRVEntry::setWordCount(TheWordCount);
     MemoryAccess.resize(TheWordCount - FixedWords);
   }
-  void encode(spv_ostream &O) const override {
-    getEncoder(O) << PtrId << ValId << MemoryAccess;
+  template <typename FormatTy>
+  void encodeImpl(const SPIRVEncoder<FormatTy> &O) const {
+    O << PtrId << ValId << MemoryAccess;
   }
 
-  void decode(std::istream &I) override {
-    getDecoder(I) >> PtrId >> ValId >> MemoryAccess;
+  template <typename FormatTy>
+  void decodeImpl(const SPIRVDecoder<FormatTy> &I) {
+    I >> PtrId >> ValId >> MemoryAccess;
     memoryAccessUpdate(MemoryAccess);
   }
+  _SPIRV_DEF_ENCDEC_FORMATS
 
   void validate() const override {
     SPIRVInstruction::validate();
@@ -583,7 +600,7 @@ protected:
   }
 
 private:
-  std::vector<SPIRVWord> MemoryAccess;
+  llvm::SmallVector<SPIRVWord, 2> MemoryAccess;
   SPIRVId PtrId;
   SPIRVId ValId;
 };
@@ -600,7 +617,7 @@ public:
             TheBB->getValueType(PointerId)->getPointerElementType(), TheId,
             TheBB),
         SPIRVMemoryAccess(TheMemoryAccess), PtrId(PointerId),
-        MemoryAccess(TheMemoryAccess) {
+        MemoryAccess(TheMemoryAccess.begin(), TheMemoryAccess.end()) {
     validate();
     assert(TheBB && "Invalid BB");
   }
@@ -616,14 +633,17 @@ protected:
     MemoryAccess.resize(TheWordCount - FixedWords);
   }
 
-  void encode(spv_ostream &O) const override {
-    getEncoder(O) << Type << Id << PtrId << MemoryAccess;
+  template <typename FormatTy>
+  void encodeImpl(const SPIRVEncoder<FormatTy> &O) const {
+    O << Type << Id << PtrId << MemoryAccess;
   }
 
-  void decode(std::istream &I) override {
-    getDecoder(I) >> Type >> Id >> PtrId >> MemoryAccess;
+  template <typename FormatTy>
+  void decodeImpl(const SPIRVDecoder<FormatTy> &I) {
+    I >> Type >> Id >> PtrId >> MemoryAccess;
     memoryAccessUpdate(MemoryAccess);
   }
+  _SPIRV_DEF_ENCDEC_FORMATS
 
   void validate() const override {
     SPIRVInstruction::validate();
@@ -634,7 +654,7 @@ protected:
 
 private:
   SPIRVId PtrId;
-  std::vector<SPIRVWord> MemoryAccess;
+  llvm::SmallVector<SPIRVWord, 2> MemoryAccess;
 };
 
 class SPIRVBinary : public SPIRVInstTemplateBase {
@@ -928,6 +948,7 @@ public:
     });
     SPIRVInstruction::validate();
   }
+  size_t getOperandMemoryUsage() const override { return getHeapSize(Pairs); }
 
 protected:
   std::vector<SPIRVId> Pairs;
@@ -1195,6 +1216,7 @@ public:
     });
     SPIRVInstruction::validate();
   }
+  size_t getOperandMemoryUsage() const override { return getHeapSize(Pairs); }
 
 protected:
   SPIRVId Select;
@@ -1222,10 +1244,7 @@ public:
   SPIRVValue *getScalar() const { return getValue(Scalar); }
 
   std::vector<SPIRVValue *> getOperands() override {
-    std::vector<SPIRVId> Operands;
-    Operands.push_back(Vector);
-    Operands.push_back(Scalar);
-    return getValues(Operands);
+    return {getValue(Vector), getValue(Scalar)};
   }
 
   void setWordCount(SPIRVWord FixedWordCount) override {
@@ -1278,10 +1297,7 @@ public:
   SPIRVValue *getMatrix() const { return getValue(Matrix); }
 
   std::vector<SPIRVValue *> getOperands() override {
-    std::vector<SPIRVId> Operands;
-    Operands.push_back(Vector);
-    Operands.push_back(Matrix);
-    return getValues(Operands);
+    return {getValue(Vector), getValue(Matrix)};
   }
 
   void setWordCount(SPIRVWord FixedWordCount) override {
@@ -1334,10 +1350,7 @@ public:
   SPIRVValue *getScalar() const { return getValue(Scalar); }
 
   std::vector<SPIRVValue *> getOperands() override {
-    std::vector<SPIRVId> Operands;
-    Operands.push_back(Matrix);
-    Operands.push_back(Scalar);
-    return getValues(Operands);
+    return {getValue(Matrix), getValue(Scalar)};
   }
 
   void setWordCount(SPIRVWord FixedWordCount) override {
@@ -1395,10 +1408,7 @@ public:
   SPIRVValue *getVector() const { return getValue(Vector); }
 
   std::vector<SPIRVValue *> getOperands() override {
-    std::vector<SPIRVId> Operands;
-    Operands.push_back(Matrix);
-    Operands.push_back(Vector);
-    return getValues(Operands);
+    return {getValue(Matrix), getValue(Vector)};
   }
 
   void setWordCount(SPIRVWord FixedWordCount) override {
@@ -1454,10 +1464,7 @@ public:
   SPIRVValue *getRightMatrix() const { return getValue(RightMatrix); }
 
   std::vector<SPIRVValue *> getOperands() override {
-    std::vector<SPIRVId> Operands;
-    Operands.push_back(LeftMatrix);
-    Operands.push_back(RightMatrix);
-    return getValues(Operands);
+    return {getValue(LeftMatrix), getValue(RightMatrix)};
   }
 
   void setWordCount(SPIRVWord FixedWordCount) override {
@@ -1511,9 +1518,7 @@ public:
   SPIRVValue *getMatrix() const { return getValue(Matrix); }
 
   std::vector<SPIRVValue *> getOperands() override {
-    std::vector<SPIRVId> Operands;
-    Operands.push_back(Matrix);
-    return getValues(Operands);
+    return {getValue(Matrix)};
   }
 
   void setWordCount(SPIRVWord FixedWordCount) override {
@@ -1721,17 +1726,16 @@ public:
     setWordCount(Args.size() + FixedWordCount);
   }
   std::vector<SPIRVValue *> getArgumentValues() { return getValues(Args); }
+  SPIRVValueRange getArgumentValueRange() const { return getValueRange(Args); }
   std::vector<SPIRVType *> getArgumentValueTypes() const {
-    std::vector<SPIRVType *> ArgTypes;
-    for (auto &I : Args)
-      ArgTypes.push_back(getValue(I)->getType());
-    return ArgTypes;
+    return getValueTypes(Args);
   }
   void setWordCount(SPIRVWord TheWordCount) override {
     SPIRVEntry::setWordCount(TheWordCount);
     Args.resize(TheWordCount - FixedWordCount);
   }
   void validate() const override { SPIRVInstruction::validate(); }
+  size_t getOperandMemoryUsage() const override { return getHeapSize(Args); }
 
 protected:
   std::vector<SPIRVWord> Args;
@@ -1827,48 +1831,50 @@ public:
             ExtSetKind == SPIRVEIS_NonSemantic_AuxData) &&
            "not supported");
   }
-  void encode(spv_ostream &O) const override {
-    getEncoder(O) << Type << Id << ExtSetId;
+  template <typename FormatTy>
+  void encodeImpl(const SPIRVEncoder<FormatTy> &O) const {
+    O << Type << Id << ExtSetId;
     switch (ExtSetKind) {
     case SPIRVEIS_OpenCL:
-      getEncoder(O) << ExtOpOCL;
+      O << ExtOpOCL;
       break;
     case SPIRVEIS_Debug:
     case SPIRVEIS_OpenCL_DebugInfo_100:
     case SPIRVEIS_NonSemantic_Shader_DebugInfo_100:
     case SPIRVEIS_NonSemantic_Shader_DebugInfo_200:
-      getEncoder(O) << ExtOpDebug;
+      O << ExtOpDebug;
       break;
     case SPIRVEIS_NonSemantic_AuxData:
-      getEncoder(O) << ExtOpNonSemanticAuxData;
+      O << ExtOpNonSemanticAuxData;
       break;
     default:
       assert(0 && "not supported");
-      getEncoder(O) << ExtOp;
+      O << ExtOp;
     }
-    getEncoder(O) << Args;
+    O << Args;
   }
-  void decode(std::istream &I) override {
-    getDecoder(I) >> Type >> Id >> ExtSetId;
+  template <typename FormatTy>
+  void decodeImpl(const SPIRVDecoder<FormatTy> &I) {
+    I >> Type >> Id >> ExtSetId;
     setExtSetKindById();
     switch (ExtSetKind) {
     case SPIRVEIS_OpenCL:
-      getDecoder(I) >> ExtOpOCL;
+      I >> ExtOpOCL;
       break;
     case SPIRVEIS_Debug:
     case SPIRVEIS_OpenCL_DebugInfo_100:
     case SPIRVEIS_NonSemantic_Shader_DebugInfo_100:
     case SPIRVEIS_NonSemantic_Shader_DebugInfo_200:
-      getDecoder(I) >> ExtOpDebug;
+      I >> ExtOpDebug;
       break;
     case SPIRVEIS_NonSemantic_AuxData:
-      getDecoder(I) >> ExtOpNonSemanticAuxData;
+      I >> ExtOpNonSemanticAuxData;
       break;
     default:
       assert(0 && "not supported");
-      getDecoder(I) >> ExtOp;
+      I >> ExtOp;
     }
-    SPIRVDecoder Decoder = getDecoder(I);
+    SPIRVDecoder<FormatTy> Decoder(I.IS, *Module);
     Decoder >> Args;
 
     if (ExtSetKind == SPIRVEIS_NonSemantic_Shader_DebugInfo_100 ||
@@ -1880,6 +1886,7 @@ public:
       }
     }
   }
+  _SPIRV_DEF_ENCDEC_FORMATS
   void validate() const override {
     SPIRVFunctionCallGeneric::validate();
     validateBuiltin(ExtSetId, ExtOp);
@@ -1958,6 +1965,9 @@ public:
   std::vector<SPIRVValue *> getOperands() override {
     return getValues(Constituents);
   }
+  SPIRVValueRange getOperandRange() const {
+    return getValueRange(Constituents);
+  }
 
 protected:
   void setWordCount(SPIRVWord TheWordCount) override {
@@ -1983,6 +1993,9 @@ protected:
       assert(false && "Invalid type");
     }
   }
+  size_t getOperandMemoryUsage() const override {
+    return getHeapSize(Constituents);
+  }
   std::vector<SPIRVId> Constituents;
 };
 
@@ -2096,7 +2109,8 @@ public:
                   const std::vector<SPIRVWord> &TheMemoryAccess,
                   SPIRVBasicBlock *TheBB)
       : SPIRVInstruction(FixedWords + TheMemoryAccess.size(), OC, TheBB),
-        SPIRVMemoryAccess(TheMemoryAccess), MemoryAccess(TheMemoryAccess),
+        SPIRVMemoryAccess(TheMemoryAccess),
+        MemoryAccess(TheMemoryAccess.begin(), TheMemoryAccess.end()),
         Target(TheTarget->getId()), Source(TheSource->getId()) {
     validate();
     assert(TheBB && "Invalid BB");
@@ -2119,14 +2133,17 @@ protected:
     MemoryAccess.resize(TheWordCount - FixedWords);
   }
 
-  void encode(spv_ostream &O) const override {
-    getEncoder(O) << Target << Source << MemoryAccess;
+  template <typename FormatTy>
+  void encodeImpl(const SPIRVEncoder<FormatTy> &O) const {
+    O << Target << Source << MemoryAccess;
   }
 
-  void decode(std::istream &I) override {
-    getDecoder(I) >> Target >> Source >> MemoryAccess;
+  template <typename FormatTy>
+  void decodeImpl(const SPIRVDecoder<FormatTy> &I) {
+    I >> Target >> Source >> MemoryAccess;
     memoryAccessUpdate(MemoryAccess);
   }
+  _SPIRV_DEF_ENCDEC_FORMATS
 
   void validate() const override {
     assert((getValueType(Id) == getValueType(Source)) && "Inconsistent type");
@@ -2136,7 +2153,7 @@ protected:
     SPIRVInstruction::validate();
   }
 
-  std::vector<SPIRVWord> MemoryAccess;
+  llvm::SmallVector<SPIRVWord, 2> MemoryAccess;
   SPIRVId Target;
   SPIRVId Source;
 };
@@ -2151,7 +2168,8 @@ public:
                        const std::vector<SPIRVWord> &TheMemoryAccess,
                        SPIRVBasicBlock *TheBB)
       : SPIRVInstruction(FixedWords + TheMemoryAccess.size(), OC, TheBB),
-        SPIRVMemoryAccess(TheMemoryAccess), MemoryAccess(TheMemoryAccess),
+        SPIRVMemoryAccess(TheMemoryAccess),
+        MemoryAccess(TheMemoryAccess.begin(), TheMemoryAccess.end()),
         Target(TheTarget->getId()), Source(TheSource->getId()),
         Size(TheSize->getId()) {
     validate();
@@ -2183,18 +2201,21 @@ protected:
     MemoryAccess.resize(TheWordCount - FixedWords);
   }
 
-  void encode(spv_ostream &O) const override {
-    getEncoder(O) << Target << Source << Size << MemoryAccess;
+  template <typename FormatTy>
+  void encodeImpl(const SPIRVEncoder<FormatTy> &O) const {
+    O << Target << Source << Size << MemoryAccess;
   }
 
-  void decode(std::istream &I) override {
-    getDecoder(I) >> Target >> Source >> Size >> MemoryAccess;
+  template <typename FormatTy>
+  void decodeImpl(const SPIRVDecoder<FormatTy> &I) {
+    I >> Target >> Source >> Size >> MemoryAccess;
     memoryAccessUpdate(MemoryAccess);
   }
+  _SPIRV_DEF_ENCDEC_FORMATS
 
   void validate() const override { SPIRVInstruction::validate(); }
 
-  std::vector<SPIRVWord> MemoryAccess;
+  llvm::SmallVector<SPIRVWord, 2> MemoryAccess;
   SPIRVId Target;
   SPIRVId Source;
   SPIRVId Size;
@@ -2322,11 +2343,7 @@ public:
   SPIRVValue *getMemScope() const { return getValue(MemScope); }
   SPIRVValue *getMemSemantic() const { return getValue(MemSema); }
   std::vector<SPIRVValue *> getOperands() override {
-    std::vector<SPIRVId> Operands;
-    Operands.push_back(ExecScope);
-    Operands.push_back(MemScope);
-    Operands.push_back(MemSema);
-    return getValues(Operands);
+    return {getValue(ExecScope), getValue(MemScope), getValue(MemSema)};
   }
 
 protected:
@@ -2417,14 +2434,8 @@ public:
   SPIRVValue *getStride() const { return getValue(Stride); }
   SPIRVValue *getEvent() const { return getValue(Event); }
   std::vector<SPIRVValue *> getOperands() override {
-    std::vector<SPIRVId> Operands;
-    Operands.push_back(ExecScope);
-    Operands.push_back(Destination);
-    Operands.push_back(Source);
-    Operands.push_back(NumElements);
-    Operands.push_back(Stride);
-    Operands.push_back(Event);
-    return getValues(Operands);
+    return {getValue(ExecScope), getValue(Destination), getValue(Source),
+            getValue(NumElements), getValue(Stride), getValue(Event)};
   }
 
 protected:
@@ -0,0 +1,594 @@
+//===- SPIRVLinker.cpp - Link SPIR-V binaries -------------------*- C++ -*-===//
+//
+//                     The LLVM/SPIR-V Translator
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+// Copyright (c) 2024 The Khronos Group Inc.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimers.
+// Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimers in the documentation
+// and/or other materials provided with the distribution.
+// Neither the names of The Khronos Group, nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// Software without specific prior written permission.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH
+// THE SOFTWARE.
+//
+//===----------------------------------------------------------------------===//
+/// \file
+///
+/// This file implements linking of several SPIR-V binaries into one module
+/// without translating them to LLVM IR. Ids of every input are moved to a
+/// range of their own, identical capabilities, extensions, extended
+/// instruction set imports, types and constants are merged, and imported
+/// symbols are replaced with the definitions exported by other inputs
+/// according to the LinkageAttributes decorations. The types, constants and
+/// global variables of all inputs are then ordered so that every id is
+/// defined before it is used.
+///
+//===----------------------------------------------------------------------===//
+
+#include "LLVMSPIRVLib.h"
+#include "SPIRVIdScanner.h"
+#include "SPIRVOpCode.h"
+
+#include <cstring>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+
+using namespace SPIRV;
+
+namespace {
+
+/// Sections of a module in the order required by the logical layout.
+enum SPIRVLinkSection {
+  LS_Capabilities,
+  LS_Extensions,
+  LS_ExtInstImports,
+  LS_MemoryModel,
+  LS_EntryPoints,
+  LS_ExecutionModes,
+  LS_DebugStrings,
+  LS_Names,
+  LS_ModuleProcessed,
+  LS_Annotations,
+  LS_Globals,
+  LS_FunctionDeclarations,
+  LS_FunctionDefinitions,
+  LS_Count
+};
+
+SPIRVLinkSection getLinkSection(Op OC) {
+  switch (OC) {
+  case OpCapability:
+    return LS_Capabilities;
+  case OpExtension:
+    return LS_Extensions;
+  case OpExtInstImport:
+    return LS_ExtInstImports;
+  case OpMemoryModel:
+    return LS_MemoryModel;
+  case OpEntryPoint:
+    return LS_EntryPoints;
+  case OpExecutionMode:
+  case OpExecutionModeId:
+    return LS_ExecutionModes;
+  case OpString:
+  case OpSource:
+  case OpSourceContinued:
+  case OpSourceExtension:
+    return LS_DebugStrings;
+  case OpName:
+  case OpMemberName:
+    return LS_Names;
+  case OpModuleProcessed:
+    return LS_ModuleProcessed;
+  case OpDecorate:
+  case OpDecorateId:
+  case OpDecorateString:
+  case OpMemberDecorate:
+  case OpMemberDecorateString:
+  case OpDecorationGroup:
+  case OpGroupDecorate:
+  case OpGroupMemberDecorate:
+    return LS_Annotations;
+  default:
+    return LS_Globals;
+  }
+}
+
+bool isDecorationOpCode(Op OC) {
+  return getLinkSection(OC) == LS_Annotations && OC != OpDecorationGroup;
+}
+
+/// Types and constants which can be replaced with an identical instruction
+/// of another input.
+bool isMergeableOpCode(Op OC) {
+  return (isTypeOpCode(OC) || isConstantOpCode(OC) || OC == OpString ||
+          OC == OpExtInstImport) &&
+         OC != OpConstantFunctionPointerINTEL;
+}
+
+struct SPIRVLinkSymbol {
+  SPIRVId Id;
+  SPIRVWord Linkage;
+  unsigned Module;
+};
+
+class SPIRVLinker {
+public:
+  bool link(const std::vector<std::string> &Binaries, std::string &Out);
+  const std::string &getError() const { return ErrMsg; }
+
+private:
+  struct InputModule {
+    std::vector<SPIRVWord> Words;
+    /// Added to every id of the input to get its id in the linked module.
+    SPIRVWord IdOffset;
+  };
+
+  bool fail(const std::string &Msg) {
+    ErrMsg = Msg;
+    return false;
+  }
+  bool collect(unsigned M);
+  bool resolveSymbols();
+  /// Make the uses of the symbol \p Id refer to \p Definition and drop the
+  /// declaration or the definition of \p Id.
+  void replaceSymbol(SPIRVId Id, SPIRVId Definition);
+  bool emit(unsigned M);
+  /// Append the global instructions of all inputs to the globals section,
+  /// definitions before uses.
+  void emitGlobals();
+
+  SPIRVId getLinkedId(unsigned M, SPIRVWord Id) const {
+    return Canonical[Modules[M].IdOffset + Id];
+  }
+  bool isRemoved(unsigned M, SPIRVWord Id) const {
+    return Removed[Modules[M].IdOffset + Id];
+  }
+  /// Replace the ids of \p Inst with the linked ones.
+  void remapIds(unsigned M, llvm::MutableArrayRef<SPIRVWord> Inst,
+                const SPIRVInstIds &Ids, bool RemapResult) const;
+
+  std::vector<InputModule> Modules;
+  /// Id in the linked module of every id of every input, indexed by the
+  /// input id plus the offset of the input.
+  std::vector<SPIRVId> Canonical;
+  /// Ids whose definition is replaced by another one.
+  std::vector<bool> Removed;
+  /// Types and constants already defined, keyed by their remapped words.
+  std::unordered_map<std::string, SPIRVId> MergedDefinitions;
+  /// Types of functions and global variables.
+  std::unordered_map<SPIRVId, SPIRVId> SymbolTypes;
+  /// Ids defined by the parameters and the body of every function.
+  std::unordered_map<SPIRVId, std::vector<SPIRVId>> FunctionLocals;
+  std::map<std::string, std::vector<SPIRVLinkSymbol>> Symbols;
+
+  /// An instruction of the types, constants and global variables section
+  /// with the OpLine and OpNoLine instructions preceding it.
+  struct GlobalInst {
+    std::vector<SPIRVWord> Words;
+    /// Linked ids defined and used by the instruction.
+    SPIRVId Result = 0;
+    llvm::SmallVector<SPIRVId, 8> Uses;
+    /// Pointer type declared by OpTypeForwardPointer.
+    SPIRVId ForwardPointer = 0;
+  };
+  /// The global instructions of all inputs, in input order. A global of one
+  /// input may use a variable defined by a later input once imports are
+  /// resolved, so they are only ordered when all inputs are emitted.
+  std::vector<GlobalInst> Globals;
+
+  std::vector<SPIRVWord> Sections[LS_Count];
+  std::set<std::vector<SPIRVWord>> UniqueModuleInsts;
+  std::vector<SPIRVWord> MemoryModel;
+  bool HasSource = false;
+  std::string ErrMsg;
+};
+
+void SPIRVLinker::remapIds(unsigned M, llvm::MutableArrayRef<SPIRVWord> Inst,
+                           const SPIRVInstIds &Ids, bool RemapResult) const {
+  if (Ids.ResultType)
+    Inst[Ids.ResultType] = getLinkedId(M, Inst[Ids.ResultType]);
+  if (Ids.Result)
+    Inst[Ids.Result] = RemapResult ? getLinkedId(M, Inst[Ids.Result])
+                                   : Modules[M].IdOffset + Inst[Ids.Result];
+  for (unsigned I : Ids.Operands)
+    Inst[I] = getLinkedId(M, Inst[I]);
+}
+
+/// Find the symbols, the decorated ids and the types and constants that
+/// duplicate ones of the previous inputs.
+bool SPIRVLinker::collect(unsigned M) {
+  SPIRVIdScanner Scanner;
+  SPIRVInstIds Ids;
+  std::unordered_map<SPIRVWord, std::string> Names;
+  // Decorations of every id, with the target replaced by 0.
+  std::unordered_map<SPIRVWord, std::vector<std::string>> Decorations;
+  // Ids whose decorations are not compared: the ones decorated through
+  // decoration groups, with id operands or as linkage symbols.
+  std::unordered_set<SPIRVWord> Decorated;
+  std::unordered_set<SPIRVWord> ForwardDeclared;
+  std::vector<SPIRVId> *Locals = nullptr;
+  bool Valid = true;
+  bool Supported = forEachSPIRVInst(
+      Modules[M].Words, [&](llvm::ArrayRef<SPIRVWord> Inst) {
+        if (!Valid)
+          return;
+        Op OC = getSPIRVInstOpCode(Inst.data());
+        if (!Scanner.scan(Inst, Ids)) {
+          std::string Name;
+          if (!OpCodeNameMap::find(OC, &Name))
+            Name = std::to_string(OC);
+          Valid = fail("module " + std::to_string(M + 1) +
+                       " uses an instruction which cannot be linked: Op" +
+                       Name);
+          return;
+        }
+        if (OC == OpName && Inst.size() > 2)
+          Names[Inst[1]] = getSPIRVString(Inst, 2);
+        else if (OC == OpTypeForwardPointer && Inst.size() > 1)
+          ForwardDeclared.insert(Inst[1]);
+        else if (isDecorationOpCode(OC)) {
+          bool IsLinkage = OC == OpDecorate && Inst.size() > 2 &&
+                           Inst[2] == DecorationLinkageAttributes;
+          if (!IsLinkage && Inst.size() > 2 &&
+              (OC == OpDecorate || OC == OpDecorateString ||
+               OC == OpMemberDecorate || OC == OpMemberDecorateString)) {
+            std::string Decoration(reinterpret_cast<const char *>(Inst.data()),
+                                   Inst.size() * sizeof(SPIRVWord));
+            std::memset(&Decoration[sizeof(SPIRVWord)], 0, sizeof(SPIRVWord));
+            Decorations[Inst[1]].push_back(std::move(Decoration));
+          } else
+            for (unsigned I : Ids.Operands)
+              Decorated.insert(Inst[I]);
+          if (IsLinkage && Inst.size() > 3) {
+            unsigned LinkageWord = 3 + getSPIRVStringWordCount(Inst, 3);
+            if (LinkageWord < Inst.size())
+              Symbols[getSPIRVString(Inst, 3)].push_back(
+                  {Modules[M].IdOffset + Inst[1], Inst[LinkageWord], M});
+          }
+        }
+
+        if (OC == OpFunctionEnd)
+          Locals = nullptr;
+        if (!Ids.Result)
+          return;
+        SPIRVWord Result = Inst[Ids.Result];
+        SPIRVId Id = Modules[M].IdOffset + Result;
+        if (OC == OpFunction) {
+          if (Inst.size() > 4)
+            SymbolTypes[Id] = getLinkedId(M, Inst[4]);
+          Locals = &FunctionLocals[Id];
+          return;
+        }
+        if (Locals) {
+          Locals->push_back(Id);
+          return;
+        }
+        if (OC == OpVariable && Ids.ResultType)
+          SymbolTypes[Id] = getLinkedId(M, Inst[Ids.ResultType]);
+        if (!isMergeableOpCode(OC) || Decorated.count(Result) ||
+            ForwardDeclared.count(Result))
+          return;
+
+        // Identical definitions differ only in their result ids. Decorated
+        // ones also need the same decorations, in any order.
+        std::vector<SPIRVWord> Key(Inst.begin(), Inst.end());
+        remapIds(M, Key, Ids, /*RemapResult=*/false);
+        Key[Ids.Result] = 0;
+        std::vector<std::string> *ResultDecorations = nullptr;
+        auto DecLoc = Decorations.find(Result);
+        if (DecLoc != Decorations.end()) {
+          ResultDecorations = &DecLoc->second;
+          llvm::sort(*ResultDecorations);
+        }
+        Key.push_back(ResultDecorations ? ResultDecorations->size() : 0);
+        std::string KeyStr(reinterpret_cast<const char *>(Key.data()),
+                           Key.size() * sizeof(SPIRVWord));
+        if (ResultDecorations)
+          for (const std::string &Decoration : *ResultDecorations)
+            KeyStr += Decoration;
+        // Keep differently named structures apart, their names are used by
+        // the reverse translation.
+        if (OC == OpTypeStruct) {
+          auto Loc = Names.find(Result);
+          if (Loc != Names.end())
+            KeyStr += Loc->second;
+        }
+        auto Ins = MergedDefinitions.insert({KeyStr, Id});
+        if (!Ins.second) {
+          Canonical[Id] = Ins.first->second;
+          Removed[Id] = true;
+        }
+      });
+  if (!Supported)
+    return fail("module " + std::to_string(M + 1) + " is malformed");
+  return Valid;
+}
+
+void SPIRVLinker::replaceSymbol(SPIRVId Id, SPIRVId Definition) {
+  Canonical[Id] = Definition;
+  Removed[Id] = true;
+  auto Loc = FunctionLocals.find(Id);
+  if (Loc == FunctionLocals.end())
+    return;
+  for (SPIRVId Local : Loc->second)
+    Removed[Local] = true;
+}
+
+/// Replace imported symbols with the definitions exported by other inputs.
+bool SPIRVLinker::resolveSymbols() {
+  for (auto &Symbol : Symbols) {
+    const SPIRVLinkSymbol *Definition = nullptr;
+    for (const SPIRVLinkSymbol &S : Symbol.second) {
+      if (S.Linkage == LinkageTypeImport)
+        continue;
+      if (!Definition) {
+        Definition = &S;
+        continue;
+      }
+      // Only one definition of a symbol may be exported. Further
+      // definitions of link-once symbols are dropped.
+      if (S.Linkage != LinkageTypeLinkOnceODR ||
+          Definition->Linkage != LinkageTypeLinkOnceODR)
+        return fail("symbol " + Symbol.first +
+                    " is defined by more than one module");
+      replaceSymbol(S.Id, Definition->Id);
+    }
+    if (!Definition)
+      continue;
+    for (const SPIRVLinkSymbol &S : Symbol.second) {
+      if (S.Linkage != LinkageTypeImport)
+        continue;
+      if (SymbolTypes[S.Id] != SymbolTypes[Definition->Id])
+        return fail("type mismatch for symbol " + Symbol.first +
+                    " imported by module " + std::to_string(S.Module + 1));
+      replaceSymbol(S.Id, Definition->Id);
+    }
+  }
+  return true;
+}
+
+/// Append the instructions of an input which are left after merging to the
+/// sections of the linked module.
+bool SPIRVLinker::emit(unsigned M) {
+  SPIRVIdScanner Scanner;
+  SPIRVInstIds Ids;
+  std::vector<SPIRVWord> Function;
+  bool InFunction = false;
+  bool SkipFunction = false;
+  bool FunctionHasBody = false;
+  bool InSource = false;
+  bool Valid = true;
+  std::vector<SPIRVWord> Lines;
+  forEachSPIRVInst(Modules[M].Words, [&](llvm::ArrayRef<SPIRVWord> Inst) {
+    if (!Valid)
+      return;
+    Op OC = getSPIRVInstOpCode(Inst.data());
+    Scanner.scan(Inst, Ids);
+
+    if (OC == OpFunction) {
+      InFunction = true;
+      SkipFunction = isRemoved(M, Inst[Ids.Result]);
+      FunctionHasBody = false;
+      Function.clear();
+    }
+    if (InFunction) {
+      if (OC == OpFunctionEnd)
+        InFunction = false;
+      if (SkipFunction)
+        return;
+      FunctionHasBody |= OC == OpLabel;
+      std::vector<SPIRVWord> Words(Inst.begin(), Inst.end());
+      remapIds(M, Words, Ids, /*RemapResult=*/true);
+      Function.insert(Function.end(), Words.begin(), Words.end());
+      if (!InFunction) {
+        auto &Section = Sections[FunctionHasBody ? LS_FunctionDefinitions
+                                                 : LS_FunctionDeclarations];
+        Section.insert(Section.end(), Function.begin(), Function.end());
+      }
+      return;
+    }
+
+    if (Ids.Result && isRemoved(M, Inst[Ids.Result]))
+      return;
+    // Drop names and decorations of removed ids.
+    std::vector<SPIRVWord> Words(Inst.begin(), Inst.end());
+    if (OC == OpGroupDecorate || OC == OpGroupMemberDecorate) {
+      unsigned Step = OC == OpGroupDecorate ? 1 : 2;
+      unsigned Kept = 2;
+      for (unsigned I = 2; I + Step <= Words.size(); I += Step)
+        if (!isRemoved(M, Words[I]))
+          for (unsigned J = 0; J < Step; ++J)
+            Words[Kept++] = Words[I + J];
+      if (Kept == 2)
+        return;
+      Words.resize(Kept);
+      Words[0] = (Kept << WordCountShift) | OC;
+      Scanner.scan(Words, Ids);
+    } else if ((isDecorationOpCode(OC) || OC == OpName ||
+                OC == OpMemberName) &&
+               isRemoved(M, Inst[1]))
+      return;
+
+    // Only keep the first source language, the reverse translation reads
+    // just one.
+    if (OC == OpSource) {
+      InSource = !HasSource;
+      HasSource = true;
+      if (!InSource)
+        return;
+    } else if (OC == OpSourceContinued) {
+      if (!InSource)
+        return;
+    } else
+      InSource = false;
+
+    remapIds(M, Words, Ids, /*RemapResult=*/true);
+    if (OC == OpMemoryModel) {
+      if (MemoryModel.empty())
+        MemoryModel = Words;
+      else if (MemoryModel != Words)
+        Valid = fail("module " + std::to_string(M + 1) +
+                     " uses a different memory model");
+      return;
+    }
+    if ((OC == OpCapability || OC == OpExtension ||
+         OC == OpSourceExtension || OC == OpModuleProcessed) &&
+        !UniqueModuleInsts.insert(Words).second)
+      return;
+    SPIRVLinkSection Kind = getLinkSection(OC);
+    if (Kind != LS_Globals) {
+      auto &Section = Sections[Kind];
+      Section.insert(Section.end(), Words.begin(), Words.end());
+      return;
+    }
+    // Debug lines stay in front of the instruction they describe.
+    if (OC == OpLine || OC == OpNoLine) {
+      Lines.insert(Lines.end(), Words.begin(), Words.end());
+      return;
+    }
+    GlobalInst &G = Globals.emplace_back();
+    G.Words = std::move(Lines);
+    G.Words.insert(G.Words.end(), Words.begin(), Words.end());
+    Lines.clear();
+    if (OC == OpTypeForwardPointer && Words.size() > 1)
+      G.ForwardPointer = Words[1];
+    else {
+      G.Result = Ids.Result ? Words[Ids.Result] : 0;
+      if (Ids.ResultType)
+        G.Uses.push_back(Words[Ids.ResultType]);
+      for (unsigned I : Ids.Operands)
+        G.Uses.push_back(Words[I]);
+    }
+  });
+  if (!Lines.empty())
+    Globals.push_back({std::move(Lines), 0, {}, 0});
+  return Valid;
+}
+
+void SPIRVLinker::emitGlobals() {
+  std::unordered_map<SPIRVId, unsigned> Definitions;
+  for (unsigned I = 0; I < Globals.size(); ++I)
+    if (Globals[I].Result)
+      Definitions[Globals[I].Result] = I;
+
+  // Keep the input order and only move a definition up when an instruction
+  // uses it before its place, i.e. when the use was resolved to another
+  // input. Uses of forward declared pointers and cycles among non-semantic
+  // instructions are left alone, like in the inputs.
+  enum { Pending, Visiting, Done };
+  std::vector<uint8_t> State(Globals.size(), Pending);
+  std::unordered_set<SPIRVId> ForwardDeclared;
+  std::vector<std::pair<unsigned, unsigned>> Stack;
+  auto &Section = Sections[LS_Globals];
+  for (unsigned Root = 0; Root < Globals.size(); ++Root) {
+    if (State[Root] != Pending)
+      continue;
+    State[Root] = Visiting;
+    Stack.push_back({Root, 0});
+    while (!Stack.empty()) {
+      unsigned I = Stack.back().first;
+      unsigned &NextUse = Stack.back().second;
+      const GlobalInst &G = Globals[I];
+      if (NextUse < G.Uses.size()) {
+        SPIRVId Use = G.Uses[NextUse++];
+        auto Loc = Definitions.find(Use);
+        if (Loc == Definitions.end() || State[Loc->second] != Pending ||
+            ForwardDeclared.count(Use))
+          continue;
+        State[Loc->second] = Visiting;
+        Stack.push_back({Loc->second, 0});
+        continue;
+      }
+      Section.insert(Section.end(), G.Words.begin(), G.Words.end());
+      if (G.ForwardPointer)
+        ForwardDeclared.insert(G.ForwardPointer);
+      State[I] = Done;
+      Stack.pop_back();
+    }
+  }
+}
+
+bool SPIRVLinker::link(const std::vector<std::string> &Binaries,
+                       std::string &Out) {
+  if (Binaries.empty())
+    return fail("no modules to link");
+  SPIRVWord Bound = 1;
+  SPIRVWord Version = 0;
+  Modules.resize(Binaries.size());
+  for (unsigned M = 0; M < Binaries.size(); ++M) {
+    std::string Err;
+    if (!readSPIRVWords(Binaries[M], Modules[M].Words, Err))
+      return fail("module " + std::to_string(M + 1) + ": " + Err);
+    // Id 0 is invalid, so the ids of the input start right after the ones
+    // of the previous input.
+    Modules[M].IdOffset = Bound - 1;
+    Bound += Modules[M].Words[SPIRVHW_Bound] - 1;
+    Version = std::max(Version, Modules[M].Words[SPIRVHW_Version]);
+  }
+  Canonical.resize(Bound);
+  for (SPIRVId Id = 0; Id < Bound; ++Id)
+    Canonical[Id] = Id;
+  Removed.assign(Bound, false);
+
+  for (unsigned M = 0; M < Modules.size(); ++M)
+    if (!collect(M))
+      return false;
+  if (!resolveSymbols())
+    return false;
+  // Definitions replaced by an import resolution may themselves have been
+  // merged into another one.
+  for (SPIRVId Id = 0; Id < Bound; ++Id)
+    while (Canonical[Canonical[Id]] != Canonical[Id])
+      Canonical[Id] = Canonical[Canonical[Id]];
+  for (unsigned M = 0; M < Modules.size(); ++M)
+    if (!emit(M))
+      return false;
+  emitGlobals();
+
+  std::vector<SPIRVWord> Words = {
+      MagicNumber, Version, Modules.front().Words[SPIRVHW_Generator], Bound,
+      SPIRVISCH_Default};
+  Sections[LS_MemoryModel] = MemoryModel;
+  for (const std::vector<SPIRVWord> &Section : Sections)
+    Words.insert(Words.end(), Section.begin(), Section.end());
+  Out.assign(reinterpret_cast<const char *>(Words.data()),
+             Words.size() * sizeof(SPIRVWord));
+  return true;
+}
+
+} // namespace
+
+namespace SPIRV {
+
+bool linkSpirv(const std::vector<std::string> &Inputs, std::string &Out,
+               std::string &ErrMsg) {
+  SPIRVLinker Linker;
+  if (Linker.link(Inputs, Out))
+    return true;
+  ErrMsg = Linker.getError();
+  return false;
+}
+
+} // namespace SPIRV
@@ -38,6 +38,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "SPIRVModule.h"
+#include "LLVMSPIRVLib.h"
 #include "SPIRVAsm.h"
 #include "SPIRVDebug.h"
 #include "SPIRVEntry.h"
@@ -51,7 +52,11 @@
 #include "SPIRVValue.h"
 
 #include "llvm/ADT/APInt.h"
+#include "llvm/ADT/Hashing.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
 
+#include <algorithm>
 #include <set>
 #include <unordered_map>
 #include <unordered_set>
@@ -111,7 +116,7 @@ public:
     return ErrLog.getError(ErrMsg);
   }
   bool checkExtension(ExtensionID Ext, SPIRVErrorCode ErrCode,
-                      const std::string &Msg) override {
+                      llvm::function_ref<std::string()> Msg) override {
     if (ErrLog.checkError(isAllowedToUseExtension(Ext), ErrCode, Msg))
       return true;
     setInvalid();
@@ -161,6 +166,7 @@ public:
   const std::vector<SPIRVString *> &getStringVec() const override {
     return StringVec;
   }
+  SPIRVMemoryReport getMemoryReport() const override;
   // Module changing functions
   bool importBuiltinSet(const std::string &, SPIRVId *) override;
   bool importBuiltinSetWithId(const std::string &, SPIRVId) override;
@@ -174,6 +180,7 @@ public:
       addCapability(CapabilityKernel);
   }
   void setName(SPIRVEntry *E, const std::string &Name) override;
+  const std::string &internName(const std::string &Name) override;
   void setSourceLanguage(SourceLanguage Lang, SPIRVWord Ver) override {
     SrcLang = Lang;
     SrcLangVer = Ver;
@@ -547,6 +554,9 @@ private:
   SPIRVIdToInstructionSetMap IdToInstSetMap;
   SPIRVIdToBuiltinSetMap IdBuiltinMap;
   SPIRVIdSet NamedId;
+  // Names of the entries, see SPIRVEntry::setName(). A node based set keeps
+  // the strings in place when it grows.
+  std::unordered_set<std::string> NamePool;
   SPIRVStringVec StringVec;
   SPIRVMemberNameVec MemberNameVec;
   std::shared_ptr<const SPIRVLine> CurrentLine;
@@ -566,6 +576,19 @@ private:
   SmallDenseMap<unsigned, SPIRVTypeInt *, 4> IntTypeMap;
   SmallDenseMap<unsigned, SPIRVTypeFloat *, 4> FloatTypeMap;
   std::unordered_map<unsigned, SPIRVConstant *> LiteralMap;
+  // Structurally interned constants: composites are keyed by their type and
+  // constituent ids, nulls by their type.
+  typedef std::pair<SPIRVId, std::vector<SPIRVId>> SPIRVCompositeConstKey;
+  struct SPIRVCompositeConstKeyHash {
+    size_t operator()(const SPIRVCompositeConstKey &K) const {
+      return llvm::hash_combine(
+          K.first, llvm::hash_combine_range(K.second.begin(), K.second.end()));
+    }
+  };
+  std::unordered_map<SPIRVCompositeConstKey, SPIRVValue *,
+                     SPIRVCompositeConstKeyHash>
+      CompositeConstMap;
+  std::unordered_map<SPIRVType *, SPIRVValue *> NullConstMap;
   std::vector<SPIRVExtInst *> DebugInstVec;
   std::vector<SPIRVExtInst *> AuxDataInstVec;
   std::vector<SPIRVModuleProcessed *> ModuleProcessedVec;
@@ -575,6 +598,8 @@ private:
   void layoutEntry(SPIRVEntry *Entry);
   std::istream &parseSPT(std::istream &I);
   std::istream &parseSPIRV(std::istream &I);
+  template <typename FormatTy>
+  void encodeModule(const SPIRVEncoder<FormatTy> &O);
 };
 
 SPIRVModuleImpl::~SPIRVModuleImpl() {
@@ -591,6 +616,42 @@ SPIRVModuleImpl::~SPIRVModuleImpl() {
     delete M;
 }
 
+SPIRVMemoryReport SPIRVModuleImpl::getMemoryReport() const {
+  // Visit every entry the module owns, see ~SPIRVModuleImpl().
+  SPIRVMemoryReport Report;
+  for (auto *I : EntryNoId)
+    I->addMemoryUsage(Report);
+  for (auto I : IdEntryMap)
+    I.second->addMemoryUsage(Report);
+  for (auto C : CapMap)
+    C.second->addMemoryUsage(Report);
+  for (auto *M : ModuleProcessedVec)
+    M->addMemoryUsage(Report);
+
+  size_t TableSize =
+      getHeapSize(ForwardPointerVec) + getHeapSize(TypeVec) +
+      getHeapSize(IdEntryMap) + getHeapSize(IdTypeForwardMap) +
+      getHeapSize(FuncVec) + getHeapSize(ConstVec) + getHeapSize(VariableVec) +
+      getHeapSize(EntryNoId) + getHeapSize(IdToInstSetMap) +
+      getHeapSize(IdBuiltinMap) + getHeapSize(NamedId) +
+      getHeapSize(StringVec) + getHeapSize(MemberNameVec) +
+      getHeapSize(DecorateVec) + getHeapSize(DecGroupVec) +
+      getHeapSize(GroupDecVec) + getHeapSize(AsmTargetVec) +
+      getHeapSize(AsmVec) + getHeapSize(EntryPointVec) + getHeapSize(StrMap) +
+      getHeapSize(CapMap) + getHeapSize(LiteralMap) +
+      getHeapSize(CompositeConstMap) + getHeapSize(NullConstMap) +
+      getHeapSize(DebugInstVec) + getHeapSize(AuxDataInstVec) +
+      getHeapSize(ModuleProcessedVec) + getHeapSize(AliasInstMDVec) +
+      getHeapSize(AliasInstMDMap);
+  Report.add(SPIRVMemoryReport::ModuleTables, sizeof(*this) + TableSize);
+
+  size_t NameSize = getHeapSize(NamePool);
+  for (const auto &Name : NamePool)
+    NameSize += getHeapSize(Name);
+  Report.add(SPIRVMemoryReport::Names, NameSize);
+  return Report;
+}
+
 const std::shared_ptr<const SPIRVLine> &
 SPIRVModuleImpl::getCurrentLine() const {
   return CurrentLine;
@@ -801,6 +862,15 @@ void SPIRVModuleImpl::layoutEntry(SPIRVEntry *E) {
 // logic layout of SPIRV.
 SPIRVEntry *SPIRVModuleImpl::addEntry(SPIRVEntry *Entry) {
   assert(Entry && "Invalid entry");
+  if (TranslationTimeReport *Report = getTimeReport()) {
+    Op OC = Entry->getOpCode();
+    if (isTypeOpCode(OC))
+      Report->addCount(TranslationTimeReport::TypesCreated);
+    else if (isConstantOpCode(OC))
+      Report->addCount(TranslationTimeReport::ConstantsCreated);
+    else if (Entry->isInst())
+      Report->addCount(TranslationTimeReport::InstructionsCreated);
+  }
   if (Entry->hasId()) {
     SPIRVId Id = Entry->getId();
     assert(Entry->getId() != SPIRVID_INVALID && "Invalid id");
@@ -938,6 +1008,10 @@ void SPIRVModuleImpl::setName(SPIRVEntry *E, const std::string &Name) {
     NamedId.erase(E->getId());
 }
 
+const std::string &SPIRVModuleImpl::internName(const std::string &Name) {
+  return *NamePool.insert(Name).first;
+}
+
 void SPIRVModuleImpl::resolveUnknownStructFields() {
   for (auto &KV : UnknownStructFieldMap) {
     auto *Struct = KV.first;
@@ -1237,7 +1311,12 @@ SPIRVValue *SPIRVModuleImpl::addDoubleConstant(SPIRVTypeFloat *Ty, double V) {
 }
 
 SPIRVValue *SPIRVModuleImpl::addNullConstant(SPIRVType *Ty) {
-  return addConstant(new SPIRVConstantNull(this, Ty, getId()));
+  auto Loc = NullConstMap.find(Ty);
+  if (Loc != NullConstMap.end())
+    return Loc->second;
+  auto *C = addConstant(new SPIRVConstantNull(this, Ty, getId()));
+  NullConstMap[Ty] = C;
+  return C;
 }
 
 SPIRVValue *SPIRVModuleImpl::addCompositeConstant(
@@ -1245,18 +1324,29 @@ SPIRVValue *SPIRVModuleImpl::addCompositeConstant(
   constexpr int MaxNumElements = MaxWordCount - SPIRVConstantComposite::FixedWC;
   const int NumElements = Elements.size();
 
+  // Equal constants coming from distinct LLVM values are emitted only once.
+  SPIRVCompositeConstKey Key(Ty->getId(), getIds(Elements));
+  auto Loc = CompositeConstMap.find(Key);
+  if (Loc != CompositeConstMap.end())
+    return Loc->second;
+
   // In case number of elements is greater than maximum WordCount and
   // SPV_INTEL_long_constant_composite is not enabled, the error will be emitted
   // by validate functionality of SPIRVCompositeConstant class.
   if (NumElements <= MaxNumElements ||
-      !isAllowedToUseExtension(ExtensionID::SPV_INTEL_long_constant_composite))
-    return addConstant(new SPIRVConstantComposite(this, Ty, getId(), Elements));
+      !isAllowedToUseExtension(
+          ExtensionID::SPV_INTEL_long_constant_composite)) {
+    auto *C =
+        addConstant(new SPIRVConstantComposite(this, Ty, getId(), Elements));
+    CompositeConstMap.emplace(std::move(Key), C);
+    return C;
+  }
 
   auto Start = Elements.begin();
   auto End = Start + MaxNumElements;
   std::vector<SPIRVValue *> Slice(Start, End);
-  auto *Res =
-      static_cast<SPIRVConstantComposite *>(addCompositeConstant(Ty, Slice));
+  auto *Res = static_cast<SPIRVConstantComposite *>(
+      addConstant(new SPIRVConstantComposite(this, Ty, getId(), Slice)));
   for (; End != Elements.end();) {
     Start = End;
     End = ((Elements.end() - End) > MaxNumElements) ? End + MaxNumElements
@@ -1266,6 +1356,7 @@ SPIRVValue *SPIRVModuleImpl::addCompositeConstant(
         addCompositeConstantContinuedINTEL(Slice));
     Res->addContinuedInstruction(Continued);
   }
+  CompositeConstMap.emplace(std::move(Key), Res);
   return Res;
 }
 
@@ -1846,15 +1937,18 @@ SPIRVInstruction *SPIRVModuleImpl::addVariable(
   return Variable;
 }
 
-template <class T>
-spv_ostream &operator<<(spv_ostream &O, const std::vector<T *> &V) {
+template <typename FormatTy, class T>
+const SPIRVEncoder<FormatTy> &operator<<(const SPIRVEncoder<FormatTy> &O,
+                                         const std::vector<T *> &V) {
   for (auto &I : V)
     O << *I;
   return O;
 }
 
-template <class T, class B = std::less<T>>
-spv_ostream &operator<<(spv_ostream &O, const std::unordered_set<T *, B> &V) {
+template <typename FormatTy, class T, class B = std::less<T>>
+const SPIRVEncoder<FormatTy> &
+operator<<(const SPIRVEncoder<FormatTy> &O,
+           const std::unordered_set<T *, B> &V) {
   for (auto &I : V)
     O << *I;
   return O;
@@ -1889,7 +1983,9 @@ class TopologicalSort {
   SPIRVForwardPointerSet ForwardPointerSet;
   EntryStateMapTy EntryStateMap;
 
-  friend spv_ostream &operator<<(spv_ostream &O, const TopologicalSort &S);
+  template <typename FormatTy>
+  friend const SPIRVEncoder<FormatTy> &
+  operator<<(const SPIRVEncoder<FormatTy> &O, const TopologicalSort &S);
 
   // This method implements recursive depth-first search among all Entries in
   // EntryStateMap. Traversing entries and adding them to corresponding
@@ -1904,7 +2000,9 @@ class TopologicalSort {
     if (State == Discovered) // Cyclic dependency detected
       return true;
     State = Discovered;
-    for (SPIRVEntry *Op : E->getNonLiteralOperands()) {
+    llvm::SmallVector<SPIRVEntry *, 4> Ops;
+    E->addNonLiteralOperands(Ops);
+    for (SPIRVEntry *Op : Ops) {
       if (Op->getOpCode() == OpTypeForwardPointer) {
         SPIRVEntry *FP = E->getModule()->getEntry(
             static_cast<SPIRVTypeForwardPointer *>(Op)->getPointerId());
@@ -1981,22 +2079,25 @@ public:
   }
 };
 
-spv_ostream &operator<<(spv_ostream &O, const TopologicalSort &S) {
+template <typename FormatTy>
+const SPIRVEncoder<FormatTy> &operator<<(const SPIRVEncoder<FormatTy> &O,
+                                         const TopologicalSort &S) {
   O << S.TypeIntVec << S.ConstIntVec << S.TypeVec << S.ConstAndVarVec;
   return O;
 }
 
-spv_ostream &operator<<(spv_ostream &O, SPIRVModule &M) {
-  SPIRVModuleImpl &MI = *static_cast<SPIRVModuleImpl *>(&M);
+template <typename FormatTy>
+void SPIRVModuleImpl::encodeModule(const SPIRVEncoder<FormatTy> &O) {
+  SPIRVModuleImpl &MI = *this;
+  SPIRVModule &M = *this;
   // Start tracking of the current line with no line
   MI.CurrentLine.reset();
   MI.CurrentDebugLine.reset();
 
-  SPIRVEncoder Encoder(O);
-  Encoder << MagicNumber << (SPIRVWord)MI.SPIRVVersion
-          << (((SPIRVWord)MI.GeneratorId << 16) | MI.GeneratorVer)
-          << MI.NextId /* Bound for Id */
-          << MI.InstSchema;
+  O << MagicNumber << (SPIRVWord)MI.SPIRVVersion
+    << (((SPIRVWord)MI.GeneratorId << 16) | MI.GeneratorVer)
+    << MI.NextId /* Bound for Id */
+    << MI.InstSchema;
   O << SPIRVNL();
 
   for (auto &I : MI.CapMap)
@@ -2066,6 +2167,20 @@ spv_ostream &operator<<(spv_ostream &O, SPIRVModule &M) {
 
   O << SPIRVNL() << MI.DebugInstVec << MI.AuxDataInstVec << SPIRVNL()
     << MI.FuncVec;
+}
+
+spv_ostream &operator<<(spv_ostream &O, SPIRVModule &M) {
+  SPIRVModuleImpl &MI = *static_cast<SPIRVModuleImpl *>(&M);
+  SPIRVDbgScope DbgScope(M.isDebugOutputEnabled());
+  // The format is selected once here: every entry of the module is written
+  // by the encoder of that format.
+#ifdef _SPIRV_SUPPORT_TEXT_FMT
+  if (M.isTextFormat()) {
+    MI.encodeModule(SPIRVTextEncoder(O));
+    return O;
+  }
+#endif
+  MI.encodeModule(SPIRVBinaryEncoder(O));
   return O;
 }
 
@@ -2087,7 +2202,9 @@ SPIRVModuleImpl::addDecorationGroup(SPIRVDecorationGroup *Group) {
   Group->takeDecorates(DecorateVec);
   DecGroupVec.push_back(Group);
   SPIRVDBG(spvdbgs() << "[addDecorationGroup] {" << *Group << "}\n";
-           spvdbgs() << "  Remaining DecorateVec: {" << DecorateVec << "}\n");
+           spvdbgs() << "  Remaining DecorateVec: {";
+           SPIRVTextEncoder(spvdbgs()) << DecorateVec;
+           spvdbgs() << "}\n");
   assert(DecorateVec.empty());
   return Group;
 }
@@ -2135,9 +2252,10 @@ void SPIRVModuleImpl::addUnknownStructField(SPIRVTypeStruct *Struct, unsigned I,
 }
 
 namespace {
+template <typename FormatTy>
 SPIRVEntry *parseAndCreateSPIRVEntry(SPIRVWord &WordCount, Op &OpCode,
                                      SPIRVEntry *Scope, SPIRVModuleImpl &M,
-                                     std::istream &IS) {
+                                     const SPIRVDecoder<FormatTy> &Decoder) {
   if (WordCount == 0 || OpCode == OpNop) {
     return nullptr;
   }
@@ -2156,7 +2274,9 @@ SPIRVEntry *parseAndCreateSPIRVEntry(SPIRVWord &WordCount, Op &OpCode,
                         SPIRVDebug::DebugLine)) {
     Entry->setDebugLine(M.getCurrentDebugLine());
   }
-  IS >> *Entry;
+  Decoder >> *Entry;
+  SPIRVTRACE(SPIRVTC_Decode, "entry", OpCode,
+             Entry->hasId() ? Entry->getId() : 0);
   if (Entry->isEndOfBlock() || OpCode == OpNoLine) {
     M.setCurrentLine(nullptr);
   }
@@ -2173,39 +2293,42 @@ SPIRVEntry *parseAndCreateSPIRVEntry(SPIRVWord &WordCount, Op &OpCode,
     ExtensionID ExtID = {};
     bool ExtIsKnown = SPIRVMap<ExtensionID, std::string>::rfind(
         OpExt->getExtensionName(), &ExtID);
-    if (!M.getErrorLog().checkError(
-            ExtIsKnown, SPIRVEC_InvalidModule,
-            "input SPIR-V module uses unknown extension '" +
-                OpExt->getExtensionName() + "'")) {
+    if (!M.getErrorLog().checkError(ExtIsKnown, SPIRVEC_InvalidModule, [&] {
+          return "input SPIR-V module uses unknown extension '" +
+                 OpExt->getExtensionName() + "'";
+        })) {
       M.setInvalid();
     }
 
     if (!M.getErrorLog().checkError(
-            M.isAllowedToUseExtension(ExtID), SPIRVEC_InvalidModule,
-            "input SPIR-V module uses extension '" + OpExt->getExtensionName() +
-                "' which were disabled by --spirv-ext option")) {
+            M.isAllowedToUseExtension(ExtID), SPIRVEC_InvalidModule, [&] {
+              return "input SPIR-V module uses extension '" +
+                     OpExt->getExtensionName() +
+                     "' which were disabled by --spirv-ext option";
+            })) {
       M.setInvalid();
     }
   }
 
-  if (!M.getErrorLog().checkError(Entry->isImplemented(),
-                                  SPIRVEC_UnimplementedOpCode,
-                                  std::to_string(Entry->getOpCode()))) {
+  if (!M.getErrorLog().checkError(
+          Entry->isImplemented(), SPIRVEC_UnimplementedOpCode,
+          [&] { return std::to_string(Entry->getOpCode()); })) {
     M.setInvalid();
   }
 
-  assert(!IS.bad() && !IS.fail() && "SPIRV stream fails");
+  assert(!Decoder.IS.bad() && !Decoder.IS.fail() && "SPIRV stream fails");
   return Entry;
 }
 } // namespace
 
 std::istream &SPIRVModuleImpl::parseSPT(std::istream &I) {
   SPIRVModuleImpl &MI = *this;
+  SPIRVTextDecoder Decoder(I, MI);
   MI.setAutoAddCapability(false);
   MI.setAutoAddExtensions(false);
   auto ReadSPIRVWord = [](std::istream &I) {
     uint32_t W;
-    I >> skipcomment >> W;
+    SPIRVTextLexer::readWord(I, W);
     SPIRVDBG(spvdbgs() << "Read word: W = " << W << " V = 0\n");
     return W;
   };
@@ -2290,11 +2413,9 @@ std::istream &SPIRVModuleImpl::parseSPT(std::istream &I) {
       SPIRVDBG(spvdbgs() << "getWordCountAndOpCode FAIL 0 0\n");
       break;
     }
-    std::string RawOp;
-    I >> RawOp;
-    OpCode = getNameMap(OpCode).rmap(RawOp);
-    SPIRVDBG(spvdbgs() << "Read word: W = " << RawOp << " V = " << OpCode
-                       << '\n');
+    bool OpCodeIsKnown = SPIRVTextLexer::readName(I, OpCode);
+    (void)OpCodeIsKnown;
+    assert((OpCodeIsKnown || I.fail()) && "Invalid key");
     if (I.fail()) {
       SPIRVDBG(spvdbgs() << "getWordCountAndOpCode FAIL 0 0\n");
       break;
@@ -2306,7 +2427,7 @@ std::istream &SPIRVModuleImpl::parseSPT(std::istream &I) {
     }
 
     SPIRVEntry *Entry =
-        parseAndCreateSPIRVEntry(WordCount, OpCode, Scope, MI, I);
+        parseAndCreateSPIRVEntry(WordCount, OpCode, Scope, MI, Decoder);
     if (Entry != nullptr) {
       MI.add(Entry);
     }
@@ -2322,6 +2443,7 @@ std::istream &SPIRVModuleImpl::parseSPT(std::istream &I) {
 
 std::istream &SPIRVModuleImpl::parseSPIRV(std::istream &I) {
   SPIRVModuleImpl &MI = *this;
+  SPIRVBinaryDecoder Decoder(I, MI);
   MI.setAutoAddCapability(false);
   MI.setAutoAddExtensions(false);
 
@@ -2379,7 +2501,7 @@ std::istream &SPIRVModuleImpl::parseSPIRV(std::istream &I) {
       break;
     }
     SPIRVEntry *Entry =
-        parseAndCreateSPIRVEntry(WordCount, OpCode, Scope, MI, I);
+        parseAndCreateSPIRVEntry(WordCount, OpCode, Scope, MI, Decoder);
     if (Entry != nullptr) {
       MI.add(Entry);
     }
@@ -2394,8 +2516,11 @@ std::istream &SPIRVModuleImpl::parseSPIRV(std::istream &I) {
 
 std::istream &operator>>(std::istream &I, SPIRVModule &M) {
   SPIRVModuleImpl &MI = *static_cast<SPIRVModuleImpl *>(&M);
+  SPIRVDbgScope DbgScope(M.isDebugOutputEnabled());
+  // The format is selected once here: parseSPT and parseSPIRV decode every
+  // entry of the module with the decoder of their format.
 #ifdef _SPIRV_SUPPORT_TEXT_FMT
-  if (SPIRVUseTextFormat) {
+  if (M.isTextFormat()) {
     return MI.parseSPT(I);
   }
 #endif
@@ -2418,23 +2543,20 @@ SPIRVType *SPIRVModuleImpl::getValueType(SPIRVId TheId) const {
 
 std::vector<SPIRVValue *>
 SPIRVModuleImpl::getValues(const std::vector<SPIRVId> &IdVec) const {
-  std::vector<SPIRVValue *> ValueVec;
-  for (auto I : IdVec)
-    ValueVec.push_back(getValue(I));
-  return ValueVec;
+  SPIRVValueRange Values = getValueRange(IdVec);
+  return std::vector<SPIRVValue *>(Values.begin(), Values.end());
 }
 
 std::vector<SPIRVType *>
 SPIRVModuleImpl::getValueTypes(const std::vector<SPIRVId> &IdVec) const {
-  std::vector<SPIRVType *> TypeVec;
-  for (auto I : IdVec)
-    TypeVec.push_back(getValue(I)->getType());
-  return TypeVec;
+  SPIRVValueTypeRange Types = getValueTypeRange(IdVec);
+  return std::vector<SPIRVType *>(Types.begin(), Types.end());
 }
 
 std::vector<SPIRVId>
 SPIRVModuleImpl::getIds(const std::vector<SPIRVEntry *> &ValueVec) const {
   std::vector<SPIRVId> IdVec;
+  IdVec.reserve(ValueVec.size());
   for (auto *I : ValueVec)
     IdVec.push_back(I->getId());
   return IdVec;
@@ -2443,6 +2565,7 @@ SPIRVModuleImpl::getIds(const std::vector<SPIRVEntry *> &ValueVec) const {
 std::vector<SPIRVId>
 SPIRVModuleImpl::getIds(const std::vector<SPIRVValue *> &ValueVec) const {
   std::vector<SPIRVId> IdVec;
+  IdVec.reserve(ValueVec.size());
   for (auto *I : ValueVec)
     IdVec.push_back(I->getId());
   return IdVec;
@@ -2495,8 +2618,6 @@ bool isSpirvBinary(const std::string &Img) {
 
 bool convertSpirv(std::istream &IS, std::ostream &OS, std::string &ErrMsg,
                   bool FromText, bool ToText) {
-  auto SaveOpt = SPIRVUseTextFormat;
-  SPIRVUseTextFormat = FromText;
   // Conversion from/to SPIR-V text representation is a side feature of the
   // translator which is mostly intended for debug usage. So, this step cannot
   // be customized to enable/disable particular extensions or restrict/allow
@@ -2504,19 +2625,15 @@ bool convertSpirv(std::istream &IS, std::ostream &OS, std::string &ErrMsg,
   // known SPIR-V extensions are enabled during this conversion
   SPIRV::TranslatorOpts DefaultOpts;
   DefaultOpts.enableAllExtensions();
+  DefaultOpts.setUseTextFormat(FromText);
   SPIRVModuleImpl M(DefaultOpts);
   IS >> M;
-  if (M.getError(ErrMsg) != SPIRVEC_Success) {
-    SPIRVUseTextFormat = SaveOpt;
+  if (M.getError(ErrMsg) != SPIRVEC_Success)
     return false;
-  }
-  SPIRVUseTextFormat = ToText;
+  M.setTextFormat(ToText);
   OS << M;
-  if (M.getError(ErrMsg) != SPIRVEC_Success) {
-    SPIRVUseTextFormat = SaveOpt;
+  if (M.getError(ErrMsg) != SPIRVEC_Success)
     return false;
-  }
-  SPIRVUseTextFormat = SaveOpt;
   return true;
 }
 
@@ -2546,4 +2663,50 @@ bool convertSpirv(std::string &Input, std::string &Out, std::string &ErrMsg,
 
 #endif // _SPIRV_SUPPORT_TEXT_FMT
 
+uint64_t SPIRVMemoryReport::getTotalBytes() const {
+  uint64_t Total = 0;
+  for (const Usage &U : Categories)
+    Total += U.Bytes;
+  return Total;
+}
+
+const char *SPIRVMemoryReport::getCategoryName(Category C) {
+  static const char *const Names[NumCategories] = {
+      "instructions",       "operand vectors", "decorations",  "strings",
+      "debug instructions", "names",           "module tables"};
+  return C < NumCategories ? Names[C] : "unknown";
+}
+
+void SPIRVMemoryReport::print(llvm::raw_ostream &OS) const {
+  OS << "===- SPIR-V module memory report -===\n"
+     << "         Bytes       Entries  Category\n";
+  auto PrintUsage = [&](const Usage &U) {
+    OS << llvm::format("  %12llu  %12llu",
+                       static_cast<unsigned long long>(U.Bytes),
+                       static_cast<unsigned long long>(U.Count));
+  };
+  for (unsigned C = 0; C != NumCategories; ++C) {
+    PrintUsage(Categories[C]);
+    OS << "  " << getCategoryName(static_cast<Category>(C)) << '\n';
+  }
+  OS << llvm::format("  %12llu",
+                     static_cast<unsigned long long>(getTotalBytes()))
+     << "                total\n";
+
+  std::vector<std::pair<uint32_t, Usage>> ByBytes(Opcodes.begin(),
+                                                  Opcodes.end());
+  std::stable_sort(ByBytes.begin(), ByBytes.end(),
+                   [](const auto &A, const auto &B) {
+                     return A.second.Bytes > B.second.Bytes;
+                   });
+  OS << "         Bytes       Entries  Opcode\n";
+  for (const auto &[OC, U] : ByBytes) {
+    std::string Name;
+    if (!OpCodeNameMap::find(static_cast<Op>(OC), &Name))
+      Name = "#" + std::to_string(OC);
+    PrintUsage(U);
+    OS << "  Op" << Name << '\n';
+  }
+}
+
 } // namespace SPIRV
@@ -124,9 +124,10 @@ public:
   virtual SPIRVErrorLog &getErrorLog() = 0;
   virtual SPIRVErrorCode getError(std::string &) = 0;
   // Check if extension is allowed, and set ErrCode and DetailedMsg if not.
+  // DetailedMsg is only called if the extension is not allowed.
   // Returns true if no error.
   virtual bool checkExtension(ExtensionID, SPIRVErrorCode,
-                              const std::string &) = 0;
+                              llvm::function_ref<std::string()>) = 0;
   void setInvalid() { IsValid = false; }
   bool isModuleValid() { return IsValid; }
 
@@ -153,6 +154,12 @@ public:
   virtual SPIRVType *getValueType(SPIRVId TheId) const = 0;
   virtual std::vector<SPIRVType *>
   getValueTypes(const std::vector<SPIRVId> &) const = 0;
+  SPIRVValueRange getValueRange(llvm::ArrayRef<SPIRVId> Ids) const {
+    return llvm::map_range(Ids, SPIRVIdToValue{this});
+  }
+  SPIRVValueTypeRange getValueTypeRange(llvm::ArrayRef<SPIRVId> Ids) const {
+    return llvm::map_range(Ids, SPIRVIdToValueType{this});
+  }
   virtual SPIRVConstant *getLiteralAsConstant(unsigned Literal) = 0;
   virtual bool isEntryPoint(SPIRVExecutionModelKind, SPIRVId) const = 0;
   virtual unsigned short getGeneratorId() const = 0;
@@ -162,6 +169,8 @@ public:
   virtual const std::vector<SPIRVExtInst *> &getAuxDataInstVec() const = 0;
 
   virtual const std::vector<SPIRVString *> &getStringVec() const = 0;
+  /// Returns the approximate memory footprint of the module.
+  virtual SPIRVMemoryReport getMemoryReport() const = 0;
 
   // Module changing functions
   virtual bool importBuiltinSet(const std::string &, SPIRVId *) = 0;
@@ -170,6 +179,9 @@ public:
   virtual void setAlignment(SPIRVValue *, SPIRVWord) = 0;
   virtual void setMemoryModel(SPIRVMemoryModelKind) = 0;
   virtual void setName(SPIRVEntry *, const std::string &) = 0;
+  /// Returns the module's copy of \p Name. Equal names share one copy, so
+  /// names of entries of the same module can be compared by address.
+  virtual const std::string &internName(const std::string &Name) = 0;
   virtual void setSourceLanguage(SourceLanguage, SPIRVWord) = 0;
   virtual void setAutoAddCapability(bool E) { AutoAddCapability = E; }
   virtual void setValidateCapability(bool E) { ValidateCapability = E; }
@@ -557,6 +569,20 @@ public:
     return TranslationOpts.getBuiltinFormat();
   }
 
+  bool isTextFormat() const noexcept { return TranslationOpts.useTextFormat(); }
+
+  void setTextFormat(bool Text) noexcept {
+    TranslationOpts.setUseTextFormat(Text);
+  }
+
+  bool isDebugOutputEnabled() const noexcept {
+    return TranslationOpts.isDebugOutputEnabled();
+  }
+
+  TranslationTimeReport *getTimeReport() const noexcept {
+    return TranslationOpts.getTimeReport();
+  }
+
   SPIRVExtInstSetKind getDebugInfoEIS() const {
     switch (TranslationOpts.getDebugInfoEIS()) {
     case DebugInfoEIS::SPIRV_Debug:
@@ -597,14 +623,10 @@ private:
 #ifdef _SPIRV_SUPPORT_TEXT_FMT
 
 /// Convert SPIR-V between binary and internel text formats.
-/// This function is not thread safe and should not be used in multi-thread
-/// applications unless guarded by a critical section.
 bool ConvertSPIRV(std::istream &IS, spv_ostream &OS, std::string &ErrMsg,
                   bool FromText, bool ToText);
 
 /// Convert SPIR-V between binary and internel text formats.
-/// This function is not thread safe and should not be used in multi-thread
-/// applications unless guarded by a critical section.
 bool ConvertSPIRV(std::string &Input, std::string &Out, std::string &ErrMsg,
                   bool ToText);
 #endif
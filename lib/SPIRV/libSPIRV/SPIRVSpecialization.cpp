@@ -0,0 +1,485 @@
+//===- SPIRVSpecialization.cpp - Specialize SPIR-V binaries -----*- C++ -*-===//
+//
+//                     The LLVM/SPIR-V Translator
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+// Copyright (c) 2024 The Khronos Group Inc.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimers.
+// Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimers in the documentation
+// and/or other materials provided with the distribution.
+// Neither the names of The Khronos Group, nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// Software without specific prior written permission.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH
+// THE SOFTWARE.
+//
+//===----------------------------------------------------------------------===//
+/// \file
+///
+/// This file implements specialization of the specialization constants of a
+/// SPIR-V binary without translating it to LLVM IR or decoding it into a
+/// SPIRVModule. The binary is rewritten in a single pass over its words:
+/// OpSpecConstant* instructions become the matching OpConstant* ones and the
+/// SpecId decorations are dropped. Specialization constants may only be
+/// defined before the first function, so the function bodies are copied as
+/// they are.
+///
+//===----------------------------------------------------------------------===//
+
+#include "LLVMSPIRVLib.h"
+#include "SPIRVIdScanner.h"
+
+#include "llvm/Support/MathExtras.h"
+
+#include <limits>
+#include <unordered_map>
+#include <unordered_set>
+
+using namespace SPIRV;
+
+namespace {
+
+/// Scalar type known to the specializer.
+struct SPIRVScalarType {
+  enum KindTy { Bool, Int, Float };
+  KindTy Kind;
+  SPIRVWord Width;
+  bool IsSigned;
+};
+
+/// Get the number of operands of the integer and boolean operations folded in
+/// OpSpecConstantOp.
+/// \returns 0 for the operations that are not folded.
+unsigned getSpecConstantOpArity(Op OC) {
+  switch (OC) {
+  case OpSNegate:
+  case OpNot:
+  case OpLogicalNot:
+  case OpUConvert:
+  case OpSConvert:
+    return 1;
+  case OpIAdd:
+  case OpISub:
+  case OpIMul:
+  case OpUDiv:
+  case OpSDiv:
+  case OpUMod:
+  case OpSRem:
+  case OpSMod:
+  case OpShiftLeftLogical:
+  case OpShiftRightLogical:
+  case OpShiftRightArithmetic:
+  case OpBitwiseOr:
+  case OpBitwiseXor:
+  case OpBitwiseAnd:
+  case OpLogicalOr:
+  case OpLogicalAnd:
+  case OpLogicalEqual:
+  case OpLogicalNotEqual:
+  case OpIEqual:
+  case OpINotEqual:
+  case OpULessThan:
+  case OpSLessThan:
+  case OpUGreaterThan:
+  case OpSGreaterThan:
+  case OpULessThanEqual:
+  case OpSLessThanEqual:
+  case OpUGreaterThanEqual:
+  case OpSGreaterThanEqual:
+    return 2;
+  case OpSelect:
+    return 3;
+  default:
+    return 0;
+  }
+}
+
+class SPIRVSpecializer {
+public:
+  SPIRVSpecializer(const TranslatorOpts &Opts, bool FoldSpecConstantOps)
+      : Opts(Opts), FoldSpecConstantOps(FoldSpecConstantOps) {}
+
+  bool specialize(llvm::StringRef Binary, std::string &Out);
+  const std::string &getError() const { return ErrMsg; }
+
+private:
+  bool fail(const std::string &Msg) {
+    ErrMsg = Msg;
+    return false;
+  }
+  /// Rewrite one instruction of the types, constants and global variables
+  /// section and append it to Words.
+  bool patch(llvm::ArrayRef<SPIRVWord> Inst);
+  /// Append a scalar constant \p Value of \p Type with the \p Result id.
+  void addConstant(SPIRVId Type, SPIRVId Result, uint64_t Value);
+  /// Evaluate OpSpecConstantOp \p Inst if all its operands are known scalar
+  /// integer or boolean constants.
+  bool fold(llvm::ArrayRef<SPIRVWord> Inst, uint64_t &Value) const;
+  bool getValue(SPIRVId Id, uint64_t &Value, SPIRVWord &Width) const;
+  const SPIRVScalarType *getType(SPIRVId Id) const {
+    auto Loc = Types.find(Id);
+    return Loc == Types.end() ? nullptr : &Loc->second;
+  }
+
+  const TranslatorOpts &Opts;
+  bool FoldSpecConstantOps;
+  std::string ErrMsg;
+  std::vector<SPIRVWord> Words;
+  std::unordered_map<SPIRVId, SPIRVScalarType> Types;
+  /// SpecId literals of the decorated specialization constants.
+  std::unordered_map<SPIRVId, SPIRVWord> SpecIds;
+  /// Values and types of the scalar integer and boolean constants, used to
+  /// fold OpSpecConstantOp.
+  std::unordered_map<SPIRVId, std::pair<SPIRVId, uint64_t>> Values;
+  /// Specialization constants that could not be turned into constants.
+  std::unordered_set<SPIRVId> SpecConstants;
+};
+
+bool SPIRVSpecializer::getValue(SPIRVId Id, uint64_t &Value,
+                                SPIRVWord &Width) const {
+  auto Loc = Values.find(Id);
+  if (Loc == Values.end())
+    return false;
+  Value = Loc->second.second;
+  Width = getType(Loc->second.first)->Width;
+  return true;
+}
+
+void SPIRVSpecializer::addConstant(SPIRVId Type, SPIRVId Result,
+                                   uint64_t Value) {
+  const SPIRVScalarType *Ty = getType(Type);
+  if (Ty->Kind == SPIRVScalarType::Bool) {
+    Value = Value != 0;
+    Words.push_back((3 << WordCountShift) |
+                    (Value ? OpConstantTrue : OpConstantFalse));
+    Words.push_back(Type);
+    Words.push_back(Result);
+  } else {
+    Value &= llvm::maskTrailingOnes<uint64_t>(Ty->Width);
+    // Narrow signed integers are sign-extended to the whole word.
+    uint64_t Encoded = Ty->IsSigned && Ty->Width < 32
+                           ? llvm::SignExtend64(Value, Ty->Width)
+                           : Value;
+    SPIRVWord WordCount = Ty->Width > 32 ? 5 : 4;
+    Words.push_back((WordCount << WordCountShift) | OpConstant);
+    Words.push_back(Type);
+    Words.push_back(Result);
+    Words.push_back(static_cast<SPIRVWord>(Encoded));
+    if (WordCount == 5)
+      Words.push_back(static_cast<SPIRVWord>(Encoded >> 32));
+  }
+  if (Ty->Kind != SPIRVScalarType::Float)
+    Values[Result] = {Type, Value};
+}
+
+bool SPIRVSpecializer::fold(llvm::ArrayRef<SPIRVWord> Inst,
+                            uint64_t &Value) const {
+  const SPIRVScalarType *Ty = getType(Inst[1]);
+  if (!Ty || Ty->Kind == SPIRVScalarType::Float || Inst.size() < 5)
+    return false;
+  unsigned NumOps = Inst.size() - 4;
+  uint64_t A = 0, B = 0, C = 0;
+  SPIRVWord WidthA = 0, WidthB = 0, WidthC = 0;
+  if (NumOps != getSpecConstantOpArity(static_cast<Op>(Inst[3])) ||
+      !getValue(Inst[4], A, WidthA) ||
+      (NumOps > 1 && !getValue(Inst[5], B, WidthB)) ||
+      (NumOps > 2 && !getValue(Inst[6], C, WidthC)))
+    return false;
+  int64_t SA = llvm::SignExtend64(A, WidthA);
+  int64_t SB = NumOps > 1 ? llvm::SignExtend64(B, WidthB) : 0;
+
+  switch (Inst[3]) {
+  case OpSNegate:
+    Value = -A;
+    break;
+  case OpNot:
+    Value = ~A;
+    break;
+  case OpLogicalNot:
+    Value = !A;
+    break;
+  case OpUConvert:
+    Value = A;
+    break;
+  case OpSConvert:
+    Value = SA;
+    break;
+  case OpIAdd:
+    Value = A + B;
+    break;
+  case OpISub:
+    Value = A - B;
+    break;
+  case OpIMul:
+    Value = A * B;
+    break;
+  case OpUDiv:
+  case OpUMod:
+    if (B == 0)
+      return false;
+    Value = Inst[3] == OpUDiv ? A / B : A % B;
+    break;
+  case OpSDiv:
+  case OpSRem:
+  case OpSMod:
+    // Division by zero and the overflowing INT_MIN / -1 are undefined.
+    if (SB == 0 || (SB == -1 && SA == std::numeric_limits<int64_t>::min()))
+      return false;
+    if (Inst[3] == OpSDiv) {
+      Value = SA / SB;
+    } else {
+      int64_t Rem = SA % SB;
+      // The result of OpSMod takes the sign of the divisor.
+      if (Inst[3] == OpSMod && Rem != 0 && (Rem < 0) != (SB < 0))
+        Rem += SB;
+      Value = Rem;
+    }
+    break;
+  case OpShiftLeftLogical:
+  case OpShiftRightLogical:
+  case OpShiftRightArithmetic:
+    // Shifting by the bit width or more is undefined.
+    if (B >= WidthA)
+      return false;
+    Value = Inst[3] == OpShiftLeftLogical    ? A << B
+            : Inst[3] == OpShiftRightLogical ? A >> B
+                                             : SA >> B;
+    break;
+  case OpBitwiseOr:
+  case OpLogicalOr:
+    Value = A | B;
+    break;
+  case OpBitwiseXor:
+  case OpLogicalNotEqual:
+  case OpINotEqual:
+    Value = Inst[3] == OpBitwiseXor ? A ^ B : A != B;
+    break;
+  case OpBitwiseAnd:
+  case OpLogicalAnd:
+    Value = A & B;
+    break;
+  case OpLogicalEqual:
+  case OpIEqual:
+    Value = A == B;
+    break;
+  case OpULessThan:
+    Value = A < B;
+    break;
+  case OpSLessThan:
+    Value = SA < SB;
+    break;
+  case OpUGreaterThan:
+    Value = A > B;
+    break;
+  case OpSGreaterThan:
+    Value = SA > SB;
+    break;
+  case OpULessThanEqual:
+    Value = A <= B;
+    break;
+  case OpSLessThanEqual:
+    Value = SA <= SB;
+    break;
+  case OpUGreaterThanEqual:
+    Value = A >= B;
+    break;
+  case OpSGreaterThanEqual:
+    Value = SA >= SB;
+    break;
+  case OpSelect:
+    Value = A ? B : C;
+    break;
+  default:
+    return false;
+  }
+  return true;
+}
+
+bool SPIRVSpecializer::patch(llvm::ArrayRef<SPIRVWord> Inst) {
+  Op OC = getSPIRVInstOpCode(Inst.data());
+  switch (OC) {
+  case OpTypeBool:
+    if (Inst.size() < 2)
+      return false;
+    Types[Inst[1]] = {SPIRVScalarType::Bool, 1, false};
+    break;
+  case OpTypeInt:
+    if (Inst.size() < 4 || Inst[2] == 0 || Inst[2] > 64)
+      return false;
+    Types[Inst[1]] = {SPIRVScalarType::Int, Inst[2], Inst[3] != 0};
+    break;
+  case OpTypeFloat:
+    if (Inst.size() < 3 || Inst[2] == 0 || Inst[2] > 64)
+      return false;
+    Types[Inst[1]] = {SPIRVScalarType::Float, Inst[2], false};
+    break;
+  case OpDecorate:
+    if (Inst.size() < 3)
+      return false;
+    if (Inst[2] == DecorationSpecId) {
+      if (Inst.size() < 4)
+        return false;
+      SpecIds[Inst[1]] = Inst[3];
+      // The decoration only applies to specialization constants, none of
+      // which remain scalar after the specialization.
+      return true;
+    }
+    break;
+  case OpConstant:
+  case OpConstantTrue:
+  case OpConstantFalse:
+  case OpConstantNull: {
+    if (Inst.size() < 3)
+      return false;
+    const SPIRVScalarType *Ty = getType(Inst[1]);
+    if (!Ty || Ty->Kind == SPIRVScalarType::Float)
+      break;
+    uint64_t Value = OC == OpConstantTrue;
+    if (OC == OpConstant && Inst.size() > 3)
+      Value = Inst[3] | (Inst.size() > 4 ? uint64_t(Inst[4]) << 32 : 0);
+    Values[Inst[2]] = {Inst[1],
+                       Value & llvm::maskTrailingOnes<uint64_t>(Ty->Width)};
+    break;
+  }
+  case OpSpecConstantTrue:
+  case OpSpecConstantFalse:
+  case OpSpecConstant: {
+    if (Inst.size() < 3)
+      return false;
+    const SPIRVScalarType *Ty = getType(Inst[1]);
+    if (!Ty)
+      return fail("specialization constant " + std::to_string(Inst[2]) +
+                  " has an unknown type");
+    uint64_t Value = OC == OpSpecConstantTrue;
+    if (OC == OpSpecConstant) {
+      if (Inst.size() < (Ty->Width > 32 ? 5u : 4u))
+        return false;
+      Value = Inst[3] | (Ty->Width > 32 ? uint64_t(Inst[4]) << 32 : 0);
+    }
+    auto SpecId = SpecIds.find(Inst[2]);
+    uint64_t SpecValue = 0;
+    if (SpecId != SpecIds.end() &&
+        Opts.getSpecializationConstant(SpecId->second, SpecValue))
+      Value = SpecValue;
+    addConstant(Inst[1], Inst[2], Value);
+    return true;
+  }
+  case OpSpecConstantOp: {
+    uint64_t Value = 0;
+    if (Inst.size() < 4)
+      return false;
+    if (FoldSpecConstantOps && fold(Inst, Value)) {
+      addConstant(Inst[1], Inst[2], Value);
+      return true;
+    }
+    SpecConstants.insert(Inst[2]);
+    break;
+  }
+  default:
+    break;
+  }
+  Words.insert(Words.end(), Inst.begin(), Inst.end());
+  return true;
+}
+
+bool SPIRVSpecializer::specialize(llvm::StringRef Binary, std::string &Out) {
+  std::vector<SPIRVWord> In;
+  if (!readSPIRVWords(Binary, In, ErrMsg))
+    return false;
+  Words.reserve(In.size());
+  Words.insert(Words.end(), In.begin(), In.begin() + SPIRVHW_Count);
+
+  size_t Pos = SPIRVHW_Count;
+  auto getInst = [&](size_t At) -> llvm::ArrayRef<SPIRVWord> {
+    SPIRVWord WordCount = getSPIRVInstWordCount(&In[At]);
+    if (WordCount == 0 || At + WordCount > In.size())
+      return {};
+    return llvm::ArrayRef<SPIRVWord>(In).slice(At, WordCount);
+  };
+  while (Pos < In.size()) {
+    llvm::ArrayRef<SPIRVWord> Inst = getInst(Pos);
+    if (Inst.empty())
+      return fail("invalid instruction at word " + std::to_string(Pos));
+    Op OC = getSPIRVInstOpCode(Inst.data());
+    if (OC == OpFunction)
+      break;
+    Pos += Inst.size();
+    if (OC != OpSpecConstantComposite) {
+      if (!patch(Inst))
+        return ErrMsg.empty() ? fail("invalid instruction at word " +
+                                     std::to_string(Pos - Inst.size()))
+                              : false;
+      continue;
+    }
+
+    // A composite becomes a constant one if none of its constituents,
+    // including those of its continuations, stayed a specialization constant.
+    size_t End = Pos;
+    while (End < In.size()) {
+      llvm::ArrayRef<SPIRVWord> Next = getInst(End);
+      if (Next.empty() || getSPIRVInstOpCode(Next.data()) !=
+                              OpSpecConstantCompositeContinuedINTEL)
+        break;
+      End += Next.size();
+    }
+    bool IsSpec = Inst.size() < 3;
+    for (size_t I = Pos - Inst.size() + 3; I < End && !IsSpec; ++I)
+      IsSpec = SpecConstants.count(In[I]);
+    if (IsSpec) {
+      if (Inst.size() >= 3)
+        SpecConstants.insert(Inst[2]);
+      Words.insert(Words.end(), In.begin() + Pos - Inst.size(),
+                   In.begin() + End);
+      Pos = End;
+      continue;
+    }
+    Words.push_back((Inst[0] & ~OpCodeMask) | OpConstantComposite);
+    Words.insert(Words.end(), Inst.begin() + 1, Inst.end());
+    while (Pos < End) {
+      llvm::ArrayRef<SPIRVWord> Next = getInst(Pos);
+      Words.push_back((Next[0] & ~OpCodeMask) |
+                      OpConstantCompositeContinuedINTEL);
+      Words.insert(Words.end(), Next.begin() + 1, Next.end());
+      Pos += Next.size();
+    }
+  }
+  // Functions cannot define specialization constants.
+  Words.insert(Words.end(), In.begin() + Pos, In.end());
+
+  Out.assign(reinterpret_cast<const char *>(Words.data()),
+             Words.size() * sizeof(SPIRVWord));
+  return true;
+}
+
+} // namespace
+
+namespace SPIRV {
+
+bool specializeSpirv(const std::string &Input, const TranslatorOpts &Opts,
+                     bool FoldSpecConstantOps, std::string &Out,
+                     std::string &ErrMsg) {
+  SPIRVSpecializer Specializer(Opts, FoldSpecConstantOps);
+  if (Specializer.specialize(Input, Out))
+    return true;
+  ErrMsg = Specializer.getError();
+  return false;
+}
+
+} // namespace SPIRV
@@ -43,6 +43,10 @@
 #include "SPIRVNameMapEnum.h"
 #include "SPIRVOpCode.h"
 
+#include "llvm/ADT/SmallString.h"
+
+#include <algorithm>
+#include <cstring>
 #include <limits> // std::numeric_limits
 
 namespace SPIRV {
@@ -58,72 +62,261 @@ static void writeQuotedString(spv_ostream &O, const std::string &Str) {
   O << '"';
 }
 
-/// Read quoted string. Replace \" with ".
-static void readQuotedString(std::istream &IS, std::string &Str) {
-  char Ch = ' ';
-  char PreCh = ' ';
-  while (IS >> Ch && Ch != '"')
-    ;
-
-  if (IS >> PreCh && PreCh != '"') {
-    while (IS >> Ch) {
-      if (Ch == '"') {
-        if (PreCh != '\\') {
-          Str += PreCh;
-          break;
-        } else
-          PreCh = Ch;
+#ifdef _SPIRV_SUPPORT_TEXT_FMT
+bool SPIRVUseTextFormat = false;
+#endif
+
+namespace {
+bool isSpace(int C) {
+  return C == ' ' || C == '\n' || C == '\t' || C == '\r' || C == '\v' ||
+         C == '\f';
+}
+
+bool isEOF(int C) {
+  return std::char_traits<char>::eq_int_type(C, std::char_traits<char>::eof());
+}
+
+// Space reserved for a string before it is read, enough for most names, so
+// that appending the characters rarely reallocates.
+constexpr size_t StringReserve = 64;
+} // namespace
+
+void SPIRVTextLexer::skipSpace(std::istream &IS) {
+  std::streambuf *SB = IS.rdbuf();
+  int C = SB->sgetc();
+  while (true) {
+    while (!isEOF(C) && isSpace(C))
+      C = SB->snextc();
+    if (C != ';')
+      break;
+    while (!isEOF(C) && C != '\n')
+      C = SB->snextc();
+  }
+  if (isEOF(C))
+    IS.setstate(std::ios::eofbit);
+}
+
+bool SPIRVTextLexer::readWord(std::istream &IS, uint32_t &W) {
+  W = 0;
+  if (IS.good())
+    skipSpace(IS);
+  if (!IS.good()) {
+    IS.setstate(std::ios::failbit);
+    return false;
+  }
+  std::streambuf *SB = IS.rdbuf();
+  int C = SB->sgetc();
+  // Like the formatted input of unsigned integers, a sign is accepted and
+  // negative values wrap around.
+  bool Negative = C == '-';
+  if (C == '-' || C == '+')
+    C = SB->snextc();
+  uint64_t V = 0;
+  bool HasDigits = false;
+  while (!isEOF(C) && C >= '0' && C <= '9') {
+    V = V * 10 + (C - '0');
+    if (V > UINT32_MAX) {
+      IS.setstate(std::ios::failbit);
+      return false;
+    }
+    HasDigits = true;
+    C = SB->snextc();
+  }
+  if (isEOF(C))
+    IS.setstate(std::ios::eofbit);
+  if (!HasDigits) {
+    IS.setstate(std::ios::failbit);
+    return false;
+  }
+  W = Negative ? 0u - static_cast<uint32_t>(V) : static_cast<uint32_t>(V);
+  return true;
+}
+
+bool SPIRVTextLexer::readToken(std::istream &IS,
+                               llvm::SmallVectorImpl<char> &Tok) {
+  Tok.clear();
+  if (IS.good())
+    skipSpace(IS);
+  if (!IS.good()) {
+    IS.setstate(std::ios::failbit);
+    return false;
+  }
+  std::streambuf *SB = IS.rdbuf();
+  int C = SB->sgetc();
+  while (!isEOF(C) && !isSpace(C)) {
+    Tok.push_back(static_cast<char>(C));
+    C = SB->snextc();
+  }
+  if (isEOF(C))
+    IS.setstate(std::ios::eofbit);
+  return true;
+}
+
+bool SPIRVTextLexer::readString(std::istream &IS, std::string &Str) {
+  if (IS.good())
+    skipSpace(IS);
+  if (!IS.good()) {
+    IS.setstate(std::ios::failbit);
+    return false;
+  }
+  std::streambuf *SB = IS.rdbuf();
+  int C = SB->sgetc();
+  while (!isEOF(C) && C != '"')
+    C = SB->snextc();
+  if (isEOF(C)) {
+    IS.setstate(std::ios::eofbit | std::ios::failbit);
+    return false;
+  }
+  // The characters are appended to Str as they are read, so there is no
+  // intermediate buffer to copy from.
+  size_t OldSize = Str.size();
+  Str.reserve(OldSize + StringReserve);
+  C = SB->snextc();
+  while (!isEOF(C) && C != '"') {
+    if (C == '\\') {
+      C = SB->snextc();
+      if (C == '"') {
+        Str.push_back('"');
+        C = SB->snextc();
       } else {
-        Str += PreCh;
-        PreCh = Ch;
+        Str.push_back('\\');
       }
+      continue;
     }
+    Str.push_back(static_cast<char>(C));
+    C = SB->snextc();
   }
+  if (isEOF(C)) {
+    Str.resize(OldSize);
+    IS.setstate(std::ios::eofbit | std::ios::failbit);
+    return false;
+  }
+  SB->sbumpc();
+  return true;
 }
 
-#ifdef _SPIRV_SUPPORT_TEXT_FMT
-bool SPIRVUseTextFormat = false;
-#endif
+template <typename T> bool SPIRVTextLexer::readName(std::istream &IS, T &V) {
+  llvm::SmallString<64> Tok;
+  V = {};
+  if (!readToken(IS, Tok))
+    return false;
+  bool Found = SPIRVMap<T, std::string>::rfind(llvm::StringRef(Tok), &V);
+  SPIRVDBG(spvdbgs() << "Read word: W = " << Tok.c_str() << " V = " << V
+                     << '\n');
+  return Found;
+}
 
-SPIRVDecoder::SPIRVDecoder(std::istream &InputStream, SPIRVFunction &F)
-    : IS(InputStream), M(*F.getModule()), WordCount(0), OpCode(OpNop),
-      Scope(&F) {}
+template <typename T> void SPIRVTextFormat::writeName(spv_ostream &OS, T V) {
+  OS << getNameMap(V).map(V) << " ";
+}
 
-SPIRVDecoder::SPIRVDecoder(std::istream &InputStream, SPIRVBasicBlock &BB)
-    : IS(InputStream), M(*BB.getModule()), WordCount(0), OpCode(OpNop),
-      Scope(&BB) {}
+void SPIRVTextFormat::readString(std::istream &IS, std::string &Str) {
+  SPIRVTextLexer::readString(IS, Str);
+  SPIRVDBG(spvdbgs() << "Read string: \"" << Str << "\"\n");
+}
 
-void SPIRVDecoder::setScope(SPIRVEntry *TheScope) {
-  assert(TheScope && (TheScope->getOpCode() == OpFunction ||
-                      TheScope->getOpCode() == OpLabel));
-  Scope = TheScope;
+void SPIRVTextFormat::writeString(spv_ostream &OS, const std::string &Str) {
+  writeQuotedString(OS, Str);
+  OS << " ";
 }
 
-template <class T> const SPIRVDecoder &decode(const SPIRVDecoder &I, T &V) {
-#ifdef _SPIRV_SUPPORT_TEXT_FMT
-  if (SPIRVUseTextFormat) {
-    std::string W;
-    I.IS >> W;
-    V = getNameMap(V).rmap(W);
-    SPIRVDBG(spvdbgs() << "Read word: W = " << W << " V = " << V << '\n');
-    return I;
+void SPIRVBinaryFormat::readString(std::istream &IS, std::string &Str,
+                                   size_t MaxWords) {
+  // The string ends in the first word having a zero byte, the rest of that
+  // word is padding. If the number of words left in the instruction is known,
+  // they are read into Str at once and the ones after the string are put back
+  // into the stream.
+  if (!IS.good()) {
+    IS.setstate(std::ios::failbit);
+    return;
+  }
+  std::streambuf *SB = IS.rdbuf();
+  if (MaxWords) {
+    size_t OldSize = Str.size();
+    size_t MaxBytes = MaxWords * sizeof(SPIRVWord);
+    Str.resize(OldSize + MaxBytes);
+    char *Bytes = &Str[OldSize];
+    size_t Read = SB->sgetn(Bytes, MaxBytes);
+    const char *End = static_cast<const char *>(std::memchr(Bytes, '\0', Read));
+    if (End) {
+      size_t Len = End - Bytes;
+      size_t Used = (Len / sizeof(SPIRVWord) + 1) * sizeof(SPIRVWord);
+      if (Used > Read) {
+        Str.resize(OldSize);
+        IS.setstate(std::ios::eofbit | std::ios::failbit);
+        return;
+      }
+      assert(std::all_of(Bytes + Len, Bytes + Used,
+                         [](char C) { return !C; }) &&
+             "Invalid string in SPIRV");
+      if (Used != Read &&
+          SB->pubseekoff(static_cast<std::streamoff>(Used) -
+                             static_cast<std::streamoff>(Read),
+                         std::ios::cur, std::ios::in) == std::streampos(-1))
+        IS.setstate(std::ios::failbit);
+      Str.resize(OldSize + Len);
+      return;
+    }
+    if (Read != MaxBytes) {
+      Str.resize(OldSize);
+      IS.setstate(std::ios::eofbit | std::ios::failbit);
+      return;
+    }
+    // MaxWords is an upper bound, so this only happens for an instruction
+    // with a wrong word count. Read the rest of the string word by word.
+  } else {
+    Str.reserve(Str.size() + StringReserve);
+  }
+  while (true) {
+    SPIRVWord W;
+    if (SB->sgetn(reinterpret_cast<char *>(&W), sizeof(W)) != sizeof(W)) {
+      IS.setstate(std::ios::eofbit | std::ios::failbit);
+      break;
+    }
+    const char *Bytes = reinterpret_cast<const char *>(&W);
+    // A byte of W is zero iff the subtraction borrows into its top bit.
+    if (!((W - 0x01010101u) & ~W & 0x80808080u)) {
+      Str.append(Bytes, sizeof(W));
+      continue;
+    }
+    const char *End =
+        static_cast<const char *>(std::memchr(Bytes, '\0', sizeof(W)));
+    assert(std::all_of(End, Bytes + sizeof(W), [](char C) { return !C; }) &&
+           "Invalid string in SPIRV");
+    Str.append(Bytes, End);
+    break;
   }
-#endif
-  return decodeBinary(I, V);
 }
 
-template <class T> const SPIRVEncoder &encode(const SPIRVEncoder &O, T V) {
-#ifdef _SPIRV_SUPPORT_TEXT_FMT
-  if (SPIRVUseTextFormat) {
-    O.OS << getNameMap(V).map(V) << " ";
-    return O;
-  }
-#endif
-  return O << static_cast<SPIRVWord>(V);
+void SPIRVBinaryFormat::writeString(spv_ostream &OS, const std::string &Str) {
+  size_t L = Str.length();
+  OS.write(Str.c_str(), L);
+  char Zeros[4] = {0, 0, 0, 0};
+  OS.write(Zeros, 4 - L % 4);
+}
+
+template <typename FormatTy>
+SPIRVDecoder<FormatTy>::SPIRVDecoder(std::istream &InputStream,
+                                     SPIRVFunction &F)
+    : IS(InputStream), M(*F.getModule()), WordCount(0), OpCode(OpNop),
+      Scope(&F), WordsLeft(0) {}
+
+template <typename FormatTy>
+SPIRVDecoder<FormatTy>::SPIRVDecoder(std::istream &InputStream,
+                                     SPIRVBasicBlock &BB)
+    : IS(InputStream), M(*BB.getModule()), WordCount(0), OpCode(OpNop),
+      Scope(&BB), WordsLeft(0) {}
+
+template <typename FormatTy>
+void SPIRVDecoder<FormatTy>::setScope(SPIRVEntry *TheScope) {
+  assert(TheScope && (TheScope->getOpCode() == OpFunction ||
+                      TheScope->getOpCode() == OpLabel));
+  Scope = TheScope;
 }
 
-template <>
-const SPIRVEncoder &operator<<(const SPIRVEncoder &O, SPIRVType *P) {
+template <typename FormatTy>
+const SPIRVEncoder<FormatTy> &operator<<(const SPIRVEncoder<FormatTy> &O,
+                                         SPIRVType *P) {
   if (!P->hasId() && P->getOpCode() == OpTypeForwardPointer)
     return O << static_cast<SPIRVTypeForwardPointer *>(
                     static_cast<SPIRVEntry *>(P))
@@ -131,13 +324,19 @@ const SPIRVEncoder &operator<<(const SPIRVEncoder &O, SPIRVType *P) {
   return O << P->getId();
 }
 
+template const SPIRVEncoder<SPIRVBinaryFormat> &
+operator<<(const SPIRVEncoder<SPIRVBinaryFormat> &O, SPIRVType *P);
+template const SPIRVEncoder<SPIRVTextFormat> &
+operator<<(const SPIRVEncoder<SPIRVTextFormat> &O, SPIRVType *P);
+
+spv_ostream &operator<<(spv_ostream &O, const SPIRVEntry &E) {
+  SPIRVTextEncoder(O) << E;
+  return O;
+}
+
 #define SPIRV_DEF_ENCDEC(Type)                                                 \
-  const SPIRVDecoder &operator>>(const SPIRVDecoder &I, Type &V) {             \
-    return decode(I, V);                                                       \
-  }                                                                            \
-  const SPIRVEncoder &operator<<(const SPIRVEncoder &O, Type V) {              \
-    return encode(O, V);                                                       \
-  }
+  template bool SPIRVTextLexer::readName(std::istream &IS, Type &V);           \
+  template void SPIRVTextFormat::writeName(spv_ostream &OS, Type V);
 
 SPIRV_DEF_ENCDEC(Op)
 SPIRV_DEF_ENCDEC(Capability)
@@ -150,52 +349,9 @@ SPIRV_DEF_ENCDEC(HostAccessQualifier)
 SPIRV_DEF_ENCDEC(NamedMaximumNumberOfRegisters)
 SPIRV_DEF_ENCDEC(LinkageType)
 
-// Read a string with padded 0's at the end so that they form a stream of
-// words.
-const SPIRVDecoder &operator>>(const SPIRVDecoder &I, std::string &Str) {
-#ifdef _SPIRV_SUPPORT_TEXT_FMT
-  if (SPIRVUseTextFormat) {
-    readQuotedString(I.IS, Str);
-    SPIRVDBG(spvdbgs() << "Read string: \"" << Str << "\"\n");
-    return I;
-  }
-#endif
-
-  uint64_t Count = 0;
-  char Ch;
-  while (I.IS.get(Ch) && Ch != '\0') {
-    Str += Ch;
-    ++Count;
-  }
-  Count = (Count + 1) % 4;
-  Count = Count ? 4 - Count : 0;
-  for (; Count; --Count) {
-    I.IS >> Ch;
-    assert(Ch == '\0' && "Invalid string in SPIRV");
-  }
-  SPIRVDBG(spvdbgs() << "Read string: \"" << Str << "\"\n");
-  return I;
-}
-
-// Write a string with padded 0's at the end so that they form a stream of
-// words.
-const SPIRVEncoder &operator<<(const SPIRVEncoder &O, const std::string &Str) {
-#ifdef _SPIRV_SUPPORT_TEXT_FMT
-  if (SPIRVUseTextFormat) {
-    writeQuotedString(O.OS, Str);
-    O.OS << " ";
-    return O;
-  }
-#endif
-
-  size_t L = Str.length();
-  O.OS.write(Str.c_str(), L);
-  char Zeros[4] = {0, 0, 0, 0};
-  O.OS.write(Zeros, 4 - L % 4);
-  return O;
-}
-
-bool SPIRVDecoder::getWordCountAndOpCode() {
+template <typename FormatTy>
+bool SPIRVDecoder<FormatTy>::getWordCountAndOpCode() {
+  WordsLeft = 0;
   if (IS.eof()) {
     WordCount = 0;
     OpCode = OpNop;
@@ -203,8 +359,7 @@ bool SPIRVDecoder::getWordCountAndOpCode() {
                        << WordCount << " " << OpCode << '\n');
     return false;
   }
-#ifdef _SPIRV_SUPPORT_TEXT_FMT
-  if (SPIRVUseTextFormat) {
+  if constexpr (FormatTy::IsText) {
     *this >> WordCount;
     assert(!IS.bad() && "SPIRV stream is bad");
     if (IS.fail()) {
@@ -216,18 +371,17 @@ bool SPIRVDecoder::getWordCountAndOpCode() {
     }
     *this >> OpCode;
   } else {
-#endif
     SPIRVWord WordCountAndOpCode;
     *this >> WordCountAndOpCode;
     WordCount = WordCountAndOpCode >> 16;
     OpCode = static_cast<Op>(WordCountAndOpCode & 0xFFFF);
-#ifdef _SPIRV_SUPPORT_TEXT_FMT
+    WordsLeft = WordCount ? WordCount - 1 : 0;
   }
-#endif
   assert(!IS.bad() && "SPIRV stream is bad");
   if (IS.fail()) {
     WordCount = 0;
     OpCode = OpNop;
+    WordsLeft = 0;
     SPIRVDBG(spvdbgs() << "[SPIRVDecoder] getWordCountAndOpCode FAIL "
                        << WordCount << " " << OpCode << '\n');
     return false;
@@ -237,7 +391,7 @@ bool SPIRVDecoder::getWordCountAndOpCode() {
   return true;
 }
 
-SPIRVEntry *SPIRVDecoder::getEntry() {
+template <typename FormatTy> SPIRVEntry *SPIRVDecoder<FormatTy>::getEntry() {
   if (WordCount == 0 || OpCode == OpNop)
     return nullptr;
   SPIRVEntry *Entry = SPIRVEntry::create(OpCode);
@@ -255,7 +409,9 @@ SPIRVEntry *SPIRVDecoder::getEntry() {
                         SPIRVDebug::DebugLine))
     Entry->setDebugLine(M.getCurrentDebugLine());
 
-  IS >> *Entry;
+  *this >> *Entry;
+  SPIRVTRACE(SPIRVTC_Decode, "entry", OpCode,
+             Entry->hasId() ? Entry->getId() : 0);
   if (Entry->isEndOfBlock() || OpCode == OpNoLine)
     M.setCurrentLine(nullptr);
   if (Entry->isEndOfBlock() ||
@@ -270,24 +426,26 @@ SPIRVEntry *SPIRVDecoder::getEntry() {
     ExtensionID ExtID = {};
     bool ExtIsKnown = SPIRVMap<ExtensionID, std::string>::rfind(
         OpExt->getExtensionName(), &ExtID);
-    if (!M.getErrorLog().checkError(
-            ExtIsKnown, SPIRVEC_InvalidModule,
-            "input SPIR-V module uses unknown extension '" +
-                OpExt->getExtensionName() + "'")) {
+    if (!M.getErrorLog().checkError(ExtIsKnown, SPIRVEC_InvalidModule, [&] {
+          return "input SPIR-V module uses unknown extension '" +
+                 OpExt->getExtensionName() + "'";
+        })) {
       M.setInvalid();
     }
 
     if (!M.getErrorLog().checkError(
-            M.isAllowedToUseExtension(ExtID), SPIRVEC_InvalidModule,
-            "input SPIR-V module uses extension '" + OpExt->getExtensionName() +
-                "' which were disabled by --spirv-ext option")) {
+            M.isAllowedToUseExtension(ExtID), SPIRVEC_InvalidModule, [&] {
+              return "input SPIR-V module uses extension '" +
+                     OpExt->getExtensionName() +
+                     "' which were disabled by --spirv-ext option";
+            })) {
       M.setInvalid();
     }
   }
 
-  if (!M.getErrorLog().checkError(Entry->isImplemented(),
-                                  SPIRVEC_UnimplementedOpCode,
-                                  std::to_string(Entry->getOpCode()))) {
+  if (!M.getErrorLog().checkError(
+          Entry->isImplemented(), SPIRVEC_UnimplementedOpCode,
+          [&] { return std::to_string(Entry->getOpCode()); })) {
     M.setInvalid();
   }
 
@@ -295,7 +453,7 @@ SPIRVEntry *SPIRVDecoder::getEntry() {
   return Entry;
 }
 
-void SPIRVDecoder::validate() const {
+template <typename FormatTy> void SPIRVDecoder<FormatTy>::validate() const {
   assert(OpCode != OpNop && "Invalid op code");
   assert(WordCount && "Invalid word count");
   assert(!IS.bad() && "Bad iInput stream");
@@ -303,24 +461,18 @@ void SPIRVDecoder::validate() const {
 
 // Skip \param n words in SPIR-V binary stream.
 // In case of SPIR-V text format always skip until the end of the line.
-void SPIRVDecoder::ignore(size_t N) {
-#ifdef _SPIRV_SUPPORT_TEXT_FMT
-  if (SPIRVUseTextFormat) {
+template <typename FormatTy> void SPIRVDecoder<FormatTy>::ignore(size_t N) {
+  if constexpr (FormatTy::IsText) {
     IS.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
     return;
   }
-#endif
   IS.ignore(N * sizeof(SPIRVWord));
+  consumeWords(N);
 }
 
-void SPIRVDecoder::ignoreInstruction() { ignore(WordCount - 1); }
-
-spv_ostream &operator<<(spv_ostream &O, const SPIRVNL &E) {
-#ifdef _SPIRV_SUPPORT_TEXT_FMT
-  if (SPIRVUseTextFormat)
-    O << '\n';
-#endif
-  return O;
+template <typename FormatTy>
+void SPIRVDecoder<FormatTy>::ignoreInstruction() {
+  ignore(WordCount - 1);
 }
 
 // Read the next word from the stream and if OpCode matches the argument,
@@ -331,8 +483,9 @@ spv_ostream &operator<<(spv_ostream &O, const SPIRVNL &E) {
 // Used to decode SPIRVTypeStructContinuedINTEL,
 // SPIRVConstantCompositeContinuedINTEL and
 // SPIRVSpecConstantCompositeContinuedINTEL.
-std::vector<SPIRVEntry *>
-SPIRVDecoder::getContinuedInstructions(const spv::Op ContinuedOpCode) {
+template <typename FormatTy>
+std::vector<SPIRVEntry *> SPIRVDecoder<FormatTy>::getContinuedInstructions(
+    const spv::Op ContinuedOpCode) {
   std::vector<SPIRVEntry *> ContinuedInst;
   std::streampos Pos = IS.tellg(); // remember position
   getWordCountAndOpCode();
@@ -348,7 +501,9 @@ SPIRVDecoder::getContinuedInstructions(const spv::Op ContinuedOpCode) {
   return ContinuedInst;
 }
 
-std::vector<SPIRVEntry *> SPIRVDecoder::getSourceContinuedInstructions() {
+template <typename FormatTy>
+std::vector<SPIRVEntry *>
+SPIRVDecoder<FormatTy>::getSourceContinuedInstructions() {
   std::vector<SPIRVEntry *> ContinuedInst;
   std::streampos Pos = IS.tellg(); // remember position
   getWordCountAndOpCode();
@@ -370,4 +525,7 @@ std::vector<SPIRVEntry *> SPIRVDecoder::getSourceContinuedInstructions() {
   return ContinuedInst;
 }
 
+template class SPIRVDecoder<SPIRVBinaryFormat>;
+template class SPIRVDecoder<SPIRVTextFormat>;
+
 } // namespace SPIRV
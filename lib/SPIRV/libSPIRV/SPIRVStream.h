@@ -43,10 +43,14 @@
 #include "SPIRVDebug.h"
 #include "SPIRVExtInst.h"
 #include "SPIRVModule.h"
+
+#include "llvm/ADT/SmallVector.h"
+
 #include <cctype>
 #include <cstdint>
 #include <iostream>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 namespace SPIRV {
@@ -63,10 +67,128 @@ extern bool SPIRVUseTextFormat;
 class SPIRVFunction;
 class SPIRVBasicBlock;
 
-class SPIRVDecoder {
+/// Word input and output of the SPIR-V binary format.
+struct SPIRVBinaryFormat {
+  static constexpr bool IsText = false;
+
+  template <typename T> static void read(std::istream &IS, T &V) {
+    uint32_t W;
+    IS.read(reinterpret_cast<char *>(&W), sizeof(W));
+    V = static_cast<T>(W);
+  }
+  /// Read \p N words at once if they are stored as words in memory too.
+  template <typename T> static void read(std::istream &IS, T *V, size_t N) {
+    if (sizeof(T) == sizeof(SPIRVWord)) {
+      IS.read(reinterpret_cast<char *>(V), N * sizeof(SPIRVWord));
+      return;
+    }
+    for (size_t J = 0; J != N; ++J)
+      read(IS, V[J]);
+  }
+  template <typename T> static void readName(std::istream &IS, T &V) {
+    read(IS, V);
+  }
+  /// Read a string with padded 0's at the end so that they form a stream of
+  /// words. \p MaxWords is the number of words left in the instruction, or
+  /// zero if it is not known.
+  static void readString(std::istream &IS, std::string &Str,
+                         size_t MaxWords);
+
+  template <typename T> static void write(spv_ostream &OS, T V) {
+    uint32_t W = static_cast<uint32_t>(V);
+    OS.write(reinterpret_cast<char *>(&W), sizeof(W));
+  }
+  template <typename T>
+  static void write(spv_ostream &OS, const T *V, size_t N) {
+    if (sizeof(T) == sizeof(SPIRVWord)) {
+      OS.write(reinterpret_cast<const char *>(V), N * sizeof(SPIRVWord));
+      return;
+    }
+    for (size_t J = 0; J != N; ++J)
+      write(OS, V[J]);
+  }
+  template <typename T> static void writeName(spv_ostream &OS, T V) {
+    write(OS, V);
+  }
+  /// Write a string with padded 0's at the end so that they form a stream of
+  /// words.
+  static void writeString(spv_ostream &OS, const std::string &Str);
+};
+
+/// Lexer of the internal text format. It reads the buffer of the stream
+/// directly instead of using the formatted input of std::istream, and sets
+/// the state of the stream like the formatted input does: failbit if there is
+/// no token to read and eofbit if the end of the stream is reached.
+class SPIRVTextLexer {
+public:
+  /// Skip whitespace and comments. Comment starts with ';', ends with '\n'.
+  static void skipSpace(std::istream &IS);
+  /// Read a decimal word.
+  static bool readWord(std::istream &IS, uint32_t &W);
+  /// Read a token delimited by whitespace.
+  static bool readToken(std::istream &IS, llvm::SmallVectorImpl<char> &Tok);
+  /// Read a quoted string. Replace \" with ".
+  static bool readString(std::istream &IS, std::string &Str);
+  /// Read the name of an enumerator of \p T, e.g. an opcode name.
+  template <typename T> static bool readName(std::istream &IS, T &V);
+};
+
+/// Skip comment and whitespace. Comment starts with ';', ends with '\n'.
+inline std::istream &skipcomment(std::istream &IS) {
+  if (IS.eof() || IS.bad())
+    return IS;
+  SPIRVTextLexer::skipSpace(IS);
+  return IS;
+}
+
+/// Word input and output of the internal text format, which is meant for
+/// debugging, so the words read are printed as debug output.
+struct SPIRVTextFormat {
+  static constexpr bool IsText = true;
+
+  template <typename T> static void read(std::istream &IS, T &V) {
+    uint32_t W = 0;
+    SPIRVTextLexer::readWord(IS, W);
+    V = static_cast<T>(W);
+    SPIRVDBG(spvdbgs() << "Read word: W = " << W << '\n');
+  }
+  template <typename T> static void read(std::istream &IS, T *V, size_t N) {
+    for (size_t J = 0; J != N; ++J)
+      read(IS, V[J]);
+  }
+  /// Read the name of an enumerator, e.g. an opcode name.
+  template <typename T> static void readName(std::istream &IS, T &V) {
+    bool Found = SPIRVTextLexer::readName(IS, V);
+    (void)Found;
+    assert((Found || IS.fail()) && "Invalid key");
+  }
+  /// Read a quoted string. Replace \" with ".
+  static void readString(std::istream &IS, std::string &Str);
+
+  template <typename T> static void write(spv_ostream &OS, T V) {
+    OS << V << " ";
+  }
+  template <typename T>
+  static void write(spv_ostream &OS, const T *V, size_t N) {
+    for (size_t J = 0; J != N; ++J)
+      write(OS, V[J]);
+  }
+  /// Write the name of an enumerator, e.g. an opcode name.
+  template <typename T> static void writeName(spv_ostream &OS, T V);
+  /// Write a quoted string. Replace " with \".
+  static void writeString(spv_ostream &OS, const std::string &Str);
+};
+
+/// Decoders and encoders are specialized for the format of the stream, one
+/// of the format policies above. The format is selected once per module, by
+/// the module reader and writer, and every entry is read and written through
+/// the decode and encode functions of that format, so reading or writing a
+/// binary word is a plain stream access without any check.
+template <typename FormatTy> class SPIRVDecoder {
 public:
   SPIRVDecoder(std::istream &InputStream, SPIRVModule &Module)
-      : IS(InputStream), M(Module), WordCount(0), OpCode(OpNop), Scope(NULL) {}
+      : IS(InputStream), M(Module), WordCount(0), OpCode(OpNop), Scope(NULL),
+        WordsLeft(0) {}
   SPIRVDecoder(std::istream &InputStream, SPIRVFunction &F);
   SPIRVDecoder(std::istream &InputStream, SPIRVBasicBlock &BB);
 
@@ -79,149 +201,234 @@ public:
   std::vector<SPIRVEntry *>
   getContinuedInstructions(const spv::Op ContinuedOpCode);
   std::vector<SPIRVEntry *> getSourceContinuedInstructions();
+  /// Account for \p N words of the current instruction read by the caller.
+  void consumeWords(size_t N) const {
+    WordsLeft = N < WordsLeft ? WordsLeft - N : 0;
+  }
 
   std::istream &IS;
   SPIRVModule &M;
   SPIRVWord WordCount;
   Op OpCode;
   SPIRVEntry *Scope; // A function or basic block
+  // Words of the current binary instruction that were not read through this
+  // decoder yet, zero if unknown. It is an upper bound only, as entries may
+  // read their operands through decoders of their own.
+  mutable SPIRVWord WordsLeft;
 };
 
-class SPIRVEncoder {
+extern template class SPIRVDecoder<SPIRVBinaryFormat>;
+extern template class SPIRVDecoder<SPIRVTextFormat>;
+
+template <typename FormatTy> class SPIRVEncoder {
 public:
   explicit SPIRVEncoder(spv_ostream &OutputStream) : OS(OutputStream) {}
   spv_ostream &OS;
 };
 
 /// Output a new line in text mode. Do nothing in binary mode.
-class SPIRVNL {
-  friend spv_ostream &operator<<(spv_ostream &O, const SPIRVNL &E);
-};
-
-template <typename T>
-const SPIRVDecoder &decodeBinary(const SPIRVDecoder &I, T &V) {
-  uint32_t W;
-  I.IS.read(reinterpret_cast<char *>(&W), sizeof(W));
-  V = static_cast<T>(W);
-  SPIRVDBG(spvdbgs() << "Read word: W = " << W << " V = " << V << '\n');
-  return I;
-}
-
-#ifdef _SPIRV_SUPPORT_TEXT_FMT
-/// Skip comment and whitespace. Comment starts with ';', ends with '\n'.
-inline std::istream &skipcomment(std::istream &IS) {
-  if (IS.eof() || IS.bad())
-    return IS;
-
-  char C = IS.peek();
-
-  while (std::char_traits<char>::not_eof(C) && std::isspace(C)) {
-    IS.get();
-    C = IS.peek();
-  }
+class SPIRVNL {};
 
-  while (std::char_traits<char>::not_eof(C) && C == ';') {
-    IS.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-    C = IS.peek();
-    while (std::char_traits<char>::not_eof(C) && std::isspace(C)) {
-      IS.get();
-      C = IS.peek();
-    }
-  }
-
-  return IS;
+template <typename FormatTy>
+const SPIRVEncoder<FormatTy> &operator<<(const SPIRVEncoder<FormatTy> &O,
+                                         const SPIRVNL &) {
+  if constexpr (FormatTy::IsText)
+    O.OS << '\n';
+  return O;
 }
-#endif
 
-template <typename T>
-const SPIRVDecoder &operator>>(const SPIRVDecoder &I, T &V) {
-#ifdef _SPIRV_SUPPORT_TEXT_FMT
-  if (SPIRVUseTextFormat) {
-    uint32_t W;
-    I.IS >> skipcomment >> W;
-    V = static_cast<T>(W);
-    SPIRVDBG(spvdbgs() << "Read word: W = " << W << " V = " << V << '\n');
-    return I;
-  }
-#endif
-  return decodeBinary(I, V);
+/// Read a word. Class types are not words, they have operators of their own,
+/// and entries are read with their decode function.
+template <typename FormatTy, typename T>
+typename std::enable_if<!std::is_class<T>::value,
+                        const SPIRVDecoder<FormatTy> &>::type
+operator>>(const SPIRVDecoder<FormatTy> &I, T &V) {
+  FormatTy::read(I.IS, V);
+  I.consumeWords(1);
+  return I;
 }
 
-template <typename T>
-const SPIRVDecoder &operator>>(const SPIRVDecoder &I, T *&P) {
+template <typename FormatTy, typename T>
+const SPIRVDecoder<FormatTy> &operator>>(const SPIRVDecoder<FormatTy> &I,
+                                         T *&P) {
   SPIRVId Id;
   I >> Id;
   P = static_cast<T *>(I.M.getEntry(Id));
   return I;
 }
 
-template <typename IterTy>
-const SPIRVDecoder &operator>>(const SPIRVDecoder &Decoder,
-                               const std::pair<IterTy, IterTy> &Range) {
+template <typename FormatTy, typename IterTy>
+const SPIRVDecoder<FormatTy> &
+operator>>(const SPIRVDecoder<FormatTy> &Decoder,
+           const std::pair<IterTy, IterTy> &Range) {
   for (IterTy I = Range.first, E = Range.second; I != E; ++I)
     Decoder >> *I;
   return Decoder;
 }
 
+/// Integers that can be read and written in bulk. Enumerations are not among
+/// them as some of them are written by name in the text format.
 template <typename T>
-const SPIRVDecoder &operator>>(const SPIRVDecoder &I, std::vector<T> &V) {
-  for (size_t J = 0, E = V.size(); J != E; ++J)
+using SPIRVIsWordLike =
+    std::integral_constant<bool, std::is_integral<T>::value &&
+                                     !std::is_same<T, bool>::value>;
+
+template <typename FormatTy, typename T>
+typename std::enable_if<SPIRVIsWordLike<T>::value>::type
+decodeArray(const SPIRVDecoder<FormatTy> &I, T *V, size_t N) {
+  FormatTy::read(I.IS, V, N);
+  I.consumeWords(N);
+}
+
+template <typename FormatTy, typename T>
+typename std::enable_if<!SPIRVIsWordLike<T>::value>::type
+decodeArray(const SPIRVDecoder<FormatTy> &I, T *V, size_t N) {
+  for (size_t J = 0; J != N; ++J)
     I >> V[J];
+}
+
+template <typename FormatTy, typename T>
+const SPIRVDecoder<FormatTy> &operator>>(const SPIRVDecoder<FormatTy> &I,
+                                         std::vector<T> &V) {
+  decodeArray(I, V.data(), V.size());
   return I;
 }
 
-template <typename T>
-const SPIRVDecoder &operator>>(const SPIRVDecoder &I, std::optional<T> &V) {
+template <typename FormatTy, typename T, unsigned N>
+const SPIRVDecoder<FormatTy> &operator>>(const SPIRVDecoder<FormatTy> &I,
+                                         llvm::SmallVector<T, N> &V) {
+  decodeArray(I, V.data(), V.size());
+  return I;
+}
+
+template <typename FormatTy, typename T>
+const SPIRVDecoder<FormatTy> &operator>>(const SPIRVDecoder<FormatTy> &I,
+                                         std::optional<T> &V) {
   if (V)
     I >> V.value();
   return I;
 }
 
-template <typename T>
-const SPIRVEncoder &operator<<(const SPIRVEncoder &O, T V) {
-#ifdef _SPIRV_SUPPORT_TEXT_FMT
-  if (SPIRVUseTextFormat) {
-    O.OS << V << " ";
-    return O;
+template <typename FormatTy>
+const SPIRVDecoder<FormatTy> &operator>>(const SPIRVDecoder<FormatTy> &I,
+                                         std::string &Str) {
+  if constexpr (FormatTy::IsText) {
+    FormatTy::readString(I.IS, Str);
+  } else {
+    size_t OldSize = Str.size();
+    FormatTy::readString(I.IS, Str, I.WordsLeft);
+    I.consumeWords((Str.size() - OldSize) / sizeof(SPIRVWord) + 1);
   }
-#endif
-  uint32_t W = static_cast<uint32_t>(V);
-  O.OS.write(reinterpret_cast<char *>(&W), sizeof(W));
+  return I;
+}
+
+template <typename FormatTy>
+const SPIRVDecoder<FormatTy> &operator>>(const SPIRVDecoder<FormatTy> &I,
+                                         SPIRVEntry &E) {
+  E.decode(I);
+  return I;
+}
+
+/// Write a word. Class types are not words, they have operators of their
+/// own, e.g. entries are written as complete instructions.
+template <typename FormatTy, typename T>
+typename std::enable_if<!std::is_class<T>::value,
+                        const SPIRVEncoder<FormatTy> &>::type
+operator<<(const SPIRVEncoder<FormatTy> &O, T V) {
+  FormatTy::write(O.OS, V);
   return O;
 }
 
-template <typename T>
-const SPIRVEncoder &operator<<(const SPIRVEncoder &O, T *P) {
+template <typename FormatTy, typename T>
+const SPIRVEncoder<FormatTy> &operator<<(const SPIRVEncoder<FormatTy> &O,
+                                         T *P) {
   return O << P->getId();
 }
-template <> const SPIRVEncoder &operator<<(const SPIRVEncoder &O, SPIRVType *P);
 
-template <typename T>
-const SPIRVEncoder &operator<<(const SPIRVEncoder &O, const std::vector<T> &V) {
-  for (size_t I = 0, E = V.size(); I != E; ++I)
+template <typename FormatTy>
+const SPIRVEncoder<FormatTy> &operator<<(const SPIRVEncoder<FormatTy> &O,
+                                         SPIRVType *P);
+
+template <typename FormatTy, typename T>
+typename std::enable_if<SPIRVIsWordLike<T>::value>::type
+encodeArray(const SPIRVEncoder<FormatTy> &O, const T *V, size_t N) {
+  FormatTy::write(O.OS, V, N);
+}
+
+template <typename FormatTy, typename T>
+typename std::enable_if<!SPIRVIsWordLike<T>::value>::type
+encodeArray(const SPIRVEncoder<FormatTy> &O, const T *V, size_t N) {
+  for (size_t I = 0; I != N; ++I)
     O << V[I];
+}
+
+template <typename FormatTy, typename T>
+const SPIRVEncoder<FormatTy> &operator<<(const SPIRVEncoder<FormatTy> &O,
+                                         const std::vector<T> &V) {
+  encodeArray(O, V.data(), V.size());
   return O;
 }
 
-template <typename T>
-const SPIRVEncoder &operator<<(const SPIRVEncoder &O,
-                               const std::optional<T> &V) {
+template <typename FormatTy, typename T, unsigned N>
+const SPIRVEncoder<FormatTy> &operator<<(const SPIRVEncoder<FormatTy> &O,
+                                         const llvm::SmallVector<T, N> &V) {
+  encodeArray(O, V.data(), V.size());
+  return O;
+}
+
+template <typename FormatTy, typename T>
+const SPIRVEncoder<FormatTy> &operator<<(const SPIRVEncoder<FormatTy> &O,
+                                         const std::optional<T> &V) {
   if (V)
     O << V.value();
   return O;
 }
 
-template <typename IterTy>
-const SPIRVEncoder &operator<<(const SPIRVEncoder &Encoder,
-                               const std::pair<IterTy, IterTy> &Range) {
+template <typename FormatTy, typename IterTy>
+const SPIRVEncoder<FormatTy> &
+operator<<(const SPIRVEncoder<FormatTy> &Encoder,
+           const std::pair<IterTy, IterTy> &Range) {
   for (IterTy I = Range.first, E = Range.second; I != E; ++I)
     Encoder << *I;
   return Encoder;
 }
 
+template <typename FormatTy>
+const SPIRVEncoder<FormatTy> &operator<<(const SPIRVEncoder<FormatTy> &O,
+                                         const std::string &Str) {
+  FormatTy::writeString(O.OS, Str);
+  return O;
+}
+
+/// Write an entry as a complete instruction, including the instructions it
+/// contains, e.g. the basic blocks of a function.
+template <typename FormatTy>
+const SPIRVEncoder<FormatTy> &operator<<(const SPIRVEncoder<FormatTy> &O,
+                                         const SPIRVEntry &E) {
+  E.validate();
+  E.encodeAll(O);
+  O << SPIRVNL();
+  return O;
+}
+
+/// Write an entry in the text format, for debug output.
+spv_ostream &operator<<(spv_ostream &O, const SPIRVEntry &E);
+
+/// Enumerations written by name in the text format.
 #define SPIRV_DEC_ENCDEC(Type)                                                 \
-  const SPIRVEncoder &operator<<(const SPIRVEncoder &O, Type V);               \
-  const SPIRVDecoder &operator>>(const SPIRVDecoder &I, Type &V);
+  template <typename FormatTy>                                                 \
+  const SPIRVEncoder<FormatTy> &operator<<(const SPIRVEncoder<FormatTy> &O,    \
+                                           Type V) {                           \
+    FormatTy::writeName(O.OS, V);                                              \
+    return O;                                                                  \
+  }                                                                            \
+  template <typename FormatTy>                                                 \
+  const SPIRVDecoder<FormatTy> &operator>>(const SPIRVDecoder<FormatTy> &I,    \
+                                           Type &V) {                          \
+    FormatTy::readName(I.IS, V);                                               \
+    I.consumeWords(1);                                                         \
+    return I;                                                                  \
+  }
 
 SPIRV_DEC_ENCDEC(Op)
 SPIRV_DEC_ENCDEC(Capability)
@@ -234,8 +441,5 @@ SPIRV_DEC_ENCDEC(HostAccessQualifier)
 SPIRV_DEC_ENCDEC(NamedMaximumNumberOfRegisters)
 SPIRV_DEC_ENCDEC(LinkageType)
 
-const SPIRVEncoder &operator<<(const SPIRVEncoder &O, const std::string &Str);
-const SPIRVDecoder &operator>>(const SPIRVDecoder &I, std::string &Str);
-
 } // namespace SPIRV
 #endif // SPIRV_LIBSPIRV_SPIRVSTREAM_H
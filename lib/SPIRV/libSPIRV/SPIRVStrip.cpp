@@ -0,0 +1,218 @@
+//===- SPIRVStrip.cpp - Strip SPIR-V binaries -------------------*- C++ -*-===//
+//
+//                     The LLVM/SPIR-V Translator
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+// Copyright (c) 2024 The Khronos Group Inc.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimers.
+// Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimers in the documentation
+// and/or other materials provided with the distribution.
+// Neither the names of The Khronos Group, nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// Software without specific prior written permission.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH
+// THE SOFTWARE.
+//
+//===----------------------------------------------------------------------===//
+/// \file
+///
+/// This file implements removal of the parts of a SPIR-V binary that are not
+/// needed to run it: names, debug information and auxiliary data. The binary
+/// is filtered in a single pass over its words without decoding it into a
+/// SPIRVModule.
+///
+//===----------------------------------------------------------------------===//
+
+#include "LLVMSPIRVLib.h"
+#include "SPIRVIdScanner.h"
+
+#include <unordered_map>
+#include <unordered_set>
+
+using namespace SPIRV;
+
+namespace {
+
+class SPIRVStripper {
+public:
+  explicit SPIRVStripper(unsigned Parts) : Parts(Parts) {}
+
+  bool strip(llvm::StringRef Binary, std::string &Out);
+  const std::string &getError() const { return ErrMsg; }
+
+private:
+  bool isStripped(StripKind Kind) const {
+    return Parts & (1u << static_cast<uint32_t>(Kind));
+  }
+  /// Check whether an extended instruction set is removed entirely.
+  bool isStrippedSet(SPIRVExtInstSetKind Kind) const;
+  /// Check whether \p Inst is removed. May rewrite the instruction into
+  /// Kept instead, e.g. to drop the debug operands of OpSource.
+  bool filter(llvm::ArrayRef<SPIRVWord> Inst,
+              llvm::SmallVectorImpl<SPIRVWord> &Kept);
+
+  unsigned Parts;
+  std::string ErrMsg;
+  /// Extended instruction sets imported by the module.
+  std::unordered_map<SPIRVId, SPIRVExtInstSetKind> ExtInstSets;
+  /// OpString results used by the remaining instructions.
+  std::unordered_set<SPIRVId> UsedStrings;
+  bool InSource = false;
+};
+
+bool SPIRVStripper::isStrippedSet(SPIRVExtInstSetKind Kind) const {
+  switch (Kind) {
+  case SPIRVEIS_Debug:
+  case SPIRVEIS_OpenCL_DebugInfo_100:
+  case SPIRVEIS_NonSemantic_Shader_DebugInfo_100:
+  case SPIRVEIS_NonSemantic_Shader_DebugInfo_200:
+    return isStripped(StripKind::Debug);
+  case SPIRVEIS_NonSemantic_AuxData:
+    return isStripped(StripKind::AuxData);
+  default:
+    return false;
+  }
+}
+
+bool SPIRVStripper::filter(llvm::ArrayRef<SPIRVWord> Inst,
+                           llvm::SmallVectorImpl<SPIRVWord> &Kept) {
+  Op OC = getSPIRVInstOpCode(Inst.data());
+  bool IsSourceContinued = OC == OpSourceContinued && InSource;
+  InSource = false;
+  switch (OC) {
+  case OpName:
+  case OpMemberName:
+    return isStripped(StripKind::Names);
+  case OpLine:
+  case OpNoLine:
+  case OpModuleProcessed:
+    return isStripped(StripKind::Debug);
+  case OpSource:
+    // The source language and version are used by the reverse translation,
+    // only the file and the source text are dropped.
+    if (!isStripped(StripKind::Debug) || Inst.size() <= 3)
+      return false;
+    InSource = true;
+    Kept.assign(Inst.begin(), Inst.begin() + 3);
+    Kept[0] = (3 << WordCountShift) | OpSource;
+    return false;
+  case OpSourceContinued:
+    InSource = IsSourceContinued;
+    return IsSourceContinued;
+  case OpExtInstImport: {
+    if (Inst.size() < 3)
+      return false;
+    SPIRVExtInstSetKind Kind = SPIRVEIS_Count;
+    SPIRVBuiltinSetNameMap::rfind(getSPIRVString(Inst, 2), &Kind);
+    ExtInstSets[Inst[1]] = Kind;
+    return isStrippedSet(Kind);
+  }
+  case OpExtInst: {
+    if (Inst.size() < 5)
+      return false;
+    auto Loc = ExtInstSets.find(Inst[3]);
+    if (Loc != ExtInstSets.end() && isStrippedSet(Loc->second))
+      return true;
+    // Any operand may refer to an OpString, e.g. in non-semantic sets.
+    UsedStrings.insert(Inst.begin() + 5, Inst.end());
+    return false;
+  }
+  default:
+    return false;
+  }
+}
+
+bool SPIRVStripper::strip(llvm::StringRef Binary, std::string &Out) {
+  std::vector<SPIRVWord> In;
+  if (!readSPIRVWords(Binary, In, ErrMsg))
+    return false;
+  std::vector<SPIRVWord> Words(In.begin(), In.begin() + SPIRVHW_Count);
+  Words.reserve(In.size());
+
+  // Strings are only referenced after they are defined, so whether a string
+  // is still used is known once the whole module is filtered. They are put
+  // back in place at the end.
+  bool DeferStrings = isStripped(StripKind::Debug);
+  std::vector<llvm::ArrayRef<SPIRVWord>> Strings;
+  size_t StringsPos = 0;
+
+  // The bound is lowered to the largest remaining id, unless some
+  // instruction has an unknown layout.
+  SPIRVIdScanner Scanner;
+  SPIRVInstIds Ids;
+  SPIRVId MaxId = 0;
+  bool KnowsMaxId = true;
+
+  llvm::SmallVector<SPIRVWord, 8> Kept;
+  bool Valid = forEachSPIRVInst(In, [&](llvm::ArrayRef<SPIRVWord> Inst) {
+    Op OC = getSPIRVInstOpCode(Inst.data());
+    if (OC == OpString && DeferStrings) {
+      if (Strings.empty())
+        StringsPos = Words.size();
+      Strings.push_back(Inst);
+      return;
+    }
+    Kept.clear();
+    if (filter(Inst, Kept))
+      return;
+    if (!Kept.empty())
+      Inst = Kept;
+    if (KnowsMaxId && Scanner.scan(Inst, Ids))
+      MaxId = std::max<SPIRVId>(MaxId, Ids.Result ? Inst[Ids.Result] : 0);
+    else
+      KnowsMaxId = false;
+    Words.insert(Words.end(), Inst.begin(), Inst.end());
+  });
+  if (!Valid) {
+    ErrMsg = "invalid instruction in SPIR-V binary";
+    return false;
+  }
+
+  std::vector<SPIRVWord> UsedStringWords;
+  for (llvm::ArrayRef<SPIRVWord> Inst : Strings) {
+    if (Inst.size() < 2 || !UsedStrings.count(Inst[1]))
+      continue;
+    MaxId = std::max<SPIRVId>(MaxId, Inst[1]);
+    UsedStringWords.insert(UsedStringWords.end(), Inst.begin(), Inst.end());
+  }
+  Words.insert(Words.begin() + StringsPos, UsedStringWords.begin(),
+               UsedStringWords.end());
+  if (KnowsMaxId)
+    Words[SPIRVHW_Bound] = MaxId + 1;
+
+  Out.assign(reinterpret_cast<const char *>(Words.data()),
+             Words.size() * sizeof(SPIRVWord));
+  return true;
+}
+
+} // namespace
+
+namespace SPIRV {
+
+bool stripSpirv(const std::string &Input, unsigned Parts, std::string &Out,
+                std::string &ErrMsg) {
+  SPIRVStripper Stripper(Parts);
+  if (Stripper.strip(Input, Out))
+    return true;
+  ErrMsg = Stripper.getError();
+  return false;
+}
+
+} // namespace SPIRV
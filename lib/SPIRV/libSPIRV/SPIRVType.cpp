@@ -284,15 +284,20 @@ SPIRVValue *SPIRVTypeArray::getLength() const { return getValue(Length); }
 
 _SPIRV_IMP_ENCDEC3(SPIRVTypeArray, Id, ElemType, Length)
 
-void SPIRVTypeForwardPointer::encode(spv_ostream &O) const {
-  getEncoder(O) << PointerId << SC;
+template <typename FormatTy>
+void SPIRVTypeForwardPointer::encodeImpl(
+    const SPIRVEncoder<FormatTy> &O) const {
+  O << PointerId << SC;
 }
 
-void SPIRVTypeForwardPointer::decode(std::istream &I) {
-  auto Decoder = getDecoder(I);
+template <typename FormatTy>
+void SPIRVTypeForwardPointer::decodeImpl(
+    const SPIRVDecoder<FormatTy> &Decoder) {
   Decoder >> PointerId >> SC;
 }
 
+_SPIRV_IMP_ENCDEC_FORMATS(SPIRVTypeForwardPointer)
+
 SPIRVTypeJointMatrixINTEL::SPIRVTypeJointMatrixINTEL(
     SPIRVModule *M, SPIRVId TheId, Op OC, SPIRVType *CompType,
     std::vector<SPIRVValue *> Args)
@@ -310,16 +315,20 @@ SPIRVTypeJointMatrixINTEL::SPIRVTypeJointMatrixINTEL()
     : SPIRVType(internal::OpTypeJointMatrixINTEL), CompType(nullptr),
       Args({nullptr, nullptr, nullptr, nullptr}) {}
 
-void SPIRVTypeJointMatrixINTEL::encode(spv_ostream &O) const {
-  auto Encoder = getEncoder(O);
+template <typename FormatTy>
+void SPIRVTypeJointMatrixINTEL::encodeImpl(
+    const SPIRVEncoder<FormatTy> &Encoder) const {
   Encoder << Id << CompType << Args;
 }
 
-void SPIRVTypeJointMatrixINTEL::decode(std::istream &I) {
-  auto Decoder = getDecoder(I);
+template <typename FormatTy>
+void SPIRVTypeJointMatrixINTEL::decodeImpl(
+    const SPIRVDecoder<FormatTy> &Decoder) {
   Decoder >> Id >> CompType >> Args;
 }
 
+_SPIRV_IMP_ENCDEC_FORMATS(SPIRVTypeJointMatrixINTEL)
+
 SPIRVTypeCooperativeMatrixKHR::SPIRVTypeCooperativeMatrixKHR(
     SPIRVModule *M, SPIRVId TheId, SPIRVType *CompType,
     std::vector<SPIRVValue *> Args)
@@ -330,16 +339,20 @@ SPIRVTypeCooperativeMatrixKHR::SPIRVTypeCooperativeMatrixKHR()
     : SPIRVType(OpTypeCooperativeMatrixKHR), CompType(nullptr),
       Args({nullptr, nullptr, nullptr, nullptr}) {}
 
-void SPIRVTypeCooperativeMatrixKHR::encode(spv_ostream &O) const {
-  auto Encoder = getEncoder(O);
+template <typename FormatTy>
+void SPIRVTypeCooperativeMatrixKHR::encodeImpl(
+    const SPIRVEncoder<FormatTy> &Encoder) const {
   Encoder << Id << CompType << Args;
 }
 
-void SPIRVTypeCooperativeMatrixKHR::decode(std::istream &I) {
-  auto Decoder = getDecoder(I);
+template <typename FormatTy>
+void SPIRVTypeCooperativeMatrixKHR::decodeImpl(
+    const SPIRVDecoder<FormatTy> &Decoder) {
   Decoder >> Id >> CompType >> Args;
 }
 
+_SPIRV_IMP_ENCDEC_FORMATS(SPIRVTypeCooperativeMatrixKHR)
+
 void SPIRVTypeCooperativeMatrixKHR::validate() const {
   SPIRVEntry::validate();
   SPIRVErrorLog &SPVErrLog = this->getModule()->getErrorLog();
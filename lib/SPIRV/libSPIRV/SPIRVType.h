@@ -260,8 +260,9 @@ public:
     Cap.insert(Cap.end(), C.begin(), C.end());
     return Cap;
   }
-  std::vector<SPIRVEntry *> getNonLiteralOperands() const override {
-    return std::vector<SPIRVEntry *>(1, getEntry(ElemTypeId));
+  void addNonLiteralOperands(
+      llvm::SmallVectorImpl<SPIRVEntry *> &Ops) const override {
+    Ops.push_back(getEntry(ElemTypeId));
   }
 
 protected:
@@ -322,8 +323,9 @@ public:
     return V;
   }
 
-  std::vector<SPIRVEntry *> getNonLiteralOperands() const override {
-    return std::vector<SPIRVEntry *>(1, CompType);
+  void addNonLiteralOperands(
+      llvm::SmallVectorImpl<SPIRVEntry *> &Ops) const override {
+    Ops.push_back(CompType);
   }
 
 protected:
@@ -369,8 +371,9 @@ public:
     return V;
   }
 
-  virtual std::vector<SPIRVEntry *> getNonLiteralOperands() const override {
-    return std::vector<SPIRVEntry *>(1, ColType);
+  void addNonLiteralOperands(
+      llvm::SmallVectorImpl<SPIRVEntry *> &Ops) const override {
+    Ops.push_back(ColType);
   }
 
   void validate() const override {
@@ -401,10 +404,10 @@ public:
   SPIRVCapVec getRequiredCapability() const override {
     return getElementType()->getRequiredCapability();
   }
-  std::vector<SPIRVEntry *> getNonLiteralOperands() const override {
-    std::vector<SPIRVEntry *> Operands(2, ElemType);
-    Operands[1] = (SPIRVEntry *)getLength();
-    return Operands;
+  void addNonLiteralOperands(
+      llvm::SmallVectorImpl<SPIRVEntry *> &Ops) const override {
+    Ops.push_back(ElemType);
+    Ops.push_back((SPIRVEntry *)getLength());
   }
 
 protected:
@@ -421,14 +424,24 @@ public:
   // Complete constructor
   SPIRVTypeOpaque(SPIRVModule *M, SPIRVId TheId, const std::string &TheName)
       : SPIRVType(M, 2 + getSizeInWords(TheName), OpTypeOpaque, TheId) {
-    Name = TheName;
+    setName(TheName);
     validate();
   }
   // Incomplete constructor
   SPIRVTypeOpaque() : SPIRVType(OpTypeOpaque) {}
 
 protected:
-  _SPIRV_DEF_ENCDEC2(Id, Name)
+  template <typename FormatTy>
+  void encodeImpl(const SPIRVEncoder<FormatTy> &O) const {
+    O << Id << *Name;
+  }
+  template <typename FormatTy>
+  void decodeImpl(const SPIRVDecoder<FormatTy> &I) {
+    std::string TheName;
+    I >> Id >> TheName;
+    setName(TheName);
+  }
+  _SPIRV_DEF_ENCDEC_FORMATS
   void validate() const override { SPIRVEntry::validate(); }
 };
 
@@ -526,8 +539,9 @@ public:
   }
   SPIRVType *getSampledType() const { return get<SPIRVType>(SampledType); }
 
-  std::vector<SPIRVEntry *> getNonLiteralOperands() const override {
-    return std::vector<SPIRVEntry *>(1, get<SPIRVType>(SampledType));
+  void addNonLiteralOperands(
+      llvm::SmallVectorImpl<SPIRVEntry *> &Ops) const override {
+    Ops.push_back(get<SPIRVType>(SampledType));
   }
 
 protected:
@@ -589,8 +603,9 @@ public:
 
   void setImageType(SPIRVTypeImage *TheImgTy) { ImgTy = TheImgTy; }
 
-  std::vector<SPIRVEntry *> getNonLiteralOperands() const override {
-    return std::vector<SPIRVEntry *>(1, ImgTy);
+  void addNonLiteralOperands(
+      llvm::SmallVectorImpl<SPIRVEntry *> &Ops) const override {
+    Ops.push_back(ImgTy);
   }
 
 protected:
@@ -637,13 +652,13 @@ public:
     MemberTypeIdVec.resize(TheMemberTypes.size());
     for (auto &T : TheMemberTypes)
       MemberTypeIdVec.push_back(T->getId());
-    Name = TheName;
+    setName(TheName);
     validate();
   }
   SPIRVTypeStruct(SPIRVModule *M, SPIRVId TheId, unsigned NumMembers,
                   const std::string &TheName)
       : SPIRVType(M, FixedWC + NumMembers, OC, TheId) {
-    Name = TheName;
+    setName(TheName);
     validate();
     MemberTypeIdVec.resize(NumMembers);
   }
@@ -674,33 +689,41 @@ public:
   }
 
   // TODO: Should we attach operands of continued instructions as well?
-  std::vector<SPIRVEntry *> getNonLiteralOperands() const override {
-    std::vector<SPIRVEntry *> Operands(MemberTypeIdVec.size());
-    for (size_t I = 0, E = MemberTypeIdVec.size(); I < E; ++I)
-      Operands[I] = getEntry(MemberTypeIdVec[I]);
-    return Operands;
+  void addNonLiteralOperands(
+      llvm::SmallVectorImpl<SPIRVEntry *> &Ops) const override {
+    for (SPIRVId I : MemberTypeIdVec)
+      Ops.push_back(getEntry(I));
   }
   void addContinuedInstruction(ContinuedInstType Inst) {
     ContinuedInstructions.push_back(Inst);
   }
 
-  void encodeChildren(spv_ostream &O) const override {
+  template <typename FormatTy>
+  void encodeChildrenImpl(const SPIRVEncoder<FormatTy> &O) const {
     O << SPIRVNL();
     for (auto &I : ContinuedInstructions)
       O << *I;
   }
+  void encodeChildren(const SPIRVBinaryEncoder &O) const override {
+    encodeChildrenImpl(O);
+  }
+  void encodeChildren(const SPIRVTextEncoder &O) const override {
+    encodeChildrenImpl(O);
+  }
 
   std::vector<ContinuedInstType> getContinuedInstructions() {
     return ContinuedInstructions;
   }
 
 protected:
-  void encode(spv_ostream &O) const override {
-    getEncoder(O) << Id << MemberTypeIdVec;
+  template <typename FormatTy>
+  void encodeImpl(const SPIRVEncoder<FormatTy> &O) const {
+    O << Id << MemberTypeIdVec;
   }
 
-  void decode(std::istream &I) override {
-    SPIRVDecoder Decoder = getDecoder(I);
+  template <typename FormatTy>
+  void decodeImpl(const SPIRVDecoder<FormatTy> &I) {
+    SPIRVDecoder<FormatTy> Decoder(I.IS, *Module);
     Decoder >> Id >> MemberTypeIdVec;
     Module->add(this);
 
@@ -708,9 +731,14 @@ protected:
       addContinuedInstruction(static_cast<ContinuedInstType>(E));
     }
   }
+  _SPIRV_DEF_ENCDEC_FORMATS
 
   void validate() const override { SPIRVEntry::validate(); }
 
+  size_t getOperandMemoryUsage() const override {
+    return getHeapSize(MemberTypeIdVec) + getHeapSize(ContinuedInstructions);
+  }
+
 private:
   std::vector<SPIRVId> MemberTypeIdVec; // Member Type Ids
   std::vector<ContinuedInstType> ContinuedInstructions;
@@ -738,11 +766,11 @@ public:
     return static_cast<SPIRVType *>(getEntry(ParamTypeIdVec[I]));
   }
 
-  std::vector<SPIRVEntry *> getNonLiteralOperands() const override {
-    std::vector<SPIRVEntry *> Operands = {ReturnType};
+  void addNonLiteralOperands(
+      llvm::SmallVectorImpl<SPIRVEntry *> &Ops) const override {
+    Ops.push_back(ReturnType);
     for (SPIRVId I : ParamTypeIdVec)
-      Operands.push_back(getEntry(I));
-    return Operands;
+      Ops.push_back(getEntry(I));
   }
 
 protected:
@@ -757,6 +785,9 @@ protected:
     for (auto I : ParamTypeIdVec)
       getEntry(I)->validate();
   }
+  size_t getOperandMemoryUsage() const override {
+    return getHeapSize(ParamTypeIdVec);
+  }
 
 private:
   SPIRVType *ReturnType;               // Return Type
@@ -940,8 +971,9 @@ public:
   const SPIRVTypeImage *getImageType() const { return ImgTy; }
   void setImageType(SPIRVTypeImage *TheImgTy) { ImgTy = TheImgTy; }
 
-  virtual std::vector<SPIRVEntry *> getNonLiteralOperands() const override {
-    return std::vector<SPIRVEntry *>(1, ImgTy);
+  void addNonLiteralOperands(
+      llvm::SmallVectorImpl<SPIRVEntry *> &Ops) const override {
+    Ops.push_back(ImgTy);
   }
 
   SPIRVCapVec getRequiredCapability() const override {
@@ -1117,8 +1149,9 @@ public:
     return Args.size() > 4 ? Args[4] : nullptr;
   }
 
-  std::vector<SPIRVEntry *> getNonLiteralOperands() const override {
-    return std::vector<SPIRVEntry *>(1, CompType);
+  void addNonLiteralOperands(
+      llvm::SmallVectorImpl<SPIRVEntry *> &Ops) const override {
+    Ops.push_back(CompType);
   }
 };
 
@@ -1152,8 +1185,9 @@ public:
   SPIRVValue *getColumns() const { return Args[2]; }
   SPIRVValue *getUse() const { return Args[3]; }
 
-  std::vector<SPIRVEntry *> getNonLiteralOperands() const override {
-    return std::vector<SPIRVEntry *>(1, CompType);
+  void addNonLiteralOperands(
+      llvm::SmallVectorImpl<SPIRVEntry *> &Ops) const override {
+    Ops.push_back(CompType);
   }
 };
 
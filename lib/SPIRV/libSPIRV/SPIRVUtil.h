@@ -43,6 +43,9 @@
 #include <ostream>
 #define spv_ostream std::ostream
 
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/MathExtras.h"
 #include "llvm/Support/raw_ostream.h"
 
 #include <algorithm>
@@ -51,9 +54,12 @@
 #include <functional>
 #include <limits>
 #include <map>
+#include <numeric>
 #include <set>
 #include <sstream>
 #include <string>
+#include <type_traits>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
@@ -79,6 +85,227 @@ static llvm::sys::Mutex MapLock;
 
 constexpr unsigned MaxWordCount = UINT16_MAX;
 
+/// Perfect hash index of a set of distinct strings, built with the hash and
+/// displace method. The strings are distributed into buckets by a first hash.
+/// Every bucket then gets either the seed of a second hash which puts all its
+/// strings into free slots, or, if it holds a single string, its slot.
+class SPIRVStringIndex {
+public:
+  static constexpr uint32_t NotFound = UINT32_MAX;
+
+  void build(const std::vector<llvm::StringRef> &Keys);
+
+  /// Position in the indexed strings of the only one that may be equal to
+  /// \p Key. The caller has to compare them.
+  uint32_t lookup(llvm::StringRef Key) const {
+    if (Displacements.empty())
+      return NotFound;
+    int32_t D = Displacements[hash(Key, 0) % Displacements.size()];
+    return Slots[D < 0 ? -D - 1 : hash(Key, D) & (Slots.size() - 1)];
+  }
+
+private:
+  static uint32_t hash(llvm::StringRef Key, uint32_t Seed) {
+    // FNV-1a followed by the finalizer of MurmurHash3, so that the low bits
+    // used to select slots depend on every character.
+    uint32_t H = 2166136261u ^ Seed;
+    for (char C : Key)
+      H = (H ^ static_cast<uint8_t>(C)) * 16777619u;
+    H ^= H >> 16;
+    H *= 0x85ebca6bu;
+    H ^= H >> 13;
+    H *= 0xc2b2ae35u;
+    H ^= H >> 16;
+    return H;
+  }
+
+  std::vector<int32_t> Displacements;
+  std::vector<uint32_t> Slots;
+};
+
+inline void SPIRVStringIndex::build(const std::vector<llvm::StringRef> &Keys) {
+  size_t N = Keys.size();
+  if (!N)
+    return;
+  size_t Mask = llvm::PowerOf2Ceil(N) - 1;
+  Slots.assign(Mask + 1, NotFound);
+  Displacements.assign(N, 0);
+  std::vector<std::vector<uint32_t>> Buckets(N);
+  for (uint32_t I = 0; I != N; ++I)
+    Buckets[hash(Keys[I], 0) % N].push_back(I);
+  // Place the biggest buckets first, while there are many free slots.
+  std::vector<uint32_t> Order(N);
+  std::iota(Order.begin(), Order.end(), 0);
+  std::stable_sort(Order.begin(), Order.end(), [&](uint32_t L, uint32_t R) {
+    return Buckets[L].size() > Buckets[R].size();
+  });
+
+  std::vector<size_t> Placed;
+  size_t B = 0;
+  for (; B != N && Buckets[Order[B]].size() > 1; ++B) {
+    const std::vector<uint32_t> &Bucket = Buckets[Order[B]];
+    for (uint32_t D = 1;; ++D) {
+      Placed.clear();
+      for (uint32_t I : Bucket) {
+        size_t S = hash(Keys[I], D) & Mask;
+        if (Slots[S] != NotFound ||
+            std::find(Placed.begin(), Placed.end(), S) != Placed.end())
+          break;
+        Placed.push_back(S);
+      }
+      if (Placed.size() != Bucket.size())
+        continue;
+      for (size_t J = 0; J != Bucket.size(); ++J)
+        Slots[Placed[J]] = Bucket[J];
+      Displacements[Order[B]] = static_cast<int32_t>(D);
+      break;
+    }
+  }
+  size_t Free = 0;
+  for (; B != N && Buckets[Order[B]].size() == 1; ++B) {
+    while (Slots[Free] != NotFound)
+      ++Free;
+    Slots[Free] = Buckets[Order[B]].front();
+    Displacements[Order[B]] = -static_cast<int32_t>(Free) - 1;
+  }
+}
+
+/// One direction of a SPIRVMap. The pairs are kept in a flat array sorted by
+/// key and are found by binary search, or through a SPIRVStringIndex if the
+/// keys are strings.
+template <class KeyTy, class ValTy> class SPIRVMapTable {
+public:
+  typedef std::pair<KeyTy, ValTy> EntryTy;
+  typedef typename std::vector<EntryTy>::const_iterator const_iterator;
+
+  void add(KeyTy Key, ValTy Val) {
+    Entries.emplace_back(std::move(Key), std::move(Val));
+  }
+
+  /// Sort the entries and keep only the last one added for every key. No
+  /// entry can be added afterwards.
+  void finalize();
+
+  const ValTy *lookup(const KeyTy &Key) const {
+    if constexpr (std::is_same<KeyTy, std::string>::value) {
+      return lookup<KeyTy>(llvm::StringRef(Key));
+    } else {
+      auto Loc = std::lower_bound(
+          Entries.begin(), Entries.end(), Key,
+          [](const EntryTy &E, const KeyTy &K) { return E.first < K; });
+      if (Loc == Entries.end() || Key < Loc->first)
+        return nullptr;
+      return &Loc->second;
+    }
+  }
+
+  template <class T = KeyTy>
+  typename std::enable_if<std::is_same<T, std::string>::value,
+                          const ValTy *>::type
+  lookup(llvm::StringRef Key) const {
+    uint32_t Pos = Index.lookup(Key);
+    if (Pos == SPIRVStringIndex::NotFound || Entries[Pos].first != Key)
+      return nullptr;
+    return &Entries[Pos].second;
+  }
+
+  const_iterator begin() const { return Entries.begin(); }
+  const_iterator end() const { return Entries.end(); }
+
+private:
+  std::vector<EntryTy> Entries;
+  SPIRVStringIndex Index;
+};
+
+template <class KeyTy, class ValTy>
+void SPIRVMapTable<KeyTy, ValTy>::finalize() {
+  std::stable_sort(
+      Entries.begin(), Entries.end(),
+      [](const EntryTy &L, const EntryTy &R) { return L.first < R.first; });
+  auto Out = Entries.begin();
+  for (auto I = Entries.begin(), E = Entries.end(); I != E; ++I) {
+    auto Next = std::next(I);
+    if (Next != E && !(I->first < Next->first))
+      continue;
+    if (Out != I)
+      *Out = std::move(*I);
+    ++Out;
+  }
+  Entries.erase(Out, Entries.end());
+  Entries.shrink_to_fit();
+
+  if constexpr (std::is_same<KeyTy, std::string>::value) {
+    std::vector<llvm::StringRef> Keys;
+    Keys.reserve(Entries.size());
+    for (const EntryTy &E : Entries)
+      Keys.push_back(E.first);
+    Index.build(Keys);
+  }
+}
+
+// A multimap kept as a sorted vector. Entries with equal keys stay in the
+// order they were inserted, as in std::multimap. The first N entries are
+// stored in the object itself.
+template <class KeyTy, class ValTy, unsigned N> class SPIRVFlatMultiMap {
+public:
+  typedef std::pair<KeyTy, ValTy> value_type;
+  typedef llvm::SmallVector<value_type, N> StorageTy;
+  typedef typename StorageTy::const_iterator const_iterator;
+
+  void insert(value_type V) {
+    // Entries are usually added in key order, so check the end first.
+    if (Entries.empty() || !(V.first < Entries.back().first)) {
+      Entries.push_back(std::move(V));
+      return;
+    }
+    auto Pos = upperBound(V.first) - begin();
+    Entries.insert(Entries.begin() + Pos, std::move(V));
+  }
+
+  size_t erase(const KeyTy &Key) {
+    auto Range = equal_range(Key);
+    size_t Count = Range.second - Range.first;
+    Entries.erase(Range.first, Range.second);
+    return Count;
+  }
+
+  const_iterator find(const KeyTy &Key) const {
+    const_iterator Loc = lowerBound(Key);
+    return Loc != end() && !(Key < Loc->first) ? Loc : end();
+  }
+
+  std::pair<const_iterator, const_iterator>
+  equal_range(const KeyTy &Key) const {
+    return {lowerBound(Key), upperBound(Key)};
+  }
+
+  size_t count(const KeyTy &Key) const {
+    auto Range = equal_range(Key);
+    return Range.second - Range.first;
+  }
+
+  size_t size() const { return Entries.size(); }
+  bool empty() const { return Entries.empty(); }
+  void clear() { Entries.clear(); }
+  const_iterator begin() const { return Entries.begin(); }
+  const_iterator end() const { return Entries.end(); }
+  const StorageTy &getStorage() const { return Entries; }
+
+private:
+  const_iterator lowerBound(const KeyTy &Key) const {
+    return std::lower_bound(
+        begin(), end(), Key,
+        [](const value_type &E, const KeyTy &K) { return E.first < K; });
+  }
+  const_iterator upperBound(const KeyTy &Key) const {
+    return std::upper_bound(
+        begin(), end(), Key,
+        [](const KeyTy &K, const value_type &E) { return K < E.first; });
+  }
+
+  StorageTy Entries;
+};
+
 // A bi-way map
 template <class Ty1, class Ty2, class Identifier = void> struct SPIRVMap {
 public:
@@ -134,37 +361,55 @@ public:
   }
 
   static bool find(Ty1 Key, Ty2 *Val = nullptr) {
-    const SPIRVMap &Map = getMap();
-    typename MapTy::const_iterator Loc = Map.Map.find(Key);
-    if (Loc == Map.Map.end())
-      return false;
-    if (Val)
-      *Val = Loc->second;
-    return true;
+    return copyFound(getMap().Map.lookup(Key), Val);
+  }
+
+  // Find a string key without copying it into a std::string.
+  template <class T = Ty1>
+  static typename std::enable_if<std::is_same<T, std::string>::value,
+                                 bool>::type
+  find(llvm::StringRef Key, Ty2 *Val = nullptr) {
+    return copyFound(getMap().Map.template lookup<T>(Key), Val);
   }
 
   static bool rfind(Ty2 Key, Ty1 *Val = nullptr) {
-    const SPIRVMap &Map = getRMap();
-    typename RevMapTy::const_iterator Loc = Map.RevMap.find(Key);
-    if (Loc == Map.RevMap.end())
-      return false;
-    if (Val)
-      *Val = Loc->second;
-    return true;
+    return copyFound(getRMap().RevMap.lookup(Key), Val);
+  }
+
+  // Find a string value without copying it into a std::string.
+  template <class T = Ty2>
+  static typename std::enable_if<std::is_same<T, std::string>::value,
+                                 bool>::type
+  rfind(llvm::StringRef Key, Ty1 *Val = nullptr) {
+    return copyFound(getRMap().RevMap.template lookup<T>(Key), Val);
   }
   SPIRVMap() : IsReverse(false) {}
 
 protected:
-  SPIRVMap(bool Reverse) : IsReverse(Reverse) { init(); }
-  typedef std::map<Ty1, Ty2> MapTy;
-  typedef std::map<Ty2, Ty1> RevMapTy;
+  SPIRVMap(bool Reverse) : IsReverse(Reverse) {
+    init();
+    if (IsReverse)
+      RevMap.finalize();
+    else
+      Map.finalize();
+  }
+  typedef SPIRVMapTable<Ty1, Ty2> MapTy;
+  typedef SPIRVMapTable<Ty2, Ty1> RevMapTy;
+
+  template <class T> static bool copyFound(const T *Loc, T *Val) {
+    if (!Loc)
+      return false;
+    if (Val)
+      *Val = *Loc;
+    return true;
+  }
 
   void add(Ty1 V1, Ty2 V2) {
     if (IsReverse) {
-      RevMap[V2] = V1;
+      RevMap.add(V2, V1);
       return;
     }
-    Map[V1] = V2;
+    Map.add(V1, V2);
   }
   MapTy Map;
   RevMapTy RevMap;
@@ -331,11 +576,14 @@ inline unsigned getSizeInWords(const std::string &Str) {
 inline std::string getString(std::vector<uint32_t>::const_iterator Begin,
                              std::vector<uint32_t>::const_iterator End) {
   std::string Str = std::string();
+  Str.reserve((End - Begin) * sizeof(uint32_t));
   for (auto I = Begin; I != End; ++I) {
     uint32_t Word = *I;
+    // A byte of Word is zero iff the subtraction borrows into its top bit.
+    bool HasZeroByte = (Word - 0x01010101u) & ~Word & 0x80808080u;
     for (unsigned J = 0u; J < 32u; J += 8u) {
       char Char = (char)((Word >> J) & 0xff);
-      if (Char == '\0')
+      if (HasZeroByte && Char == '\0')
         return Str;
       Str += Char;
     }
@@ -424,6 +672,65 @@ getOrInsert(MapTy &Map, typename MapTy::key_type Key, FuncTy Func) {
   return NF;
 }
 
+// Approximate heap bytes owned by a container, for memory reports. Node based
+// containers are charged the value and the usual node links.
+template <typename T> size_t getHeapSize(const std::vector<T> &V) {
+  return V.capacity() * sizeof(T);
+}
+
+template <typename T, unsigned N>
+size_t getHeapSize(const llvm::SmallVector<T, N> &V) {
+  // The elements are stored in the object itself until they outgrow it.
+  const char *Data = reinterpret_cast<const char *>(V.data());
+  const char *Object = reinterpret_cast<const char *>(&V);
+  if (Data >= Object && Data < Object + sizeof(V))
+    return 0;
+  return V.capacity() * sizeof(T);
+}
+
+template <typename KeyTy, typename ValTy, unsigned N>
+size_t getHeapSize(const SPIRVFlatMultiMap<KeyTy, ValTy, N> &C) {
+  return getHeapSize(C.getStorage());
+}
+
+inline size_t getHeapSize(const std::string &S) {
+  // Short strings are stored in the object itself.
+  return S.capacity() > std::string().capacity() ? S.capacity() + 1 : 0;
+}
+
+template <typename ContainerTy> size_t getTreeHeapSize(const ContainerTy &C) {
+  return C.size() *
+         (sizeof(typename ContainerTy::value_type) + 4 * sizeof(void *));
+}
+
+template <typename ContainerTy> size_t getHashHeapSize(const ContainerTy &C) {
+  return C.size() *
+             (sizeof(typename ContainerTy::value_type) + 2 * sizeof(void *)) +
+         C.bucket_count() * sizeof(void *);
+}
+
+template <typename... Ts> size_t getHeapSize(const std::set<Ts...> &C) {
+  return getTreeHeapSize(C);
+}
+
+template <typename... Ts> size_t getHeapSize(const std::map<Ts...> &C) {
+  return getTreeHeapSize(C);
+}
+
+template <typename... Ts> size_t getHeapSize(const std::multimap<Ts...> &C) {
+  return getTreeHeapSize(C);
+}
+
+template <typename... Ts>
+size_t getHeapSize(const std::unordered_map<Ts...> &C) {
+  return getHashHeapSize(C);
+}
+
+template <typename... Ts>
+size_t getHeapSize(const std::unordered_set<Ts...> &C) {
+  return getHashHeapSize(C);
+}
+
 template <typename T> std::string toString(const T *Object) {
   if (Object == nullptr)
     return "";
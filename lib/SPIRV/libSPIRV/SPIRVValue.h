@@ -198,21 +198,26 @@ protected:
     SPIRVValue::validate();
     assert(NumWords >= 1 && "Invalid constant size");
   }
-  void encode(spv_ostream &O) const override {
-    getEncoder(O) << Type << Id;
+  template <typename FormatTy>
+  void encodeImpl(const SPIRVEncoder<FormatTy> &O) const {
+    O << Type << Id;
     for (const auto &Word : Words)
-      getEncoder(O) << Word;
+      O << Word;
   }
   void setWordCount(SPIRVWord WordCount) override {
     SPIRVValue::setWordCount(WordCount);
     NumWords = WordCount - FixedWC;
   }
-  void decode(std::istream &I) override {
-    getDecoder(I) >> Type >> Id;
+  template <typename FormatTy>
+  void decodeImpl(const SPIRVDecoder<FormatTy> &I) {
+    I >> Type >> Id;
     Words.resize(NumWords);
     for (auto &Word : Words)
-      getDecoder(I) >> Word;
+      I >> Word;
   }
+  _SPIRV_DEF_ENCDEC_FORMATS
+
+  size_t getOperandMemoryUsage() const override { return getHeapSize(Words); }
 
   unsigned NumWords;
 
@@ -315,9 +320,10 @@ public:
   std::vector<SPIRVValue *> getElements() const { return getValues(Elements); }
 
   // TODO: Should we attach operands of continued instructions as well?
-  std::vector<SPIRVEntry *> getNonLiteralOperands() const override {
-    std::vector<SPIRVValue *> Elements = getElements();
-    return std::vector<SPIRVEntry *>(Elements.begin(), Elements.end());
+  void addNonLiteralOperands(
+      llvm::SmallVectorImpl<SPIRVEntry *> &Ops) const override {
+    for (SPIRVValue *V : getValueRange(Elements))
+      Ops.push_back(V);
   }
 
   std::vector<ContinuedInstType> getContinuedInstructions() {
@@ -328,11 +334,18 @@ public:
     ContinuedInstructions.push_back(Inst);
   }
 
-  void encodeChildren(spv_ostream &O) const override {
+  template <typename FormatTy>
+  void encodeChildrenImpl(const SPIRVEncoder<FormatTy> &O) const {
     O << SPIRVNL();
     for (auto &I : ContinuedInstructions)
       O << *I;
   }
+  void encodeChildren(const SPIRVBinaryEncoder &O) const override {
+    encodeChildrenImpl(O);
+  }
+  void encodeChildren(const SPIRVTextEncoder &O) const override {
+    encodeChildrenImpl(O);
+  }
 
 protected:
   void validate() const override {
@@ -346,18 +359,25 @@ protected:
     Elements.resize(WordCount - FixedWC);
   }
 
-  void encode(spv_ostream &O) const override {
-    getEncoder(O) << Type << Id << Elements;
+  template <typename FormatTy>
+  void encodeImpl(const SPIRVEncoder<FormatTy> &O) const {
+    O << Type << Id << Elements;
   }
 
-  void decode(std::istream &I) override {
-    SPIRVDecoder Decoder = getDecoder(I);
+  template <typename FormatTy>
+  void decodeImpl(const SPIRVDecoder<FormatTy> &I) {
+    SPIRVDecoder<FormatTy> Decoder(I.IS, *Module);
     Decoder >> Type >> Id >> Elements;
 
     for (SPIRVEntry *E : Decoder.getContinuedInstructions(ContinuedOpCode)) {
       addContinuedInstruction(static_cast<ContinuedInstType>(E));
     }
   }
+  _SPIRV_DEF_ENCDEC_FORMATS
+
+  size_t getOperandMemoryUsage() const override {
+    return getHeapSize(Elements) + getHeapSize(ContinuedInstructions);
+  }
 
   std::vector<SPIRVId> Elements;
   std::vector<ContinuedInstType> ContinuedInstructions;
@@ -0,0 +1,28 @@
+; Look for data races between concurrent translations which use different
+; SPIR-V formats and directions within one process.
+; Only meaningful in a ThreadSanitizer build (LLVM_USE_SANITIZER=Thread),
+; which makes the first reported race fail the test.
+; REQUIRES: tsan, shell
+; RUN: llvm-as %s -o %t.bc
+; RUN: llvm-spirv %t.bc -o %t.0.spv
+; RUN: llvm-spirv %t.bc -spirv-text -o %t.0.spt
+
+; RUN: rm -f %t.jobs.txt
+; RUN: for i in 1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16; do \
+; RUN:   echo "%t.bc %t.$i.spv" >> %t.jobs.txt; \
+; RUN:   echo "%t.bc %t.$i.spt" >> %t.jobs.txt; \
+; RUN:   echo "-r %t.0.spv %t.$i.bin.bc" >> %t.jobs.txt; \
+; RUN:   echo "-r %t.0.spt %t.$i.text.bc" >> %t.jobs.txt; \
+; RUN: done
+; RUN: env TSAN_OPTIONS=halt_on_error=1 llvm-spirv --batch %t.jobs.txt -j 16
+; RUN: cmp %t.0.spv %t.16.spv
+; RUN: cmp %t.0.spt %t.16.spt
+
+target datalayout = "e-i64:64-v16:16-v24:32-v32:32-v48:64-v96:128-v192:256-v256:256-v512:512-v1024:1024"
+target triple = "spir64-unknown-unknown"
+
+define spir_kernel void @foo(ptr addrspace(1) %p) {
+entry:
+  store i32 0, ptr addrspace(1) %p, align 4
+  ret void
+}
@@ -0,0 +1,38 @@
+; Check that concurrent translations using different SPIR-V formats and
+; directions within one process produce the same results as sequential ones.
+; Every job selects its format through its own translator options. Data races
+; between the jobs are checked by batch-mixed-formats-tsan.ll.
+; REQUIRES: shell
+; RUN: llvm-as %s -o %t.bc
+; RUN: echo "%t.bc %t.0.spv" > %t.init.txt
+; RUN: echo "%t.bc %t.0.spt" >> %t.init.txt
+; RUN: llvm-spirv --batch %t.init.txt -j 2
+; RUN: FileCheck %s --check-prefix=CHECK-SPIRV < %t.0.spt
+
+; RUN: rm -f %t.jobs.txt
+; RUN: for i in 1 2 3 4 5 6 7 8; do \
+; RUN:   echo "%t.bc %t.$i.spv" >> %t.jobs.txt; \
+; RUN:   echo "%t.bc %t.$i.spt" >> %t.jobs.txt; \
+; RUN:   echo "-r %t.0.spv %t.$i.bin.bc" >> %t.jobs.txt; \
+; RUN:   echo "-r %t.0.spt %t.$i.text.bc" >> %t.jobs.txt; \
+; RUN: done
+; RUN: llvm-spirv --batch %t.jobs.txt -j 8
+
+; RUN: FileCheck %s --check-prefix=CHECK-SPIRV < %t.8.spt
+; RUN: llvm-spirv %t.8.spv -to-text -o - | FileCheck %s --check-prefix=CHECK-SPIRV
+; RUN: cmp %t.0.spv %t.8.spv
+; RUN: cmp %t.0.spt %t.8.spt
+; RUN: llvm-dis %t.8.bin.bc -o - | FileCheck %s --check-prefix=CHECK-LLVM
+; RUN: llvm-dis %t.8.text.bc -o - | FileCheck %s --check-prefix=CHECK-LLVM
+
+; CHECK-SPIRV: Name [[#]] "foo"
+; CHECK-LLVM: define spir_kernel void @foo(
+
+target datalayout = "e-i64:64-v16:16-v24:32-v32:32-v48:64-v96:128-v192:256-v256:256-v512:512-v1024:1024"
+target triple = "spir64-unknown-unknown"
+
+define spir_kernel void @foo(ptr addrspace(1) %p) {
+entry:
+  store i32 0, ptr addrspace(1) %p, align 4
+  ret void
+}
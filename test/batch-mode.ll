@@ -0,0 +1,33 @@
+; Check that --batch translates several modules in one process, both forward
+; and in reverse, and that per-job failures are reported.
+; RUN: llvm-as %s -o %t.a.bc
+; RUN: llvm-as %s -o %t.b.bc
+; RUN: echo "%t.a.bc %t.a.spv" > %t.fwd.txt
+; RUN: echo "%t.b.bc" >> %t.fwd.txt
+; RUN: llvm-spirv --batch %t.fwd.txt -j 2
+; RUN: llvm-spirv %t.a.spv -to-text -o - | FileCheck %s --check-prefix=CHECK-SPIRV
+; RUN: llvm-spirv %t.b.spv -to-text -o - | FileCheck %s --check-prefix=CHECK-SPIRV
+
+; RUN: echo "%t.a.spv %t.a.rev.bc" > %t.rev.txt
+; RUN: echo "%t.b.spv %t.b.rev.bc" >> %t.rev.txt
+; RUN: llvm-spirv -r --batch %t.rev.txt -j 2
+; RUN: llvm-dis %t.a.rev.bc -o - | FileCheck %s --check-prefix=CHECK-LLVM
+; RUN: llvm-dis %t.b.rev.bc -o - | FileCheck %s --check-prefix=CHECK-LLVM
+
+; RUN: echo "%t.missing.bc" > %t.bad.txt
+; RUN: echo "%t.a.bc %t.c.spv" >> %t.bad.txt
+; RUN: not llvm-spirv --batch %t.bad.txt 2>&1 | FileCheck %s --check-prefix=CHECK-ERROR
+; RUN: llvm-spirv %t.c.spv -to-text -o - | FileCheck %s --check-prefix=CHECK-SPIRV
+
+; CHECK-SPIRV: Name [[#]] "foo"
+; CHECK-LLVM: define spir_kernel void @foo(
+; CHECK-ERROR: missing.bc: Fails to open input file
+
+target datalayout = "e-i64:64-v16:16-v24:32-v32:32-v48:64-v96:128-v192:256-v256:256-v512:512-v1024:1024"
+target triple = "spir64-unknown-unknown"
+
+define spir_kernel void @foo(ptr addrspace(1) %p) {
+entry:
+  store i32 0, ptr addrspace(1) %p, align 4
+  ret void
+}
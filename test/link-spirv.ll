@@ -0,0 +1,63 @@
+; Check that --link merges SPIR-V modules, shares their types and resolves the
+; functions and variables imported by one module to the definitions exported
+; by another. Globals of the first module may use variables of the second one,
+; and types decorated the same way (here a packed struct) are shared.
+
+; RUN: llvm-as %s -o %t.main.bc
+; RUN: llvm-spirv %t.main.bc -o %t.main.spv
+; RUN: echo 'target triple = "spir64-unknown-unknown" @lib_counter = addrspace(1) global i32 7 @lib_pair = addrspace(1) global <{ i32, i8 }> <{ i32 1, i8 2 }> define spir_func i32 @lib_add(i32 %0, i32 %1) { %3 = add i32 %0, %1 ret i32 %3 }' > %t.lib.ll
+; RUN: llvm-as %t.lib.ll -o %t.lib.bc
+; RUN: llvm-spirv %t.lib.bc -o %t.lib.spv
+
+; RUN: llvm-spirv --link %t.main.spv %t.lib.spv -o %t.linked.spv
+; RUN: spirv-val %t.linked.spv
+; RUN: llvm-spirv -to-text %t.linked.spv -o %t.linked.spt
+; RUN: FileCheck < %t.linked.spt %s --check-prefix=CHECK-SPIRV
+; RUN: FileCheck < %t.linked.spt %s --check-prefix=CHECK-GLOBALS
+; RUN: llvm-spirv -r %t.linked.spv -o %t.rev.bc
+; RUN: llvm-dis %t.rev.bc -o - | FileCheck %s --check-prefix=CHECK-LLVM
+
+; Linking a module with itself defines everything twice.
+; RUN: not llvm-spirv --link %t.lib.spv %t.lib.spv -o %t.dup.spv 2>&1 \
+; RUN:   | FileCheck %s --check-prefix=CHECK-DUP
+
+; CHECK-SPIRV-NOT: LinkageAttributes "lib_add" Import
+; CHECK-SPIRV-NOT: LinkageAttributes "lib_counter" Import
+; CHECK-SPIRV-NOT: LinkageAttributes "lib_pair" Import
+; CHECK-SPIRV: TypeInt [[#Int:]] 32 0
+; CHECK-SPIRV-NOT: TypeInt {{[0-9]+}} 32 0
+; CHECK-SPIRV: Function [[#Int]] [[#LibAdd:]]
+; CHECK-SPIRV: FunctionCall [[#Int]] [[#]] [[#LibAdd]]
+
+; CHECK-GLOBALS: Name [[#Counter:]] "lib_counter"
+; CHECK-GLOBALS-COUNT-1: Decorate [[#]] CPacked
+; CHECK-GLOBALS-NOT: Decorate [[#]] CPacked
+; CHECK-GLOBALS: Variable [[#]] [[#Counter]] 5
+; CHECK-GLOBALS: Variable [[#]] [[#]] 5 [[#Counter]]
+
+; CHECK-LLVM-DAG: @lib_counter_ref = addrspace(1) global ptr addrspace(1) @lib_counter
+; CHECK-LLVM-DAG: @lib_counter = addrspace(1) global i32 7
+; CHECK-LLVM: define spir_kernel void @test
+; CHECK-LLVM: call spir_func i32 @lib_add(i32
+; CHECK-LLVM: define spir_func i32 @lib_add(i32
+; CHECK-LLVM-NOT: declare spir_func i32 @lib_add
+
+; CHECK-DUP: Fails to link SPIR-V: symbol lib_{{[a-z]+}} is defined by more than one module
+
+target datalayout = "e-i64:64-v16:16-v24:32-v32:32-v48:64-v96:128-v192:256-v256:256-v512:512-v1024:1024"
+target triple = "spir64-unknown-unknown"
+
+@lib_counter = external addrspace(1) global i32
+@lib_counter_ref = addrspace(1) global ptr addrspace(1) @lib_counter
+@lib_pair = external addrspace(1) global <{ i32, i8 }>
+
+define spir_kernel void @test(ptr addrspace(1) %out, i32 %a) {
+entry:
+  %c = load i32, ptr addrspace(1) @lib_counter
+  store i8 3, ptr addrspace(1) getelementptr inbounds (<{ i32, i8 }>, ptr addrspace(1) @lib_pair, i64 0, i32 1)
+  %r = call spir_func i32 @lib_add(i32 %a, i32 %c)
+  store i32 %r, ptr addrspace(1) %out
+  ret void
+}
+
+declare spir_func i32 @lib_add(i32, i32)
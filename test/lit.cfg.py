@@ -24,6 +24,13 @@ config.excludes = ['CMakeLists.txt']
 if config.spirv_tools_found:
     config.available_features.add('libspirv_dis')
 
+# Tests that look for data races between concurrent translations.
+if 'thread' in config.llvm_use_sanitizer.lower():
+    config.available_features.add('tsan')
+
+if config.spirv_enable_trace:
+    config.available_features.add('spirv-trace')
+
 if not config.spirv_skip_debug_info_tests:
     # Direct object generation.
     config.available_features.add('object-emission')
@@ -52,7 +59,7 @@ config.substitutions.append(('%PATH%', config.environment['PATH']))
 
 tool_dirs = [config.llvm_spirv_dir, config.llvm_tools_dir]
 
-tools = ['llvm-as', 'llvm-dis', 'llvm-spirv', 'not']
+tools = ['llvm-as', 'llvm-dis', 'llvm-spirv', 'llvm-spirv-client', 'not']
 if not config.spirv_skip_debug_info_tests:
     tools.extend(['llc', 'llvm-dwarfdump', 'llvm-objdump', 'llvm-readelf', 'llvm-readobj'])
 
@@ -0,0 +1,35 @@
+; Check that the fused lowering gives the same result as running the lowering
+; passes one by one on a module that links in emulation functions. The
+; emulation functions must only get the intrinsic lowering, like they do when
+; SPIRVLowerLLVMIntrinsic runs last.
+
+; RUN: llvm-as %s -o %t.bc
+; RUN: llvm-spirv -spirv-text %t.bc -o %t.spt
+; RUN: llvm-spirv -spirv-text --spirv-fused-lowering %t.bc -o %t.fused.spt
+; RUN: diff %t.spt %t.fused.spt
+; RUN: FileCheck %s < %t.fused.spt
+
+; CHECK-DAG: Name [[SADD:[0-9]+]] "llvm_sadd_with_overflow_i32"
+; CHECK-DAG: Name [[BITREV:[0-9]+]] "llvm_bitreverse_i32"
+; CHECK: FunctionCall {{[0-9]+}} {{[0-9]+}} [[SADD]]
+; CHECK: FunctionCall {{[0-9]+}} {{[0-9]+}} [[BITREV]]
+; CHECK: Function {{[0-9]+}} [[SADD]]
+; CHECK: Function {{[0-9]+}} [[BITREV]]
+
+target datalayout = "e-i64:64-v16:16-v24:32-v32:32-v48:64-v96:128-v192:256-v256:256-v512:512-v1024:1024"
+target triple = "spir64-unknown-unknown"
+
+define spir_kernel void @foo(i32 %a, i32 %b, ptr addrspace(1) %out) {
+entry:
+  %sum = call { i32, i1 } @llvm.sadd.with.overflow.i32(i32 %a, i32 %b)
+  %val = extractvalue { i32, i1 } %sum, 0
+  %ovf = extractvalue { i32, i1 } %sum, 1
+  %ovf.ext = zext i1 %ovf to i32
+  %rev = call i32 @llvm.bitreverse.i32(i32 %val)
+  %res = add i32 %rev, %ovf.ext
+  store i32 %res, ptr addrspace(1) %out, align 4
+  ret void
+}
+
+declare { i32, i1 } @llvm.sadd.with.overflow.i32(i32, i32)
+declare i32 @llvm.bitreverse.i32(i32)
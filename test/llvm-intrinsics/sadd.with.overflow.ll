@@ -13,6 +13,7 @@
 
 ; RUN: llvm-as < %s -o %t.bc
 ; RUN: llvm-spirv -s %t.bc -o - | llvm-dis -o - | FileCheck %s
+; RUN: llvm-spirv -s --spirv-fused-lowering %t.bc -o - | llvm-dis -o - | FileCheck %s
 
 ; CHECK: call { i32, i1 } @llvm_sadd_with_overflow_i32{{.*}} !nosanitize !2
 ; CHECK-NOT: call { i32, i1 } @llvm.sadd.with.overflow.i32
@@ -0,0 +1,32 @@
+; Check that --spirv-mem-report reports the memory footprint of the SPIR-V
+; module by category and by opcode in both translation directions.
+; RUN: llvm-as %s -o %t.bc
+; RUN: llvm-spirv %t.bc -o %t.spv --spirv-mem-report 2>&1 | FileCheck %s
+; RUN: llvm-spirv -r %t.spv -o %t.rev.bc --spirv-mem-report 2>&1 | FileCheck %s
+
+; CHECK: SPIR-V module memory report
+; CHECK-NEXT: Bytes Entries Category
+; CHECK-NEXT: {{[1-9][0-9]*}} {{[1-9][0-9]*}} instructions
+; CHECK-NEXT: {{[1-9][0-9]*}} 0 operand vectors
+; CHECK-NEXT: {{[1-9][0-9]*}} {{[1-9][0-9]*}} decorations
+; CHECK-NEXT: {{[0-9]+}} {{[0-9]+}} strings
+; CHECK-NEXT: {{[0-9]+}} {{[0-9]+}} debug instructions
+; CHECK-NEXT: {{[0-9]+}} {{[0-9]+}} names
+; CHECK-NEXT: {{[1-9][0-9]*}} 0 module tables
+; CHECK-NEXT: {{[1-9][0-9]*}} total
+; CHECK-NEXT: Bytes Entries Opcode
+; CHECK-DAG: {{[1-9][0-9]*}} 1 OpFunction{{$}}
+; CHECK-DAG: {{[1-9][0-9]*}} {{[1-9][0-9]*}} OpDecorate{{$}}
+; CHECK-DAG: {{[1-9][0-9]*}} 1 OpVariable{{$}}
+; CHECK-DAG: {{[1-9][0-9]*}} 1 OpStore{{$}}
+
+target datalayout = "e-i64:64-v16:16-v24:32-v32:32-v48:64-v96:128-v192:256-v256:256-v512:512-v1024:1024"
+target triple = "spir64-unknown-unknown"
+
+@gv = addrspace(1) global i32 0, align 4
+
+define spir_kernel void @foo(ptr addrspace(1) %p) {
+entry:
+  store i32 0, ptr addrspace(1) %p, align 4
+  ret void
+}
@@ -0,0 +1,28 @@
+; Check that llvm-spirv --serve translates requests sent by llvm-spirv-client
+; in both directions and stops on a shutdown request.
+; UNSUPPORTED: system-windows
+
+; Every client below starts its own server with --spawn-server and stops it
+; before exiting, so no server outlives the test even if a check fails.
+; RUN: llvm-as %s -o %t.bc
+; RUN: llvm-spirv-client %t.sock %t.bc -o %t.spv --spawn-server=llvm-spirv
+; RUN: llvm-spirv %t.spv -to-text -o - | FileCheck %s --check-prefix=CHECK-SPIRV
+; RUN: llvm-spirv-client %t.sock -r %t.spv -o %t.rev.bc --spawn-server=llvm-spirv
+; RUN: llvm-dis %t.rev.bc -o - | FileCheck %s --check-prefix=CHECK-LLVM
+; RUN: not llvm-spirv-client %t.sock %t.bc --spirv-ext=+SPV_UNKNOWN -o %t.bad.spv --spawn-server=llvm-spirv 2>&1 | FileCheck %s --check-prefix=CHECK-ERROR
+; RUN: not llvm-spirv-client %t.sock %t.bc -o %t.big.spv --spawn-server=llvm-spirv --server-arg=--serve-max-request=16 2>&1 | FileCheck %s --check-prefix=CHECK-TOO-LARGE
+; RUN: llvm-spirv-client %t.sock --shutdown --spawn-server=llvm-spirv
+
+; CHECK-SPIRV: Name [[#]] "foo"
+; CHECK-LLVM: define spir_kernel void @foo(
+; CHECK-ERROR: Translation failed: Unknown extension 'SPV_UNKNOWN'
+; CHECK-TOO-LARGE: Translation failed: Request exceeds the --serve-max-request limit of 16 bytes
+
+target datalayout = "e-i64:64-v16:16-v24:32-v32:32-v48:64-v96:128-v192:256-v256:256-v512:512-v1024:1024"
+target triple = "spir64-unknown-unknown"
+
+define spir_kernel void @foo(ptr addrspace(1) %p) {
+entry:
+  store i32 0, ptr addrspace(1) %p, align 4
+  ret void
+}
@@ -0,0 +1,59 @@
+; Check that --strip removes names, debug information and auxiliary data from
+; a SPIR-V binary and that the result is still valid.
+
+; RUN: llvm-as %s -o %t.bc
+; RUN: llvm-spirv %t.bc --spirv-debug-info-version=nonsemantic-shader-100 --spirv-preserve-auxdata -o %t.spv
+; RUN: llvm-spirv -to-text %t.spv -o - | FileCheck %s --check-prefix=CHECK-ORIG
+
+; RUN: llvm-spirv --strip=names,debug,auxdata %t.spv -o %t.all.spv
+; RUN: spirv-val %t.all.spv
+; RUN: llvm-spirv -to-text %t.all.spv -o - | FileCheck %s --check-prefix=CHECK-ALL \
+; RUN:   --implicit-check-not=" Name " --implicit-check-not=" String " \
+; RUN:   --implicit-check-not=" Line " --implicit-check-not=ModuleProcessed \
+; RUN:   --implicit-check-not=NonSemantic --implicit-check-not=" ExtInst "
+; RUN: llvm-spirv -r %t.all.spv -o %t.rev.bc
+; RUN: llvm-dis %t.rev.bc -o - | FileCheck %s --check-prefix=CHECK-LLVM
+
+; RUN: llvm-spirv --strip=names %t.spv -o %t.names.spv
+; RUN: spirv-val %t.names.spv
+; RUN: llvm-spirv -to-text %t.names.spv -o - | FileCheck %s --check-prefix=CHECK-NAMES \
+; RUN:   --implicit-check-not=" Name "
+
+; CHECK-ORIG-DAG: ExtInstImport [[#]] "NonSemantic.Shader.DebugInfo.100"
+; CHECK-ORIG-DAG: ExtInstImport [[#]] "NonSemantic.AuxData"
+; CHECK-ORIG: Name [[#]] "test"
+
+; CHECK-ALL: EntryPoint 6 [[#]] "test"
+; CHECK-ALL: Source 3 {{[0-9]+$}}
+
+; CHECK-NAMES-DAG: ExtInstImport [[#]] "NonSemantic.Shader.DebugInfo.100"
+; CHECK-NAMES-DAG: ExtInstImport [[#]] "NonSemantic.AuxData"
+; CHECK-NAMES: String [[#]] "foo"
+
+; CHECK-LLVM: define spir_kernel void @test(
+; CHECK-LLVM-NOT: !dbg
+
+target datalayout = "e-i64:64-v16:16-v24:32-v32:32-v48:64-v96:128-v192:256-v256:256-v512:512-v1024:1024"
+target triple = "spir64-unknown-unknown"
+
+define spir_kernel void @test(ptr addrspace(1) %out) #0 !dbg !4 {
+entry:
+  store i32 42, ptr addrspace(1) %out, align 4, !dbg !7
+  ret void, !dbg !8
+}
+
+attributes #0 = { "foo" }
+
+!llvm.dbg.cu = !{!0}
+!llvm.module.flags = !{!2}
+!opencl.ocl.version = !{!3}
+
+!0 = distinct !DICompileUnit(language: DW_LANG_OpenCL, file: !1, producer: "clang", isOptimized: false, runtimeVersion: 0, emissionKind: FullDebug)
+!1 = !DIFile(filename: "test.cl", directory: "/tmp")
+!2 = !{i32 2, !"Debug Info Version", i32 3}
+!3 = !{i32 2, i32 0}
+!4 = distinct !DISubprogram(name: "test", scope: !1, file: !1, line: 1, type: !5, scopeLine: 1, spFlags: DISPFlagDefinition, unit: !0)
+!5 = !DISubroutineType(types: !6)
+!6 = !{null}
+!7 = !DILocation(line: 2, column: 3, scope: !4)
+!8 = !DILocation(line: 3, column: 1, scope: !4)
@@ -0,0 +1,41 @@
+; Check that --spirv-time-report reports the phases and counters of forward
+; and reverse translations, both as text and as JSON.
+; RUN: llvm-as %s -o %t.bc
+; RUN: llvm-spirv %t.bc -o %t.spv --spirv-time-report 2>&1 | FileCheck %s --check-prefix=CHECK-FWD
+; RUN: llvm-spirv -r %t.spv -o %t.rev.bc --spirv-time-report=json 2>&1 | FileCheck %s --check-prefix=CHECK-REV
+
+; CHECK-FWD: SPIR-V translation time report
+; CHECK-FWD-DAG: pass: SPIRV::OCLToSPIRVPass
+; CHECK-FWD-DAG: pass: SPIRV::SPIRVLowerConstExprPass
+; CHECK-FWD-DAG: type translation
+; CHECK-FWD-DAG: function translation
+; CHECK-FWD-DAG: debug info translation
+; CHECK-FWD-DAG: encoding
+; CHECK-FWD-NOT: LLVMToSPIRVPass
+; CHECK-FWD: SPIR-V instructions created
+; CHECK-FWD: SPIR-V types created
+; CHECK-FWD: SPIR-V constants created
+; CHECK-FWD: {{[1-9][0-9]*}}  builtins mangled
+
+; CHECK-REV: "phases": [
+; CHECK-REV-DAG: "name": "decode"
+; CHECK-REV-DAG: "name": "type translation"
+; CHECK-REV-DAG: "name": "function translation"
+; CHECK-REV-DAG: "name": "pass: SPIRV::SPIRVToOCL12Pass"
+; CHECK-REV: "counters": {
+; CHECK-REV-NEXT: "instructions": {{[1-9][0-9]*}},
+; CHECK-REV-NEXT: "types": {{[1-9][0-9]*}},
+; CHECK-REV-NEXT: "constants": {{[0-9]+}},
+; CHECK-REV-NEXT: "builtins_mangled": {{[1-9][0-9]*}}
+
+target datalayout = "e-i64:64-v16:16-v24:32-v32:32-v48:64-v96:128-v192:256-v256:256-v512:512-v1024:1024"
+target triple = "spir64-unknown-unknown"
+
+define spir_kernel void @foo(ptr addrspace(1) %p) {
+entry:
+  store i32 0, ptr addrspace(1) %p, align 4
+  call spir_func void @_Z7barrierj(i32 1)
+  ret void
+}
+
+declare spir_func void @_Z7barrierj(i32)
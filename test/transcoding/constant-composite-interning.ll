@@ -0,0 +1,54 @@
+; Check that structurally equal composite constants produced from distinct
+; LLVM values are emitted only once, also when one of them is nested in
+; another composite, and that composites which differ only in their type stay
+; separate.
+; RUN: llvm-as %s -o %t.bc
+; RUN: llvm-spirv %t.bc -spirv-text -o %t.spt
+; RUN: FileCheck < %t.spt %s --check-prefix=CHECK-SPIRV
+; RUN: FileCheck < %t.spt %s --check-prefix=CHECK-COUNT
+; RUN: llvm-spirv %t.bc -o %t.spv
+; RUN: spirv-val %t.spv
+
+target datalayout = "e-p:32:32-i64:64-v16:16-v24:32-v32:32-v48:64-v96:128-v192:256-v256:256-v512:512-v1024:1024-n8:16:32:64"
+target triple = "spir"
+
+; CHECK-SPIRV-DAG: TypeInt [[I8:[0-9]+]] 8 0
+; CHECK-SPIRV-DAG: TypeInt [[I32:[0-9]+]] 32 0
+; CHECK-SPIRV-DAG: Constant [[I8]] [[C21:[0-9]+]] 21
+; CHECK-SPIRV-DAG: Constant [[I32]] [[C7:[0-9]+]] 7
+; CHECK-SPIRV-DAG: TypeArray [[ARR:[0-9]+]] [[I8]] {{[0-9]+}}
+; CHECK-SPIRV-DAG: TypeVector [[VEC:[0-9]+]] [[I8]] 4
+; CHECK-SPIRV-DAG: TypeStruct [[STRUCT:[0-9]+]] [[ARR]] [[I32]]
+
+; The initializer of @arr, the array nested in the initializer of @struct and
+; the arrays built for both memsets are the same constant.
+; CHECK-SPIRV-DAG: 7 ConstantComposite [[ARR]] [[ARRC:[0-9]+]] [[C21]] [[C21]] [[C21]] [[C21]]
+; CHECK-SPIRV-DAG: 7 ConstantComposite [[VEC]] {{[0-9]+}} [[C21]] [[C21]] [[C21]] [[C21]]
+; CHECK-SPIRV-DAG: 5 ConstantComposite [[STRUCT]] [[STRUCTC:[0-9]+]] [[ARRC]] [[C7]]
+; CHECK-SPIRV-DAG: Variable {{[0-9]+}} {{[0-9]+}} 5 [[ARRC]]
+; CHECK-SPIRV-DAG: Variable {{[0-9]+}} {{[0-9]+}} 5 [[STRUCTC]]
+; CHECK-SPIRV-DAG: Variable {{[0-9]+}} {{[0-9]+}} 0 [[ARRC]]
+; CHECK-SPIRV-DAG: Variable {{[0-9]+}} {{[0-9]+}} 0 [[ARRC]]
+
+; CHECK-COUNT-COUNT-3: ConstantComposite
+; CHECK-COUNT-NOT: ConstantComposite
+
+%struct.T = type { [4 x i8], i32 }
+
+@arr = addrspace(1) constant [4 x i8] c"\15\15\15\15", align 4
+@vec = addrspace(1) constant <4 x i8> <i8 21, i8 21, i8 21, i8 21>, align 4
+@struct = addrspace(1) constant %struct.T { [4 x i8] c"\15\15\15\15", i32 7 }, align 4
+
+define spir_kernel void @foo(ptr addrspace(1) %out) {
+entry:
+  call void @llvm.memset.p1.i32(ptr addrspace(1) align 4 %out, i8 21, i32 4, i1 false)
+  ret void
+}
+
+define spir_kernel void @bar(ptr addrspace(1) %out) {
+entry:
+  call void @llvm.memset.p1.i32(ptr addrspace(1) align 4 %out, i8 21, i32 4, i1 false)
+  ret void
+}
+
+declare void @llvm.memset.p1.i32(ptr addrspace(1) nocapture writeonly, i8, i32, i1 immarg)
@@ -0,0 +1,29 @@
+; Check that structurally equal null constants produced from distinct LLVM
+; values are emitted only once.
+; RUN: llvm-as %s -o %t.bc
+; RUN: llvm-spirv %t.bc -spirv-text -o - | FileCheck %s --check-prefix=CHECK-SPIRV
+; RUN: llvm-spirv %t.bc -o %t.spv
+; RUN: spirv-val %t.spv
+
+target datalayout = "e-i64:64-v16:16-v24:32-v32:32-v48:64-v96:128-v192:256-v256:256-v512:512-v1024:1024"
+target triple = "spir64-unknown-unknown"
+
+; CHECK-SPIRV: TypeBool [[BOOL:[0-9]+]]
+; CHECK-SPIRV: TypeVector [[BOOLVEC:[0-9]+]] [[BOOL]] 2
+; CHECK-SPIRV: ConstantNull [[BOOLVEC]] [[NULL:[0-9]+]]
+; CHECK-SPIRV-NOT: ConstantNull [[BOOLVEC]]
+; CHECK-SPIRV: Function
+; CHECK-SPIRV: Select {{[0-9]+}} {{[0-9]+}} [[NULL]]
+; CHECK-SPIRV: Select {{[0-9]+}} {{[0-9]+}} [[NULL]]
+; CHECK-SPIRV: Select {{[0-9]+}} {{[0-9]+}} [[NULL]]
+
+define spir_kernel void @test(<2 x float> %a, <2 x float> %b, <2 x i32> %x, <2 x i32> %y, ptr addrspace(1) %out) {
+entry:
+  %c1 = fcmp false <2 x float> %a, %b
+  %c2 = fcmp false <2 x float> %b, %a
+  %s1 = select <2 x i1> %c1, <2 x i32> %x, <2 x i32> %y
+  %s2 = select <2 x i1> %c2, <2 x i32> %s1, <2 x i32> %y
+  %s3 = select <2 x i1> zeroinitializer, <2 x i32> %s2, <2 x i32> %x
+  store <2 x i32> %s3, ptr addrspace(1) %out, align 8
+  ret void
+}
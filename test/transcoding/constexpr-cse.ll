@@ -0,0 +1,24 @@
+; Check that a constant expression shared by several lowered constant
+; expressions is materialized only once per function.
+; RUN: llvm-as %s -o %t.bc
+; RUN: llvm-spirv %t.bc -spirv-text -o - | FileCheck %s --check-prefix=CHECK-SPIRV
+; RUN: llvm-spirv %t.bc -o %t.spv
+; RUN: spirv-val %t.spv
+
+target datalayout = "e-i64:64-v16:16-v24:32-v32:32-v48:64-v96:128-v192:256-v256:256-v512:512-v1024:1024"
+target triple = "spir64-unknown-unknown"
+
+@g = addrspace(1) global [4 x i32] zeroinitializer, align 4
+
+; CHECK-SPIRV: Function
+; CHECK-SPIRV: InBoundsPtrAccessChain {{[0-9]+}} [[GEP:[0-9]+]]
+; CHECK-SPIRV: ConvertPtrToU {{[0-9]+}} {{[0-9]+}} [[GEP]]
+; CHECK-SPIRV: PtrCastToGeneric {{[0-9]+}} {{[0-9]+}} [[GEP]]
+; CHECK-SPIRV-NOT: PtrAccessChain
+
+define spir_kernel void @test(ptr addrspace(1) %out, ptr addrspace(1) %out2) {
+entry:
+  store i64 ptrtoint (ptr addrspace(1) getelementptr inbounds ([4 x i32], ptr addrspace(1) @g, i64 0, i64 1) to i64), ptr addrspace(1) %out, align 8
+  store ptr addrspace(4) addrspacecast (ptr addrspace(1) getelementptr inbounds ([4 x i32], ptr addrspace(1) @g, i64 0, i64 1) to ptr addrspace(4)), ptr addrspace(1) %out2, align 8
+  ret void
+}
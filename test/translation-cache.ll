@@ -0,0 +1,36 @@
+; Check that --spirv-cache-dir reuses translation results keyed by the input
+; and the translator options.
+; RUN: rm -rf %t.cache
+; RUN: llvm-as %s -o %t.bc
+; RUN: llvm-spirv %t.bc -o %t.1.spv --spirv-cache-dir=%t.cache --spirv-cache-stats 2>&1 | FileCheck %s --check-prefix=CHECK-MISS
+; RUN: llvm-spirv %t.bc -o %t.2.spv --spirv-cache-dir=%t.cache --spirv-cache-stats 2>&1 | FileCheck %s --check-prefix=CHECK-HIT
+; RUN: cmp %t.1.spv %t.2.spv
+; RUN: spirv-val %t.2.spv
+
+; Different options must not reuse the entry.
+; RUN: llvm-spirv %t.bc -o %t.3.spv --spirv-max-version=1.0 --spirv-cache-dir=%t.cache --spirv-cache-stats 2>&1 | FileCheck %s --check-prefix=CHECK-MISS
+
+; RUN: llvm-spirv -r %t.1.spv -o %t.rev.1.bc --spirv-cache-dir=%t.cache --spirv-cache-stats 2>&1 | FileCheck %s --check-prefix=CHECK-MISS
+; RUN: llvm-spirv -r %t.1.spv -o %t.rev.2.bc --spirv-cache-dir=%t.cache --spirv-cache-stats 2>&1 | FileCheck %s --check-prefix=CHECK-HIT
+; RUN: llvm-dis %t.rev.2.bc -o - | FileCheck %s --check-prefix=CHECK-LLVM
+
+; Library options which change the result are a part of the key.
+; RUN: llvm-spirv -r %t.1.spv -o %t.rev.3.bc --spirv-expand-step=false --spirv-cache-dir=%t.cache --spirv-cache-stats 2>&1 | FileCheck %s --check-prefix=CHECK-MISS
+
+; A cache exceeding its size limit drops the least recently used entries.
+; RUN: rm -rf %t.small
+; RUN: llvm-spirv %t.bc -o %t.4.spv --spirv-cache-dir=%t.small --spirv-cache-max-size=1 --spirv-cache-stats 2>&1 | FileCheck %s --check-prefix=CHECK-MISS
+; RUN: llvm-spirv %t.bc -o %t.4.spv --spirv-cache-dir=%t.small --spirv-cache-max-size=1 --spirv-cache-stats 2>&1 | FileCheck %s --check-prefix=CHECK-MISS
+
+; CHECK-MISS: Translation cache: 0 hits, 1 misses, 1 stores
+; CHECK-HIT: Translation cache: 1 hits, 0 misses, 0 stores
+; CHECK-LLVM: define spir_kernel void @foo(
+
+target datalayout = "e-i64:64-v16:16-v24:32-v32:32-v48:64-v96:128-v192:256-v256:256-v512:512-v1024:1024"
+target triple = "spir64-unknown-unknown"
+
+define spir_kernel void @foo(ptr addrspace(1) %p) {
+entry:
+  store i32 0, ptr addrspace(1) %p, align 4
+  ret void
+}
@@ -0,0 +1,39 @@
+; RUN: llvm-as %s -o %t.bc
+; RUN: llvm-spirv %t.bc -spirv-text -o - | FileCheck %s
+; RUN: llvm-spirv %t.bc -o %t.spv
+; RUN: spirv-val %t.spv
+
+; This test checks that the type of an instruction is deduced from an operand
+; defined later in the function, even when that operand itself depends on
+; another instruction that hasn't been typed yet.
+
+target datalayout = "e-p:32:32-i64:64-v16:16-v24:32-v32:32-v48:64-v96:128-v192:256-v256:256-v512:512-v1024:1024"
+target triple = "spir-unknown-unknown"
+
+; CHECK: 3 TypeFloat [[FLOAT:[0-9]+]] 32
+; CHECK: 4 TypePointer [[FLOATPTR:[0-9]+]] 7 [[FLOAT]]
+
+; Function Attrs: nounwind
+define spir_kernel void @foo() {
+; CHECK: 4 Variable [[FLOATPTR]] [[FPTR:[0-9]+]] 7
+; CHECK: 7 Phi [[FLOATPTR]] [[PTR1:[0-9]+]] [[PTR2:[0-9]+]] {{[0-9]+}} [[FPTR]]
+; CHECK: 7 Phi [[FLOATPTR]] [[PTR2]] [[PTR3:[0-9]+]] {{[0-9]+}} [[FPTR]]
+; CHECK: 7 Phi [[FLOATPTR]] [[PTR3]] [[PTR4:[0-9]+]] {{[0-9]+}} [[FPTR]]
+; CHECK: InBoundsPtrAccessChain [[FLOATPTR]] [[PTR4]] [[PTR1]]
+entry:
+  %fptr = alloca float, align 4
+  br label %loop
+
+loop:
+  %ptr1 = phi ptr [%ptr2, %loop], [%fptr, %entry]
+  %ptr2 = phi ptr [%ptr3, %loop], [%fptr, %entry]
+  %ptr3 = phi ptr [%ptr4, %loop], [%fptr, %entry]
+  %cond = phi i32 [0, %entry], [%cond.next, %loop]
+  %ptr4 = getelementptr inbounds float, ptr %ptr1, i32 1
+  %cond.next = add i32 %cond, 1
+  %cmp = icmp slt i32 %cond.next, 16
+  br i1 %cmp, label %loop, label %exit
+
+exit:
+  ret void
+}
@@ -0,0 +1,111 @@
+; RUN: llvm-as %s -o %t.bc
+; RUN: llvm-spirv %t.bc -spirv-text -o - \
+; RUN:   | FileCheck %s --implicit-check-not=Bitcast
+; RUN: llvm-spirv %t.bc -o %t.spv
+; RUN: spirv-val %t.spv
+
+; This test checks a deep chain of deferred deductions. The blocks of the
+; chain are laid out in reverse, so every select is typed before the link it
+; selects from. None of the pointers has a known type until the store at the
+; end of the chain, which makes all of them pointers to i32, and the argument
+; the chain starts from a pointer to a pointer to i32.
+
+target datalayout = "e-p:32:32-i64:64-v16:16-v24:32-v32:32-v48:64-v96:128-v192:256-v256:256-v512:512-v1024:1024"
+target triple = "spir-unknown-unknown"
+
+; CHECK-DAG: 4 TypeInt [[INT:[0-9]+]] 32 0
+; CHECK-DAG: 4 TypePointer [[INTPTR:[0-9]+]] 5 [[INT]]
+; CHECK-DAG: 4 TypePointer [[INTPTRPTR:[0-9]+]] 5 [[INTPTR]]
+
+; CHECK: FunctionParameter [[INTPTRPTR]] [[PP:[0-9]+]]
+; CHECK: FunctionParameter [[INTPTR]] [[Q:[0-9]+]]
+; CHECK: Load [[INTPTR]] {{[0-9]+}} [[PP]]
+; CHECK-COUNT-16: Select [[INTPTR]]
+; CHECK: Store
+
+define spir_kernel void @chain(ptr addrspace(1) %pp, ptr addrspace(1) %q, i32 %n) {
+entry:
+  %p0 = load ptr addrspace(1), ptr addrspace(1) %pp, align 4
+  br label %link1
+
+link16:
+  %c16 = icmp eq i32 %n, 16
+  %p16 = select i1 %c16, ptr addrspace(1) %p15, ptr addrspace(1) %q
+  store i32 %n, ptr addrspace(1) %p16, align 4
+  ret void
+
+link15:
+  %c15 = icmp eq i32 %n, 15
+  %p15 = select i1 %c15, ptr addrspace(1) %p14, ptr addrspace(1) %q
+  br label %link16
+
+link14:
+  %c14 = icmp eq i32 %n, 14
+  %p14 = select i1 %c14, ptr addrspace(1) %p13, ptr addrspace(1) %q
+  br label %link15
+
+link13:
+  %c13 = icmp eq i32 %n, 13
+  %p13 = select i1 %c13, ptr addrspace(1) %p12, ptr addrspace(1) %q
+  br label %link14
+
+link12:
+  %c12 = icmp eq i32 %n, 12
+  %p12 = select i1 %c12, ptr addrspace(1) %p11, ptr addrspace(1) %q
+  br label %link13
+
+link11:
+  %c11 = icmp eq i32 %n, 11
+  %p11 = select i1 %c11, ptr addrspace(1) %p10, ptr addrspace(1) %q
+  br label %link12
+
+link10:
+  %c10 = icmp eq i32 %n, 10
+  %p10 = select i1 %c10, ptr addrspace(1) %p9, ptr addrspace(1) %q
+  br label %link11
+
+link9:
+  %c9 = icmp eq i32 %n, 9
+  %p9 = select i1 %c9, ptr addrspace(1) %p8, ptr addrspace(1) %q
+  br label %link10
+
+link8:
+  %c8 = icmp eq i32 %n, 8
+  %p8 = select i1 %c8, ptr addrspace(1) %p7, ptr addrspace(1) %q
+  br label %link9
+
+link7:
+  %c7 = icmp eq i32 %n, 7
+  %p7 = select i1 %c7, ptr addrspace(1) %p6, ptr addrspace(1) %q
+  br label %link8
+
+link6:
+  %c6 = icmp eq i32 %n, 6
+  %p6 = select i1 %c6, ptr addrspace(1) %p5, ptr addrspace(1) %q
+  br label %link7
+
+link5:
+  %c5 = icmp eq i32 %n, 5
+  %p5 = select i1 %c5, ptr addrspace(1) %p4, ptr addrspace(1) %q
+  br label %link6
+
+link4:
+  %c4 = icmp eq i32 %n, 4
+  %p4 = select i1 %c4, ptr addrspace(1) %p3, ptr addrspace(1) %q
+  br label %link5
+
+link3:
+  %c3 = icmp eq i32 %n, 3
+  %p3 = select i1 %c3, ptr addrspace(1) %p2, ptr addrspace(1) %q
+  br label %link4
+
+link2:
+  %c2 = icmp eq i32 %n, 2
+  %p2 = select i1 %c2, ptr addrspace(1) %p1, ptr addrspace(1) %q
+  br label %link3
+
+link1:
+  %c1 = icmp eq i32 %n, 1
+  %p1 = select i1 %c1, ptr addrspace(1) %p0, ptr addrspace(1) %q
+  br label %link2
+}
@@ -0,0 +1,256 @@
+//===-- llvm-spirv-client.cpp - Client of the llvm-spirv server -*- C++ -*-===//
+//
+//
+//                     The LLVM/SPIRV Translator
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+// Copyright (c) 2024 The Khronos Group Inc.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimers.
+// Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimers in the documentation
+// and/or other materials provided with the distribution.
+// Neither the names of The Khronos Group, nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// Software without specific prior written permission.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH
+// THE SOFTWARE.
+//
+//===----------------------------------------------------------------------===//
+/// \file
+///
+///  Example client of the llvm-spirv translation server.
+///
+///  Common Usage:
+///  llvm-spirv --serve x.sock &
+///  llvm-spirv-client x.sock x.bc -o x.spv    - Translate LLVM bitcode to
+///                                              SPIR-V
+///  llvm-spirv-client x.sock -r x.spv -o x.bc - Translate SPIR-V to LLVM
+///                                              bitcode
+///  llvm-spirv-client x.sock --shutdown       - Stop the server
+///  llvm-spirv-client x.sock x.bc -o x.spv --spawn-server=llvm-spirv
+///                                            - Start a server for this
+///                                              request only
+///
+///  The protocol is described in llvm-spirv.cpp.
+///
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/EndianStream.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Program.h"
+#include "llvm/Support/ToolOutputFile.h"
+#include "llvm/Support/raw_socket_stream.h"
+
+#include <chrono>
+#include <optional>
+#include <string>
+#include <thread>
+
+using namespace llvm;
+
+static cl::opt<std::string> SocketPath(cl::Positional, cl::Required,
+                                       cl::desc("<socket>"));
+
+static cl::opt<std::string> InputFile(cl::Positional, cl::desc("<input file>"),
+                                      cl::init("-"));
+
+static cl::opt<std::string> OutputFile("o",
+                                       cl::desc("Override output filename"),
+                                       cl::value_desc("filename"),
+                                       cl::init("-"));
+
+static cl::opt<bool>
+    IsReverse("r", cl::desc("Reverse translation (SPIR-V to LLVM)"));
+
+static cl::opt<std::string>
+    SPVExt("spirv-ext",
+           cl::desc("Allowed/disallowed extensions applied on top of the "
+                    "server options"),
+           cl::value_desc("+SPV_extenstion1_name,-SPV_extension2_name"));
+
+static cl::opt<bool> Shutdown("shutdown", cl::desc("Stop the server"));
+
+static cl::opt<unsigned> ConnectTimeout(
+    "connect-timeout", cl::init(10),
+    cl::desc("Keep retrying to connect to the server for the given number of "
+             "seconds"),
+    cl::value_desc("seconds"));
+
+static cl::opt<std::string> SpawnServer(
+    "spawn-server",
+    cl::desc("Start the given llvm-spirv executable as the server and stop it "
+             "once the request is done"),
+    cl::value_desc("llvm-spirv path"));
+
+static cl::list<std::string>
+    ServerArgs("server-arg",
+               cl::desc("Extra argument passed to the server started by "
+                        "--spawn-server"),
+               cl::value_desc("argument"));
+
+namespace {
+// Must be kept in sync with ServerRequestKind in llvm-spirv.cpp.
+enum ServerRequestKind : uint32_t {
+  SRK_LLVMToSPIRV = 0,
+  SRK_SPIRVToLLVM = 1,
+  SRK_Shutdown = 2
+};
+} // namespace
+
+static ExitOnError ExitOnErr;
+
+static bool readSocketBytes(raw_socket_stream &S, char *Ptr, size_t Size) {
+  while (Size) {
+    ssize_t Read = S.read(Ptr, Size);
+    if (Read <= 0)
+      return false;
+    Ptr += Read;
+    Size -= Read;
+  }
+  return true;
+}
+
+static bool readSocketUInt32(raw_socket_stream &S, uint32_t &Value) {
+  char Buf[sizeof(uint32_t)];
+  if (!readSocketBytes(S, Buf, sizeof(Buf)))
+    return false;
+  Value = support::endian::read32le(Buf);
+  return true;
+}
+
+// The server may still be starting up, so retry for a while.
+static Expected<std::unique_ptr<raw_socket_stream>> connect() {
+  auto Deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(ConnectTimeout);
+  for (;;) {
+    Expected<std::unique_ptr<raw_socket_stream>> S =
+        raw_socket_stream::createConnectedUnix(SocketPath);
+    if (S || std::chrono::steady_clock::now() >= Deadline)
+      return S;
+    consumeError(S.takeError());
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  }
+}
+
+// Sends a single request and reads the response of the server. Returns false
+// if the server could not be reached.
+static bool sendRequest(uint32_t Kind, StringRef Options, StringRef Payload,
+                        uint32_t &Status, std::string &Response) {
+  Expected<std::unique_ptr<raw_socket_stream>> S = connect();
+  if (!S) {
+    errs() << "Fails to connect to the server: " << toString(S.takeError())
+           << '\n';
+    return false;
+  }
+  support::endian::Writer W(**S, llvm::endianness::little);
+  W.write<uint32_t>(Kind);
+  W.write<uint32_t>(Options.size());
+  **S << Options;
+  W.write<uint32_t>(Payload.size());
+  **S << Payload;
+  (*S)->flush();
+  // The server may reject a request before reading all of it, the response
+  // still explains why.
+  if ((*S)->has_error())
+    (*S)->clear_error();
+
+  uint32_t Size = 0;
+  if (!readSocketUInt32(**S, Status) || !readSocketUInt32(**S, Size)) {
+    errs() << "Connection to the server was closed unexpectedly\n";
+    return false;
+  }
+  Response.resize(Size);
+  if (!readSocketBytes(**S, Response.data(), Size)) {
+    errs() << "Connection to the server was closed unexpectedly\n";
+    return false;
+  }
+  return true;
+}
+
+// Stops a server started by --spawn-server. The server is killed if it does
+// not exit on its own after the shutdown request.
+static void stopServer(const sys::ProcessInfo &Server, bool WasShutdown) {
+  uint32_t Status = 0;
+  std::string Response;
+  if (!WasShutdown)
+    sendRequest(SRK_Shutdown, "", "", Status, Response);
+  sys::Wait(Server, /*SecondsToWait=*/ConnectTimeout);
+}
+
+int main(int Ac, char **Av) {
+  InitLLVM X(Ac, Av);
+  ExitOnErr.setBanner(std::string(Av[0]) + ": ");
+
+  cl::ParseCommandLineOptions(Ac, Av, "LLVM/SPIR-V translation client");
+
+  std::string Payload;
+  uint32_t Kind = SRK_Shutdown;
+  if (!Shutdown) {
+    std::unique_ptr<MemoryBuffer> MB =
+        ExitOnErr(errorOrToExpected(MemoryBuffer::getFileOrSTDIN(InputFile)));
+    Payload = MB->getBuffer().str();
+    Kind = IsReverse ? SRK_SPIRVToLLVM : SRK_LLVMToSPIRV;
+  }
+
+  std::optional<sys::ProcessInfo> Server;
+  if (!SpawnServer.empty()) {
+    sys::fs::remove(SocketPath);
+    SmallVector<StringRef, 8> Args = {SpawnServer, "--serve", SocketPath};
+    Args.append(ServerArgs.begin(), ServerArgs.end());
+    std::string ErrMsg;
+    bool ExecutionFailed = false;
+    Server = sys::ExecuteNoWait(SpawnServer, Args, std::nullopt, {}, 0,
+                                &ErrMsg, &ExecutionFailed);
+    if (ExecutionFailed) {
+      errs() << "Fails to start the server: " << ErrMsg << '\n';
+      return 1;
+    }
+  }
+
+  uint32_t Status = 0;
+  std::string Response;
+  bool Connected = sendRequest(Kind, SPVExt, Payload, Status, Response);
+  if (Server)
+    stopServer(*Server, Connected && Shutdown);
+  if (!Connected)
+    return 1;
+
+  if (Status != 0) {
+    errs() << "Translation failed: " << Response << '\n';
+    return 1;
+  }
+  if (Shutdown)
+    return 0;
+
+  std::error_code EC;
+  ToolOutputFile Out(OutputFile, EC, sys::fs::OF_None);
+  if (EC) {
+    errs() << "Fails to open output file: " << EC.message() << '\n';
+    return 1;
+  }
+  Out.os() << Response;
+  Out.keep();
+  return 0;
+}
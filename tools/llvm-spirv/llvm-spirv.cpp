@@ -39,6 +39,23 @@
 ///  llvm-spirv -r       - Read SPIR-V from stdin, write LLVM bitcode to stdout
 ///  llvm-spirv -r x.bil - Read SPIR-V from the x.bil file, write SPIR-V to
 ///                        the x.bc file
+///  llvm-spirv --batch list.txt -j N
+///                      - Translate every file listed in list.txt using N
+///                        threads
+///
+///  llvm-spirv --link a.spv b.spv -o ab.spv
+///                      - Link SPIR-V binaries a.spv and b.spv into ab.spv
+///
+///  llvm-spirv --spec-const-patch --spec-const "1:i32:8" x.spv -o y.spv
+///                      - Specialize the specialization constants of x.spv
+///                        without translating it to LLVM IR
+///
+///  llvm-spirv --strip=names,debug x.spv -o y.spv
+///                      - Remove names and debug information from x.spv
+///
+///  llvm-spirv --serve x.sock
+///                      - Serve translation requests received over the x.sock
+///                        UNIX domain socket, see llvm-spirv-client
 ///
 ///  Options:
 ///      --help   - Output command line options
@@ -53,12 +70,18 @@
 #include "llvm/IR/Verifier.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/EndianStream.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/Signals.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/ToolOutputFile.h"
+#include "llvm/Support/raw_socket_stream.h"
 
 #ifdef LLVM_SPIRV_HAVE_SPIRV_TOOLS
 #include "spirv-tools/libspirv.hpp"
@@ -70,6 +93,7 @@
 
 #include "LLVMSPIRVLib.h"
 
+#include <csignal>
 #include <fstream>
 #include <iostream>
 #include <map>
@@ -91,6 +115,9 @@ using namespace llvm;
 static cl::opt<std::string> InputFile(cl::Positional, cl::desc("<input file>"),
                                       cl::init("-"));
 
+static cl::list<std::string>
+    LinkInputFiles(cl::Positional, cl::desc("<more input files for --link>"));
+
 static cl::opt<std::string> OutputFile("o",
                                        cl::desc("Override output filename"),
                                        cl::value_desc("filename"));
@@ -98,6 +125,52 @@ static cl::opt<std::string> OutputFile("o",
 static cl::opt<bool>
     IsReverse("r", cl::desc("Reverse translation (SPIR-V to LLVM)"));
 
+static cl::opt<bool>
+    Link("link", cl::desc("Link the SPIR-V binaries given as input files into "
+                          "one module without translating them to LLVM IR"));
+
+static cl::bits<SPIRV::StripKind> Strip(
+    "strip", cl::CommaSeparated,
+    cl::desc("Remove the given parts of the SPIR-V input without translating "
+             "it to LLVM IR"),
+    cl::values(clEnumValN(SPIRV::StripKind::Names, "names",
+                          "OpName and OpMemberName"),
+               clEnumValN(SPIRV::StripKind::Debug, "debug",
+                          "Line, string, source text and debug info "
+                          "instructions"),
+               clEnumValN(SPIRV::StripKind::AuxData, "auxdata",
+                          "NonSemantic.AuxData instructions")));
+
+static cl::opt<std::string> BatchFile(
+    "batch",
+    cl::desc("Translate all modules listed in the given file, one job per "
+             "line in the form \"<input> [<output>]\""),
+    cl::value_desc("filename"));
+
+static cl::opt<std::string> ServeSocket(
+    "serve",
+    cl::desc("Serve translation requests received over the given UNIX "
+             "domain socket until a client asks the server to stop"),
+    cl::value_desc("socket path"));
+
+static cl::opt<unsigned> ServeIdleTimeout(
+    "serve-idle-timeout", cl::init(0),
+    cl::desc("Stop serving after the given number of seconds without new "
+             "connections (0 means never)"),
+    cl::value_desc("seconds"));
+
+static cl::opt<unsigned> ServeMaxRequest(
+    "serve-max-request", cl::init(256u << 20),
+    cl::desc("Reject requests whose options and payload take more than the "
+             "given number of bytes"),
+    cl::value_desc("bytes"));
+
+static cl::opt<unsigned>
+    BatchJobs("j", cl::init(0),
+              cl::desc("Number of threads used by --batch (0 means one per "
+                       "hardware thread)"),
+              cl::value_desc("N"));
+
 static cl::opt<bool>
     IsRegularization("s",
                      cl::desc("Regularize LLVM to be representable by SPIR-V"));
@@ -197,10 +270,63 @@ static cl::opt<std::string> SpecConst(
              "Supported types are: i1, i8, i16, i32, i64, f16, f32, f64.\n"),
     cl::value_desc("id1:type1:value1 id2:type2:value2 ..."));
 
+static cl::opt<bool> SpecConstPatch(
+    "spec-const-patch",
+    cl::desc("Specialize the specialization constants of the SPIR-V input "
+             "with the values of -spec-const and write the specialized SPIR-V "
+             "binary without translating it to LLVM IR"));
+
+static cl::opt<bool> SpecConstFold(
+    "spec-const-fold",
+    cl::desc("Evaluate integer and boolean OpSpecConstantOp instructions "
+             "with -spec-const-patch"));
+
 static cl::opt<bool>
     SPIRVMemToReg("spirv-mem2reg", cl::init(false),
                   cl::desc("LLVM/SPIR-V translation enable mem2reg"));
 
+static cl::opt<bool> SPIRVFusedLowering(
+    "spirv-fused-lowering", cl::init(false),
+    cl::desc("Lower bool operations, memmoves and emulated LLVM intrinsics "
+             "in a single traversal of the module"));
+
+static cl::opt<std::string> SPIRVCacheDir(
+    "spirv-cache-dir",
+    cl::desc("Reuse translation results stored in the given directory and "
+             "store new ones there"),
+    cl::value_desc("directory"));
+
+static cl::opt<uint64_t> SPIRVCacheMaxSize(
+    "spirv-cache-max-size", cl::init(0),
+    cl::desc("Prune the translation cache to stay within the given size in "
+             "bytes (0 means no limit)"),
+    cl::value_desc("bytes"));
+
+static cl::opt<bool> SPIRVCacheStats(
+    "spirv-cache-stats", cl::init(false),
+    cl::desc("Print translation cache hit/miss statistics"));
+
+enum class TimeReportFormat { None, Text, JSON };
+
+static cl::opt<TimeReportFormat> SPIRVTimeReport(
+    "spirv-time-report", cl::ValueOptional,
+    cl::init(TimeReportFormat::None),
+    cl::desc("Print the wall time of the translation phases and translation "
+             "counters to stderr"),
+    cl::values(clEnumValN(TimeReportFormat::Text, "text",
+                          "Human-readable report (default)"),
+               clEnumValN(TimeReportFormat::JSON, "json", "JSON report"),
+               clEnumValN(TimeReportFormat::Text, "", "")));
+
+static SPIRV::TranslationTimeReport TimeReport;
+
+static cl::opt<bool> SPIRVMemReport(
+    "spirv-mem-report", cl::init(false),
+    cl::desc("Print the memory footprint of the in-memory SPIR-V module by "
+             "category and by opcode to stderr"));
+
+static SPIRV::SPIRVMemoryReport MemoryReport;
+
 static cl::opt<bool> SPIRVPreserveAuxData(
     "spirv-preserve-auxdata", cl::init(false),
     cl::desc("Preserve all auxiliary data, such as function attributes and metadata"));
@@ -287,6 +413,39 @@ static std::string removeExt(const std::string &FileName) {
 
 static ExitOnError ExitOnErr;
 
+static std::unique_ptr<SPIRV::TranslationCache> TransCache;
+
+// Returns an empty key if the translation cache is disabled.
+static std::string getCacheKey(StringRef Input,
+                               const SPIRV::TranslatorOpts &Opts,
+                               bool IsReverse) {
+  if (!TransCache)
+    return std::string();
+  return TransCache->getKey(Input, Opts, IsReverse);
+}
+
+static bool lookupCache(const std::string &Key, std::string &Result) {
+  return !Key.empty() && TransCache->lookup(Key, Result);
+}
+
+static void storeCache(const std::string &Key, StringRef Result) {
+  if (!Key.empty())
+    TransCache->store(Key, Result);
+}
+
+static bool writeOutputFile(const std::string &FileName, StringRef Data,
+                            std::string &Err) {
+  std::error_code EC;
+  ToolOutputFile Out(FileName, EC, sys::fs::OF_None);
+  if (EC) {
+    Err = "Fails to open output file: " + EC.message();
+    return false;
+  }
+  Out.os() << Data;
+  Out.keep();
+  return true;
+}
+
 #ifdef LLVM_SPIRV_HAVE_SPIRV_TOOLS
 /// Stream buffer that captures written data into a vector and allows reading
 /// the data back as an array of uint32_t's.
@@ -316,10 +475,6 @@ static int convertLLVMToSPIRV(const SPIRV::TranslatorOpts &Opts) {
 
   std::unique_ptr<MemoryBuffer> MB =
       ExitOnErr(errorOrToExpected(MemoryBuffer::getFileOrSTDIN(InputFile)));
-  std::unique_ptr<Module> M =
-      ExitOnErr(getOwningLazyBitcodeModule(std::move(MB), Context,
-                                           /*ShouldLazyLoadMetadata=*/true));
-  ExitOnErr(M->materializeAll());
 
   if (OutputFile.empty()) {
     if (InputFile == "-")
@@ -330,6 +485,25 @@ static int convertLLVMToSPIRV(const SPIRV::TranslatorOpts &Opts) {
           (SPIRV::SPIRVUseTextFormat ? kExt::SpirvText : kExt::SpirvBinary);
   }
 
+  std::string CacheKey;
+  if (!SPIRVToolsDis) {
+    CacheKey = getCacheKey(MB->getBuffer(), Opts, /*IsReverse=*/false);
+    std::string Cached;
+    if (lookupCache(CacheKey, Cached)) {
+      std::string Err;
+      if (!writeOutputFile(OutputFile, Cached, Err)) {
+        errs() << Err << '\n';
+        return -1;
+      }
+      return 0;
+    }
+  }
+
+  std::unique_ptr<Module> M =
+      ExitOnErr(getOwningLazyBitcodeModule(std::move(MB), Context,
+                                           /*ShouldLazyLoadMetadata=*/true));
+  ExitOnErr(M->materializeAll());
+
   if (SPIRVToolsDis) {
 #ifdef LLVM_SPIRV_HAVE_SPIRV_TOOLS
     auto DisMessagePrinter = [](spv_message_level_t Level, const char *source,
@@ -374,7 +548,18 @@ static int convertLLVMToSPIRV(const SPIRV::TranslatorOpts &Opts) {
 
   std::string Err;
   bool Success = false;
-  if (OutputFile != "-") {
+  if (!CacheKey.empty()) {
+    std::ostringstream OS;
+    Success = writeSpirv(M.get(), Opts, OS, Err);
+    if (Success) {
+      const std::string Result = OS.str();
+      storeCache(CacheKey, Result);
+      if (!writeOutputFile(OutputFile, Result, Err)) {
+        errs() << Err << '\n';
+        return -1;
+      }
+    }
+  } else if (OutputFile != "-") {
     std::ofstream OutFile(OutputFile, std::ios::binary);
     Success = writeSpirv(M.get(), Opts, OutFile, Err);
   } else {
@@ -395,10 +580,33 @@ static bool isFileEmpty(const std::string &FileName) {
 
 static int convertSPIRVToLLVM(const SPIRV::TranslatorOpts &Opts) {
   LLVMContext Context;
-  
+
+  if (OutputFile.empty()) {
+    if (InputFile == "-")
+      OutputFile = "-";
+    else
+      OutputFile = removeExt(InputFile) + kExt::LLVMBinary;
+  }
+
+  std::string Err;
+  std::string CacheKey;
+  if (TransCache) {
+    ErrorOr<std::unique_ptr<MemoryBuffer>> MB =
+        MemoryBuffer::getFile(InputFile);
+    if (MB)
+      CacheKey = getCacheKey((*MB)->getBuffer(), Opts, /*IsReverse=*/true);
+    std::string Cached;
+    if (lookupCache(CacheKey, Cached)) {
+      if (!writeOutputFile(OutputFile, Cached, Err)) {
+        errs() << Err << '\n';
+        return -1;
+      }
+      return 0;
+    }
+  }
+
   std::ifstream IFS(InputFile, std::ios::binary);
   Module *M;
-  std::string Err;
 
   if (!readSpirv(Context, Opts, IFS, M, Err)) {
     errs() << "Fails to load SPIR-V as LLVM Module: " << Err << '\n';
@@ -413,11 +621,18 @@ static int convertSPIRVToLLVM(const SPIRV::TranslatorOpts &Opts) {
     return -1;
   }
 
-  if (OutputFile.empty()) {
-    if (InputFile == "-")
-      OutputFile = "-";
-    else
-      OutputFile = removeExt(InputFile) + kExt::LLVMBinary;
+  if (!CacheKey.empty()) {
+    SmallVector<char, 0> Buffer;
+    raw_svector_ostream OS(Buffer);
+    WriteBitcodeToFile(*M, OS);
+    delete M;
+    StringRef Result(Buffer.data(), Buffer.size());
+    storeCache(CacheKey, Result);
+    if (!writeOutputFile(OutputFile, Result, Err)) {
+      errs() << Err << '\n';
+      return -1;
+    }
+    return 0;
   }
 
   std::error_code EC;
@@ -509,9 +724,71 @@ static int regularizeLLVM(SPIRV::TranslatorOpts &Opts) {
   return 0;
 }
 
-static int parseSPVExtOption(
-    SPIRV::TranslatorOpts::ExtensionsStatusMap &ExtensionsStatus) {
-  // Map name -> id for known extensions
+// Translates LLVM bitcode held in memory to SPIR-V. Used by the batch and
+// server modes, where every translation gets its own LLVMContext.
+static bool translateLLVMToSPIRVBuffer(StringRef Input,
+                                       const SPIRV::TranslatorOpts &Opts,
+                                       std::string &Result, std::string &Err) {
+  std::string CacheKey = getCacheKey(Input, Opts, /*IsReverse=*/false);
+  if (lookupCache(CacheKey, Result))
+    return true;
+
+  LLVMContext Context;
+  Expected<std::unique_ptr<Module>> M = getOwningLazyBitcodeModule(
+      MemoryBuffer::getMemBuffer(Input, "", /*RequiresNullTerminator=*/false),
+      Context, /*ShouldLazyLoadMetadata=*/true);
+  if (!M) {
+    Err = toString(M.takeError());
+    return false;
+  }
+  if (Error E = (*M)->materializeAll()) {
+    Err = toString(std::move(E));
+    return false;
+  }
+
+  std::ostringstream OS;
+  if (!writeSpirv(M->get(), Opts, OS, Err)) {
+    Err = "Fails to save LLVM as SPIR-V: " + Err;
+    return false;
+  }
+  Result = OS.str();
+  storeCache(CacheKey, Result);
+  return true;
+}
+
+// Translates SPIR-V held in memory to LLVM bitcode.
+static bool translateSPIRVToLLVMBuffer(StringRef Input,
+                                       const SPIRV::TranslatorOpts &Opts,
+                                       std::string &Result, std::string &Err) {
+  std::string CacheKey = getCacheKey(Input, Opts, /*IsReverse=*/true);
+  if (lookupCache(CacheKey, Result))
+    return true;
+
+  LLVMContext Context;
+  std::istringstream IS(Input.str());
+  Module *RawM = nullptr;
+  if (!readSpirv(Context, Opts, IS, RawM, Err)) {
+    Err = "Fails to load SPIR-V as LLVM Module: " + Err;
+    return false;
+  }
+  std::unique_ptr<Module> M(RawM);
+
+  raw_string_ostream ErrorOS(Err);
+  if (verifyModule(*M, &ErrorOS)) {
+    Err = "Fails to verify module: " + ErrorOS.str();
+    return false;
+  }
+
+  Result.clear();
+  raw_string_ostream OS(Result);
+  WriteBitcodeToFile(*M, OS);
+  OS.flush();
+  storeCache(CacheKey, Result);
+  return true;
+}
+
+// Map name -> id for known extensions
+static std::map<std::string, ExtensionID> getExtensionNamesMap() {
   std::map<std::string, ExtensionID> ExtensionNamesMap;
 #define _STRINGIFY(X) #X
 #define STRINGIFY(X) _STRINGIFY(X)
@@ -520,6 +797,148 @@ static int parseSPVExtOption(
 #undef EXT
 #undef STRINGIFY
 #undef _STRINGIFY
+  return ExtensionNamesMap;
+}
+
+namespace {
+/// A single translation requested via --batch.
+struct BatchJob {
+  std::string Input;
+  std::string Output;
+  bool IsReverse = false;
+};
+} // namespace
+
+static bool runBatchJob(const BatchJob &Job, SPIRV::TranslatorOpts Opts,
+                        std::string &Err) {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> MB = MemoryBuffer::getFile(Job.Input);
+  if (!MB) {
+    Err = "Fails to open input file: " + MB.getError().message();
+    return false;
+  }
+  StringRef Input = (*MB)->getBuffer();
+  std::string Result;
+  bool Success = false;
+  if (Job.IsReverse) {
+#ifdef _SPIRV_SUPPORT_TEXT_FMT
+    // Every job reads SPIR-V in the format it is actually stored in.
+    Opts.setUseTextFormat(!SPIRV::isSpirvBinary(Input.str()));
+#endif
+    Success = translateSPIRVToLLVMBuffer(Input, Opts, Result, Err);
+  } else {
+#ifdef _SPIRV_SUPPORT_TEXT_FMT
+    // The output file extension selects the format of the produced SPIR-V.
+    StringRef Ext = sys::path::extension(Job.Output);
+    if (Ext == kExt::SpirvText)
+      Opts.setUseTextFormat(true);
+    else if (Ext == kExt::SpirvBinary)
+      Opts.setUseTextFormat(false);
+#endif
+    Success = translateLLVMToSPIRVBuffer(Input, Opts, Result, Err);
+  }
+  return Success && writeOutputFile(Job.Output, Result, Err);
+}
+
+static bool parseBatchFile(std::vector<BatchJob> &Jobs) {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> MB = MemoryBuffer::getFile(BatchFile);
+  if (!MB) {
+    errs() << "Fails to open batch file: " << MB.getError().message() << '\n';
+    return false;
+  }
+
+  SmallVector<StringRef, 64> Lines;
+  (*MB)->getBuffer().split(Lines, '\n', -1, false);
+  for (StringRef Line : Lines) {
+    Line = Line.trim();
+    if (Line.empty() || Line.starts_with("#"))
+      continue;
+    SmallVector<StringRef, 3> Fields;
+    Line.split(Fields, ' ', -1, false);
+    BatchJob Job;
+    Job.IsReverse = IsReverse;
+    if (Fields.front() == "-r") {
+      Job.IsReverse = true;
+      Fields.erase(Fields.begin());
+    }
+    if (Fields.empty() || Fields.size() > 2) {
+      errs() << "Invalid line in batch file: \"" << Line
+             << "\". Expected format: [-r] <input> [<output>]\n";
+      return false;
+    }
+    Job.Input = Fields[0].str();
+    if (Fields.size() == 2)
+      Job.Output = Fields[1].str();
+    else if (Job.IsReverse)
+      Job.Output = removeExt(Job.Input) + kExt::LLVMBinary;
+    else
+      Job.Output =
+          removeExt(Job.Input) +
+          (SPIRV::SPIRVUseTextFormat ? kExt::SpirvText : kExt::SpirvBinary);
+    Jobs.push_back(std::move(Job));
+  }
+  return true;
+}
+
+// Returns the options for consuming SPIR-V in a run that may also generate
+// it, i.e. for the -r jobs of a batch and the reverse requests of the server.
+// As in parseSPVExtOption for -r, every extension that --spirv-ext left unset
+// is allowed, while the ones it disallowed stay disallowed.
+static SPIRV::TranslatorOpts getReverseOpts(
+    const SPIRV::TranslatorOpts &Opts,
+    const SPIRV::TranslatorOpts::ExtensionsStatusMap &ExtensionsStatus) {
+  SPIRV::TranslatorOpts ReverseOpts = Opts;
+  for (const auto &[Ext, Status] : ExtensionsStatus)
+    if (!Status)
+      ReverseOpts.setAllowedToUseExtension(Ext);
+  return ReverseOpts;
+}
+
+// Translates every module listed in the batch file. Each job owns its
+// LLVMContext, so jobs are independent and may run concurrently. Errors are
+// reported per job once all of them have finished.
+static int
+runBatch(const SPIRV::TranslatorOpts &Opts,
+         const SPIRV::TranslatorOpts::ExtensionsStatusMap &ExtensionsStatus) {
+  std::vector<BatchJob> Jobs;
+  if (!parseBatchFile(Jobs))
+    return -1;
+
+  const SPIRV::TranslatorOpts ReverseOpts =
+      getReverseOpts(Opts, ExtensionsStatus);
+
+  std::vector<std::string> Errors(Jobs.size());
+  std::vector<char> Failed(Jobs.size(), false);
+  {
+    DefaultThreadPool Pool(hardware_concurrency(BatchJobs));
+    for (size_t I = 0, E = Jobs.size(); I != E; ++I) {
+      Pool.async([&, I] {
+        const BatchJob &Job = Jobs[I];
+        if (isFileEmpty(Job.Input)) {
+          Errors[I] = "Can't translate, file is empty";
+          Failed[I] = true;
+          return;
+        }
+        Failed[I] =
+            !runBatchJob(Job, Job.IsReverse ? ReverseOpts : Opts, Errors[I]);
+      });
+    }
+    Pool.wait();
+  }
+
+  int Ret = 0;
+  for (size_t I = 0, E = Jobs.size(); I != E; ++I) {
+    if (!Failed[I])
+      continue;
+    errs() << Jobs[I].Input << ": " << Errors[I] << '\n';
+    Ret = -1;
+  }
+  return Ret;
+}
+
+static int parseSPVExtOption(
+    SPIRV::TranslatorOpts::ExtensionsStatusMap &ExtensionsStatus) {
+  const std::map<std::string, ExtensionID> ExtensionNamesMap =
+      getExtensionNamesMap();
 
   // Set the initial state:
   //  - during SPIR-V consumption, assume that any known extension is allowed.
@@ -573,6 +992,189 @@ static int parseSPVExtOption(
   return 0;
 }
 
+// Server protocol used by --serve. All integers are 32-bit little-endian.
+//   Request:  <kind> <options size> <options> <payload size> <payload>
+//     kind 0 translates LLVM bitcode to SPIR-V, kind 1 translates SPIR-V to
+//     LLVM bitcode and kind 2 stops the server.
+//     options is a comma separated list in the --spirv-ext format applied on
+//     top of the options the server was started with. It may be empty.
+//   Response: <status> <size> <data>
+//     status is 0 on success and data holds the translation result.
+//     Otherwise data holds an error message.
+// A connection may carry any number of requests. A request larger than
+// --serve-max-request gets an error response and its connection is closed.
+// See llvm-spirv-client for an example client.
+namespace {
+enum ServerRequestKind : uint32_t {
+  SRK_LLVMToSPIRV = 0,
+  SRK_SPIRVToLLVM = 1,
+  SRK_Shutdown = 2
+};
+} // namespace
+
+static bool readSocketBytes(raw_socket_stream &S, char *Ptr, size_t Size) {
+  while (Size) {
+    ssize_t Read = S.read(Ptr, Size);
+    if (Read <= 0)
+      return false;
+    Ptr += Read;
+    Size -= Read;
+  }
+  return true;
+}
+
+static bool readSocketUInt32(raw_socket_stream &S, uint32_t &Value) {
+  char Buf[sizeof(uint32_t)];
+  if (!readSocketBytes(S, Buf, sizeof(Buf)))
+    return false;
+  Value = support::endian::read32le(Buf);
+  return true;
+}
+
+// Reads a length-prefixed string of at most MaxSize bytes. A longer string is
+// left unread and reported through TooLarge.
+static bool readSocketString(raw_socket_stream &S, std::string &Str,
+                             size_t MaxSize, bool &TooLarge) {
+  uint32_t Size = 0;
+  if (!readSocketUInt32(S, Size))
+    return false;
+  TooLarge = Size > MaxSize;
+  if (TooLarge)
+    return true;
+  Str.resize(Size);
+  return readSocketBytes(S, Str.data(), Size);
+}
+
+static bool writeServerResponse(raw_socket_stream &S, bool Success,
+                                StringRef Data) {
+  support::endian::Writer W(S, llvm::endianness::little);
+  W.write<uint32_t>(Success ? 0 : 1);
+  W.write<uint32_t>(Data.size());
+  S << Data;
+  S.flush();
+  if (S.has_error()) {
+    S.clear_error();
+    return false;
+  }
+  return true;
+}
+
+static bool applyRequestExtensions(
+    StringRef Extensions,
+    const std::map<std::string, ExtensionID> &ExtensionNamesMap,
+    SPIRV::TranslatorOpts &Opts, std::string &Err) {
+  SmallVector<StringRef, 8> List;
+  Extensions.split(List, ',', -1, false);
+  for (StringRef Ext : List) {
+    bool Allow = Ext.consume_front("+");
+    if (!Allow && !Ext.consume_front("-")) {
+      Err = "Invalid extension list, expected format is +EXT_NAME,-EXT_NAME";
+      return false;
+    }
+    if (Ext == "all") {
+      for (const auto &It : ExtensionNamesMap)
+        Opts.setAllowedToUseExtension(It.second, Allow);
+      continue;
+    }
+    auto It = ExtensionNamesMap.find(Ext.str());
+    if (It == ExtensionNamesMap.end()) {
+      Err = "Unknown extension '" + Ext.str() + "'";
+      return false;
+    }
+    Opts.setAllowedToUseExtension(It->second, Allow);
+  }
+  return true;
+}
+
+// Serves requests of a single connection until the client disconnects.
+// Returns true if the client asked the server to stop.
+static bool serveConnection(
+    raw_socket_stream &S, const SPIRV::TranslatorOpts &ForwardOpts,
+    const SPIRV::TranslatorOpts &ReverseOpts,
+    const std::map<std::string, ExtensionID> &ExtensionNamesMap) {
+  for (;;) {
+    uint32_t Kind = 0;
+    std::string Extensions, Payload;
+    bool TooLarge = false;
+    if (!readSocketUInt32(S, Kind) ||
+        !readSocketString(S, Extensions, ServeMaxRequest, TooLarge))
+      return false;
+    if (!TooLarge && !readSocketString(S, Payload,
+                                       ServeMaxRequest - Extensions.size(),
+                                       TooLarge))
+      return false;
+    if (TooLarge) {
+      // The rest of the request is left unread, so the connection cannot be
+      // used for further requests.
+      writeServerResponse(S, false,
+                          "Request exceeds the --serve-max-request limit of " +
+                              std::to_string(ServeMaxRequest) + " bytes");
+      return false;
+    }
+
+    if (Kind == SRK_Shutdown) {
+      writeServerResponse(S, true, "");
+      return true;
+    }
+    if (Kind != SRK_LLVMToSPIRV && Kind != SRK_SPIRVToLLVM) {
+      if (!writeServerResponse(S, false, "Unknown request kind"))
+        return false;
+      continue;
+    }
+
+    SPIRV::TranslatorOpts Opts =
+        Kind == SRK_SPIRVToLLVM ? ReverseOpts : ForwardOpts;
+    std::string Result, Err;
+    bool Success =
+        applyRequestExtensions(Extensions, ExtensionNamesMap, Opts, Err) &&
+        (Kind == SRK_SPIRVToLLVM
+             ? translateSPIRVToLLVMBuffer(Payload, Opts, Result, Err)
+             : translateLLVMToSPIRVBuffer(Payload, Opts, Result, Err));
+    if (!writeServerResponse(S, Success, Success ? Result : Err))
+      return false;
+  }
+}
+
+// Keeps the translator warm and serves translation requests received over a
+// UNIX domain socket, one connection at a time.
+static int
+runServer(const SPIRV::TranslatorOpts &Opts,
+          const SPIRV::TranslatorOpts::ExtensionsStatusMap &ExtensionsStatus) {
+#ifndef _WIN32
+  // A client closing its connection early must not terminate the server.
+  signal(SIGPIPE, SIG_IGN);
+#endif
+
+  const std::map<std::string, ExtensionID> ExtensionNamesMap =
+      getExtensionNamesMap();
+  const SPIRV::TranslatorOpts ReverseOpts =
+      getReverseOpts(Opts, ExtensionsStatus);
+
+  Expected<ListeningSocket> Server = ListeningSocket::createUnix(ServeSocket);
+  if (!Server) {
+    errs() << "Fails to listen on socket: " << toString(Server.takeError())
+           << '\n';
+    return -1;
+  }
+
+  std::chrono::milliseconds Timeout(-1);
+  if (ServeIdleTimeout)
+    Timeout = std::chrono::seconds(ServeIdleTimeout);
+  for (;;) {
+    Expected<std::unique_ptr<raw_socket_stream>> Conn =
+        Server->accept(Timeout);
+    if (!Conn) {
+      std::error_code EC = errorToErrorCode(Conn.takeError());
+      if (EC == std::errc::timed_out)
+        return 0;
+      errs() << "Fails to accept connection: " << EC.message() << '\n';
+      return -1;
+    }
+    if (serveConnection(**Conn, Opts, ReverseOpts, ExtensionNamesMap))
+      return 0;
+  }
+}
+
 // Returns true on error.
 bool parseSpecConstOpt(llvm::StringRef SpecConstStr,
                        SPIRV::TranslatorOpts &Opts) {
@@ -692,6 +1294,21 @@ bool parseSpecConstOpt(llvm::StringRef SpecConstStr,
   return false;
 }
 
+static void printStatistics() {
+  if (SPIRVTimeReport == TimeReportFormat::Text)
+    TimeReport.print(errs());
+  else if (SPIRVTimeReport == TimeReportFormat::JSON)
+    TimeReport.printJSON(errs());
+  if (SPIRVMemReport)
+    MemoryReport.print(errs());
+
+  if (!SPIRVCacheStats || !TransCache)
+    return;
+  SPIRV::TranslationCache::Statistics Stats = TransCache->getStatistics();
+  errs() << "Translation cache: " << Stats.Hits << " hits, " << Stats.Misses
+         << " misses, " << Stats.Stores << " stores\n";
+}
+
 static void parseAllowUnknownIntrinsicsOpt(SPIRV::TranslatorOpts &Opts) {
   SPIRV::TranslatorOpts::ArgList PrefixList;
   for (const auto &Prefix : SPIRVAllowUnknownIntrinsics) {
@@ -700,6 +1317,89 @@ static void parseAllowUnknownIntrinsicsOpt(SPIRV::TranslatorOpts &Opts) {
   Opts.setSPIRVAllowUnknownIntrinsics(PrefixList);
 }
 
+static int linkSPIRV() {
+  std::vector<std::string> Inputs;
+  std::vector<std::string> Files = {InputFile};
+  Files.insert(Files.end(), LinkInputFiles.begin(), LinkInputFiles.end());
+  for (const std::string &File : Files) {
+    ErrorOr<std::unique_ptr<MemoryBuffer>> MB =
+        MemoryBuffer::getFileOrSTDIN(File);
+    if (!MB) {
+      errs() << "Fails to open input file " << File << ": "
+             << MB.getError().message() << '\n';
+      return -1;
+    }
+    Inputs.push_back((*MB)->getBuffer().str());
+  }
+
+  if (OutputFile.empty())
+    OutputFile = "-";
+
+  std::string Out;
+  std::string Err;
+  if (!SPIRV::linkSpirv(Inputs, Out, Err)) {
+    errs() << "Fails to link SPIR-V: " << Err << '\n';
+    return -1;
+  }
+  if (!writeOutputFile(OutputFile, Out, Err)) {
+    errs() << Err << '\n';
+    return -1;
+  }
+  return 0;
+}
+
+static int patchSpecConstants(const SPIRV::TranslatorOpts &Opts) {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> MB =
+      MemoryBuffer::getFileOrSTDIN(InputFile);
+  if (!MB) {
+    errs() << "Fails to open input file " << InputFile << ": "
+           << MB.getError().message() << '\n';
+    return -1;
+  }
+
+  if (OutputFile.empty())
+    OutputFile = "-";
+
+  std::string Out;
+  std::string Err;
+  if (!SPIRV::specializeSpirv((*MB)->getBuffer().str(), Opts, SpecConstFold,
+                              Out, Err)) {
+    errs() << "Fails to specialize SPIR-V: " << Err << '\n';
+    return -1;
+  }
+  if (!writeOutputFile(OutputFile, Out, Err)) {
+    errs() << Err << '\n';
+    return -1;
+  }
+  return 0;
+}
+
+static int stripSPIRV() {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> MB =
+      MemoryBuffer::getFileOrSTDIN(InputFile);
+  if (!MB) {
+    errs() << "Fails to open input file " << InputFile << ": "
+           << MB.getError().message() << '\n';
+    return -1;
+  }
+
+  if (OutputFile.empty())
+    OutputFile = "-";
+
+  std::string Out;
+  std::string Err;
+  if (!SPIRV::stripSpirv((*MB)->getBuffer().str(), Strip.getBits(), Out,
+                         Err)) {
+    errs() << "Fails to strip SPIR-V: " << Err << '\n';
+    return -1;
+  }
+  if (!writeOutputFile(OutputFile, Out, Err)) {
+    errs() << Err << '\n';
+    return -1;
+  }
+  return 0;
+}
+
 int main(int Ac, char **Av) {
   EnablePrettyStackTrace();
   sys::PrintStackTraceOnErrorSignal(Av[0]);
@@ -712,6 +1412,10 @@ int main(int Ac, char **Av) {
     return -1;
   }
 
+  // The server translates in both directions, so it keeps the options that
+  // only affect one of them.
+  const bool IsServe = !ServeSocket.empty();
+
   SPIRV::TranslatorOpts::ExtensionsStatusMap ExtensionsStatus;
   // ExtensionsStatus will be properly initialized and update according to
   // values passed via --spirv-ext option in parseSPVExtOption function.
@@ -739,7 +1443,7 @@ int main(int Ac, char **Av) {
   }
 
   if (BIsRepresentation.getNumOccurrences() != 0) {
-    if (!IsReverse) {
+    if (!IsReverse && !IsServe) {
       errs() << "Note: --spirv-target-env option ignored as it only "
                 "affects translation from SPIR-V to LLVM IR";
     } else {
@@ -750,7 +1454,7 @@ int main(int Ac, char **Av) {
   Opts.setFPContractMode(FPCMode);
 
   if (SPIRVBuiltinFormat.getNumOccurrences() != 0) {
-    if (!IsReverse) {
+    if (!IsReverse && !IsServe) {
       errs() << "Note: --spirv-builtin-format option ignored as it only "
                 "affects translation from SPIR-V to LLVM IR";
     } else {
@@ -760,9 +1464,11 @@ int main(int Ac, char **Av) {
 
   if (SPIRVMemToReg)
     Opts.setMemToRegEnabled(SPIRVMemToReg);
+  if (SPIRVFusedLowering)
+    Opts.setFusedLoweringEnabled(SPIRVFusedLowering);
   if (SPIRVGenKernelArgNameMD)
     Opts.setGenKernelArgNameMDEnabled(SPIRVGenKernelArgNameMD);
-  if (IsReverse && !SpecConst.empty()) {
+  if ((IsReverse || SpecConstPatch) && !SpecConst.empty()) {
     if (parseSpecConstOpt(SpecConst, Opts))
       return -1;
   }
@@ -820,6 +1526,116 @@ int main(int Ac, char **Av) {
   if (PreserveOCLKernelArgTypeMetadataThroughString.getNumOccurrences() != 0)
     Opts.setPreserveOCLKernelArgTypeMetadataThroughString(true);
 
+  if (!SPIRVCacheDir.empty())
+    TransCache = std::make_unique<SPIRV::TranslationCache>(SPIRVCacheDir,
+                                                           SPIRVCacheMaxSize);
+
+  if (SPIRVTimeReport != TimeReportFormat::None)
+    Opts.setTimeReport(&TimeReport);
+  if (SPIRVMemReport)
+    Opts.setMemoryReport(&MemoryReport);
+
+  if (IsServe) {
+    if (IsReverse || !BatchFile.empty() || InputFile.getNumOccurrences() ||
+        !OutputFile.empty() || IsRegularization || SpecConstInfo ||
+        SPIRVPrintReport || SPIRVToolsDis || !SpecConst.empty() ||
+        SpecConstPatch || SPIRVMemReport || Link || Strip.getBits()) {
+      errs() << "Cannot use --serve with -r, --batch, --link, --strip, an "
+                "input file, -o, -s, -spec-const, -spec-const-info, "
+                "-spec-const-patch, -spirv-print-report, -spirv-mem-report or "
+                "-spirv-tools-dis\n";
+      return -1;
+    }
+#ifdef _SPIRV_SUPPORT_TEXT_FMT
+    if (ToText || ToBinary) {
+      errs() << "Cannot use --serve with -to-text or -to-binary\n";
+      return -1;
+    }
+#endif
+    Ret = runServer(Opts, ExtensionsStatus);
+    printStatistics();
+    return Ret;
+  }
+
+  if (!BatchFile.empty()) {
+    if (InputFile.getNumOccurrences() || !OutputFile.empty() ||
+        IsRegularization || SpecConstInfo || SPIRVPrintReport ||
+        SPIRVToolsDis || !SpecConst.empty() || SpecConstPatch ||
+        SPIRVMemReport || Link || Strip.getBits()) {
+      errs() << "Cannot use --batch with --link, --strip, an input file, -o, "
+                "-s, -spec-const, -spec-const-info, -spec-const-patch, "
+                "-spirv-print-report, -spirv-mem-report or -spirv-tools-dis\n";
+      return -1;
+    }
+#ifdef _SPIRV_SUPPORT_TEXT_FMT
+    if (ToText || ToBinary) {
+      errs() << "Cannot use --batch with -to-text or -to-binary\n";
+      return -1;
+    }
+#endif
+    Ret = runBatch(Opts, ExtensionsStatus);
+    printStatistics();
+    return Ret;
+  }
+
+  if (Link) {
+    if (IsReverse || IsRegularization || SpecConstInfo || SPIRVPrintReport ||
+        SPIRVToolsDis || !SpecConst.empty() || SpecConstPatch ||
+        SPIRVMemReport || Strip.getBits()) {
+      errs() << "Cannot use --link with -r, -s, --strip, -spec-const, "
+                "-spec-const-info, -spec-const-patch, -spirv-print-report, "
+                "-spirv-mem-report or -spirv-tools-dis\n";
+      return -1;
+    }
+#ifdef _SPIRV_SUPPORT_TEXT_FMT
+    if (ToText || ToBinary) {
+      errs() << "Cannot use --link with -to-text or -to-binary\n";
+      return -1;
+    }
+#endif
+    return linkSPIRV();
+  }
+
+  if (SpecConstPatch) {
+    if (IsReverse || IsRegularization || SpecConstInfo || SPIRVPrintReport ||
+        SPIRVToolsDis || SPIRVMemReport || Strip.getBits()) {
+      errs() << "Cannot use -spec-const-patch with -r, -s, --strip, "
+                "-spec-const-info, -spirv-print-report, -spirv-mem-report or "
+                "-spirv-tools-dis\n";
+      return -1;
+    }
+#ifdef _SPIRV_SUPPORT_TEXT_FMT
+    if (ToText || ToBinary) {
+      errs() << "Cannot use -spec-const-patch with -to-text or -to-binary\n";
+      return -1;
+    }
+#endif
+    return patchSpecConstants(Opts);
+  }
+
+  if (Strip.getBits()) {
+    if (IsReverse || IsRegularization || SpecConstInfo || SPIRVPrintReport ||
+        SPIRVToolsDis || !SpecConst.empty() || SPIRVMemReport) {
+      errs() << "Cannot use --strip with -r, -s, -spec-const, "
+                "-spec-const-info, -spirv-print-report, -spirv-mem-report "
+                "or -spirv-tools-dis\n";
+      return -1;
+    }
+#ifdef _SPIRV_SUPPORT_TEXT_FMT
+    if (ToText || ToBinary) {
+      errs() << "Cannot use --strip with -to-text or -to-binary\n";
+      return -1;
+    }
+#endif
+    return stripSPIRV();
+  }
+
+  if (!LinkInputFiles.empty()) {
+    errs() << "Only one input file is allowed, use --link to link several "
+              "SPIR-V binaries\n";
+    return -1;
+  }
+
 #ifdef _SPIRV_SUPPORT_TEXT_FMT
   if (ToText && (ToBinary || IsReverse || IsRegularization)) {
     errs() << "Cannot use -to-text with -to-binary, -r, -s\n";
@@ -835,18 +1651,27 @@ int main(int Ac, char **Av) {
     return convertSPIRV();
 #endif
 
-  if (!IsReverse && !IsRegularization && !SpecConstInfo && !SPIRVPrintReport)
-    return convertLLVMToSPIRV(Opts);
+  if (!IsReverse && !IsRegularization && !SpecConstInfo && !SPIRVPrintReport) {
+    Ret = convertLLVMToSPIRV(Opts);
+    printStatistics();
+    return Ret;
+  }
 
   if (IsReverse && IsRegularization) {
     errs() << "Cannot have both -r and -s options\n";
     return -1;
   }
-  if (IsReverse)
-    return convertSPIRVToLLVM(Opts);
+  if (IsReverse) {
+    Ret = convertSPIRVToLLVM(Opts);
+    printStatistics();
+    return Ret;
+  }
 
-  if (IsRegularization)
-    return regularizeLLVM(Opts);
+  if (IsRegularization) {
+    Ret = regularizeLLVM(Opts);
+    printStatistics();
+    return Ret;
+  }
 
   if (SpecConstInfo) {
     std::ifstream IFS(InputFile, std::ios::binary);
@@ -0,0 +1,569 @@
+//===-- spirv-bench.cpp - SPIR-V translation benchmark ----------*- C++ -*-===//
+//
+//
+//                     The LLVM/SPIRV Translator
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+// Copyright (c) 2024 The Khronos Group Inc.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal with the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// Redistributions of source code must retain the above copyright notice,
+// this list of conditions and the following disclaimers.
+// Redistributions in binary form must reproduce the above copyright notice,
+// this list of conditions and the following disclaimers in the documentation
+// and/or other materials provided with the distribution.
+// Neither the names of The Khronos Group, nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// Software without specific prior written permission.
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// CONTRIBUTORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS WITH
+// THE SOFTWARE.
+//
+//===----------------------------------------------------------------------===//
+/// \file
+///
+///  Translation throughput benchmark.
+///
+///  Generates a synthetic LLVM module (many kernels, a deep type graph, a large
+///  constant table, debug info and builtin calls) and measures forward
+///  (LLVM to SPIR-V), reverse (SPIR-V to LLVM) and round-trip translation
+///  through the public writeSpirv/readSpirv API, and decoding of the binary
+///  into a SPIRVModule alone. The peak resident set size is reported for the
+///  whole process, i.e. it is the maximum over the module generation and all
+///  the phases that were run, not a per-phase figure.
+///
+///  Common Usage:
+///  spirv-bench                          - Run with the default workload
+///  spirv-bench --kernels=1024 --json    - Bigger workload, JSON results
+///  spirv-bench --emit-input=x.bc        - Also save the generated module
+///  spirv-bench --pointer-chains=64 --phase=forward
+///                                       - Measure pointer type deduction
+///  spirv-bench --embed-source=1048576 --phase=decode
+///                                       - Decode a module embedding 1 MiB
+///                                         of source text
+///
+//===----------------------------------------------------------------------===//
+
+#include "LLVMSPIRVLib.h"
+#include "SPIRVModule.h"
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Twine.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/IR/DIBuilder.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <chrono>
+#include <optional>
+#include <sstream>
+#include <string>
+
+#if !defined(_WIN32)
+#include <sys/resource.h>
+#endif
+
+using namespace llvm;
+
+static cl::OptionCategory BenchCategory("Workload options");
+
+static cl::opt<unsigned> Kernels("kernels", cl::init(256),
+                                 cl::desc("Number of kernels to generate"),
+                                 cl::cat(BenchCategory));
+
+static cl::opt<unsigned>
+    BodySize("body-size", cl::init(64),
+             cl::desc("Number of arithmetic instructions per kernel"),
+             cl::cat(BenchCategory));
+
+static cl::opt<unsigned>
+    TypeDepth("type-depth", cl::init(32),
+              cl::desc("Nesting depth of the generated struct types"),
+              cl::cat(BenchCategory));
+
+static cl::opt<unsigned>
+    ConstArraySize("const-array-size", cl::init(65536),
+                   cl::desc("Number of elements in the constant table"),
+                   cl::cat(BenchCategory));
+
+static cl::opt<unsigned>
+    BuiltinCalls("builtin-calls", cl::init(32),
+                 cl::desc("Number of OpenCL builtin calls per kernel"),
+                 cl::cat(BenchCategory));
+
+static cl::opt<unsigned> PointerChains(
+    "pointer-chains", cl::init(0),
+    cl::desc("Length of a chain of opaque pointer selects per kernel, typed "
+             "only by the store after it. The forward translation has to "
+             "defer the deduction of every link until the one before it"),
+    cl::cat(BenchCategory));
+
+static cl::opt<bool> DebugInfo("debug-info", cl::init(true),
+                               cl::desc("Attach debug info to every kernel"),
+                               cl::cat(BenchCategory));
+
+static cl::opt<unsigned> EmbedSource(
+    "embed-source", cl::init(0),
+    cl::desc("Size in bytes of the source text embedded in the debug info. "
+             "Uses the non-semantic debug info, which stores the source as "
+             "literal strings"),
+    cl::cat(BenchCategory));
+
+static cl::opt<unsigned> Iterations("iterations", cl::init(5),
+                                    cl::desc("Number of runs of each phase"));
+
+enum class BenchPhase { Forward, Reverse, RoundTrip, Decode, All };
+
+static cl::opt<BenchPhase> Phase(
+    "phase", cl::init(BenchPhase::All), cl::desc("Phase to measure:"),
+    cl::values(clEnumValN(BenchPhase::Forward, "forward", "LLVM to SPIR-V"),
+               clEnumValN(BenchPhase::Reverse, "reverse", "SPIR-V to LLVM"),
+               clEnumValN(BenchPhase::RoundTrip, "roundtrip",
+                          "LLVM to SPIR-V to LLVM"),
+               clEnumValN(BenchPhase::Decode, "decode",
+                          "SPIR-V to SPIRVModule"),
+               clEnumValN(BenchPhase::All, "all", "All of the above")));
+
+static cl::opt<bool> JSONOutput("json",
+                                cl::desc("Print the results as JSON"));
+
+static cl::opt<std::string>
+    EmitInput("emit-input", cl::desc("Save the generated LLVM bitcode"),
+              cl::value_desc("filename"));
+
+static ExitOnError ExitOnErr;
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+struct PhaseResult {
+  const char *Name;
+  unsigned Runs = 0;
+  double MinSeconds = 0;
+  double TotalSeconds = 0;
+
+  explicit PhaseResult(const char *Name) : Name(Name) {}
+  void add(double Seconds) {
+    MinSeconds = Runs ? std::min(MinSeconds, Seconds) : Seconds;
+    TotalSeconds += Seconds;
+    ++Runs;
+  }
+  double getMeanSeconds() const { return Runs ? TotalSeconds / Runs : 0; }
+};
+} // namespace
+
+static double getSecondsSince(Clock::time_point Start) {
+  return std::chrono::duration<double>(Clock::now() - Start).count();
+}
+
+// Returns the peak resident set size of the process so far in bytes, or 0
+// where it cannot be queried. The peak never decreases, so it cannot be
+// attributed to a single phase.
+static uint64_t getPeakRSS() {
+#if defined(_WIN32)
+  return 0;
+#else
+  struct rusage Usage;
+  if (getrusage(RUSAGE_SELF, &Usage))
+    return 0;
+#if defined(__APPLE__)
+  return Usage.ru_maxrss;
+#else
+  return static_cast<uint64_t>(Usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+static Function *getBuiltin(Module &M, StringRef Name, Type *RetTy,
+                            ArrayRef<Type *> ArgTys) {
+  auto *F = cast<Function>(
+      M.getOrInsertFunction(Name, FunctionType::get(RetTy, ArgTys, false))
+          .getCallee());
+  F->setCallingConv(CallingConv::SPIR_FUNC);
+  return F;
+}
+
+static Value *createBuiltinCall(IRBuilder<> &B, Function *F,
+                                ArrayRef<Value *> Args) {
+  CallInst *CI = B.CreateCall(F, Args);
+  CI->setCallingConv(CallingConv::SPIR_FUNC);
+  return CI;
+}
+
+static std::unique_ptr<Module> generateModule(LLVMContext &C) {
+  auto M = std::make_unique<Module>("spirv-bench", C);
+  M->setTargetTriple("spir64-unknown-unknown");
+  M->setDataLayout("e-i64:64-v16:16-v24:32-v32:32-v48:64-v96:128-v192:256-"
+                   "v256:256-v512:512-v1024:1024");
+
+  IRBuilder<> B(C);
+  Type *VoidTy = B.getVoidTy();
+  Type *Int32Ty = B.getInt32Ty();
+  Type *Int64Ty = B.getInt64Ty();
+  Type *FloatTy = B.getFloatTy();
+  Type *GlobalPtrTy = PointerType::get(C, 1);
+
+  M->getOrInsertNamedMetadata("opencl.ocl.version")
+      ->addOperand(MDNode::get(C, {ConstantAsMetadata::get(B.getInt32(2)),
+                                   ConstantAsMetadata::get(B.getInt32(0))}));
+
+  // Each level of the type graph wraps the previous one, so translating the
+  // outermost type has to walk all of them.
+  SmallVector<StructType *, 32> Levels;
+  Type *ElemTy = FloatTy;
+  for (unsigned I = 0; I < TypeDepth; ++I) {
+    StructType *ST = StructType::create(
+        C, {ElemTy, ArrayType::get(Int32Ty, 4), GlobalPtrTy},
+        ("struct.level" + Twine(I)).str());
+    Levels.push_back(ST);
+    ElemTy = ST;
+  }
+
+  unsigned TableSize = std::max(1u, unsigned(ConstArraySize));
+  SmallVector<uint32_t, 0> TableData(TableSize);
+  for (unsigned I = 0; I < TableSize; ++I)
+    TableData[I] = I * 2654435761u;
+  Constant *TableInit = ConstantDataArray::get(C, TableData);
+  auto *Table = new GlobalVariable(
+      *M, TableInit->getType(), /*isConstant=*/true,
+      GlobalValue::InternalLinkage, TableInit, "table", nullptr,
+      GlobalValue::NotThreadLocal, /*AddressSpace=*/2);
+
+  Function *GetGlobalId =
+      getBuiltin(*M, "_Z13get_global_idj", Int64Ty, {Int32Ty});
+  Function *Sqrt = getBuiltin(*M, "_Z4sqrtf", FloatTy, {FloatTy});
+  Function *Max = getBuiltin(*M, "_Z3maxii", Int32Ty, {Int32Ty, Int32Ty});
+  Function *Clz = getBuiltin(*M, "_Z3clzi", Int32Ty, {Int32Ty});
+
+  std::unique_ptr<DIBuilder> DIB;
+  DIFile *File = nullptr;
+  DISubroutineType *KernelDITy = nullptr;
+  if (DebugInfo) {
+    DIB = std::make_unique<DIBuilder>(*M);
+    std::string Source;
+    if (EmbedSource) {
+      // Repeat a line of OpenCL C, so the text is split into many strings
+      // like a real source file.
+      static const char Line[] =
+          "  out[i] = max(clz(in[i]), (int)sqrt((float)table[i % N]));\n";
+      Source.reserve(EmbedSource);
+      while (Source.size() < EmbedSource)
+        Source.append(Line, std::min<size_t>(sizeof(Line) - 1,
+                                             EmbedSource - Source.size()));
+    }
+    File = DIB->createFile(
+        "spirv-bench.cl", "/tmp", std::nullopt,
+        EmbedSource ? std::optional<StringRef>(Source) : std::nullopt);
+    DIB->createCompileUnit(dwarf::DW_LANG_OpenCL, File, "spirv-bench",
+                           /*isOptimized=*/false, "", 0);
+    DIType *IntDITy = DIB->createBasicType("int", 32, dwarf::DW_ATE_signed);
+    DIType *PtrDITy = DIB->createPointerType(IntDITy, 64);
+    KernelDITy = DIB->createSubroutineType(
+        DIB->getOrCreateTypeArray({nullptr, PtrDITy, PtrDITy}));
+    M->addModuleFlag(Module::Warning, "Dwarf Version", 4);
+    M->addModuleFlag(Module::Warning, "Debug Info Version",
+                     DEBUG_METADATA_VERSION);
+  }
+
+  FunctionType *KernelTy =
+      FunctionType::get(VoidTy, {GlobalPtrTy, GlobalPtrTy}, false);
+  for (unsigned K = 0; K < Kernels; ++K) {
+    Function *F = Function::Create(KernelTy, GlobalValue::ExternalLinkage,
+                                   "kernel" + Twine(K), *M);
+    F->setCallingConv(CallingConv::SPIR_KERNEL);
+    B.SetInsertPoint(BasicBlock::Create(C, "entry", F));
+
+    unsigned Line = 1;
+    DISubprogram *SP = nullptr;
+    if (DIB) {
+      SP = DIB->createFunction(File, F->getName(), StringRef(), File, Line,
+                               KernelDITy, Line, DINode::FlagPrototyped,
+                               DISubprogram::SPFlagDefinition);
+      F->setSubprogram(SP);
+    }
+    auto NextLine = [&]() {
+      if (SP)
+        B.SetCurrentDebugLocation(DILocation::get(C, ++Line, 1, SP));
+    };
+
+    NextLine();
+    Value *Id = createBuiltinCall(B, GetGlobalId, {B.getInt32(0)});
+    NextLine();
+    Value *Index = B.CreateURem(Id, B.getInt64(TableSize));
+    Value *V = B.CreateLoad(
+        Int32Ty, B.CreateInBoundsGEP(TableInit->getType(), Table,
+                                     {B.getInt64(0), Index}));
+    if (!Levels.empty()) {
+      NextLine();
+      SmallVector<Value *, 32> Indices(Levels.size() + 1, B.getInt32(0));
+      Indices[0] = B.getInt64(0);
+      Value *Inner = B.CreateLoad(
+          FloatTy, B.CreateInBoundsGEP(Levels.back(), F->getArg(0), Indices));
+      V = B.CreateAdd(V, B.CreateFPToSI(Inner, Int32Ty));
+    }
+    for (unsigned I = 0; I < BodySize; ++I) {
+      NextLine();
+      Value *Operand = B.getInt32(K * BodySize + I + 1);
+      switch (I % 3) {
+      case 0:
+        V = B.CreateAdd(V, Operand);
+        break;
+      case 1:
+        V = B.CreateMul(V, Operand);
+        break;
+      default:
+        V = B.CreateXor(V, Operand);
+        break;
+      }
+    }
+    for (unsigned I = 0; I < BuiltinCalls; ++I) {
+      NextLine();
+      switch (I % 3) {
+      case 0:
+        V = B.CreateFPToSI(
+            createBuiltinCall(B, Sqrt, {B.CreateSIToFP(V, FloatTy)}),
+            Int32Ty);
+        break;
+      case 1:
+        V = createBuiltinCall(B, Max, {V, B.getInt32(I)});
+        break;
+      default:
+        V = B.CreateAdd(V, createBuiltinCall(B, Clz, {V}));
+        break;
+      }
+    }
+    // Every link of the chain selects between the link before it and the
+    // output argument, so its pointee type is only known from the store at
+    // the end. The links are in blocks laid out in reverse order, so each
+    // select is typed before the link it selects from, and the whole chain
+    // is deduced on the deduction stack at once.
+    Value *Out = F->getArg(1);
+    BasicBlock *Prev = nullptr;
+    for (unsigned I = 0; I < PointerChains; ++I) {
+      BasicBlock *Link = BasicBlock::Create(C, "link", F, Prev);
+      B.CreateBr(Link);
+      B.SetInsertPoint(Link);
+      NextLine();
+      Out = B.CreateSelect(B.CreateICmpEQ(V, B.getInt32(I)), Out,
+                           F->getArg(1));
+      Prev = Link;
+    }
+    NextLine();
+    B.CreateStore(V, B.CreateInBoundsGEP(Int32Ty, Out, Id));
+    B.CreateRetVoid();
+  }
+
+  if (DIB)
+    DIB->finalize();
+  return M;
+}
+
+static std::unique_ptr<Module> loadBitcode(LLVMContext &C, StringRef BC) {
+  return ExitOnErr(parseBitcodeFile(MemoryBufferRef(BC, "spirv-bench"), C));
+}
+
+static double runForward(StringRef BC, const SPIRV::TranslatorOpts &Opts,
+                         std::string &SPIRV) {
+  LLVMContext C;
+  std::unique_ptr<Module> M = loadBitcode(C, BC);
+  std::ostringstream OS;
+  std::string Err;
+  Clock::time_point Start = Clock::now();
+  if (!writeSpirv(M.get(), Opts, OS, Err))
+    ExitOnErr(createStringError(inconvertibleErrorCode(),
+                                "Fails to save LLVM as SPIR-V: " + Err));
+  double Seconds = getSecondsSince(Start);
+  SPIRV = OS.str();
+  return Seconds;
+}
+
+static double runReverse(const std::string &SPIRV,
+                         const SPIRV::TranslatorOpts &Opts) {
+  LLVMContext C;
+  std::istringstream IS(SPIRV);
+  Module *RawM = nullptr;
+  std::string Err;
+  Clock::time_point Start = Clock::now();
+  if (!readSpirv(C, Opts, IS, RawM, Err))
+    ExitOnErr(createStringError(inconvertibleErrorCode(),
+                                "Fails to load SPIR-V as LLVM Module: " +
+                                    Err));
+  std::unique_ptr<Module> M(RawM);
+  return getSecondsSince(Start);
+}
+
+static double runRoundTrip(StringRef BC, const SPIRV::TranslatorOpts &Opts) {
+  LLVMContext C;
+  std::unique_ptr<Module> M = loadBitcode(C, BC);
+  std::ostringstream OS;
+  std::string Err;
+  Clock::time_point Start = Clock::now();
+  if (!writeSpirv(M.get(), Opts, OS, Err))
+    ExitOnErr(createStringError(inconvertibleErrorCode(),
+                                "Fails to save LLVM as SPIR-V: " + Err));
+  std::istringstream IS(OS.str());
+  Module *RawM = nullptr;
+  if (!readSpirv(C, Opts, IS, RawM, Err))
+    ExitOnErr(createStringError(inconvertibleErrorCode(),
+                                "Fails to load SPIR-V as LLVM Module: " +
+                                    Err));
+  std::unique_ptr<Module> Back(RawM);
+  return getSecondsSince(Start);
+}
+
+static double runDecode(const std::string &SPIRV,
+                        const SPIRV::TranslatorOpts &Opts) {
+  std::istringstream IS(SPIRV);
+  std::string Err;
+  Clock::time_point Start = Clock::now();
+  std::unique_ptr<SPIRV::SPIRVModule> BM = readSpirvModule(IS, Opts, Err);
+  if (!BM)
+    ExitOnErr(createStringError(inconvertibleErrorCode(),
+                                "Fails to load SPIR-V: " + Err));
+  return getSecondsSince(Start);
+}
+
+static double toMiB(uint64_t Bytes) { return Bytes / (1024.0 * 1024.0); }
+
+static void printText(raw_ostream &OS, ArrayRef<PhaseResult> Results,
+                      size_t BitcodeSize, size_t SPIRVSize, uint64_t PeakRSS) {
+  OS << "spirv-bench: " << Kernels << " kernels, body size " << BodySize
+     << ", type depth " << TypeDepth << ", " << ConstArraySize
+     << " constants, " << BuiltinCalls
+     << " builtin calls per kernel, pointer chains of " << PointerChains
+     << ", debug info " << (DebugInfo ? "on" : "off");
+  if (DebugInfo && EmbedSource)
+    OS << ", " << EmbedSource << " bytes of source";
+  OS << '\n';
+  OS << "  LLVM bitcode: " << BitcodeSize << " bytes\n";
+  OS << "  SPIR-V:       " << SPIRVSize << " bytes\n";
+  OS << "  Process peak RSS: ";
+  if (PeakRSS)
+    OS << format("%.1f MiB\n", toMiB(PeakRSS));
+  else
+    OS << "n/a\n";
+  OS << "  phase       runs    min (s)   mean (s)      MiB/s  kernels/s\n";
+  for (const PhaseResult &R : Results) {
+    double Throughput = R.MinSeconds > 0 ? 1 / R.MinSeconds : 0;
+    OS << format("  %-10s %5u %10.4f %10.4f %10.2f %10.1f\n", R.Name, R.Runs,
+                 R.MinSeconds, R.getMeanSeconds(),
+                 toMiB(SPIRVSize) * Throughput, Kernels * Throughput);
+  }
+}
+
+static void printJSON(raw_ostream &OS, ArrayRef<PhaseResult> Results,
+                      size_t BitcodeSize, size_t SPIRVSize, uint64_t PeakRSS) {
+  json::OStream J(OS, /*IndentSize=*/2);
+  J.object([&] {
+    J.attributeObject("workload", [&] {
+      J.attribute("kernels", int64_t(Kernels));
+      J.attribute("body_size", int64_t(BodySize));
+      J.attribute("type_depth", int64_t(TypeDepth));
+      J.attribute("const_array_size", int64_t(ConstArraySize));
+      J.attribute("builtin_calls", int64_t(BuiltinCalls));
+      J.attribute("pointer_chains", int64_t(PointerChains));
+      J.attribute("debug_info", bool(DebugInfo));
+      J.attribute("embed_source", int64_t(EmbedSource));
+    });
+    J.attribute("bitcode_bytes", int64_t(BitcodeSize));
+    J.attribute("spirv_bytes", int64_t(SPIRVSize));
+    J.attribute("process_peak_rss_bytes", int64_t(PeakRSS));
+    J.attributeArray("phases", [&] {
+      for (const PhaseResult &R : Results)
+        J.object([&] {
+          J.attribute("name", R.Name);
+          J.attribute("runs", int64_t(R.Runs));
+          J.attribute("min_seconds", R.MinSeconds);
+          J.attribute("mean_seconds", R.getMeanSeconds());
+        });
+    });
+  });
+  OS << '\n';
+}
+
+int main(int Ac, char **Av) {
+  InitLLVM X(Ac, Av);
+  ExitOnErr.setBanner(std::string(Av[0]) + ": ");
+  cl::ParseCommandLineOptions(Ac, Av, "SPIR-V translation benchmark");
+
+  SmallVector<char, 0> BitcodeBuf;
+  {
+    LLVMContext C;
+    std::unique_ptr<Module> M = generateModule(C);
+    raw_svector_ostream BCOS(BitcodeBuf);
+    WriteBitcodeToFile(*M, BCOS);
+  }
+  StringRef BC(BitcodeBuf.data(), BitcodeBuf.size());
+
+  if (!EmitInput.empty()) {
+    std::error_code EC;
+    raw_fd_ostream OutOS(EmitInput, EC, sys::fs::OF_None);
+    if (EC)
+      ExitOnErr(errorCodeToError(EC));
+    OutOS << BC;
+  }
+
+  SPIRV::TranslatorOpts Opts;
+  Opts.enableAllExtensions();
+  // Only the non-semantic debug info keeps the source text.
+  if (EmbedSource)
+    Opts.setDebugInfoEIS(
+        SPIRV::DebugInfoEIS::NonSemantic_Shader_DebugInfo_200);
+
+  // The reverse phase needs the SPIR-V even when only it is measured.
+  std::string SPIRV;
+  runForward(BC, Opts, SPIRV);
+
+  unsigned Runs = std::max(1u, unsigned(Iterations));
+  SmallVector<PhaseResult, 4> Results;
+  if (Phase == BenchPhase::Forward || Phase == BenchPhase::All) {
+    PhaseResult &R = Results.emplace_back("forward");
+    for (unsigned I = 0; I < Runs; ++I)
+      R.add(runForward(BC, Opts, SPIRV));
+  }
+  if (Phase == BenchPhase::Reverse || Phase == BenchPhase::All) {
+    PhaseResult &R = Results.emplace_back("reverse");
+    for (unsigned I = 0; I < Runs; ++I)
+      R.add(runReverse(SPIRV, Opts));
+  }
+  if (Phase == BenchPhase::RoundTrip || Phase == BenchPhase::All) {
+    PhaseResult &R = Results.emplace_back("roundtrip");
+    for (unsigned I = 0; I < Runs; ++I)
+      R.add(runRoundTrip(BC, Opts));
+  }
+  if (Phase == BenchPhase::Decode || Phase == BenchPhase::All) {
+    PhaseResult &R = Results.emplace_back("decode");
+    for (unsigned I = 0; I < Runs; ++I)
+      R.add(runDecode(SPIRV, Opts));
+  }
+
+  uint64_t PeakRSS = getPeakRSS();
+  if (JSONOutput)
+    printJSON(outs(), Results, BC.size(), SPIRV.size(), PeakRSS);
+  else
+    printText(outs(), Results, BC.size(), SPIRV.size(), PeakRSS);
+  return 0;
+}